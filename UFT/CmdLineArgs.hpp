@@ -136,5 +136,13 @@ inline std::uint32_t CmdLineArgs::GetValueFromString(const std::string& string)
 		std::strtoul(string.c_str(), nullptr, 10)
 	);
 }
+template<>
+inline double CmdLineArgs::GetValueFromString(const std::string& string)
+{
+	return std::strtod(
+		string.c_str(),
+		nullptr
+	);
+}
 
 #endif // !CMDLINEARGS_HPP
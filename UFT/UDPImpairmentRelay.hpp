@@ -0,0 +1,456 @@
+// -----------------------------------------------------------------------------
+// Date: 10/18/2026
+// -----------------------------------------------------------------------------
+
+#ifndef UDPIMPAIRMENTRELAY_HPP
+#define UDPIMPAIRMENTRELAY_HPP
+
+#include <deque>
+#include <queue>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <condition_variable>
+
+#include <poll.h>
+#include <assert.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+// Forwards UDP datagrams between a local port and a local server port while
+// applying delay, jitter, random loss and a bandwidth cap in both directions.
+// The first peer to send to the local port is treated as the client.
+class UDPImpairmentRelay
+{
+public:
+	struct Settings
+	{
+		std::uint32_t DelayMS      = 0;
+		std::uint32_t JitterMS     = 0;
+		double        LossPercent  = 0;
+		std::uint32_t RateMbps     = 0; // 0 = unlimited
+		std::uint32_t QueuePackets = 0; // 0 = unlimited, only applies with RateMbps; packets waiting to be serialized
+		std::uint32_t Seed         = 1;
+	};
+
+private:
+	typedef std::chrono::steady_clock Clock;
+
+	enum Directions : std::uint8_t
+	{
+		ToServer,
+		ToClient,
+
+		DirectionCount
+	};
+
+	struct Packet
+	{
+		Clock::time_point         Release;
+		std::uint64_t             Sequence;
+		Directions                Direction;
+		std::vector<std::uint8_t> Buffer;
+
+		bool operator > (const Packet& packet) const
+		{
+			return (Release > packet.Release) || ((Release == packet.Release) && (Sequence > packet.Sequence));
+		}
+	};
+
+	Settings                settings;
+
+	int                     clientSocket = -1;
+	int                     serverSocket = -1;
+
+	sockaddr_in             clientAddress;
+	bool                    isClientAddressKnown = false;
+
+	std::atomic<bool>       isRunning;
+
+	std::thread             receiveThread;
+	std::thread             sendThread;
+
+	std::mutex              queueMutex;
+	std::condition_variable queueCondition;
+	std::priority_queue<Packet, std::vector<Packet>, std::greater<Packet>> queue;
+	std::uint64_t           queueSequence = 0;
+	Clock::time_point       linkFreeAt[DirectionCount];
+	// serialization end times of the packets waiting for the bottleneck, propagating packets are not counted
+	std::deque<Clock::time_point> linkQueue[DirectionCount];
+
+	std::mt19937            random;
+
+	std::atomic<std::uint64_t> packetsForwarded;
+	std::atomic<std::uint64_t> packetsDropped;
+
+	UDPImpairmentRelay(UDPImpairmentRelay&&) = delete;
+	UDPImpairmentRelay(const UDPImpairmentRelay&) = delete;
+
+public:
+	UDPImpairmentRelay()
+		: isRunning(
+			false
+		),
+		packetsForwarded(
+			0
+		),
+		packetsDropped(
+			0
+		)
+	{
+	}
+
+	virtual ~UDPImpairmentRelay()
+	{
+		Stop();
+	}
+
+	bool IsRunning() const
+	{
+		return isRunning;
+	}
+
+	std::uint64_t GetPacketsForwarded() const
+	{
+		return packetsForwarded;
+	}
+
+	std::uint64_t GetPacketsDropped() const
+	{
+		return packetsDropped;
+	}
+
+	// @return 0 on error
+	std::uint16_t GetLocalPort() const
+	{
+		sockaddr_in address;
+		socklen_t addressSize = sizeof(address);
+
+		if (getsockname(clientSocket, (sockaddr*)&address, &addressSize) == -1)
+		{
+
+			return 0;
+		}
+
+		return ntohs(address.sin_port);
+	}
+
+	// @param localPort 0 to bind an ephemeral port
+	bool Start(std::uint16_t localPort, std::uint16_t serverPort, const Settings& value)
+	{
+		assert(!IsRunning());
+
+		settings = value;
+
+		random.seed(
+			settings.Seed
+		);
+
+		sockaddr_in addr = { 0 };
+		addr.sin_family = AF_INET;
+		addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+		if ((clientSocket = socket(AF_INET, SOCK_DGRAM, 0)) == -1)
+		{
+
+			return false;
+		}
+
+		addr.sin_port = htons(localPort);
+
+		if (bind(clientSocket, (const sockaddr*)&addr, sizeof(addr)) == -1)
+		{
+			CloseSockets();
+
+			return false;
+		}
+
+		if ((serverSocket = socket(AF_INET, SOCK_DGRAM, 0)) == -1)
+		{
+			CloseSockets();
+
+			return false;
+		}
+
+		addr.sin_port = htons(serverPort);
+
+		if (connect(serverSocket, (const sockaddr*)&addr, sizeof(addr)) == -1)
+		{
+			CloseSockets();
+
+			return false;
+		}
+
+		isClientAddressKnown = false;
+
+		for (auto& value : linkFreeAt)
+		{
+
+			value = Clock::now();
+		}
+
+		for (auto& value : linkQueue)
+		{
+
+			value.clear();
+		}
+
+		isRunning = true;
+
+		receiveThread = std::thread(
+			[this]()
+			{
+				ReceiveThreadProc();
+			}
+		);
+
+		sendThread = std::thread(
+			[this]()
+			{
+				SendThreadProc();
+			}
+		);
+
+		return true;
+	}
+
+	void Stop()
+	{
+		if (isRunning.exchange(false))
+		{
+			queueCondition.notify_all();
+
+			receiveThread.join();
+			sendThread.join();
+
+			CloseSockets();
+		}
+	}
+
+private:
+	void CloseSockets()
+	{
+		if (clientSocket != -1)
+		{
+			close(clientSocket);
+
+			clientSocket = -1;
+		}
+
+		if (serverSocket != -1)
+		{
+			close(serverSocket);
+
+			serverSocket = -1;
+		}
+	}
+
+	void ReceiveThreadProc()
+	{
+		std::uint8_t buffer[0xFFFF];
+
+		pollfd fds[2];
+		fds[0].fd = clientSocket;
+		fds[0].events = POLLIN;
+		fds[1].fd = serverSocket;
+		fds[1].events = POLLIN;
+
+		while (IsRunning())
+		{
+			if (poll(fds, 2, 50) <= 0)
+			{
+
+				continue;
+			}
+
+			if (fds[0].revents & POLLIN)
+			{
+				sockaddr_in address;
+				socklen_t addressSize = sizeof(address);
+
+				auto bytesReceived = recvfrom(clientSocket, buffer, sizeof(buffer), 0, (sockaddr*)&address, &addressSize);
+
+				if (bytesReceived > 0)
+				{
+					{
+						std::lock_guard<std::mutex> lock(
+							queueMutex
+						);
+
+						clientAddress = address;
+						isClientAddressKnown = true;
+					}
+
+					Enqueue(ToServer, buffer, static_cast<std::size_t>(bytesReceived));
+				}
+			}
+
+			if (fds[1].revents & POLLIN)
+			{
+				auto bytesReceived = recv(serverSocket, buffer, sizeof(buffer), 0);
+
+				if (bytesReceived > 0)
+				{
+
+					Enqueue(ToClient, buffer, static_cast<std::size_t>(bytesReceived));
+				}
+			}
+		}
+	}
+
+	void SendThreadProc()
+	{
+		std::vector<Packet> due;
+
+		std::unique_lock<std::mutex> lock(
+			queueMutex
+		);
+
+		while (IsRunning())
+		{
+			if (queue.empty())
+			{
+				queueCondition.wait_for(
+					lock,
+					std::chrono::milliseconds(50)
+				);
+
+				continue;
+			}
+
+			if (queue.top().Release > Clock::now())
+			{
+				queueCondition.wait_until(
+					lock,
+					queue.top().Release
+				);
+
+				continue;
+			}
+
+			// take every due packet, then send them without the lock so the receive thread is not held up
+			for (auto now = Clock::now(); !queue.empty() && (queue.top().Release <= now); queue.pop())
+			{
+				due.push_back(
+					queue.top()
+				);
+			}
+
+			auto address = clientAddress;
+
+			lock.unlock();
+
+			for (auto& packet : due)
+			{
+				switch (packet.Direction)
+				{
+					case ToServer:
+						send(serverSocket, &packet.Buffer[0], packet.Buffer.size(), 0);
+						break;
+
+					case ToClient:
+						sendto(clientSocket, &packet.Buffer[0], packet.Buffer.size(), 0, (const sockaddr*)&address, sizeof(address));
+						break;
+
+					default:
+						break;
+				}
+
+				++packetsForwarded;
+			}
+
+			due.clear();
+
+			lock.lock();
+		}
+	}
+
+	void Enqueue(Directions direction, const std::uint8_t* lpBuffer, std::size_t size)
+	{
+		std::lock_guard<std::mutex> lock(
+			queueMutex
+		);
+
+		if ((direction == ToClient) && !isClientAddressKnown)
+		{
+
+			return;
+		}
+
+		if ((settings.LossPercent > 0) && (std::uniform_real_distribution<double>(0, 100)(random) < settings.LossPercent))
+		{
+			++packetsDropped;
+
+			return;
+		}
+
+		auto now = Clock::now();
+		auto release = now;
+
+		if (settings.RateMbps)
+		{
+			while (!linkQueue[direction].empty() && (linkQueue[direction].front() <= now))
+			{
+
+				linkQueue[direction].pop_front();
+			}
+
+			if (settings.QueuePackets && (linkQueue[direction].size() >= settings.QueuePackets))
+			{
+				++packetsDropped;
+
+				return;
+			}
+
+			// serialize behind the previous packet on the same link
+			auto serializationTime = std::chrono::nanoseconds(
+				(static_cast<std::uint64_t>(size) * 8 * 1000) / settings.RateMbps
+			);
+
+			if (linkFreeAt[direction] < now)
+			{
+
+				linkFreeAt[direction] = now;
+			}
+
+			linkFreeAt[direction] += serializationTime;
+			linkQueue[direction].push_back(
+				linkFreeAt[direction]
+			);
+
+			release = linkFreeAt[direction];
+		}
+
+		release += std::chrono::milliseconds(
+			settings.DelayMS
+		);
+
+		if (settings.JitterMS)
+		{
+
+			release += std::chrono::microseconds(
+				std::uniform_int_distribution<std::uint32_t>(0, settings.JitterMS * 1000)(random)
+			);
+		}
+
+		Packet packet;
+		packet.Release = release;
+		packet.Sequence = queueSequence++;
+		packet.Direction = direction;
+		packet.Buffer.assign(lpBuffer, lpBuffer + size);
+
+		queue.push(
+			std::move(packet)
+		);
+
+		queueCondition.notify_one();
+	}
+};
+
+#endif // !UDPIMPAIRMENTRELAY_HPP
@@ -54,6 +54,48 @@ public:
 
 		return true;
 	}
+
+	// starts connecting without waiting for the handshake, so many clients can connect at once
+	// add GetSocket() to a UFTSocket_Poller for write and call EndConnect when it is reported
+	bool BeginConnect(std::uint32_t host, std::uint16_t port)
+	{
+		assert(!IsConnected());
+		assert(!GetSocket().IsConnecting());
+
+		if (!GetSocket().IsOpen() && !GetSocket().Open())
+		{
+
+			return false;
+		}
+
+		return GetSocket().BeginConnect(
+			host,
+			port
+		);
+	}
+
+	// @return 1 if connected
+	// @return 0 if still connecting
+	// @return -1 if the connection timed out or was rejected; the socket has left its poller
+	std::int32_t EndConnect()
+	{
+		std::int32_t result;
+
+		if ((result = GetSocket().EndConnect()) != 1)
+		{
+
+			return result;
+		}
+
+		if (!GetSocket().SetBlocking(false))
+		{
+			GetSocket().Disconnect();
+
+			return -1;
+		}
+
+		return 1;
+	}
 };
 
 #endif
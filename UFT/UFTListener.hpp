@@ -66,6 +66,38 @@ public:
 		return true;
 	}
 
+	// takes up to count queued connections at once, e.g. when clients reconnect after a restart
+	// accepted sockets inherit the blocking mode from the listener
+	// @return number of sessions connected
+	std::uint32_t Accept(UFTSession** lpSessions, std::uint32_t count)
+	{
+		assert(IsListening());
+
+		UFTSocket* sockets[64];
+
+		if (count > (sizeof(sockets) / sizeof(UFTSocket*)))
+		{
+
+			count = sizeof(sockets) / sizeof(UFTSocket*);
+		}
+
+		for (std::uint32_t i = 0; i < count; ++i)
+		{
+			if (lpSessions[i]->IsConnected())
+			{
+
+				lpSessions[i]->Disconnect();
+			}
+
+			sockets[i] = &lpSessions[i]->GetSocket();
+		}
+
+		return GetSocket().Accept(
+			sockets,
+			count
+		);
+	}
+
 	bool Listen(std::uint32_t host, std::uint16_t port, std::uint32_t backlog)
 	{
 		assert(!IsListening());
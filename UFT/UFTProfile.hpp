@@ -0,0 +1,189 @@
+// -----------------------------------------------------------------------------
+// Date: 10/18/2026
+// -----------------------------------------------------------------------------
+
+#ifndef UFTPROFILE_HPP
+#define UFTPROFILE_HPP
+
+#include "UFTSocket.hpp"
+
+#include <string>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+
+// Socket configuration written by uft_tune and loaded by uft_client and uft_server with
+// --profile. One "key=value" per line, '#' starts a comment, missing keys keep the UDT default:
+//   cc=bbr
+//   mss=8900
+//   fc=25600
+//   udt-sndbuf=67108864
+//   udt-rcvbuf=67108864
+//   udp-sndbuf=8388608
+//   udp-rcvbuf=8388608
+struct UFTProfile
+{
+	UFTSOCKET_CONGESTION_CONTROLS CongestionControl = UFTSOCKET_CONGESTION_CONTROL_UDT;
+	UFTSocket_Options             Options;
+};
+
+struct UFTProfile_Key
+{
+	const char*                      lpName;
+	std::int32_t UFTSocket_Options::* lpOption;
+};
+
+static constexpr UFTProfile_Key UFTPROFILE_KEYS[] =
+{
+	{ "mss",        &UFTSocket_Options::MSS },
+	{ "fc",         &UFTSocket_Options::FlowWindow },
+	{ "udt-sndbuf", &UFTSocket_Options::UDTSendBuffer },
+	{ "udt-rcvbuf", &UFTSocket_Options::UDTReceiveBuffer },
+	{ "udp-sndbuf", &UFTSocket_Options::UDPSendBuffer },
+	{ "udp-rcvbuf", &UFTSocket_Options::UDPReceiveBuffer }
+};
+
+// @return false if the file could not be read or contains an unknown key or an invalid value
+inline bool UFTProfile_Load(const char* lpPath, UFTProfile& profile)
+{
+	std::ifstream fStream(
+		lpPath
+	);
+
+	if (!fStream.is_open())
+	{
+
+		return false;
+	}
+
+	UFTProfile value;
+	std::string line;
+
+	while (std::getline(fStream, line))
+	{
+		auto comment = line.find('#');
+
+		if (comment != std::string::npos)
+		{
+
+			line.erase(comment);
+		}
+
+		auto first = line.find_first_not_of(" \t\r");
+
+		if (first == std::string::npos)
+		{
+
+			continue;
+		}
+
+		auto last = line.find_last_not_of(" \t\r");
+		auto separator = line.find('=');
+
+		if ((separator == std::string::npos) || (separator < first) || (separator >= last))
+		{
+
+			return false;
+		}
+
+		std::string key(
+			line,
+			first,
+			line.find_last_not_of(" \t", separator - 1) + 1 - first
+		);
+
+		std::string data(
+			line,
+			line.find_first_not_of(" \t", separator + 1),
+			std::string::npos
+		);
+
+		data.erase(
+			data.find_last_not_of(" \t\r") + 1
+		);
+
+		if (!key.compare("cc"))
+		{
+			if (!UFTSOCKET_CONGESTION_CONTROLS_FromString(data.c_str(), value.CongestionControl))
+			{
+
+				return false;
+			}
+
+			continue;
+		}
+
+		std::int32_t* lpOption = nullptr;
+
+		for (auto& profileKey : UFTPROFILE_KEYS)
+		{
+			if (!key.compare(profileKey.lpName))
+			{
+
+				lpOption = &(value.Options.*profileKey.lpOption);
+			}
+		}
+
+		char* lpEnd;
+		long number = std::strtol(data.c_str(), &lpEnd, 10);
+
+		if (!lpOption || (*lpEnd != '\0') || (number < 0) || (number > INT32_MAX))
+		{
+
+			return false;
+		}
+
+		*lpOption = static_cast<std::int32_t>(
+			number
+		);
+	}
+
+	if (fStream.bad())
+	{
+
+		return false;
+	}
+
+	profile = value;
+
+	return true;
+}
+
+// @param lpComment written as a comment at the top of the file, may be nullptr
+// @return false if the file could not be written
+inline bool UFTProfile_Save(const char* lpPath, const UFTProfile& profile, const char* lpComment)
+{
+	std::ofstream fStream(
+		lpPath,
+		std::ios::trunc
+	);
+
+	if (!fStream.is_open())
+	{
+
+		return false;
+	}
+
+	if (lpComment)
+	{
+
+		fStream << "# " << lpComment << '\n';
+	}
+
+	fStream << "cc=" << UFTSOCKET_CONGESTION_CONTROLS_ToString(profile.CongestionControl) << '\n';
+
+	for (auto& profileKey : UFTPROFILE_KEYS)
+	{
+		if (auto optionValue = profile.Options.*profileKey.lpOption)
+		{
+
+			fStream << profileKey.lpName << '=' << optionValue << '\n';
+		}
+	}
+
+	fStream.flush();
+
+	return fStream.good();
+}
+
+#endif // !UFTPROFILE_HPP
@@ -6,13 +6,16 @@
 #ifndef UFTSESSION_HPP
 #define UFTSESSION_HPP
 
+#include "UFTTrace.hpp"
 #include "UFTSocket.hpp"
 #include "ByteBuffer.hpp"
 #include "BitConverter.hpp"
 
 #include <list>
+#include <chrono>
 #include <string>
 #include <vector>
+#include <cstdio>
 #include <fstream>
 #include <sstream>
 
@@ -49,11 +52,16 @@
 		#include <Windows.h>
 	#endif
 #else
+	#include <fcntl.h>
 	#include <dirent.h>
 
 	#include <sys/stat.h>
 #endif
 
+#if defined(WIN32) || defined(_WIN32)
+	#include <sys/utime.h>
+#endif
+
 struct UFTSession_FileListEntry
 {
 	std::string   Path;
@@ -95,6 +103,66 @@ struct UFTSession_FileListEntry
 
 typedef std::vector<UFTSession_FileListEntry> UFTSession_FileList;
 
+struct UFTSession_Stats
+{
+	std::uint64_t FilesTransmitted      = 0; // including skipped
+	std::uint64_t FilesSkipped          = 0;
+
+	std::uint64_t ChunksSent            = 0;
+	std::uint64_t ChunksReceived        = 0;
+	std::uint64_t ChunksSkipped         = 0; // hash matched
+
+	std::uint64_t BytesRead             = 0; // from disk
+	std::uint64_t BytesWritten          = 0; // to disk
+	std::uint64_t BytesHashed           = 0;
+	std::uint64_t BytesCompressed       = 0; // before compression
+	std::uint64_t BytesCompressedOutput = 0; // after compression
+	std::uint64_t BytesDecompressed     = 0; // after decompression
+	std::uint64_t BytesSent             = 0; // to socket
+	std::uint64_t BytesReceived         = 0; // from socket
+
+	std::uint64_t TimeDiskReadUS        = 0;
+	std::uint64_t TimeDiskWriteUS       = 0;
+	std::uint64_t TimeHashUS            = 0;
+	std::uint64_t TimeCompressUS        = 0;
+	std::uint64_t TimeDecompressUS      = 0;
+	std::uint64_t TimeSendUS            = 0; // blocked in socket send
+	std::uint64_t TimeReceiveUS         = 0; // blocked in socket receive
+	std::uint64_t TimeTotalUS           = 0;
+
+	double GetCompressionRatio() const
+	{
+		return BytesCompressedOutput ? (static_cast<double>(BytesCompressed) / BytesCompressedOutput) : 0.0;
+	}
+
+	UFTSession_Stats& operator += (const UFTSession_Stats& stats)
+	{
+		FilesTransmitted += stats.FilesTransmitted;
+		FilesSkipped += stats.FilesSkipped;
+		ChunksSent += stats.ChunksSent;
+		ChunksReceived += stats.ChunksReceived;
+		ChunksSkipped += stats.ChunksSkipped;
+		BytesRead += stats.BytesRead;
+		BytesWritten += stats.BytesWritten;
+		BytesHashed += stats.BytesHashed;
+		BytesCompressed += stats.BytesCompressed;
+		BytesCompressedOutput += stats.BytesCompressedOutput;
+		BytesDecompressed += stats.BytesDecompressed;
+		BytesSent += stats.BytesSent;
+		BytesReceived += stats.BytesReceived;
+		TimeDiskReadUS += stats.TimeDiskReadUS;
+		TimeDiskWriteUS += stats.TimeDiskWriteUS;
+		TimeHashUS += stats.TimeHashUS;
+		TimeCompressUS += stats.TimeCompressUS;
+		TimeDecompressUS += stats.TimeDecompressUS;
+		TimeSendUS += stats.TimeSendUS;
+		TimeReceiveUS += stats.TimeReceiveUS;
+		TimeTotalUS += stats.TimeTotalUS;
+
+		return *this;
+	}
+};
+
 typedef void(*UFTSession_OnSendProgress)(std::uint64_t bytesSent, std::uint64_t fileSize, void* lpParam);
 
 typedef void(*UFTSession_OnReceiveProgress)(std::uint64_t bytesReceived, std::uint64_t fileSize, void* lpParam);
@@ -122,6 +190,8 @@ typedef void(*UFTSession_OnReceiveProgress)(std::uint64_t bytesReceived, std::ui
 		/*auto header_OPCode = BitConverter::NetworkToHost(header.OPCode);*/ \
 		/*auto header_PayloadSize = BitConverter::NetworkToHost(header.PayloadSize);*/ \
 		/*printf("Sent PacketHeader { OPCode: %u, PayloadSize: %llu }\n", header_OPCode, header_PayloadSize);*/ \
+		StatsTimer timer(transferStats.TimeSendUS); \
+		transferStats.BytesSent += bufferSize; \
 		return GetSocket().SendAll(buffer.GetBuffer(), bufferSize); \
 	}()
 
@@ -141,7 +211,15 @@ enum UFTSESSION_ERROR_CODES : std::uint32_t
 	UFTSESSION_ERROR_CODE_FILESYSTEM_OPEN_STREAM_FAILED,
 };
 
-static std::string UFTSESSION_ERROR_CODES_ToString(UFTSESSION_ERROR_CODES errorCode)
+enum UFTSESSION_TRANSMIT_FILE_POLICIES : std::uint8_t
+{
+	// read and hash every chunk on both ends, transmit on mismatch
+	UFTSESSION_TRANSMIT_FILE_POLICY_COMPARE_HASH,
+	// skip the transfer if size and timestamp (including nanoseconds) match
+	UFTSESSION_TRANSMIT_FILE_POLICY_SKIP_UNCHANGED
+};
+
+inline std::string UFTSESSION_ERROR_CODES_ToString(UFTSESSION_ERROR_CODES errorCode)
 {
 	switch (errorCode)
 	{
@@ -173,6 +251,59 @@ static std::string UFTSESSION_ERROR_CODES_ToString(UFTSESSION_ERROR_CODES errorC
 	);
 }
 
+inline std::string UFTSession_Stats_ToJSON(const UFTSession_Stats& stats, const UFTSocket_Performance& performance)
+{
+	char buffer[2048];
+
+	snprintf(
+		buffer,
+		sizeof(buffer),
+		"{\"files_transmitted\": %llu, \"files_skipped\": %llu, "
+		"\"chunks_sent\": %llu, \"chunks_received\": %llu, \"chunks_skipped\": %llu, "
+		"\"bytes_read\": %llu, \"bytes_written\": %llu, \"bytes_hashed\": %llu, \"bytes_compressed\": %llu, \"bytes_compressed_output\": %llu, \"bytes_decompressed\": %llu, \"bytes_sent\": %llu, \"bytes_received\": %llu, "
+		"\"compression_ratio\": %.3f, "
+		"\"time_disk_read_us\": %llu, \"time_disk_write_us\": %llu, \"time_hash_us\": %llu, \"time_compress_us\": %llu, \"time_decompress_us\": %llu, \"time_send_us\": %llu, \"time_receive_us\": %llu, \"time_total_us\": %llu, "
+		"\"udt\": {\"timestamp_ms\": %lld, \"packets_sent\": %lld, \"packets_received\": %lld, \"packets_send_lost\": %d, \"packets_receive_lost\": %d, \"packets_retransmitted\": %d, \"send_duration_us\": %lld, \"send_period_us\": %.3f, \"flow_window\": %d, \"congestion_window\": %d, \"flight_size\": %d, \"rtt_ms\": %.3f, \"bandwidth_mbps\": %.3f}}",
+		static_cast<unsigned long long>(stats.FilesTransmitted),
+		static_cast<unsigned long long>(stats.FilesSkipped),
+		static_cast<unsigned long long>(stats.ChunksSent),
+		static_cast<unsigned long long>(stats.ChunksReceived),
+		static_cast<unsigned long long>(stats.ChunksSkipped),
+		static_cast<unsigned long long>(stats.BytesRead),
+		static_cast<unsigned long long>(stats.BytesWritten),
+		static_cast<unsigned long long>(stats.BytesHashed),
+		static_cast<unsigned long long>(stats.BytesCompressed),
+		static_cast<unsigned long long>(stats.BytesCompressedOutput),
+		static_cast<unsigned long long>(stats.BytesDecompressed),
+		static_cast<unsigned long long>(stats.BytesSent),
+		static_cast<unsigned long long>(stats.BytesReceived),
+		stats.GetCompressionRatio(),
+		static_cast<unsigned long long>(stats.TimeDiskReadUS),
+		static_cast<unsigned long long>(stats.TimeDiskWriteUS),
+		static_cast<unsigned long long>(stats.TimeHashUS),
+		static_cast<unsigned long long>(stats.TimeCompressUS),
+		static_cast<unsigned long long>(stats.TimeDecompressUS),
+		static_cast<unsigned long long>(stats.TimeSendUS),
+		static_cast<unsigned long long>(stats.TimeReceiveUS),
+		static_cast<unsigned long long>(stats.TimeTotalUS),
+		static_cast<long long>(performance.TimestampMS),
+		static_cast<long long>(performance.PacketsSent),
+		static_cast<long long>(performance.PacketsReceived),
+		performance.PacketsSendLost,
+		performance.PacketsRecvLost,
+		performance.PacketsRetransmitted,
+		static_cast<long long>(performance.SendDurationUS),
+		performance.SendPeriodUS,
+		performance.FlowWindow,
+		performance.CongestionWindow,
+		performance.FlightSize,
+		performance.RTTMS,
+		performance.BandwidthMbps
+	);
+
+	return buffer;
+}
+
 class UFTSession
 {
 	static constexpr std::size_t  FILE_CHUNK_SIZE              = 1 * (1024 * 1024);  // 1MB
@@ -233,6 +364,7 @@ class UFTSession
 		String8       Path;
 		std::uint64_t Size;
 		std::uint32_t Timestamp;
+		std::uint32_t TimestampNS;
 
 		FileInfo()
 			: Size(
@@ -240,6 +372,9 @@ class UFTSession
 			),
 			Timestamp(
 				0
+			),
+			TimestampNS(
+				0
 			)
 		{
 		}
@@ -253,6 +388,9 @@ class UFTSession
 			),
 			Timestamp(
 				0
+			),
+			TimestampNS(
+				0
 			)
 		{
 		}
@@ -272,8 +410,43 @@ class UFTSession
 
 	typedef std::vector<std::uint8_t> FileChunkBuffer;
 
+	// adds the elapsed time in microseconds to value when destroyed
+	class StatsTimer final
+	{
+		std::uint64_t&                        value;
+		std::chrono::steady_clock::time_point start;
+
+		StatsTimer(StatsTimer&&) = delete;
+		StatsTimer(const StatsTimer&) = delete;
+
+	public:
+		explicit StatsTimer(std::uint64_t& value)
+			: value(
+				value
+			),
+			start(
+				std::chrono::steady_clock::now()
+			)
+		{
+		}
+
+		~StatsTimer()
+		{
+			value += static_cast<std::uint64_t>(
+				std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count()
+			);
+		}
+	};
+
 	UFTSocket socket;
 
+	UFTSession_Stats stats;
+	UFTSession_Stats transferStats;
+	UFTSocket_Performance socketPerformance;
+	std::chrono::steady_clock::time_point transferStatsStart;
+
+	UFTSESSION_TRANSMIT_FILE_POLICIES transmitFilePolicy = UFTSESSION_TRANSMIT_FILE_POLICY_COMPARE_HASH;
+
 	UFTSession(UFTSession&&) = delete;
 	UFTSession(const UFTSession&) = delete;
 
@@ -327,6 +500,51 @@ public:
 		);
 	}
 
+	// must be set before connecting
+	bool SetCongestionControl(UFTSOCKET_CONGESTION_CONTROLS value)
+	{
+		return GetSocket().SetCongestionControl(
+			value
+		);
+	}
+
+	// must be set before connecting
+	bool SetOptions(const UFTSocket_Options& value)
+	{
+		return GetSocket().SetOptions(
+			value
+		);
+	}
+
+	auto GetTransmitFilePolicy() const
+	{
+		return transmitFilePolicy;
+	}
+
+	// @return totals for all completed transfers
+	const UFTSession_Stats& GetStats() const
+	{
+		return stats;
+	}
+
+	// @return the current or most recent transfer
+	const UFTSession_Stats& GetTransferStats() const
+	{
+		return transferStats;
+	}
+
+	// @return UDT performance as of the end of the most recent transfer
+	const UFTSocket_Performance& GetSocketPerformance() const
+	{
+		return socketPerformance;
+	}
+
+	// the policy is sent with each SendFile/ReceiveFile and applied by both ends
+	void SetTransmitFilePolicy(UFTSESSION_TRANSMIT_FILE_POLICIES value)
+	{
+		transmitFilePolicy = value;
+	}
+
 	UFTSESSION_ERROR_CODES Update()
 	{
 		if (!IsConnected())
@@ -417,13 +635,19 @@ public:
 			GetSocket()
 		);
 
-		return TransmitFile(
+		BeginTransferStats();
+
+		auto errorCode = TransmitFile(
 			lpSource,
 			lpDestination,
 			TransmitFileDirections::Up,
 			onProgress,
 			lpParam
 		);
+
+		EndTransferStats(errorCode);
+
+		return errorCode;
 	}
 
 	UFTSESSION_ERROR_CODES ReceiveFile(const char* lpSource, const char* lpDestination)
@@ -453,13 +677,19 @@ public:
 			GetSocket()
 		);
 
-		return TransmitFile(
+		BeginTransferStats();
+
+		auto errorCode = TransmitFile(
 			lpSource,
 			lpDestination,
 			TransmitFileDirections::Down,
 			onProgress,
 			lpParam
 		);
+
+		EndTransferStats(errorCode);
+
+		return errorCode;
 	}
 
 	void Disconnect()
@@ -505,6 +735,31 @@ protected:
 	}
 
 private:
+	void BeginTransferStats()
+	{
+		transferStats = UFTSession_Stats();
+		transferStatsStart = std::chrono::steady_clock::now();
+	}
+
+	void EndTransferStats(UFTSESSION_ERROR_CODES errorCode)
+	{
+		transferStats.TimeTotalUS = static_cast<std::uint64_t>(
+			std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - transferStatsStart).count()
+		);
+
+		if (errorCode == UFTSESSION_ERROR_CODE_SUCCESS)
+		{
+
+			++transferStats.FilesTransmitted;
+		}
+
+		stats += transferStats;
+
+		GetSocket().GetPerformance(
+			socketPerformance
+		);
+	}
+
 	UFTSESSION_ERROR_CODES SendFileList(const char* lpPath)
 	{
 		bool success = true;
@@ -685,14 +940,18 @@ private:
 			break;
 		}
 
+		auto policy = GetTransmitFilePolicy();
+
 		// Send OPCodes::TransmitFile
 		{
-			UFTSession_CreatePacketBuffer(transmitFile, OPCodes::TransmitFile, sizeof(std::uint8_t) + (remoteFileInfo.Path.Length * sizeof(char)) + sizeof(std::uint64_t) + sizeof(std::uint32_t) + sizeof(TransmitFileDirections));
+			UFTSession_CreatePacketBuffer(transmitFile, OPCodes::TransmitFile, sizeof(std::uint8_t) + (remoteFileInfo.Path.Length * sizeof(char)) + sizeof(std::uint64_t) + sizeof(std::uint32_t) + sizeof(std::uint32_t) + sizeof(TransmitFileDirections) + sizeof(UFTSESSION_TRANSMIT_FILE_POLICIES));
 			transmitFile.Write(remoteFileInfo.Path.Length);
 			transmitFile.Write(remoteFileInfo.Path.Buffer, remoteFileInfo.Path.Length);
 			transmitFile.Write(localFileInfo.Size);
 			transmitFile.Write(localFileInfo.Timestamp);
+			transmitFile.Write(localFileInfo.TimestampNS);
 			transmitFile.Write(direction);
+			transmitFile.Write(policy);
 
 			if (UFTSession_SendPacketBuffer(transmitFile) == 0)
 			{
@@ -716,7 +975,8 @@ private:
 			if (!transmitFile.Read(remoteFileInfo.Path.Length) ||
 				!transmitFile.Read(remoteFileInfo.Path.Buffer, remoteFileInfo.Path.Length) ||
 				!transmitFile.Read(remoteFileInfo.Size) ||
-				!transmitFile.Read(remoteFileInfo.Timestamp))
+				!transmitFile.Read(remoteFileInfo.Timestamp) ||
+				!transmitFile.Read(remoteFileInfo.TimestampNS))
 			{
 				Disconnect();
 
@@ -729,10 +989,10 @@ private:
 		switch (direction)
 		{
 			case TransmitFileDirections::Up:
-				return SendFileChunks(localFileInfo, remoteFileInfo, std::move(onProgress), lpParam);
+				return SendFileChunks(localFileInfo, remoteFileInfo, policy, std::move(onProgress), lpParam);
 
 			case TransmitFileDirections::Down:
-				return ReceiveFileChunks(localFileInfo, remoteFileInfo, std::move(onProgress), lpParam);
+				return ReceiveFileChunks(localFileInfo, remoteFileInfo, policy, std::move(onProgress), lpParam);
 		}
 
 		Disconnect();
@@ -740,7 +1000,7 @@ private:
 		return UFTSESSION_ERROR_CODE_NETWORK_API_ERROR;
 	}
 
-	UFTSESSION_ERROR_CODES TransmitFile2(FileInfo& remoteFileInfoLocalPath, TransmitFileDirections direction)
+	UFTSESSION_ERROR_CODES TransmitFile2(FileInfo& remoteFileInfoLocalPath, TransmitFileDirections direction, UFTSESSION_TRANSMIT_FILE_POLICIES policy)
 	{
 		FileInfo localFileInfo;
 
@@ -766,11 +1026,12 @@ private:
 
 		// Send OPCodes::TransmitFile
 		{
-			UFTSession_CreatePacketBuffer(transmitFile, OPCodes::TransmitFile, sizeof(std::uint8_t) + (localFileInfo.Path.Length * sizeof(char)) + sizeof(std::uint64_t) + sizeof(std::uint32_t) + sizeof(TransmitFileDirections));
+			UFTSession_CreatePacketBuffer(transmitFile, OPCodes::TransmitFile, sizeof(std::uint8_t) + (localFileInfo.Path.Length * sizeof(char)) + sizeof(std::uint64_t) + sizeof(std::uint32_t) + sizeof(std::uint32_t) + sizeof(TransmitFileDirections));
 			transmitFile.Write(localFileInfo.Path.Length);
 			transmitFile.Write(localFileInfo.Path.Buffer, localFileInfo.Path.Length);
 			transmitFile.Write(localFileInfo.Size);
 			transmitFile.Write(localFileInfo.Timestamp);
+			transmitFile.Write(localFileInfo.TimestampNS);
 			transmitFile.Write(direction);
 
 			if (UFTSession_SendPacketBuffer(transmitFile) == 0)
@@ -783,10 +1044,10 @@ private:
 		switch (direction)
 		{
 			case TransmitFileDirections::Up:
-				return ReceiveFileChunks(localFileInfo, remoteFileInfoLocalPath, nullptr, nullptr);
+				return ReceiveFileChunks(localFileInfo, remoteFileInfoLocalPath, policy, nullptr, nullptr);
 
 			case TransmitFileDirections::Down:
-				return SendFileChunks(localFileInfo, remoteFileInfoLocalPath, nullptr, nullptr);
+				return SendFileChunks(localFileInfo, remoteFileInfoLocalPath, policy, nullptr, nullptr);
 		}
 
 		Disconnect();
@@ -795,12 +1056,28 @@ private:
 	}
 
 	template<typename F_ON_PROGRESS>
-	UFTSESSION_ERROR_CODES SendFileChunks(const FileInfo& localFileInfo, FileInfo& remoteFileInfo, F_ON_PROGRESS onProgress, void* lpParam)
+	UFTSESSION_ERROR_CODES SendFileChunks(const FileInfo& localFileInfo, FileInfo& remoteFileInfo, UFTSESSION_TRANSMIT_FILE_POLICIES policy, F_ON_PROGRESS onProgress, void* lpParam)
 	{
 		UFTSESSION_ERROR_CODES errorCode;
 
+		// Check if remote file is unchanged - nothing to transmit
+		if (IsFileUnchanged(localFileInfo, remoteFileInfo, policy))
+		{
+			++transferStats.FilesSkipped;
+
+			if constexpr (!std::is_same<F_ON_PROGRESS, std::nullptr_t>::value)
+			{
+
+				onProgress(
+					localFileInfo.Size,
+					localFileInfo.Size,
+					lpParam
+				);
+			}
+		}
+
 		// Check if remote file does not exist or remote is larger than local - transmit file
-		if (((remoteFileInfo.Size == 0) && (remoteFileInfo.Timestamp == 0)) || (remoteFileInfo.Size > localFileInfo.Size))
+		else if (((remoteFileInfo.Size == 0) && (remoteFileInfo.Timestamp == 0)) || (remoteFileInfo.Size > localFileInfo.Size))
 		{
 			std::ifstream fStream(
 				localFileInfo.Path.Buffer,
@@ -827,13 +1104,12 @@ private:
 					static_cast<std::streampos>(fileOffset)
 				);
 
-				fStream.read(
-					reinterpret_cast<char*>(&fileChunkBuffer[0]),
-					fileChunkBuffer.size()
+				std::uint64_t fileChunkBufferSize = ReadFileChunk(
+					fStream,
+					fileChunkBuffer,
+					fileOffset
 				);
 
-				std::uint64_t fileChunkBufferSize = fStream.gcount();
-
 				if ((errorCode = SendFileChunk(compressedFileChunkBuffer, fileChunkBuffer, fileOffset, fileChunkBufferSize)) != UFTSESSION_ERROR_CODE_SUCCESS)
 				{
 
@@ -887,13 +1163,12 @@ private:
 			// Compare to end of remote file - replace on mismatch
 			while (localFileOffset < remoteFileInfo.Size)
 			{
-				fStream.read(
-					reinterpret_cast<char*>(&fileChunkBuffer[0]),
-					fileChunkBuffer.size()
+				localFileChunkSize = ReadFileChunk(
+					fStream,
+					fileChunkBuffer,
+					localFileOffset
 				);
 
-				localFileChunkSize = fStream.gcount();
-
 				if ((errorCode = SendFileChunkHash(localFileChunkHash, fileChunkBuffer, localFileOffset, localFileChunkSize)) != UFTSESSION_ERROR_CODE_SUCCESS)
 				{
 
@@ -929,6 +1204,11 @@ private:
 						remoteFileInfo.Size += (localFileChunkSize - remoteFileChunkSize);
 					}
 				}
+				else
+				{
+
+					++transferStats.ChunksSkipped;
+				}
 
 				localFileOffset += localFileChunkSize;
 
@@ -946,13 +1226,12 @@ private:
 			// Send remaining chunks, if any
 			while (localFileOffset < localFileInfo.Size)
 			{
-				fStream.read(
-					reinterpret_cast<char*>(&fileChunkBuffer[0]),
-					fileChunkBuffer.size()
+				localFileChunkSize = ReadFileChunk(
+					fStream,
+					fileChunkBuffer,
+					localFileOffset
 				);
 
-				localFileChunkSize = fStream.gcount();
-
 				if ((errorCode = SendFileChunk(compressedFileChunkBuffer, fileChunkBuffer, localFileOffset, localFileChunkSize)) != UFTSESSION_ERROR_CODE_SUCCESS)
 				{
 
@@ -977,10 +1256,28 @@ private:
 	}
 
 	template<typename F_ON_PROGRESS>
-	UFTSESSION_ERROR_CODES ReceiveFileChunks(FileInfo& localFileInfo, const FileInfo& remoteFileInfo, F_ON_PROGRESS onProgress, void* lpParam)
+	UFTSESSION_ERROR_CODES ReceiveFileChunks(FileInfo& localFileInfo, const FileInfo& remoteFileInfo, UFTSESSION_TRANSMIT_FILE_POLICIES policy, F_ON_PROGRESS onProgress, void* lpParam)
 	{
 		UFTSESSION_ERROR_CODES errorCode;
 
+		// Check if local file is unchanged - nothing to receive
+		if (IsFileUnchanged(localFileInfo, remoteFileInfo, policy))
+		{
+			++transferStats.FilesSkipped;
+
+			if constexpr (!std::is_same<F_ON_PROGRESS, std::nullptr_t>::value)
+			{
+
+				onProgress(
+					remoteFileInfo.Size,
+					remoteFileInfo.Size,
+					lpParam
+				);
+			}
+
+			return UFTSESSION_ERROR_CODE_SUCCESS;
+		}
+
 		// Check if local file does not exist or local is larger than remote - receive file
 		if (((localFileInfo.Size == 0) && (localFileInfo.Timestamp == 0)) || (localFileInfo.Size > remoteFileInfo.Size))
 		{
@@ -999,15 +1296,22 @@ private:
 				FILE_CHUNK_SIZE
 			);
 
-			FileChunkBuffer compressedFileChunkBuffer(
-				FILE_CHUNK_SIZE_COMPRESSED
-			);
-
 			std::uint64_t fileChunkBufferSize;
 			std::uint64_t fileChunkBufferOffset;
 
-			auto onReceiveFileChunk = [&fStream](const FileChunkBuffer& _buffer, std::uint64_t _offset, std::uint64_t _size)
+			auto onReceiveFileChunk = [this, &fStream](const FileChunkBuffer& _buffer, std::uint64_t _offset, std::uint64_t _size)
 			{
+				UFTTrace_Scope(
+					UFTTRACE_EVENT_WRITE,
+					_offset
+				);
+
+				StatsTimer timer(
+					transferStats.TimeDiskWriteUS
+				);
+
+				transferStats.BytesWritten += _size;
+
 				// TODO: compare offset
 
 				fStream.seekp(
@@ -1024,7 +1328,7 @@ private:
 
 			for (std::uint64_t fileOffset = 0; fileOffset < remoteFileInfo.Size; )
 			{
-				if ((errorCode = ReceiveFileChunk(compressedFileChunkBuffer, fileChunkBuffer, fileChunkBufferOffset, fileChunkBufferSize, onReceiveFileChunk)) != UFTSESSION_ERROR_CODE_SUCCESS)
+				if ((errorCode = ReceiveFileChunk(fileChunkBuffer, fileChunkBufferOffset, fileChunkBufferSize, onReceiveFileChunk)) != UFTSESSION_ERROR_CODE_SUCCESS)
 				{
 
 					return errorCode;
@@ -1062,10 +1366,6 @@ private:
 				FILE_CHUNK_SIZE
 			);
 
-			FileChunkBuffer compressedFileChunkBuffer(
-				FILE_CHUNK_SIZE_COMPRESSED
-			);
-
 			std::uint64_t localFileOffset = 0;
 			std::uint64_t localFileChunkSize;
 			FileChunkHash localFileChunkHash;
@@ -1074,10 +1374,21 @@ private:
 			std::uint64_t remoteFileChunkSize;
 			FileChunkHash remoteFileChunkHash;
 
-			auto onReceiveFileChunk = [&fStream](const FileChunkBuffer& _buffer, std::uint64_t _offset, std::uint64_t _size)
+			auto onReceiveFileChunk = [this, &fStream](const FileChunkBuffer& _buffer, std::uint64_t _offset, std::uint64_t _size)
 			{
 //				printf("Received %llu bytes for offset %llu\n", _size, _offset);
 
+				UFTTrace_Scope(
+					UFTTRACE_EVENT_WRITE,
+					_offset
+				);
+
+				StatsTimer timer(
+					transferStats.TimeDiskWriteUS
+				);
+
+				transferStats.BytesWritten += _size;
+
 				// TODO: compare offset
 
 				fStream.clear();
@@ -1101,13 +1412,12 @@ private:
 					static_cast<std::streampos>(localFileOffset)
 				);
 
-				fStream.read(
-					reinterpret_cast<char*>(&fileChunkBuffer[0]),
-					fileChunkBuffer.size()
+				localFileChunkSize = ReadFileChunk(
+					fStream,
+					fileChunkBuffer,
+					localFileOffset
 				);
 
-				localFileChunkSize = fStream.gcount();
-
 				if ((errorCode = ReceiveFileChunkHash(remoteFileChunkHash, remoteFileOffset, remoteFileChunkSize)) != UFTSESSION_ERROR_CODE_SUCCESS)
 				{
 
@@ -1129,7 +1439,7 @@ private:
 
 				if ((localFileChunkSize != remoteFileChunkSize) || (localFileChunkHash != remoteFileChunkHash))
 				{
-					if ((errorCode = ReceiveFileChunk(compressedFileChunkBuffer, fileChunkBuffer, remoteFileOffset, remoteFileChunkSize, onReceiveFileChunk)) != UFTSESSION_ERROR_CODE_SUCCESS)
+					if ((errorCode = ReceiveFileChunk(fileChunkBuffer, remoteFileOffset, remoteFileChunkSize, onReceiveFileChunk)) != UFTSESSION_ERROR_CODE_SUCCESS)
 					{
 
 						return errorCode;
@@ -1141,6 +1451,11 @@ private:
 						localFileInfo.Size += (remoteFileChunkSize - localFileChunkSize);
 					}
 				}
+				else
+				{
+
+					++transferStats.ChunksSkipped;
+				}
 
 				localFileOffset += remoteFileChunkSize;
 
@@ -1158,7 +1473,7 @@ private:
 			// Receive remaining chunks, if any
 			while (localFileOffset < remoteFileInfo.Size)
 			{
-				if ((errorCode = ReceiveFileChunk(compressedFileChunkBuffer, fileChunkBuffer, remoteFileOffset, remoteFileChunkSize, onReceiveFileChunk)) != UFTSESSION_ERROR_CODE_SUCCESS)
+				if ((errorCode = ReceiveFileChunk(fileChunkBuffer, remoteFileOffset, remoteFileChunkSize, onReceiveFileChunk)) != UFTSESSION_ERROR_CODE_SUCCESS)
 				{
 
 					return errorCode;
@@ -1178,17 +1493,66 @@ private:
 			}
 		}
 
+		// Match the source timestamp so the next transfer may be skipped
+		// failure is not fatal, the file contents are already in place
+		SetFileTimestamp(
+			localFileInfo.Path.Buffer,
+			remoteFileInfo.Timestamp,
+			remoteFileInfo.TimestampNS
+		);
+
 		return UFTSESSION_ERROR_CODE_SUCCESS;
 	}
 
-	UFTSESSION_ERROR_CODES SendFileChunk(FileChunkBuffer& buffer, const FileChunkBuffer& source, std::uint64_t offset, std::uint64_t size)
+	// @return number of bytes read
+	std::uint64_t ReadFileChunk(std::istream& stream, FileChunkBuffer& buffer, std::uint64_t offset)
 	{
-		std::uint64_t compressedSize = CompressFileChunk(
-			buffer,
-			source,
-			size
+		UFTTrace_Scope(
+			UFTTRACE_EVENT_READ,
+			offset
 		);
 
+		StatsTimer timer(
+			transferStats.TimeDiskReadUS
+		);
+
+		stream.read(
+			reinterpret_cast<char*>(&buffer[0]),
+			buffer.size()
+		);
+
+		std::uint64_t bytesRead = stream.gcount();
+
+		transferStats.BytesRead += bytesRead;
+
+		return bytesRead;
+	}
+
+	UFTSESSION_ERROR_CODES SendFileChunk(FileChunkBuffer& buffer, const FileChunkBuffer& source, std::uint64_t offset, std::uint64_t size)
+	{
+		std::uint64_t compressedSize;
+
+		{
+			UFTTrace_Scope(
+				UFTTRACE_EVENT_COMPRESS,
+				offset
+			);
+
+			StatsTimer timer(
+				transferStats.TimeCompressUS
+			);
+
+			compressedSize = CompressFileChunk(
+				buffer,
+				source,
+				size
+			);
+		}
+
+		++transferStats.ChunksSent;
+		transferStats.BytesCompressed += size;
+		transferStats.BytesCompressedOutput += compressedSize;
+
 		// Send OPCodes::TransmitFileChunk
 		{
 			UFTSession_CreatePacketBuffer(transmitFileChunk, OPCodes::TransmitFileChunk, sizeof(std::uint64_t) + sizeof(std::uint64_t) + sizeof(std::uint64_t) + static_cast<std::size_t>(compressedSize));
@@ -1197,6 +1561,11 @@ private:
 			transmitFileChunk.Write(compressedSize);
 			transmitFileChunk.Write(&buffer[0], static_cast<std::size_t>(compressedSize));
 
+			UFTTrace_Scope(
+				UFTTRACE_EVENT_SEND,
+				offset
+			);
+
 			if (UFTSession_SendPacketBuffer(transmitFileChunk) == 0)
 			{
 
@@ -1210,6 +1579,11 @@ private:
 			std::uint32_t          bytesReceived;
 			ByteBuffer             transmitFileChunkResult;
 
+			UFTTrace_Scope(
+				UFTTRACE_EVENT_WAIT_ACK,
+				offset
+			);
+
 			if ((errorCode = ReadPacket(OPCodes::TransmitFileChunkResult, transmitFileChunkResult, bytesReceived, true)) != UFTSESSION_ERROR_CODE_SUCCESS)
 			{
 
@@ -1237,40 +1611,158 @@ private:
 
 	// F = bool(*)(const FileChunkBuffer& buffer, std::uint64_t offset, std::uint64_t size)
 	template<typename F>
-	UFTSESSION_ERROR_CODES ReceiveFileChunk(FileChunkBuffer& buffer, FileChunkBuffer& destination, std::uint64_t& offset, std::uint64_t& size, F&& callback)
+	UFTSESSION_ERROR_CODES ReceiveFileChunk(FileChunkBuffer& destination, std::uint64_t& offset, std::uint64_t& size, F&& callback)
 	{
+		bool isInflated;
+
 		// Receive OPCodes::TransmitFileChunk
 		{
 			UFTSESSION_ERROR_CODES errorCode;
-			std::uint32_t          bytesReceived;
-			ByteBuffer             transmitFileChunk;
+			PacketHeader           packetHeader;
+			ByteBuffer             transmitFileChunk(sizeof(std::uint64_t) + sizeof(std::uint64_t) + sizeof(std::uint64_t));
+			std::uint64_t          compressedSize;
 
-			if ((errorCode = ReadPacket(OPCodes::TransmitFileChunk, transmitFileChunk, bytesReceived, true)) != UFTSESSION_ERROR_CODE_SUCCESS)
 			{
+				UFTTrace_Scope(
+					UFTTRACE_EVENT_RECEIVE,
+					0
+				);
 
-				return errorCode;
+				StatsTimer timer(
+					transferStats.TimeReceiveUS
+				);
+
+				if ((errorCode = ReadPacketHeader(OPCodes::TransmitFileChunk, packetHeader)) != UFTSESSION_ERROR_CODE_SUCCESS)
+				{
+
+					return errorCode;
+				}
+
+				if (packetHeader.PayloadSize < transmitFileChunk.GetCapacity())
+				{
+					Disconnect();
+
+					return UFTSESSION_ERROR_CODE_NETWORK_API_ERROR;
+				}
+
+				if (GetSocket().ReceiveAll(transmitFileChunk.GetBuffer(), static_cast<std::uint32_t>(transmitFileChunk.GetCapacity())) == 0)
+				{
+
+					return UFTSESSION_ERROR_CODE_NETWORK_CONNECTION_LOST;
+				}
+
+				transmitFileChunk.SetOffsetW(
+					transmitFileChunk.GetCapacity()
+				);
+
+				if (!transmitFileChunk.Read(offset) ||
+					!transmitFileChunk.Read(size) ||
+					!transmitFileChunk.Read(compressedSize) ||
+					(compressedSize != (packetHeader.PayloadSize - transmitFileChunk.GetCapacity())) ||
+					(compressedSize > FILE_CHUNK_SIZE_COMPRESSED))
+				{
+					Disconnect();
+
+					return UFTSESSION_ERROR_CODE_NETWORK_API_ERROR;
+				}
+
+				transferStats.BytesReceived += sizeof(PacketHeader) + packetHeader.PayloadSize;
 			}
 
-			std::uint64_t compressedSize;
+			UFTTrace_Scope(
+				UFTTRACE_EVENT_DECOMPRESS,
+				offset
+			);
+
+			// the compressed chunk is inflated straight out of the UDT receive buffer
+			z_stream stream = { 0 };
+			int      inflateStatus = inflateInit(&stream);
+			bool     isInitialized = inflateStatus == Z_OK;
+
+			stream.next_out = reinterpret_cast<Bytef*>(
+				&destination[0]
+			);
+			stream.avail_out = static_cast<uInt>(
+				destination.size()
+			);
+
+			std::uint64_t timeInflateUS = 0;
+			std::uint64_t timeTotalUS = 0;
+			std::int32_t  bytesReceived;
 
-			if (!transmitFileChunk.Read(offset) ||
-				!transmitFileChunk.Read(size) ||
-				!transmitFileChunk.Read(compressedSize) ||
-				!transmitFileChunk.Read(&buffer[0], static_cast<std::size_t>(compressedSize)))
 			{
+				StatsTimer timer(
+					timeTotalUS
+				);
+
+				bytesReceived = GetSocket().ReceiveAllInPlace(
+					static_cast<std::uint32_t>(compressedSize),
+					[&stream, &inflateStatus, &timeInflateUS](const void* _lpBuffer, std::uint32_t _size)
+					{
+						// after an error the rest of the chunk is still consumed so the session stays in sync
+						if (inflateStatus != Z_OK)
+						{
+
+							return true;
+						}
+
+						StatsTimer timer(
+							timeInflateUS
+						);
+
+						stream.next_in = reinterpret_cast<Bytef*>(
+							const_cast<void*>(_lpBuffer)
+						);
+						stream.avail_in = static_cast<uInt>(
+							_size
+						);
+
+						inflateStatus = inflate(&stream, Z_NO_FLUSH);
+
+						// input left over means the output is full or data follows the end of the stream
+						if (((inflateStatus == Z_OK) || (inflateStatus == Z_STREAM_END)) && (stream.avail_in != 0))
+						{
+
+							inflateStatus = Z_DATA_ERROR;
+						}
+
+						return true;
+					}
+				);
+			}
+
+			auto decompressedSize = stream.total_out;
+
+			if (isInitialized)
+			{
+
+				inflateEnd(&stream);
+			}
+
+			isInflated = (inflateStatus == Z_STREAM_END) && (decompressedSize == size);
+
+			transferStats.TimeReceiveUS += timeTotalUS - timeInflateUS;
+			transferStats.TimeDecompressUS += timeInflateUS;
+
+			if (bytesReceived == 0)
+			{
+				if (!GetSocket().IsConnected())
+				{
+
+					return UFTSESSION_ERROR_CODE_NETWORK_CONNECTION_LOST;
+				}
+
 				Disconnect();
 
 				return UFTSESSION_ERROR_CODE_NETWORK_API_ERROR;
 			}
 
-			/*auto decompressedSize = */DecompressFileChunk(
-				destination,
-				buffer,
-				compressedSize
-			);
+			++transferStats.ChunksReceived;
+			transferStats.BytesDecompressed += decompressedSize;
 		}
 		
-		bool success = callback(
+		// a chunk that did not inflate to exactly its size is rejected without writing it
+		bool success = isInflated && callback(
 			destination,
 			offset,
 			size
@@ -1293,10 +1785,23 @@ private:
 
 	UFTSESSION_ERROR_CODES SendFileChunkHash(FileChunkHash& hash, const FileChunkBuffer& buffer, std::uint64_t offset, std::uint64_t size)
 	{
-		hash = CalculateFileChunkHash(
-			buffer,
-			size
-		);
+		{
+			UFTTrace_Scope(
+				UFTTRACE_EVENT_HASH,
+				offset
+			);
+
+			StatsTimer timer(
+				transferStats.TimeHashUS
+			);
+
+			hash = CalculateFileChunkHash(
+				buffer,
+				size
+			);
+		}
+
+		transferStats.BytesHashed += size;
 
 		// Send OPCodes::TransmitFileChunkHash
 		{
@@ -1377,12 +1882,15 @@ private:
 			{
 				FileInfo file;
 				TransmitFileDirections direction;
+				UFTSESSION_TRANSMIT_FILE_POLICIES policy;
 
 				if (!buffer.Read(file.Path.Length) ||
 					!buffer.Read(file.Path.Buffer, file.Path.Length) ||
 					!buffer.Read(file.Size) ||
 					!buffer.Read(file.Timestamp) ||
-					!buffer.Read(direction))
+					!buffer.Read(file.TimestampNS) ||
+					!buffer.Read(direction) ||
+					!buffer.Read(policy))
 				{
 					Disconnect();
 
@@ -1393,7 +1901,17 @@ private:
 
 				UFTSESSION_ERROR_CODES errorCode;
 
-				if ((errorCode = TransmitFile2(file, direction)) != UFTSESSION_ERROR_CODE_SUCCESS)
+				BeginTransferStats();
+
+				errorCode = TransmitFile2(
+					file,
+					direction,
+					policy
+				);
+
+				EndTransferStats(errorCode);
+
+				if (errorCode != UFTSESSION_ERROR_CODE_SUCCESS)
 				{
 
 					return errorCode;
@@ -1415,9 +1933,15 @@ private:
 		UFTSESSION_ERROR_CODES errorCode;
 
 		PacketHeader packetHeader;
+
+		StatsTimer timer(
+			transferStats.TimeReceiveUS
+		);
 		
 		if ((errorCode = ReadNextPacket(packetHeader, buffer, bytesReceived, block)) == UFTSESSION_ERROR_CODE_SUCCESS)
 		{
+			transferStats.BytesReceived += sizeof(PacketHeader) + buffer.GetCapacity();
+
 			if (packetHeader.OPCode != opcode)
 			{
 				Disconnect();
@@ -1431,6 +1955,32 @@ private:
 		return errorCode;
 	}
 
+	// reads only the header, leaving the payload in the socket
+	UFTSESSION_ERROR_CODES ReadPacketHeader(OPCodes opcode, PacketHeader& header)
+	{
+		if (GetSocket().ReceiveAll(&header, sizeof(PacketHeader)) == 0)
+		{
+
+			return UFTSESSION_ERROR_CODE_NETWORK_CONNECTION_LOST;
+		}
+
+		header.OPCode = BitConverter::NetworkToHost(
+			header.OPCode
+		);
+		header.PayloadSize = BitConverter::NetworkToHost(
+			header.PayloadSize
+		);
+
+		if (header.OPCode != opcode)
+		{
+			Disconnect();
+
+			return UFTSESSION_ERROR_CODE_NETWORK_API_ERROR;
+		}
+
+		return UFTSESSION_ERROR_CODE_SUCCESS;
+	}
+
 	UFTSESSION_ERROR_CODES ReadNextPacket(PacketHeader& header, ByteBuffer& buffer, std::uint32_t& bytesReceived, bool block)
 	{
 		std::int32_t _bytesReceived;
@@ -1538,6 +2088,7 @@ private:
 			
 			info.Size = 0;
 			info.Timestamp = 0;
+			info.TimestampNS = 0;
 
 			return -1;
 		}
@@ -1552,10 +2103,61 @@ private:
 
 		info.Size = static_cast<std::uint64_t>(stat.st_size);
 		info.Timestamp = static_cast<std::uint32_t>(stat.st_mtime);
+#if defined(WIN32) || defined(_WIN32)
+		info.TimestampNS = 0;
+#else
+		info.TimestampNS = static_cast<std::uint32_t>(stat.st_mtim.tv_nsec);
+#endif
 
 		return 1;
 	}
 
+	// @return false on error
+	static bool SetFileTimestamp(const char* lpPath, std::uint32_t timestamp, std::uint32_t timestampNS)
+	{
+#if defined(WIN32) || defined(_WIN32)
+		__utimbuf64 times;
+		times.actime = static_cast<__time64_t>(timestamp);
+		times.modtime = static_cast<__time64_t>(timestamp);
+
+		if (_utime64(lpPath, &times) == -1)
+#else
+		timespec times[2];
+		times[0].tv_sec = 0;
+		times[0].tv_nsec = UTIME_OMIT;
+		times[1].tv_sec = static_cast<time_t>(timestamp);
+		times[1].tv_nsec = static_cast<long>(timestampNS);
+
+		if (utimensat(AT_FDCWD, lpPath, times, 0) == -1)
+#endif
+		{
+
+			return false;
+		}
+
+		return true;
+	}
+
+	static bool IsFileUnchanged(const FileInfo& localFileInfo, const FileInfo& remoteFileInfo, UFTSESSION_TRANSMIT_FILE_POLICIES policy)
+	{
+		if (policy != UFTSESSION_TRANSMIT_FILE_POLICY_SKIP_UNCHANGED)
+		{
+
+			return false;
+		}
+
+		// Size and Timestamp are both 0 when the file does not exist
+		if ((localFileInfo.Size == 0) && (localFileInfo.Timestamp == 0))
+		{
+
+			return false;
+		}
+
+		return (localFileInfo.Size == remoteFileInfo.Size) &&
+			(localFileInfo.Timestamp == remoteFileInfo.Timestamp) &&
+			(localFileInfo.TimestampNS == remoteFileInfo.TimestampNS);
+	}
+
 	// @return 0 on error
 	// @return -1 if not found
 	static int GetFilesInPath(const char* path, FileInfoList& files, bool includePathInFileInfo)
@@ -1655,6 +2257,9 @@ private:
 		return 1;
 	}
 
+public:
+	// chunk kernels are public for uft_microbench
+
 	static FileChunkHash CalculateFileChunkHash(const FileChunkBuffer& buffer, std::uint64_t size)
 	{
 		static constexpr FileChunkHash FNV_1a_64_PRIME = 0x100000001B3;
@@ -1708,11 +2313,16 @@ private:
 		return deflatedSize;
 	}
 
-	// @return deflated chunk size
+	// @return inflated chunk size, 0 if the data is corrupt, truncated or does not fit in the buffer
 	static std::uint64_t DecompressFileChunk(FileChunkBuffer& buffer, const FileChunkBuffer& source, std::uint64_t size)
 	{
 		z_stream stream = { 0 };
-		inflateInit(&stream);
+
+		if (inflateInit(&stream) != Z_OK)
+		{
+
+			return 0;
+		}
 
 		stream.next_in = reinterpret_cast<Bytef*>(
 			const_cast<std::uint8_t*>(&source[0])
@@ -1727,12 +2337,18 @@ private:
 			buffer.size()
 		);
 
-		inflate(&stream, Z_FINISH);
+		auto status = inflate(&stream, Z_FINISH);
 
 		auto inflatedSize = stream.total_out;
 
 		inflateEnd(&stream);
 
+		if ((status != Z_STREAM_END) || (stream.avail_in != 0))
+		{
+
+			return 0;
+		}
+
 		return inflatedSize;
 	}
 };
@@ -13,8 +13,11 @@
 #endif
 
 #include <atomic>
+#include <vector>
+#include <unordered_map>
 
 #include <udt.h>
+#include <ccc.h>
 #include <assert.h>
 
 std::atomic<size_t> UDT_Init_RefCount = 0;
@@ -95,16 +98,24 @@ struct UFTSocket::Context
 	bool          IsOpen          = false;
 	bool          IsBlocking      = true;
 	bool          IsConnected     = false;
+	bool          IsConnecting    = false;
 	bool          IsListening     = false;
 
 	std::int32_t  Timeout         = 15 * 1000;
-	
+
+	UFTSOCKET_CONGESTION_CONTROLS CongestionControl = UFTSOCKET_CONGESTION_CONTROL_UDT;
+
+	UFTSocket_Options Options;
+
 	UDTSOCKET     Socket;
 
 	Mutex         IOMutex;
 
 	std::uint16_t RemotePort      = 0;
 	std::uint32_t RemoteAddress   = 0;
+
+	// the UDT id changes when the socket is re-opened, so it leaves its poller on Close
+	UFTSocket_Poller* lpPoller    = nullptr;
 };
 
 UFTSocket::UFTSocket()
@@ -142,6 +153,11 @@ bool UFTSocket::IsConnected() const
 	return lpContext->IsConnected;
 }
 
+bool UFTSocket::IsConnecting() const
+{
+	return lpContext->IsConnecting;
+}
+
 bool UFTSocket::IsListening() const
 {
 	return lpContext->IsListening;
@@ -152,6 +168,16 @@ std::int32_t UFTSocket::GetTimeout() const
 	return lpContext->Timeout;
 }
 
+UFTSOCKET_CONGESTION_CONTROLS UFTSocket::GetCongestionControl() const
+{
+	return lpContext->CongestionControl;
+}
+
+const UFTSocket_Options& UFTSocket::GetOptions() const
+{
+	return lpContext->Options;
+}
+
 std::uint16_t UFTSocket::GetRemotePort() const
 {
 	return lpContext->RemotePort;
@@ -180,7 +206,7 @@ bool UFTSocket::Open()
 	lpContext->IsOpen = true;
 
 	// if the socket was opened, closed and then re-opened this will restore the state
-	if (!SetBlocking(IsBlocking()) || !SetTimeout(GetTimeout()))
+	if (!SetBlocking(IsBlocking()) || !SetTimeout(GetTimeout()) || !SetCongestionControl(GetCongestionControl()) || !SetOptions(GetOptions()))
 	{
 		lpContext->IsOpen = false;
 
@@ -198,13 +224,26 @@ void UFTSocket::Close()
 {
 	if (IsOpen())
 	{
+		if (lpContext->lpPoller)
+		{
+
+			lpContext->lpPoller->Remove(*this);
+		}
+
 		if (IsConnected())
 		{
 
 			Disconnect();
 		}
+		else if (IsListening() || IsConnecting())
+		{
+
+			// also wakes up threads blocked in Accept
+			UDT::close(lpContext->Socket);
+		}
 
 		lpContext->IsOpen = false;
+		lpContext->IsConnecting = false;
 		lpContext->IsListening = false;
 
 		UDT_Cleanup();
@@ -263,6 +302,82 @@ bool UFTSocket::SetTimeout(std::int32_t milliseconds)
 	return true;
 }
 
+bool UFTSocket::SetCongestionControl(UFTSOCKET_CONGESTION_CONTROLS value)
+{
+	if (IsOpen())
+	{
+		int result;
+
+		switch (value)
+		{
+			case UFTSOCKET_CONGESTION_CONTROL_UDT:
+			{
+				CCCFactory<CUDTCC> factory;
+
+				result = UDT::setsockopt(lpContext->Socket, 0, UDT_CC, &factory, sizeof(factory));
+			}
+			break;
+
+			case UFTSOCKET_CONGESTION_CONTROL_BBR:
+			{
+				CCCFactory<CBBRCC> factory;
+
+				result = UDT::setsockopt(lpContext->Socket, 0, UDT_CC, &factory, sizeof(factory));
+			}
+			break;
+
+			default:
+				return false;
+		}
+
+		if (result == UDT::ERROR)
+		{
+//			WriteLastError("UDT::setsockopt");
+
+			return false;
+		}
+	}
+
+	lpContext->CongestionControl = value;
+
+	return true;
+}
+
+bool UFTSocket::SetOptions(const UFTSocket_Options& value)
+{
+	if (IsOpen())
+	{
+		// UDT limits the MSS to the UDP buffers and the receive buffer to the flow window, so the order matters
+		const struct
+		{
+			std::int32_t Option;
+			std::int32_t Value;
+		} options[] =
+		{
+			{ UDP_SNDBUF, value.UDPSendBuffer },
+			{ UDP_RCVBUF, value.UDPReceiveBuffer },
+			{ UDT_MSS,    value.MSS },
+			{ UDT_FC,     value.FlowWindow },
+			{ UDT_SNDBUF, value.UDTSendBuffer },
+			{ UDT_RCVBUF, value.UDTReceiveBuffer }
+		};
+
+		for (auto& option : options)
+		{
+			if (option.Value && (UDT::setsockopt(lpContext->Socket, 0, static_cast<UDTOpt>(option.Option), &option.Value, sizeof(std::int32_t)) == UDT::ERROR))
+			{
+//				WriteLastError("UDT::setsockopt");
+
+				return false;
+			}
+		}
+	}
+
+	lpContext->Options = value;
+
+	return true;
+}
+
 bool UFTSocket::Listen(std::uint32_t host, std::uint16_t port, std::uint32_t backlog)
 {
 	assert(IsOpen());
@@ -311,6 +426,59 @@ bool UFTSocket::Accept(UFTSocket& socket)
 		return false;
 	}
 
+	return AcceptSocket(
+		socket,
+		udtSocket
+	);
+}
+
+// takes up to count queued connections at once
+// waits for the first one if blocking
+// @return number of sockets accepted
+// @return 0 if would block or on error
+std::uint32_t UFTSocket::Accept(UFTSocket** lpSockets, std::uint32_t count)
+{
+	assert(IsOpen());
+	assert(IsListening());
+
+	UDTSOCKET udtSockets[64];
+
+	if (count > (sizeof(udtSockets) / sizeof(UDTSOCKET)))
+	{
+
+		count = sizeof(udtSockets) / sizeof(UDTSOCKET);
+	}
+
+	std::int32_t udtSocketCount;
+
+	if ((udtSocketCount = UDT::acceptBatch(lpContext->Socket, udtSockets, static_cast<std::int32_t>(count))) == UDT::ERROR)
+	{
+		if (UDT::getlasterror().getErrorCode() != CUDTException::EASYNCRCV)
+		{
+
+//			WriteLastError("UDT::acceptBatch");
+		}
+
+		return 0;
+	}
+
+	std::uint32_t acceptedCount = 0;
+
+	for (std::int32_t i = 0; i < udtSocketCount; ++i)
+	{
+		// a connection that was reset before it could be accepted is skipped
+		if (AcceptSocket(*lpSockets[acceptedCount], udtSockets[i]))
+		{
+
+			++acceptedCount;
+		}
+	}
+
+	return acceptedCount;
+}
+
+bool UFTSocket::AcceptSocket(UFTSocket& socket, std::int32_t udtSocket)
+{
 	sockaddr_in address;
 	int addressSize = sizeof(address);
 
@@ -335,6 +503,8 @@ bool UFTSocket::Accept(UFTSocket& socket)
 	socket.lpContext->IsListening = false;
 	socket.lpContext->Socket = udtSocket;
 	socket.lpContext->Timeout = GetTimeout();
+	socket.lpContext->CongestionControl = GetCongestionControl();
+	socket.lpContext->Options = GetOptions();
 	socket.lpContext->RemotePort = ntohs(address.sin_port);
 	socket.lpContext->RemoteAddress = ntohl(address.sin_addr.s_addr);
 
@@ -382,6 +552,95 @@ bool UFTSocket::Connect(std::uint32_t remoteHost, std::uint16_t remotePort)
 	return true;
 }
 
+// starts the handshake without waiting for it, regardless of IsBlocking
+// the socket becomes writable in a UFTSocket_Poller once EndConnect can complete it
+bool UFTSocket::BeginConnect(std::uint32_t remoteHost, std::uint16_t remotePort)
+{
+	assert(IsOpen());
+	assert(!IsConnected());
+	assert(!IsConnecting());
+	assert(!IsListening());
+
+	sockaddr_in addr = { 0 };
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(remotePort);
+	addr.sin_addr.s_addr = htonl(remoteHost);
+
+	// UDT connects in the background when receiving is non-blocking
+	bool isSynRecving = false;
+
+	if (IsBlocking() && (UDT::setsockopt(lpContext->Socket, 0, UDT_RCVSYN, &isSynRecving, sizeof(bool)) == UDT::ERROR))
+	{
+//		WriteLastError("UDT::setsockopt");
+
+		return false;
+	}
+
+	if (UDT::connect(lpContext->Socket, (sockaddr*)&addr, sizeof(addr)) == UDT::ERROR)
+	{
+//		WriteLastError("UDT::connect");
+
+		if (IsBlocking())
+		{
+			isSynRecving = true;
+
+			UDT::setsockopt(lpContext->Socket, 0, UDT_RCVSYN, &isSynRecving, sizeof(bool));
+		}
+
+		return false;
+	}
+
+	lpContext->IsConnecting = true;
+
+	lpContext->RemotePort = remotePort;
+	lpContext->RemoteAddress = remoteHost;
+
+	return true;
+}
+
+// a failed socket is replaced by a new one, so it can connect again like after a failed Connect
+// @return 1 if connected
+// @return 0 if still connecting
+// @return -1 if the connection timed out or was rejected
+std::int32_t UFTSocket::EndConnect()
+{
+	assert(IsOpen());
+	assert(IsConnecting());
+
+	UDTSTATUS status;
+
+	if ((status = UDT::getsockstate(lpContext->Socket)) == CONNECTING)
+	{
+
+		return 0;
+	}
+
+	if (status == CONNECTED)
+	{
+		lpContext->IsConnecting = false;
+		lpContext->IsConnected = true;
+
+		bool isSynRecving = true;
+
+		if (IsBlocking() && (UDT::setsockopt(lpContext->Socket, 0, UDT_RCVSYN, &isSynRecving, sizeof(bool)) == UDT::ERROR))
+		{
+			Disconnect();
+
+			return -1;
+		}
+
+		return 1;
+	}
+
+	// UDT does not allow connect to be called again on the same socket
+	// if the new socket cannot be opened IsOpen will be false
+	// Close removes the old UDT id from the poller, the new socket must be added again
+	Close();
+	Open();
+
+	return -1;
+}
+
 void UFTSocket::Disconnect()
 {
 	if (IsConnected())
@@ -392,6 +651,40 @@ void UFTSocket::Disconnect()
 	}
 }
 
+bool UFTSocket::GetPerformance(UFTSocket_Performance& performance) const
+{
+	if (!IsConnected())
+	{
+
+		return false;
+	}
+
+	UDT::TRACEINFO perf;
+
+	if (UDT::perfmon(lpContext->Socket, &perf, false) == UDT::ERROR)
+	{
+//		WriteLastError("UDT::perfmon");
+
+		return false;
+	}
+
+	performance.TimestampMS = perf.msTimeStamp;
+	performance.PacketsSent = perf.pktSentTotal;
+	performance.PacketsReceived = perf.pktRecvTotal;
+	performance.PacketsSendLost = perf.pktSndLossTotal;
+	performance.PacketsRecvLost = perf.pktRcvLossTotal;
+	performance.PacketsRetransmitted = perf.pktRetransTotal;
+	performance.SendDurationUS = perf.usSndDurationTotal;
+	performance.SendPeriodUS = perf.usPktSndPeriod;
+	performance.FlowWindow = perf.pktFlowWindow;
+	performance.CongestionWindow = perf.pktCongestionWindow;
+	performance.FlightSize = perf.pktFlightSize;
+	performance.RTTMS = perf.msRTT;
+	performance.BandwidthMbps = perf.mbpsBandwidth;
+
+	return true;
+}
+
 void UFTSocket::LockIO()
 {
 	lpContext->IOMutex.Lock();
@@ -457,3 +750,214 @@ std::int32_t UFTSocket::Receive(void* lpBuffer, std::uint32_t size)
 
 	return bytesReceived;
 }
+
+// @return number of spans
+// @return -1 if would block
+// @return 0 on connection closed
+std::int32_t UFTSocket::Peek(UFTSocket_Span* lpSpans, std::uint32_t count)
+{
+	assert(IsOpen());
+	assert(IsConnected());
+
+	UDTIOVEC iov[32];
+
+	if (count > (sizeof(iov) / sizeof(UDTIOVEC)))
+	{
+
+		count = sizeof(iov) / sizeof(UDTIOVEC);
+	}
+
+	std::int32_t spanCount;
+
+	if ((spanCount = UDT::recvpeek(lpContext->Socket, iov, (std::int32_t)count)) == UDT::ERROR)
+	{
+		if (UDT::getlasterror().getErrorCode() == CUDTException::EASYNCRCV)
+		{
+
+			return -1;
+		}
+
+		Disconnect();
+		Close();
+
+		return 0;
+	}
+
+	for (std::int32_t i = 0; i < spanCount; ++i)
+	{
+		lpSpans[i].lpBuffer = iov[i].iov_base;
+		lpSpans[i].Size = (std::uint32_t)iov[i].iov_len;
+	}
+
+	return spanCount;
+}
+
+// @return false on connection closed
+bool UFTSocket::Consume(std::uint32_t size)
+{
+	assert(IsOpen());
+	assert(IsConnected());
+
+	if (UDT::recvconsume(lpContext->Socket, (std::int32_t)size) == UDT::ERROR)
+	{
+		Disconnect();
+		Close();
+
+		return false;
+	}
+
+	return true;
+}
+
+struct UFTSocket_Poller::Context
+{
+	std::int32_t                                 EpollID;
+
+	std::unordered_map<UDTSOCKET, UFTSocket*>    Sockets;
+
+	std::vector<UDTSOCKET>                       Readable;
+	std::vector<UDTSOCKET>                       Writable;
+};
+
+UFTSocket_Poller::UFTSocket_Poller()
+	: lpContext(
+		new Context()
+	)
+{
+	UDT_Init();
+
+	lpContext->EpollID = UDT::epoll_create();
+}
+
+UFTSocket_Poller::~UFTSocket_Poller()
+{
+	for (auto& socket : lpContext->Sockets)
+	{
+
+		socket.second->lpContext->lpPoller = nullptr;
+	}
+
+	if (lpContext->EpollID >= 0)
+	{
+
+		UDT::epoll_release(lpContext->EpollID);
+	}
+
+	UDT_Cleanup();
+
+	delete lpContext;
+}
+
+bool UFTSocket_Poller::Add(UFTSocket& socket, bool read, bool write)
+{
+	assert(socket.IsOpen());
+	assert(!socket.lpContext->lpPoller || (socket.lpContext->lpPoller == this));
+
+	std::int32_t events = 0;
+
+	if (read)
+	{
+
+		events |= UDT_EPOLL_IN;
+	}
+
+	if (write)
+	{
+
+		events |= UDT_EPOLL_OUT;
+	}
+
+	if ((lpContext->EpollID < 0) || (UDT::epoll_add_usock(lpContext->EpollID, socket.lpContext->Socket, &events) == UDT::ERROR))
+	{
+//		WriteLastError("UDT::epoll_add_usock");
+
+		return false;
+	}
+
+	lpContext->Sockets[socket.lpContext->Socket] = &socket;
+	socket.lpContext->lpPoller = this;
+
+	return true;
+}
+
+void UFTSocket_Poller::Remove(UFTSocket& socket)
+{
+	auto it = lpContext->Sockets.find(
+		socket.lpContext->Socket
+	);
+
+	if ((it != lpContext->Sockets.end()) && (it->second == &socket))
+	{
+		UDT::epoll_remove_usock(lpContext->EpollID, it->first);
+
+		lpContext->Sockets.erase(it);
+	}
+
+	if (socket.lpContext->lpPoller == this)
+	{
+
+		socket.lpContext->lpPoller = nullptr;
+	}
+}
+
+// readCount and writeCount are the sizes of the arrays on input and the number of sockets stored on output
+// @return number of ready sockets
+// @return 0 on timeout
+// @return -1 on error
+std::int32_t UFTSocket_Poller::Wait(UFTSocket** lpReadable, std::uint32_t& readCount, UFTSocket** lpWritable, std::uint32_t& writeCount, std::int32_t timeoutMS)
+{
+	lpContext->Readable.resize(readCount);
+	lpContext->Writable.resize(writeCount);
+
+	std::int32_t readableCount = static_cast<std::int32_t>(readCount);
+	std::int32_t writableCount = static_cast<std::int32_t>(writeCount);
+
+	readCount = 0;
+	writeCount = 0;
+
+	std::int32_t readyCount;
+
+	if ((readyCount = UDT::epoll_wait2(lpContext->EpollID, lpReadable ? lpContext->Readable.data() : nullptr, &readableCount, lpWritable ? lpContext->Writable.data() : nullptr, &writableCount, timeoutMS)) == UDT::ERROR)
+	{
+//		WriteLastError("UDT::epoll_wait2");
+
+		return -1;
+	}
+
+	if (readyCount == 0)
+	{
+
+		return 0;
+	}
+
+	// sockets closed by UDT are reported until removed, unknown ones are skipped
+	for (std::int32_t i = 0; lpReadable && (i < readableCount); ++i)
+	{
+		auto it = lpContext->Sockets.find(
+			lpContext->Readable[i]
+		);
+
+		if (it != lpContext->Sockets.end())
+		{
+
+			lpReadable[readCount++] = it->second;
+		}
+	}
+
+	for (std::int32_t i = 0; lpWritable && (i < writableCount); ++i)
+	{
+		auto it = lpContext->Sockets.find(
+			lpContext->Writable[i]
+		);
+
+		if (it != lpContext->Sockets.end())
+		{
+
+			lpWritable[writeCount++] = it->second;
+		}
+	}
+
+	return static_cast<std::int32_t>(
+		readCount + writeCount
+	);
+}
@@ -7,9 +7,88 @@
 #define UFTSOCKET_HPP
 
 #include <cstdint>
+#include <cstring>
 
 class UFTSocket;
 
+enum UFTSOCKET_CONGESTION_CONTROLS : std::uint8_t
+{
+	// UDT's native rate based AIMD controller, backs off on every loss report
+	UFTSOCKET_CONGESTION_CONTROL_UDT,
+	// paces to the estimated bottleneck bandwidth and min RTT, ignores random loss
+	UFTSOCKET_CONGESTION_CONTROL_BBR
+};
+
+// @return false if lpName is not "udt" or "bbr"
+inline bool UFTSOCKET_CONGESTION_CONTROLS_FromString(const char* lpName, UFTSOCKET_CONGESTION_CONTROLS& value)
+{
+	if (!std::strcmp(lpName, "udt"))
+	{
+		value = UFTSOCKET_CONGESTION_CONTROL_UDT;
+
+		return true;
+	}
+
+	if (!std::strcmp(lpName, "bbr"))
+	{
+		value = UFTSOCKET_CONGESTION_CONTROL_BBR;
+
+		return true;
+	}
+
+	return false;
+}
+
+inline const char* UFTSOCKET_CONGESTION_CONTROLS_ToString(UFTSOCKET_CONGESTION_CONTROLS value)
+{
+	switch (value)
+	{
+		case UFTSOCKET_CONGESTION_CONTROL_UDT:
+			return "udt";
+
+		case UFTSOCKET_CONGESTION_CONTROL_BBR:
+			return "bbr";
+	}
+
+	return "";
+}
+
+// UDT socket options, 0 keeps the UDT default
+struct UFTSocket_Options
+{
+	std::int32_t MSS              = 0; // UDT_MSS, bytes including the IP and UDP headers
+	std::int32_t FlowWindow       = 0; // UDT_FC, packets
+	std::int32_t UDTSendBuffer    = 0; // UDT_SNDBUF, bytes
+	std::int32_t UDTReceiveBuffer = 0; // UDT_RCVBUF, bytes, limited to FlowWindow packets
+	std::int32_t UDPSendBuffer    = 0; // UDP_SNDBUF, bytes
+	std::int32_t UDPReceiveBuffer = 0; // UDP_RCVBUF, bytes
+};
+
+// subset of the UDT CPerfMon totals and instant measurements
+struct UFTSocket_Performance
+{
+	std::int64_t TimestampMS          = 0;
+	std::int64_t PacketsSent          = 0;
+	std::int64_t PacketsReceived      = 0;
+	std::int32_t PacketsSendLost      = 0;
+	std::int32_t PacketsRecvLost      = 0;
+	std::int32_t PacketsRetransmitted = 0;
+	std::int64_t SendDurationUS       = 0;
+	double       SendPeriodUS         = 0;
+	std::int32_t FlowWindow           = 0;
+	std::int32_t CongestionWindow     = 0;
+	std::int32_t FlightSize           = 0;
+	double       RTTMS                = 0;
+	double       BandwidthMbps        = 0;
+};
+
+// received data lent out by UFTSocket::Peek, valid until UFTSocket::Consume
+struct UFTSocket_Span
+{
+	const void*   lpBuffer;
+	std::uint32_t Size;
+};
+
 class UFTSocket_IOLockGuard final
 {
 	UFTSocket* const lpSocket;
@@ -25,12 +104,17 @@ public:
 
 class UFTSocket
 {
+	friend class UFTSocket_Poller;
+
 	struct Context;
 
 	Context* lpContext;
 
 	UFTSocket(const UFTSocket&) = delete;
 
+	// udtSocket is a UDTSOCKET returned by UDT::accept or UDT::acceptBatch
+	bool AcceptSocket(UFTSocket& socket, std::int32_t udtSocket);
+
 public:
 	UFTSocket();
 
@@ -44,10 +128,16 @@ public:
 
 	bool IsConnected() const;
 
+	bool IsConnecting() const;
+
 	bool IsListening() const;
 
 	std::int32_t GetTimeout() const;
 
+	UFTSOCKET_CONGESTION_CONTROLS GetCongestionControl() const;
+
+	const UFTSocket_Options& GetOptions() const;
+
 	std::uint16_t GetRemotePort() const;
 
 	std::uint32_t GetRemoteAddress() const;
@@ -60,14 +150,40 @@ public:
 
 	bool SetTimeout(std::int32_t milliseconds);
 
+	// must be set before Connect or Listen, accepted sockets inherit it from the listener
+	bool SetCongestionControl(UFTSOCKET_CONGESTION_CONTROLS value);
+
+	// must be set before Connect or Listen, accepted sockets inherit them from the listener
+	bool SetOptions(const UFTSocket_Options& value);
+
 	bool Listen(std::uint32_t host, std::uint16_t port, std::uint32_t backlog);
 
 	bool Accept(UFTSocket& socket);
 
+	// takes up to count queued connections at once
+	// waits for the first one if blocking
+	// @return number of sockets accepted
+	// @return 0 if would block or on error
+	std::uint32_t Accept(UFTSocket** lpSockets, std::uint32_t count);
+
 	bool Connect(std::uint32_t remoteHost, std::uint16_t remotePort);
 
+	// starts the handshake without waiting for it, regardless of IsBlocking
+	// the socket becomes writable in a UFTSocket_Poller once EndConnect can complete it
+	bool BeginConnect(std::uint32_t remoteHost, std::uint16_t remotePort);
+
+	// a failed socket is replaced by a new one, so it can connect again like after a failed Connect
+	// the new socket is not in the poller the old one was added to
+	// @return 1 if connected
+	// @return 0 if still connecting
+	// @return -1 if the connection timed out or was rejected
+	std::int32_t EndConnect();
+
 	void Disconnect();
 
+	// @return false if not connected or on error
+	bool GetPerformance(UFTSocket_Performance& performance) const;
+
 	void LockIO();
 
 	void UnlockIO();
@@ -82,6 +198,16 @@ public:
 	// @return 0 on connection closed
 	std::int32_t Receive(void* lpBuffer, std::uint32_t size);
 
+	// exposes received data in place without consuming it
+	// @return number of spans
+	// @return -1 if would block
+	// @return 0 on connection closed
+	std::int32_t Peek(UFTSocket_Span* lpSpans, std::uint32_t count);
+
+	// releases data exposed by Peek
+	// @return false on connection closed
+	bool Consume(std::uint32_t size);
+
 	// @return number of bytes sent
 	// @return 0 on connection closed
 	std::int32_t SendAll(const void* lpBuffer, std::uint32_t size)
@@ -173,6 +299,60 @@ public:
 		);
 	}
 
+	// passes received data to callback in place instead of copying it out of the UDT receive buffer
+	// F = bool(*)(const void* lpBuffer, std::uint32_t size)
+	// @return number of bytes read
+	// @return 0 on connection closed or if callback returns false
+	template<typename F>
+	std::int32_t ReceiveAllInPlace(std::uint32_t size, F&& callback)
+	{
+		UFTSocket_Span spans[32];
+
+		for (std::uint32_t i = 0; i < size; )
+		{
+			std::int32_t spanCount;
+
+			if (!IsConnected() || ((spanCount = Peek(spans, sizeof(spans) / sizeof(UFTSocket_Span))) == 0))
+			{
+
+				return 0;
+			}
+
+			std::uint32_t bytesRead = 0;
+
+			for (std::int32_t j = 0; (j < spanCount) && ((i + bytesRead) < size); ++j)
+			{
+				auto spanSize = spans[j].Size;
+
+				if (spanSize > (size - i - bytesRead))
+				{
+
+					spanSize = size - i - bytesRead;
+				}
+
+				if (!callback(spans[j].lpBuffer, spanSize))
+				{
+
+					return 0;
+				}
+
+				bytesRead += spanSize;
+			}
+
+			if (bytesRead && !Consume(bytesRead))
+			{
+
+				return 0;
+			}
+
+			i += bytesRead;
+		}
+
+		return static_cast<std::int32_t>(
+			size
+		);
+	}
+
 	UFTSocket& operator = (UFTSocket&&) = delete;
 };
 
@@ -189,4 +369,31 @@ inline UFTSocket_IOLockGuard::~UFTSocket_IOLockGuard()
 	lpSocket->UnlockIO();
 }
 
+// waits for many sockets at once, e.g. to complete BeginConnect or to Accept when a listener is readable
+// sockets must not be moved or destroyed while added; a socket is in at most one poller and leaves it when closed
+class UFTSocket_Poller final
+{
+	struct Context;
+
+	Context* lpContext;
+
+	UFTSocket_Poller(UFTSocket_Poller&&) = delete;
+	UFTSocket_Poller(const UFTSocket_Poller&) = delete;
+
+public:
+	UFTSocket_Poller();
+
+	~UFTSocket_Poller();
+
+	bool Add(UFTSocket& socket, bool read, bool write);
+
+	void Remove(UFTSocket& socket);
+
+	// readCount and writeCount are the sizes of the arrays on input and the number of sockets stored on output
+	// @return number of ready sockets
+	// @return 0 on timeout
+	// @return -1 on error
+	std::int32_t Wait(UFTSocket** lpReadable, std::uint32_t& readCount, UFTSocket** lpWritable, std::uint32_t& writeCount, std::int32_t timeoutMS);
+};
+
 #endif // !UFTSOCKET_HPP
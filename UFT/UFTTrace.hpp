@@ -0,0 +1,282 @@
+// -----------------------------------------------------------------------------
+// Date: 10/18/2026
+// -----------------------------------------------------------------------------
+
+#ifndef UFTTRACE_HPP
+#define UFTTRACE_HPP
+
+// Chunk lifecycle tracing, compiled in with -DUFT_TRACE (make UFT_TRACE=1).
+// Without UFT_TRACE the UFTTrace_Scope macro expands to nothing.
+//
+// Each thread records into its own ring buffer, so recording takes no locks.
+// The most recent UFTTRACE_BUFFER_CAPACITY events per thread are kept.
+
+#if defined(UFT_TRACE)
+
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+
+enum UFTTRACE_EVENTS : std::uint8_t
+{
+	UFTTRACE_EVENT_READ,
+	UFTTRACE_EVENT_HASH,
+	UFTTRACE_EVENT_COMPRESS,
+	UFTTRACE_EVENT_SEND,
+	UFTTRACE_EVENT_WAIT_ACK,
+	UFTTRACE_EVENT_RECEIVE,
+	UFTTRACE_EVENT_DECOMPRESS,
+	UFTTRACE_EVENT_WRITE,
+
+	UFTTRACE_EVENT_COUNT
+};
+
+inline const char* UFTTRACE_EVENTS_ToString(UFTTRACE_EVENTS event)
+{
+	switch (event)
+	{
+		case UFTTRACE_EVENT_READ:       return "read";
+		case UFTTRACE_EVENT_HASH:       return "hash";
+		case UFTTRACE_EVENT_COMPRESS:   return "compress";
+		case UFTTRACE_EVENT_SEND:       return "send";
+		case UFTTRACE_EVENT_WAIT_ACK:   return "wait_ack";
+		case UFTTRACE_EVENT_RECEIVE:    return "receive";
+		case UFTTRACE_EVENT_DECOMPRESS: return "decompress";
+		case UFTTRACE_EVENT_WRITE:      return "write";
+		default:                        break;
+	}
+
+	return "unknown";
+}
+
+class UFTTrace
+{
+	static constexpr std::size_t UFTTRACE_BUFFER_CAPACITY = 64 * 1024; // must be a power of 2
+
+public:
+#pragma pack(push, 1)
+	// binary format: "UFTTRACE", std::uint32_t version, std::uint64_t count, Record[count]
+	struct Record
+	{
+		std::uint64_t   Timestamp; // nanoseconds since the process started
+		std::uint64_t   Duration;  // nanoseconds
+		std::uint64_t   Offset;    // file offset of the chunk, 0 if not known yet
+		std::uint32_t   ThreadId;
+		UFTTRACE_EVENTS Event;
+	};
+#pragma pack(pop)
+
+	class Scope final
+	{
+		UFTTRACE_EVENTS event;
+		std::uint64_t   offset;
+		std::uint64_t   start;
+
+		Scope(Scope&&) = delete;
+		Scope(const Scope&) = delete;
+
+	public:
+		Scope(UFTTRACE_EVENTS event, std::uint64_t offset)
+			: event(
+				event
+			),
+			offset(
+				offset
+			),
+			start(
+				GetTimestamp()
+			)
+		{
+		}
+
+		~Scope()
+		{
+			UFTTrace::AddRecord(
+				event,
+				offset,
+				start,
+				GetTimestamp() - start
+			);
+		}
+	};
+
+private:
+	struct Buffer
+	{
+		std::uint32_t              ThreadId;
+		std::atomic<std::uint64_t> Count;
+		UFTTrace::Record           Records[UFTTRACE_BUFFER_CAPACITY];
+	};
+
+	// buffers are never freed so events survive the thread that recorded them
+	inline static std::mutex           registryMutex;
+	inline static std::vector<Buffer*> registry;
+
+	inline static const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+
+	UFTTrace() = delete;
+
+public:
+	static void AddRecord(UFTTRACE_EVENTS event, std::uint64_t offset, std::uint64_t timestamp, std::uint64_t duration)
+	{
+		auto lpBuffer = GetBuffer();
+		auto count = lpBuffer->Count.load(std::memory_order_relaxed);
+
+		auto& record = lpBuffer->Records[count & (UFTTRACE_BUFFER_CAPACITY - 1)];
+		record.Timestamp = timestamp;
+		record.Duration = duration;
+		record.Offset = offset;
+		record.ThreadId = lpBuffer->ThreadId;
+		record.Event = event;
+
+		lpBuffer->Count.store(count + 1, std::memory_order_release);
+	}
+
+	// should be called once recording threads are idle
+	static bool WriteChromeJSON(const char* lpPath)
+	{
+		FILE* lpFile;
+
+		if ((lpFile = fopen(lpPath, "w")) == nullptr)
+		{
+
+			return false;
+		}
+
+		fprintf(lpFile, "{\"traceEvents\": [\n");
+
+		bool isFirst = true;
+
+		ForEachRecord(
+			[lpFile, &isFirst](const UFTTrace::Record& _record)
+			{
+				fprintf(
+					lpFile,
+					"%s{\"name\": \"%s\", \"ph\": \"X\", \"ts\": %.3f, \"dur\": %.3f, \"pid\": 0, \"tid\": %u, \"args\": {\"offset\": %llu}}",
+					isFirst ? "" : ",\n",
+					UFTTRACE_EVENTS_ToString(_record.Event),
+					_record.Timestamp / 1000.0,
+					_record.Duration / 1000.0,
+					_record.ThreadId,
+					static_cast<unsigned long long>(_record.Offset)
+				);
+
+				isFirst = false;
+			}
+		);
+
+		fprintf(lpFile, "\n]}\n");
+
+		return fclose(lpFile) == 0;
+	}
+
+	// should be called once recording threads are idle
+	static bool WriteBinary(const char* lpPath)
+	{
+		static constexpr char          MAGIC[8] = { 'U', 'F', 'T', 'T', 'R', 'A', 'C', 'E' };
+		static constexpr std::uint32_t VERSION  = 1;
+
+		FILE* lpFile;
+
+		if ((lpFile = fopen(lpPath, "wb")) == nullptr)
+		{
+
+			return false;
+		}
+
+		std::uint64_t count = 0;
+
+		ForEachRecord(
+			[&count](const UFTTrace::Record&)
+			{
+				++count;
+			}
+		);
+
+		fwrite(MAGIC, sizeof(MAGIC), 1, lpFile);
+		fwrite(&VERSION, sizeof(VERSION), 1, lpFile);
+		fwrite(&count, sizeof(count), 1, lpFile);
+
+		ForEachRecord(
+			[lpFile](const UFTTrace::Record& _record)
+			{
+				fwrite(&_record, sizeof(_record), 1, lpFile);
+			}
+		);
+
+		return fclose(lpFile) == 0;
+	}
+
+private:
+	static std::uint64_t GetTimestamp()
+	{
+		return static_cast<std::uint64_t>(
+			std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count()
+		);
+	}
+
+	static Buffer* GetBuffer()
+	{
+		thread_local Buffer* lpBuffer = nullptr;
+
+		if (lpBuffer == nullptr)
+		{
+			lpBuffer = new Buffer();
+			lpBuffer->Count = 0;
+
+			std::lock_guard<std::mutex> lock(
+				registryMutex
+			);
+
+			lpBuffer->ThreadId = static_cast<std::uint32_t>(
+				registry.size() + 1
+			);
+
+			registry.push_back(
+				lpBuffer
+			);
+		}
+
+		return lpBuffer;
+	}
+
+	// F = void(*)(const Record& record)
+	template<typename F>
+	static void ForEachRecord(F&& callback)
+	{
+		std::lock_guard<std::mutex> lock(
+			registryMutex
+		);
+
+		for (auto lpBuffer : registry)
+		{
+			auto count = lpBuffer->Count.load(std::memory_order_acquire);
+			auto first = (count > UFTTRACE_BUFFER_CAPACITY) ? (count - UFTTRACE_BUFFER_CAPACITY) : 0;
+
+			for (auto i = first; i < count; ++i)
+			{
+
+				callback(
+					lpBuffer->Records[i & (UFTTRACE_BUFFER_CAPACITY - 1)]
+				);
+			}
+		}
+	}
+};
+
+#define UFTTrace_Scope_Concat2(a, b) a##b
+#define UFTTrace_Scope_Concat(a, b)  UFTTrace_Scope_Concat2(a, b)
+
+#define UFTTrace_Scope(event, offset) \
+	UFTTrace::Scope UFTTrace_Scope_Concat(uftTraceScope, __LINE__)(event, offset)
+
+#else
+
+#define UFTTrace_Scope(event, offset)
+
+#endif // UFT_TRACE
+
+#endif // !UFTTRACE_HPP
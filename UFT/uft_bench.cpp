@@ -0,0 +1,470 @@
+#include "UFTClient.hpp"
+#include "CmdLineArgs.hpp"
+#include "UFTListener.hpp"
+#include "UDPImpairmentRelay.hpp"
+
+#include <chrono>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdio>
+#include <fstream>
+#include <algorithm>
+
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+
+static constexpr std::uint64_t BENCH_CHUNK_SIZE          = 1 * (1024 * 1024); // matches UFTSession
+static constexpr std::uint64_t BENCH_DELTA_CHUNK_INTERVAL = 8;                 // modify every Nth chunk
+
+typedef std::chrono::steady_clock BenchClock;
+
+struct BenchResult
+{
+	std::string         Workload;
+	std::uint64_t       Bytes   = 0;
+	double              Seconds = 0;
+	double              CPUSeconds = 0;
+	std::vector<double> ChunkLatencies; // milliseconds
+};
+
+struct BenchProgress
+{
+	BenchClock::time_point Last;
+	std::vector<double>*   lpChunkLatencies;
+};
+
+template<typename ... TArgs>
+inline void Console_WriteLine(const char* format, TArgs ... args)
+{
+	printf(format, args ...);
+	printf("\n");
+}
+
+void main_show_cli_usage(const char* arg0)
+{
+	Console_WriteLine("Example usage for %s", arg0);
+	Console_WriteLine("%s --workload={all|cold|delta|small} --path=\"{path}\"", arg0);
+	Console_WriteLine("Optional: --local-port=9100 --file-size={bytes} --small-file-count={count} --small-file-size={bytes} --cc={udt|bbr}");
+	Console_WriteLine("Optional: --delay={ms} --jitter={ms} --loss={percent} --rate={mbps} --queue={packets}");
+}
+
+double GetProcessCPUSeconds()
+{
+	rusage usage;
+
+	if (getrusage(RUSAGE_SELF, &usage) == -1)
+	{
+
+		return 0;
+	}
+
+	return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) + ((usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000000.0);
+}
+
+double GetPercentile(std::vector<double> values, double percentile)
+{
+	if (values.empty())
+	{
+
+		return 0;
+	}
+
+	std::sort(
+		values.begin(),
+		values.end()
+	);
+
+	auto index = static_cast<std::size_t>(
+		percentile * (values.size() - 1)
+	);
+
+	return values[index];
+}
+
+bool WriteRandomFile(const std::string& path, std::uint64_t size, std::uint32_t seed)
+{
+	std::ofstream fStream(
+		path,
+		std::ios::binary | std::ios::trunc
+	);
+
+	if (!fStream.is_open())
+	{
+
+		return false;
+	}
+
+	std::mt19937_64 random(
+		seed
+	);
+
+	std::vector<std::uint64_t> buffer(
+		BENCH_CHUNK_SIZE / sizeof(std::uint64_t)
+	);
+
+	for (std::uint64_t offset = 0; offset < size; )
+	{
+		for (auto& value : buffer)
+		{
+
+			value = random();
+		}
+
+		auto bytesToWrite = std::min<std::uint64_t>(
+			BENCH_CHUNK_SIZE,
+			size - offset
+		);
+
+		fStream.write(
+			reinterpret_cast<const char*>(&buffer[0]),
+			static_cast<std::streamsize>(bytesToWrite)
+		);
+
+		offset += bytesToWrite;
+	}
+
+	return fStream.good();
+}
+
+// flips one byte in every BENCH_DELTA_CHUNK_INTERVAL chunks
+bool ModifyFile(const std::string& path, std::uint64_t size)
+{
+	std::fstream fStream(
+		path,
+		std::ios::binary | std::ios::in | std::ios::out
+	);
+
+	if (!fStream.is_open())
+	{
+
+		return false;
+	}
+
+	for (std::uint64_t offset = 0; offset < size; offset += BENCH_CHUNK_SIZE * BENCH_DELTA_CHUNK_INTERVAL)
+	{
+		char value;
+
+		fStream.seekg(static_cast<std::streampos>(offset));
+		fStream.read(&value, 1);
+
+		value = ~value;
+
+		fStream.seekp(static_cast<std::streampos>(offset));
+		fStream.write(&value, 1);
+	}
+
+	return fStream.good();
+}
+
+bool SendFiles(UFTClient& client, const std::vector<std::string>& sources, const std::vector<std::string>& destinations, BenchResult& result)
+{
+	BenchProgress progress;
+	progress.lpChunkLatencies = &result.ChunkLatencies;
+
+	auto cpuStart = GetProcessCPUSeconds();
+	auto timeStart = BenchClock::now();
+
+	for (std::size_t i = 0; i < sources.size(); ++i)
+	{
+		progress.Last = BenchClock::now();
+
+		UFTSESSION_ERROR_CODES errorCode;
+
+		errorCode = client.SendFile(
+			sources[i].c_str(),
+			destinations[i].c_str(),
+			[](std::uint64_t _bytesSent, std::uint64_t _fileSize, void* _lpParam)
+			{
+				auto lpProgress = reinterpret_cast<BenchProgress*>(
+					_lpParam
+				);
+
+				auto now = BenchClock::now();
+
+				lpProgress->lpChunkLatencies->push_back(
+					std::chrono::duration<double, std::milli>(now - lpProgress->Last).count()
+				);
+
+				lpProgress->Last = now;
+			},
+			&progress
+		);
+
+		if (errorCode != UFTSESSION_ERROR_CODE_SUCCESS)
+		{
+			Console_WriteLine(
+				"Error sending '%s' to '%s': %s",
+				sources[i].c_str(),
+				destinations[i].c_str(),
+				UFTSESSION_ERROR_CODES_ToString(errorCode).c_str()
+			);
+
+			return false;
+		}
+	}
+
+	result.Seconds = std::chrono::duration<double>(BenchClock::now() - timeStart).count();
+	result.CPUSeconds = GetProcessCPUSeconds() - cpuStart;
+
+	return true;
+}
+
+void PrintResult(const BenchResult& result, const UDPImpairmentRelay& relay)
+{
+	double megabytes = result.Bytes / (1024.0 * 1024.0);
+	double gigabytes = result.Bytes / (1024.0 * 1024.0 * 1024.0);
+
+	Console_WriteLine(
+		"{\"workload\": \"%s\", \"bytes\": %llu, \"seconds\": %.3f, \"mb_per_second\": %.2f, \"cpu_seconds_per_gb\": %.3f, \"chunk_count\": %llu, \"chunk_latency_p50_ms\": %.3f, \"chunk_latency_p99_ms\": %.3f, \"packets_dropped\": %llu}",
+		result.Workload.c_str(),
+		static_cast<unsigned long long>(result.Bytes),
+		result.Seconds,
+		result.Seconds ? (megabytes / result.Seconds) : 0.0,
+		gigabytes ? (result.CPUSeconds / gigabytes) : 0.0,
+		static_cast<unsigned long long>(result.ChunkLatencies.size()),
+		GetPercentile(result.ChunkLatencies, 0.50),
+		GetPercentile(result.ChunkLatencies, 0.99),
+		static_cast<unsigned long long>(relay.GetPacketsDropped())
+	);
+}
+
+int main(int argc, char* argv[])
+{
+	CmdLineArgs args(
+		argc,
+		argv
+	);
+
+	std::string argWorkload;
+	std::string argPath;
+	std::uint16_t argLocalPort = 9100;
+	std::uint32_t argFileSize = 256 * (1024 * 1024);
+	std::uint32_t argSmallFileCount = 1000;
+	std::uint32_t argSmallFileSize = 4096;
+	std::uint32_t argTimeout = 15 * 1000;
+	std::string argCC("udt");
+
+	UDPImpairmentRelay::Settings relaySettings;
+
+	if (!args.TryGetValue("workload", argWorkload) ||
+		!args.TryGetValue("path", argPath))
+	{
+		main_show_cli_usage(argv[0]);
+
+		return -1;
+	}
+
+	args.TryGetValue("local-port", argLocalPort);
+	args.TryGetValue("file-size", argFileSize);
+	args.TryGetValue("small-file-count", argSmallFileCount);
+	args.TryGetValue("small-file-size", argSmallFileSize);
+	args.TryGetValue("timeout", argTimeout);
+	args.TryGetValue("cc", argCC);
+	args.TryGetValue("delay", relaySettings.DelayMS);
+	args.TryGetValue("jitter", relaySettings.JitterMS);
+	args.TryGetValue("loss", relaySettings.LossPercent);
+	args.TryGetValue("rate", relaySettings.RateMbps);
+	args.TryGetValue("queue", relaySettings.QueuePackets);
+
+	bool runCold = !argWorkload.compare("all") || !argWorkload.compare("cold");
+	bool runDelta = !argWorkload.compare("all") || !argWorkload.compare("delta");
+	bool runSmall = !argWorkload.compare("all") || !argWorkload.compare("small");
+
+	UFTSOCKET_CONGESTION_CONTROLS congestionControl;
+
+	if ((!runCold && !runDelta && !runSmall) || !UFTSOCKET_CONGESTION_CONTROLS_FromString(argCC.c_str(), congestionControl))
+	{
+		main_show_cli_usage(argv[0]);
+
+		return -2;
+	}
+
+	if ((mkdir(argPath.c_str(), 0755) == -1) && (errno != EEXIST))
+	{
+		Console_WriteLine(
+			"Error creating '%s'",
+			argPath.c_str()
+		);
+
+		return -3;
+	}
+
+	UFTListener listener;
+
+	listener.GetSocket().SetCongestionControl(
+		congestionControl
+	);
+
+	if (!listener.Listen(INADDR_LOOPBACK, argLocalPort, 1))
+	{
+		Console_WriteLine(
+			"Error listening on 127.0.0.1:%u",
+			argLocalPort
+		);
+
+		return -4;
+	}
+
+	// the server side runs on its own thread in this process
+	std::thread serverThread(
+		[&listener, argTimeout]()
+		{
+			UFTSession session;
+
+			if (listener.Accept(session) && session.SetTimeout(argTimeout))
+			{
+				while (session.Update() == UFTSESSION_ERROR_CODE_SUCCESS)
+				{
+				}
+			}
+
+			session.Disconnect();
+		}
+	);
+
+	UDPImpairmentRelay relay;
+	std::uint16_t remotePort = argLocalPort;
+
+	if (relaySettings.DelayMS || relaySettings.JitterMS || (relaySettings.LossPercent > 0) || relaySettings.RateMbps)
+	{
+		if (!relay.Start(0, argLocalPort, relaySettings))
+		{
+			Console_WriteLine(
+				"Error starting impairment relay"
+			);
+
+			listener.Close();
+			serverThread.join();
+
+			return -5;
+		}
+
+		remotePort = relay.GetLocalPort();
+	}
+
+	UFTClient client;
+
+	client.SetCongestionControl(
+		congestionControl
+	);
+
+	if (!client.Connect(INADDR_LOOPBACK, remotePort) || !client.SetTimeout(argTimeout))
+	{
+		Console_WriteLine(
+			"Error connecting to 127.0.0.1:%u",
+			remotePort
+		);
+
+		listener.Close();
+		serverThread.join();
+
+		return -6;
+	}
+
+	std::string source = argPath + "/source.bin";
+	std::string destination = argPath + "/destination.bin";
+
+	std::vector<std::string> smallSources;
+	std::vector<std::string> smallDestinations;
+
+	bool success = true;
+
+	if (runCold || runDelta)
+	{
+		unlink(destination.c_str());
+
+		if (!WriteRandomFile(source, argFileSize, 1))
+		{
+			Console_WriteLine(
+				"Error writing '%s'",
+				source.c_str()
+			);
+
+			success = false;
+		}
+	}
+
+	if (success && (runCold || runDelta))
+	{
+		BenchResult result;
+		result.Workload = "cold";
+		result.Bytes = argFileSize;
+
+		if ((success = SendFiles(client, { source }, { destination }, result)) && runCold)
+		{
+
+			PrintResult(result, relay);
+		}
+	}
+
+	if (success && runDelta)
+	{
+		BenchResult result;
+		result.Workload = "delta";
+		result.Bytes = argFileSize;
+
+		if (!(success = ModifyFile(source, argFileSize)))
+		{
+			Console_WriteLine(
+				"Error modifying '%s'",
+				source.c_str()
+			);
+		}
+		else if ((success = SendFiles(client, { source }, { destination }, result)))
+		{
+
+			PrintResult(result, relay);
+		}
+	}
+
+	if (success && runSmall)
+	{
+		BenchResult result;
+		result.Workload = "small";
+		result.Bytes = static_cast<std::uint64_t>(argSmallFileCount) * argSmallFileSize;
+
+		for (std::uint32_t i = 0; success && (i < argSmallFileCount); ++i)
+		{
+			smallSources.push_back(argPath + "/small_source_" + std::to_string(i) + ".bin");
+			smallDestinations.push_back(argPath + "/small_destination_" + std::to_string(i) + ".bin");
+
+			unlink(smallDestinations.back().c_str());
+
+			success = WriteRandomFile(smallSources.back(), argSmallFileSize, i + 2);
+		}
+
+		if (success && (success = SendFiles(client, smallSources, smallDestinations, result)))
+		{
+
+			PrintResult(result, relay);
+		}
+	}
+
+	client.Disconnect();
+	listener.Close();
+	serverThread.join();
+	relay.Stop();
+
+	unlink(source.c_str());
+	unlink(destination.c_str());
+
+	for (auto& path : smallSources)
+	{
+
+		unlink(path.c_str());
+	}
+
+	for (auto& path : smallDestinations)
+	{
+
+		unlink(path.c_str());
+	}
+
+	rmdir(argPath.c_str());
+
+	return success ? 0 : -7;
+}
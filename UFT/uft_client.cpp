@@ -1,5 +1,6 @@
 #include "UFTClient.hpp"
 #include "CmdLineArgs.hpp"
+#include "UFTProfile.hpp"
 
 #include <cstdio>
 #include <string>
@@ -25,6 +26,10 @@ void main_show_cli_usage(const char* arg0)
 	Console_WriteLine("%s --remote-host=127.0.0.1 --remote-port=9000 --command=get_file_list --path=\"{path}\" --timeout={seconds}", arg0);
 	Console_WriteLine("%s --remote-host=127.0.0.1 --remote-port=9000 --command=send_file --source=\"{source}\" --destination=\"{destination}\" --timeout={seconds}", arg0);
 	Console_WriteLine("%s --remote-host=127.0.0.1 --remote-port=9000 --command=receive_file --source=\"{source}\" --destination=\"{destination}\" --timeout={seconds}", arg0);
+	Console_WriteLine("Optional: --policy={compare_hash|skip_unchanged} --cc={udt|bbr} --profile=\"{path}\" --stats=json");
+#if defined(UFT_TRACE)
+	Console_WriteLine("Optional: --trace=\"{path}\" --trace-format={json|binary}");
+#endif
 }
 
 void main_on_arg_not_found(const std::string& arg)
@@ -46,6 +51,12 @@ int main(int argc, char* argv[])
 	std::string argPath; // optional
 	std::string argSource; // optional
 	std::string argDestination; // optional
+	std::string argPolicy("compare_hash"); // optional
+	std::string argCC; // optional
+	std::string argProfile; // optional
+	std::string argStats; // optional
+	std::string argTrace; // optional
+	std::string argTraceFormat("json"); // optional
 
 	if (!args.TryGetValue("remote-host", argRemoteHost, main_on_arg_not_found) ||
 		!args.TryGetValue("remote-port", argRemotePort, main_on_arg_not_found) ||
@@ -74,6 +85,64 @@ int main(int argc, char* argv[])
 		return -3;
 	}
 
+	UFTSESSION_TRANSMIT_FILE_POLICIES policy;
+
+	args.TryGetValue("policy", argPolicy);
+	args.TryGetValue("cc", argCC);
+	args.TryGetValue("profile", argProfile);
+	args.TryGetValue("stats", argStats);
+	args.TryGetValue("trace", argTrace);
+	args.TryGetValue("trace-format", argTraceFormat);
+
+	if (!argPolicy.compare("compare_hash"))
+	{
+
+		policy = UFTSESSION_TRANSMIT_FILE_POLICY_COMPARE_HASH;
+	}
+	else if (!argPolicy.compare("skip_unchanged"))
+	{
+
+		policy = UFTSESSION_TRANSMIT_FILE_POLICY_SKIP_UNCHANGED;
+	}
+	else
+	{
+		Console_WriteLine(
+			"Invalid policy '%s'",
+			argPolicy.c_str()
+		);
+
+		main_show_cli_usage(argv[0]);
+
+		return -7;
+	}
+
+	UFTProfile profile;
+
+	if (!argProfile.empty() && !UFTProfile_Load(argProfile.c_str(), profile))
+	{
+		Console_WriteLine(
+			"Error loading profile '%s'",
+			argProfile.c_str()
+		);
+
+		return -9;
+	}
+
+	// --cc overrides the congestion control of the profile
+	UFTSOCKET_CONGESTION_CONTROLS congestionControl = profile.CongestionControl;
+
+	if (!argCC.empty() && !UFTSOCKET_CONGESTION_CONTROLS_FromString(argCC.c_str(), congestionControl))
+	{
+		Console_WriteLine(
+			"Invalid congestion control '%s'",
+			argCC.c_str()
+		);
+
+		main_show_cli_usage(argv[0]);
+
+		return -8;
+	}
+
 	in_addr addr;
 
 	if (inet_pton(AF_INET, argRemoteHost.c_str(), &addr) != 1)
@@ -87,6 +156,18 @@ int main(int argc, char* argv[])
 
 	UFTClient client;
 
+	client.SetTransmitFilePolicy(
+		policy
+	);
+
+	client.SetCongestionControl(
+		congestionControl
+	);
+
+	client.SetOptions(
+		profile.Options
+	);
+
 	if (!client.Connect(ntohl(addr.s_addr), argRemotePort))
 	{
 		Console_WriteLine(
@@ -227,7 +308,32 @@ int main(int argc, char* argv[])
 		);
 	}
 
+	if (!argStats.compare("json"))
+	{
+
+		Console_WriteLine(
+			"%s",
+			UFTSession_Stats_ToJSON(client.GetStats(), client.GetSocketPerformance()).c_str()
+		);
+	}
+
 	client.Disconnect();
 
+#if defined(UFT_TRACE)
+	if (!argTrace.empty())
+	{
+		bool success = !argTraceFormat.compare("binary") ? UFTTrace::WriteBinary(argTrace.c_str()) : UFTTrace::WriteChromeJSON(argTrace.c_str());
+
+		if (!success)
+		{
+
+			Console_WriteLine(
+				"Error writing trace to '%s'",
+				argTrace.c_str()
+			);
+		}
+	}
+#endif
+
 	return 0;
 }
@@ -0,0 +1,317 @@
+#include "UFTSession.hpp"
+#include "ByteBuffer.hpp"
+#include "CmdLineArgs.hpp"
+#include "BitConverter.hpp"
+
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include <cstdio>
+
+typedef std::chrono::steady_clock BenchClock;
+
+typedef std::vector<std::uint8_t> BenchBuffer;
+
+enum BENCH_ENTROPIES
+{
+	BENCH_ENTROPY_ZERO,
+	BENCH_ENTROPY_TEXT,
+	BENCH_ENTROPY_RANDOM,
+
+	BENCH_ENTROPY_COUNT
+};
+
+static const char* BENCH_ENTROPIES_ToString(BENCH_ENTROPIES entropy)
+{
+	switch (entropy)
+	{
+		case BENCH_ENTROPY_ZERO:   return "zero";
+		case BENCH_ENTROPY_TEXT:   return "text";
+		case BENCH_ENTROPY_RANDOM: return "random";
+		default:                   break;
+	}
+
+	return "unknown";
+}
+
+struct BenchResult
+{
+	std::string   Name;
+	std::string   Entropy;
+	std::size_t   Size;
+	std::uint64_t Iterations;
+	double        NanosecondsPerIteration;
+	double        MegabytesPerSecond;
+};
+
+// prevents the compiler from discarding the result of a kernel
+static volatile std::uint64_t Bench_Sink;
+
+template<typename ... TArgs>
+inline void Console_WriteLine(const char* format, TArgs ... args)
+{
+	printf(format, args ...);
+	printf("\n");
+}
+
+void main_show_cli_usage(const char* arg0)
+{
+	Console_WriteLine("Example usage for %s", arg0);
+	Console_WriteLine("%s --min-time={ms} --filter={name}", arg0);
+}
+
+void FillBuffer(BenchBuffer& buffer, BENCH_ENTROPIES entropy)
+{
+	static constexpr char TEXT[] = "the quick brown fox jumps over the lazy dog 0123456789\n";
+
+	std::mt19937 random(
+		1
+	);
+
+	for (std::size_t i = 0; i < buffer.size(); ++i)
+	{
+		switch (entropy)
+		{
+			case BENCH_ENTROPY_ZERO:
+				buffer[i] = 0;
+				break;
+
+			case BENCH_ENTROPY_TEXT:
+				buffer[i] = static_cast<std::uint8_t>(TEXT[random() % (sizeof(TEXT) - 1)]);
+				break;
+
+			default:
+				buffer[i] = static_cast<std::uint8_t>(random());
+				break;
+		}
+	}
+}
+
+// F = void(*)()
+// runs callback until minTime has elapsed, at least once
+template<typename F>
+BenchResult Run(const char* lpName, const char* lpEntropy, std::size_t size, std::chrono::milliseconds minTime, F&& callback)
+{
+	BenchResult result;
+	result.Name = lpName;
+	result.Entropy = lpEntropy;
+	result.Size = size;
+	result.Iterations = 0;
+
+	// warm up caches and allocations
+	callback();
+
+	auto timeStart = BenchClock::now();
+	BenchClock::duration elapsed;
+
+	do
+	{
+		callback();
+
+		++result.Iterations;
+	} while ((elapsed = BenchClock::now() - timeStart) < minTime);
+
+	auto seconds = std::chrono::duration<double>(elapsed).count();
+
+	result.NanosecondsPerIteration = (seconds * 1000000000.0) / result.Iterations;
+	result.MegabytesPerSecond = ((static_cast<double>(size) * result.Iterations) / (1024.0 * 1024.0)) / seconds;
+
+	return result;
+}
+
+int main(int argc, char* argv[])
+{
+	CmdLineArgs args(
+		argc,
+		argv
+	);
+
+	std::uint32_t argMinTime = 200;
+	std::string argFilter;
+
+	args.TryGetValue("min-time", argMinTime);
+	args.TryGetValue("filter", argFilter);
+
+	if (argMinTime == 0)
+	{
+		main_show_cli_usage(argv[0]);
+
+		return -1;
+	}
+
+	static constexpr std::size_t CHUNK_SIZES[] =
+	{
+		4 * 1024,
+		64 * 1024,
+		1 * (1024 * 1024)
+	};
+
+	std::chrono::milliseconds minTime(
+		argMinTime
+	);
+
+	auto isEnabled = [&argFilter](const char* _lpName)
+	{
+		return argFilter.empty() || (std::string(_lpName).find(argFilter) != std::string::npos);
+	};
+
+	std::vector<BenchResult> results;
+
+	for (auto size : CHUNK_SIZES)
+	{
+		for (int entropy = 0; entropy < BENCH_ENTROPY_COUNT; ++entropy)
+		{
+			BenchBuffer source(size);
+			BenchBuffer compressed(size * 2);
+			BenchBuffer decompressed(size);
+
+			FillBuffer(
+				source,
+				static_cast<BENCH_ENTROPIES>(entropy)
+			);
+
+			if (isEnabled("CalculateFileChunkHash"))
+			{
+				results.push_back(
+					Run("CalculateFileChunkHash", BENCH_ENTROPIES_ToString(static_cast<BENCH_ENTROPIES>(entropy)), size, minTime, [&source, size]()
+					{
+						Bench_Sink = UFTSession::CalculateFileChunkHash(source, size);
+					})
+				);
+			}
+
+			if (isEnabled("CompressFileChunk"))
+			{
+				results.push_back(
+					Run("CompressFileChunk", BENCH_ENTROPIES_ToString(static_cast<BENCH_ENTROPIES>(entropy)), size, minTime, [&source, &compressed, size]()
+					{
+						Bench_Sink = UFTSession::CompressFileChunk(compressed, source, size);
+					})
+				);
+			}
+
+			if (isEnabled("DecompressFileChunk"))
+			{
+				auto compressedSize = UFTSession::CompressFileChunk(
+					compressed,
+					source,
+					size
+				);
+
+				results.push_back(
+					Run("DecompressFileChunk", BENCH_ENTROPIES_ToString(static_cast<BENCH_ENTROPIES>(entropy)), size, minTime, [&compressed, &decompressed, compressedSize]()
+					{
+						Bench_Sink = UFTSession::DecompressFileChunk(decompressed, compressed, compressedSize);
+					})
+				);
+			}
+		}
+
+		// ByteBuffer and BitConverter do not depend on entropy
+
+		if (isEnabled("ByteBuffer::Write"))
+		{
+			ByteBuffer buffer(size);
+
+			results.push_back(
+				Run("ByteBuffer::Write", "none", size, minTime, [&buffer, size]()
+				{
+					buffer.SetOffsetW(0);
+
+					for (std::size_t i = 0; i < (size / sizeof(std::uint64_t)); ++i)
+					{
+
+						buffer.Write(static_cast<std::uint64_t>(i));
+					}
+
+					Bench_Sink = buffer.GetSize();
+				})
+			);
+		}
+
+		if (isEnabled("ByteBuffer::Read"))
+		{
+			ByteBuffer buffer(size);
+
+			for (std::size_t i = 0; i < (size / sizeof(std::uint64_t)); ++i)
+			{
+
+				buffer.Write(static_cast<std::uint64_t>(i));
+			}
+
+			results.push_back(
+				Run("ByteBuffer::Read", "none", size, minTime, [&buffer, size]()
+				{
+					std::uint64_t value = 0;
+					std::uint64_t sum = 0;
+
+					buffer.SetOffsetR(0);
+
+					for (std::size_t i = 0; i < (size / sizeof(std::uint64_t)); ++i)
+					{
+						buffer.Read(value);
+
+						sum += value;
+					}
+
+					Bench_Sink = sum;
+				})
+			);
+		}
+
+		if (isEnabled("BitConverter::NetworkToHost"))
+		{
+			std::vector<std::uint64_t> values(
+				size / sizeof(std::uint64_t)
+			);
+
+			std::mt19937_64 random(
+				1
+			);
+
+			for (auto& value : values)
+			{
+
+				value = random();
+			}
+
+			results.push_back(
+				Run("BitConverter::NetworkToHost", "none", size, minTime, [&values]()
+				{
+					std::uint64_t sum = 0;
+
+					for (auto value : values)
+					{
+
+						sum += BitConverter::NetworkToHost(value);
+					}
+
+					Bench_Sink = sum;
+				})
+			);
+		}
+	}
+
+	printf("{\n\t\"benchmarks\": [\n");
+
+	for (std::size_t i = 0; i < results.size(); ++i)
+	{
+		auto& result = results[i];
+
+		printf(
+			"\t\t{\"name\": \"%s\", \"entropy\": \"%s\", \"size\": %llu, \"iterations\": %llu, \"ns_per_iteration\": %.1f, \"mb_per_second\": %.2f}%s\n",
+			result.Name.c_str(),
+			result.Entropy.c_str(),
+			static_cast<unsigned long long>(result.Size),
+			static_cast<unsigned long long>(result.Iterations),
+			result.NanosecondsPerIteration,
+			result.MegabytesPerSecond,
+			((i + 1) < results.size()) ? "," : ""
+		);
+	}
+
+	printf("\t]\n}\n");
+
+	return 0;
+}
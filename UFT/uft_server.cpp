@@ -1,4 +1,5 @@
 #include "CmdLineArgs.hpp"
+#include "UFTProfile.hpp"
 #include "UFTListener.hpp"
 
 #include <mutex>
@@ -30,6 +31,10 @@ void main_show_cli_usage(const char* arg0)
 {
 	Console_WriteLine("Example usage for %s", arg0);
 	Console_WriteLine("%s --local-host=127.0.0.1 --local-port=9000 --timeout={seconds}", arg0);
+	Console_WriteLine("Optional: --cc={udt|bbr} --profile=\"{path}\" --stats=json");
+#if defined(UFT_TRACE)
+	Console_WriteLine("Optional: --trace=\"{path}\" --trace-format={json|binary}");
+#endif
 }
 
 void main_on_arg_not_found(const std::string& arg)
@@ -50,6 +55,11 @@ int main(int argc, char* argv[])
 	std::string argLocalHost("127.0.0.1");
 	std::uint16_t argLocalPort = 9000;
 	std::uint32_t argTimeout = 15 * 1000;
+	std::string argCC; // optional
+	std::string argProfile; // optional
+	std::string argStats; // optional
+	std::string argTrace; // optional
+	std::string argTraceFormat("json"); // optional
 
 	if (!args.TryGetValue("local-host", argLocalHost, main_on_arg_not_found) ||
 		!args.TryGetValue("local-port", argLocalPort, main_on_arg_not_found) ||
@@ -60,6 +70,12 @@ int main(int argc, char* argv[])
 		return -1;
 	}
 
+	args.TryGetValue("cc", argCC);
+	args.TryGetValue("profile", argProfile);
+	args.TryGetValue("stats", argStats);
+	args.TryGetValue("trace", argTrace);
+	args.TryGetValue("trace-format", argTraceFormat);
+
 	in_addr addr;
 
 	if (inet_pton(AF_INET, argLocalHost.c_str(), &addr) != 1)
@@ -71,7 +87,43 @@ int main(int argc, char* argv[])
 		return -2;
 	}
 
+	UFTProfile profile;
+
+	if (!argProfile.empty() && !UFTProfile_Load(argProfile.c_str(), profile))
+	{
+		Console_WriteLine(
+			"Error loading profile '%s'",
+			argProfile.c_str()
+		);
+
+		return -7;
+	}
+
+	// --cc overrides the congestion control of the profile
+	UFTSOCKET_CONGESTION_CONTROLS congestionControl = profile.CongestionControl;
+
+	if (!argCC.empty() && !UFTSOCKET_CONGESTION_CONTROLS_FromString(argCC.c_str(), congestionControl))
+	{
+		Console_WriteLine(
+			"Invalid congestion control '%s'",
+			argCC.c_str()
+		);
+
+		main_show_cli_usage(argv[0]);
+
+		return -3;
+	}
+
 	UFTListener listener;
+
+	// accepted sessions inherit the congestion control and the options of the listener
+	listener.GetSocket().SetCongestionControl(
+		congestionControl
+	);
+
+	listener.GetSocket().SetOptions(
+		profile.Options
+	);
 	
 	if (!listener.Listen(ntohl(addr.s_addr), argLocalPort, 1))
 	{
@@ -146,5 +198,30 @@ int main(int argc, char* argv[])
 			break;
 	}
 
+	if (!argStats.compare("json"))
+	{
+
+		Console_WriteLine(
+			"%s",
+			UFTSession_Stats_ToJSON(session.GetStats(), session.GetSocketPerformance()).c_str()
+		);
+	}
+
+#if defined(UFT_TRACE)
+	if (!argTrace.empty())
+	{
+		bool success = !argTraceFormat.compare("binary") ? UFTTrace::WriteBinary(argTrace.c_str()) : UFTTrace::WriteChromeJSON(argTrace.c_str());
+
+		if (!success)
+		{
+
+			Console_WriteLine(
+				"Error writing trace to '%s'",
+				argTrace.c_str()
+			);
+		}
+	}
+#endif
+
 	return 0;
 }
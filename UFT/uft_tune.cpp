@@ -0,0 +1,447 @@
+#include "UFTSocket.hpp"
+#include "CmdLineArgs.hpp"
+#include "UFTProfile.hpp"
+#include "UDPImpairmentRelay.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+
+#include <arpa/inet.h>
+
+static constexpr std::uint32_t TUNE_SEND_SIZE  = 1 * (1024 * 1024);
+static constexpr std::int32_t  TUNE_IO_TIMEOUT = 200; // milliseconds, bounds how long a trial takes to stop
+
+typedef std::chrono::steady_clock TuneClock;
+
+struct TuneSettings
+{
+	std::uint16_t LocalPort        = 9200;
+	std::uint32_t Passes           = 1;
+	std::uint32_t IntervalMS       = 250;   // length of one throughput sample
+	std::uint32_t MaxTrialMS       = 10000; // a trial that has not converged ends here
+	std::uint32_t WindowSamples    = 4;     // a trial has converged once this many samples agree
+	double        TolerancePercent = 10;    // ... within this much of their mean
+	std::uint32_t MaxMSS           = 9000;
+
+	bool                         IsRelayEnabled = false;
+	UDPImpairmentRelay::Settings Relay;
+};
+
+struct TuneTrial
+{
+	double Mbps      = 0; // mean of the last samples
+	double Seconds   = 0;
+	bool   Converged = false;
+};
+
+struct TuneParameter
+{
+	const char*               lpName;
+	std::vector<std::int32_t> Values; // 0 keeps the UDT default
+
+	std::int32_t(*Get)(const UFTProfile& profile);
+	void(*Set)(UFTProfile& profile, std::int32_t value);
+};
+
+template<typename ... TArgs>
+inline void Console_WriteLine(const char* format, TArgs ... args)
+{
+	printf(format, args ...);
+	printf("\n");
+	fflush(stdout);
+}
+
+void main_show_cli_usage(const char* arg0)
+{
+	Console_WriteLine("Example usage for %s", arg0);
+	Console_WriteLine("%s --output=\"{path}\"", arg0);
+	Console_WriteLine("Optional: --local-port=9200 --passes={count} --interval={ms} --max-trial-time={ms} --tolerance={percent} --max-mss={bytes}");
+	Console_WriteLine("Optional: --delay={ms} --jitter={ms} --loss={percent} --rate={mbps} --queue={packets}");
+}
+
+std::string GetValueString(const TuneParameter& parameter, std::int32_t value)
+{
+	if (!std::strcmp(parameter.lpName, "cc"))
+	{
+
+		return UFTSOCKET_CONGESTION_CONTROLS_ToString(static_cast<UFTSOCKET_CONGESTION_CONTROLS>(value));
+	}
+
+	return value ? std::to_string(value) : std::string("default");
+}
+
+// @return false if the sockets could not be set up or connected
+bool RunTrial(const UFTProfile& profile, const TuneSettings& settings, std::uint16_t port, TuneTrial& trial)
+{
+	UFTSocket listener;
+
+	if (!listener.SetCongestionControl(profile.CongestionControl) ||
+		!listener.SetOptions(profile.Options) ||
+		!listener.Open())
+	{
+
+		return false;
+	}
+
+	if (!listener.Listen(INADDR_LOOPBACK, port, 1))
+	{
+		listener.Close();
+
+		return false;
+	}
+
+	UDPImpairmentRelay relay;
+	std::uint16_t remotePort = port;
+
+	if (settings.IsRelayEnabled)
+	{
+		if (!relay.Start(0, port, settings.Relay))
+		{
+			listener.Close();
+
+			return false;
+		}
+
+		remotePort = relay.GetLocalPort();
+	}
+
+	std::atomic<bool> isStopping(false);
+	std::atomic<std::uint64_t> bytesReceived(0);
+
+	std::thread receiveThread(
+		[&listener, &isStopping, &bytesReceived]()
+		{
+			UFTSocket socket;
+
+			if (!listener.Accept(socket) || !socket.SetTimeout(TUNE_IO_TIMEOUT))
+			{
+
+				return;
+			}
+
+			std::vector<std::uint8_t> buffer(
+				TUNE_SEND_SIZE
+			);
+
+			while (!isStopping)
+			{
+				auto bytesRead = socket.Receive(&buffer[0], TUNE_SEND_SIZE);
+
+				if (bytesRead == 0)
+				{
+
+					break;
+				}
+
+				if (bytesRead > 0)
+				{
+
+					bytesReceived += bytesRead;
+				}
+			}
+
+			// closing the receiving side first ends the sender's linger on unacknowledged data
+			socket.Close();
+		}
+	);
+
+	UFTSocket sender;
+
+	bool isConnected = sender.SetCongestionControl(profile.CongestionControl) &&
+		sender.SetOptions(profile.Options) &&
+		sender.Open() &&
+		sender.Connect(INADDR_LOOPBACK, remotePort) &&
+		sender.SetTimeout(TUNE_IO_TIMEOUT);
+
+	std::thread sendThread;
+
+	if (isConnected)
+	{
+		sendThread = std::thread(
+			[&sender, &isStopping]()
+			{
+				std::vector<std::uint8_t> buffer(
+					TUNE_SEND_SIZE
+				);
+
+				while (!isStopping && sender.IsConnected())
+				{
+
+					sender.Send(&buffer[0], TUNE_SEND_SIZE);
+				}
+			}
+		);
+
+		std::vector<double> samples;
+
+		auto timeStart = TuneClock::now();
+		auto timeSample = timeStart;
+		std::uint64_t bytesSample = 0;
+
+		while (sender.IsConnected())
+		{
+			std::this_thread::sleep_until(
+				timeSample + std::chrono::milliseconds(settings.IntervalMS)
+			);
+
+			auto now = TuneClock::now();
+			std::uint64_t bytes = bytesReceived;
+
+			samples.push_back(
+				(bytes - bytesSample) * 8.0 / std::chrono::duration<double, std::micro>(now - timeSample).count()
+			);
+
+			timeSample = now;
+			bytesSample = bytes;
+			trial.Seconds = std::chrono::duration<double>(now - timeStart).count();
+
+			// the first sample includes the connection ramp up and is never part of the window
+			if (samples.size() > settings.WindowSamples)
+			{
+				auto first = samples.end() - settings.WindowSamples;
+				auto range = std::minmax_element(first, samples.end());
+
+				trial.Mbps = 0;
+
+				for (auto it = first; it != samples.end(); ++it)
+				{
+
+					trial.Mbps += *it / settings.WindowSamples;
+				}
+
+				if ((trial.Mbps > 0) && ((*range.second - *range.first) <= (trial.Mbps * settings.TolerancePercent / 100)))
+				{
+					trial.Converged = true;
+
+					break;
+				}
+			}
+
+			if (trial.Seconds * 1000 >= settings.MaxTrialMS)
+			{
+
+				break;
+			}
+		}
+	}
+
+	isStopping = true;
+
+	// wakes up the receiving thread if the sender never connected
+	listener.Close();
+	receiveThread.join();
+
+	if (sendThread.joinable())
+	{
+
+		sendThread.join();
+	}
+
+	sender.Close();
+	relay.Stop();
+
+	return isConnected;
+}
+
+int main(int argc, char* argv[])
+{
+	CmdLineArgs args(
+		argc,
+		argv
+	);
+
+	std::string argOutput;
+	TuneSettings settings;
+
+	if (!args.TryGetValue("output", argOutput))
+	{
+		main_show_cli_usage(argv[0]);
+
+		return -1;
+	}
+
+	args.TryGetValue("local-port", settings.LocalPort);
+	args.TryGetValue("passes", settings.Passes);
+	args.TryGetValue("interval", settings.IntervalMS);
+	args.TryGetValue("max-trial-time", settings.MaxTrialMS);
+	args.TryGetValue("tolerance", settings.TolerancePercent);
+	args.TryGetValue("max-mss", settings.MaxMSS);
+	args.TryGetValue("delay", settings.Relay.DelayMS);
+	args.TryGetValue("jitter", settings.Relay.JitterMS);
+	args.TryGetValue("loss", settings.Relay.LossPercent);
+	args.TryGetValue("rate", settings.Relay.RateMbps);
+	args.TryGetValue("queue", settings.Relay.QueuePackets);
+
+	if (!settings.Passes || !settings.IntervalMS || (settings.TolerancePercent <= 0))
+	{
+		main_show_cli_usage(argv[0]);
+
+		return -2;
+	}
+
+	settings.IsRelayEnabled = settings.Relay.DelayMS || settings.Relay.JitterMS || (settings.Relay.LossPercent > 0) || settings.Relay.RateMbps;
+
+	// the UDP buffers come first because UDT limits the MSS to them, the flow window last
+	// because UDT limits the receive buffer to it
+	std::vector<TuneParameter> parameters =
+	{
+		{
+			"cc",
+			{ UFTSOCKET_CONGESTION_CONTROL_UDT, UFTSOCKET_CONGESTION_CONTROL_BBR },
+			[](const UFTProfile& _profile) { return static_cast<std::int32_t>(_profile.CongestionControl); },
+			[](UFTProfile& _profile, std::int32_t _value) { _profile.CongestionControl = static_cast<UFTSOCKET_CONGESTION_CONTROLS>(_value); }
+		},
+		{
+			"udp-buffer",
+			{ 0, 1 * (1024 * 1024), 4 * (1024 * 1024), 16 * (1024 * 1024) },
+			[](const UFTProfile& _profile) { return _profile.Options.UDPSendBuffer; },
+			[](UFTProfile& _profile, std::int32_t _value) { _profile.Options.UDPSendBuffer = _profile.Options.UDPReceiveBuffer = _value; }
+		},
+		{
+			"mss",
+			{ 0, 4000, 9000, 16000, 32000 },
+			[](const UFTProfile& _profile) { return _profile.Options.MSS; },
+			[](UFTProfile& _profile, std::int32_t _value) { _profile.Options.MSS = _value; }
+		},
+		{
+			"udt-buffer",
+			{ 0, 32 * (1024 * 1024), 128 * (1024 * 1024) },
+			[](const UFTProfile& _profile) { return _profile.Options.UDTSendBuffer; },
+			[](UFTProfile& _profile, std::int32_t _value) { _profile.Options.UDTSendBuffer = _profile.Options.UDTReceiveBuffer = _value; }
+		},
+		{
+			"fc",
+			{ 0, 65536, 262144 },
+			[](const UFTProfile& _profile) { return _profile.Options.FlowWindow; },
+			[](UFTProfile& _profile, std::int32_t _value) { _profile.Options.FlowWindow = _value; }
+		}
+	};
+
+	// the MSS can not be larger than the MTU of the path that is being tuned for
+	auto& mssValues = parameters[2].Values;
+
+	mssValues.erase(
+		std::remove_if(mssValues.begin(), mssValues.end(), [&settings](std::int32_t _value) { return _value > static_cast<std::int32_t>(settings.MaxMSS); }),
+		mssValues.end()
+	);
+
+	Console_WriteLine(
+		"Tuning over %s: delay %u ms, jitter %u ms, loss %.2f%%, rate %u Mb/s, queue %u packets",
+		settings.IsRelayEnabled ? "an emulated link" : "loopback",
+		settings.Relay.DelayMS,
+		settings.Relay.JitterMS,
+		settings.Relay.LossPercent,
+		settings.Relay.RateMbps,
+		settings.Relay.QueuePackets
+	);
+
+	UFTProfile profile;
+	double profileMbps = 0;
+	std::uint16_t port = settings.LocalPort;
+
+	for (std::uint32_t pass = 0; pass < settings.Passes; ++pass)
+	{
+		for (auto& parameter : parameters)
+		{
+			// the current value is measured first, another one has to beat it by more than the tolerance
+			std::vector<std::int32_t> values(
+				1,
+				parameter.Get(profile)
+			);
+
+			for (auto value : parameter.Values)
+			{
+				if (value != values[0])
+				{
+
+					values.push_back(value);
+				}
+			}
+
+			std::int32_t bestValue = values[0];
+			double bestMbps = 0;
+
+			for (std::size_t i = 0; i < values.size(); ++i)
+			{
+				UFTProfile candidate = profile;
+				parameter.Set(candidate, values[i]);
+
+				TuneTrial trial;
+
+				// every trial listens on a new port, UDT releases closed ones in the background
+				if (!RunTrial(candidate, settings, port++, trial))
+				{
+					Console_WriteLine(
+						"%-10s %-10s error",
+						parameter.lpName,
+						GetValueString(parameter, values[i]).c_str()
+					);
+
+					continue;
+				}
+
+				Console_WriteLine(
+					"%-10s %-10s %10.1f Mb/s %6.1f s %s",
+					parameter.lpName,
+					GetValueString(parameter, values[i]).c_str(),
+					trial.Mbps,
+					trial.Seconds,
+					trial.Converged ? "converged" : "not converged"
+				);
+
+				if ((i == 0) || (trial.Mbps > bestMbps * (1 + settings.TolerancePercent / 100)))
+				{
+					bestValue = values[i];
+					bestMbps = trial.Mbps;
+				}
+			}
+
+			parameter.Set(profile, bestValue);
+			profileMbps = bestMbps;
+		}
+	}
+
+	char comment[256];
+
+	snprintf(
+		comment,
+		sizeof(comment),
+		"uft_tune: %.1f Mb/s over %s (delay %u ms, jitter %u ms, loss %.2f%%, rate %u Mb/s, queue %u packets)",
+		profileMbps,
+		settings.IsRelayEnabled ? "an emulated link" : "loopback",
+		settings.Relay.DelayMS,
+		settings.Relay.JitterMS,
+		settings.Relay.LossPercent,
+		settings.Relay.RateMbps,
+		settings.Relay.QueuePackets
+	);
+
+	if (!UFTProfile_Save(argOutput.c_str(), profile, comment))
+	{
+		Console_WriteLine(
+			"Error writing '%s'",
+			argOutput.c_str()
+		);
+
+		return -3;
+	}
+
+	Console_WriteLine(
+		"Recommended profile (%.1f Mb/s) written to '%s': cc=%s mss=%s fc=%s udt-buffer=%s udp-buffer=%s",
+		profileMbps,
+		argOutput.c_str(),
+		UFTSOCKET_CONGESTION_CONTROLS_ToString(profile.CongestionControl),
+		GetValueString(parameters[2], profile.Options.MSS).c_str(),
+		GetValueString(parameters[4], profile.Options.FlowWindow).c_str(),
+		GetValueString(parameters[3], profile.Options.UDTSendBuffer).c_str(),
+		GetValueString(parameters[1], profile.Options.UDPSendBuffer).c_str()
+	);
+
+	return 0;
+}
@@ -14,6 +14,9 @@ public:
 
       setACKInterval(2);
       setRTO(1000000);
+
+      m_iLastACK = m_iSndCurrSeqNo;
+      m_iDupACKCount = 0;
    }
 
    virtual void onACK(const int& ack)
@@ -0,0 +1,183 @@
+// Congestion control comparison: runs each CCC through scripted scenarios on the simulated link
+// in sim.h and reports goodput, utilization, fairness, queueing delay and retransmissions. The
+// simulation is deterministic, so two runs with the same seed print the same numbers.
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <sstream>
+#include <iostream>
+#include <iomanip>
+#include <sim.h>
+#include "cc.h"
+
+using namespace std;
+
+// UDP blast at a fixed share of the bottleneck: a non-adaptive baseline.
+class CSimBlast: public CUDPBlast
+{
+public:
+   void init()
+   {
+      setRate(s_dRate);
+   }
+
+public:
+   static double s_dRate;
+};
+
+double CSimBlast::s_dRate = 100;
+
+struct Scenario
+{
+   const char* m_pcName;
+   const char* m_pcDesc;
+   double m_dRate;		// Mb/s
+   int m_iRTT;			// ms
+   int m_iBuffer;		// packets, 0 for one BDP
+   double m_dLoss;
+   double m_dBurstStart;
+   double m_dBurstEnd;
+   double m_dBurstLoss;
+   int m_iFlows;
+   int m_iStagger;		// delay between flow starts, seconds
+   int m_iDuration;		// seconds
+};
+
+static const Scenario g_Scenarios[] =
+{
+   {"clean", "100Mb/s, 40ms, 1 BDP buffer, no loss", 100, 40, 0, 0, 0, 0, 0, 1, 0, 30},
+   {"lossy", "100Mb/s, 40ms, 1 BDP buffer, 1% random loss", 100, 40, 0, 0.01, 0, 0, 0, 1, 0, 30},
+   {"bursty", "100Mb/s, 40ms, 1 BDP buffer, bursts of ~10 pkts at 50% loss", 100, 40, 0, 0, 0.0005, 0.1, 0.5, 1, 0, 30},
+   {"shallow", "1Gb/s, 20ms, 100 pkt buffer", 1000, 20, 100, 0, 0, 0, 0, 1, 0, 20},
+   {"bloat", "20Mb/s, 20ms, 2000 pkt buffer", 20, 20, 2000, 0, 0, 0, 0, 1, 0, 30},
+   {"fair", "100Mb/s, 40ms, 1 BDP buffer, 2 flows 10s apart", 100, 40, 0, 0, 0, 0, 0, 2, 10, 60},
+   {"fair4", "100Mb/s, 40ms, 1 BDP buffer, 4 flows 5s apart", 100, 40, 0, 0, 0, 0, 0, 4, 5, 60}
+};
+
+static const char* g_pcCCs[] = {"udt", "bbr", "tcp", "blast"};
+
+static CCCVirtualFactory* createFactory(const string& cc)
+{
+   if (cc == "udt")
+      return new CCCFactory<CUDTCC>;
+   if (cc == "bbr")
+      return new CCCFactory<CBBRCC>;
+   if (cc == "tcp")
+      return new CCCFactory<CTCP>;
+   return new CCCFactory<CSimBlast>;
+}
+
+static void runScenario(const Scenario& s, const string& cc, const uint64_t& seed)
+{
+   CSimLink link;
+   link.m_dRate = s.m_dRate;
+   link.m_iRTT = s.m_iRTT * 1000;
+   link.m_iBuffer = (s.m_iBuffer > 0) ? s.m_iBuffer : int(s.m_dRate * s.m_iRTT * 1000 / (link.m_iMSS * 8));
+   link.m_dLoss = s.m_dLoss;
+   link.m_dBurstStart = s.m_dBurstStart;
+   link.m_dBurstEnd = s.m_dBurstEnd;
+   link.m_dBurstLoss = s.m_dBurstLoss;
+
+   // blast paces whole packets at its share of the link rate
+   CSimBlast::s_dRate = s.m_dRate / s.m_iFlows;
+
+   CSimulator sim(link, seed);
+   CCCVirtualFactory* factory = createFactory(cc);
+
+   uint64_t duration = s.m_iDuration * 1000000ULL;
+   for (int i = 0; i < s.m_iFlows; ++ i)
+      sim.addFlow(factory, i * s.m_iStagger * 1000000ULL, duration);
+
+   sim.run(duration);
+
+   double goodput = 0;
+   double avgdelay = 0;
+   double maxdelay = 0;
+   int64_t sent = 0;
+   int64_t retrans = 0;
+   int64_t dropped = 0;
+   int64_t lost = 0;
+   int timeouts = 0;
+   stringstream flows;
+   flows << fixed << setprecision(1);
+
+   for (int i = 0; i < s.m_iFlows; ++ i)
+   {
+      CSimStats st;
+      sim.getStats(i, st);
+
+      goodput += st.m_dGoodput;
+      avgdelay += st.m_dAvgQueueDelay * st.m_llSent;
+      if (st.m_dMaxQueueDelay > maxdelay)
+         maxdelay = st.m_dMaxQueueDelay;
+      sent += st.m_llSent;
+      retrans += st.m_llRetrans;
+      dropped += st.m_llDropped;
+      lost += st.m_llLost;
+      timeouts += st.m_iTimeouts;
+
+      if (i > 0)
+         flows << "/";
+      flows << st.m_dGoodput;
+   }
+
+   if (sent > 0)
+      avgdelay /= sent;
+
+   cout << setw(9) << s.m_pcName << setw(7) << cc
+        << fixed << setprecision(2)
+        << setw(11) << goodput << setw(8) << sim.getUtilization() * 100 << setw(8) << sim.getFairness()
+        << setw(11) << avgdelay << setw(11) << maxdelay
+        << setw(10) << ((sent > 0) ? retrans * 100.0 / sent : 0)
+        << setw(9) << dropped << setw(9) << lost << setw(6) << timeouts
+        << "  " << flows.str() << endl;
+
+   delete factory;
+}
+
+int main(int argc, char* argv[])
+{
+   string scenario = (argc > 1) ? argv[1] : "all";
+   string cc = (argc > 2) ? argv[2] : "all";
+   uint64_t seed = (argc > 3) ? strtoull(argv[3], NULL, 10) : 1;
+
+   const int scenarios = sizeof(g_Scenarios) / sizeof(Scenario);
+   const int ccs = sizeof(g_pcCCs) / sizeof(char*);
+
+   bool valid = (argc <= 4) && (seed > 0);
+   bool found = (scenario == "all");
+   for (int i = 0; i < scenarios; ++ i)
+      found = found || (scenario == g_Scenarios[i].m_pcName);
+   valid = valid && found;
+   found = (cc == "all");
+   for (int i = 0; i < ccs; ++ i)
+      found = found || (cc == g_pcCCs[i]);
+   valid = valid && found;
+
+   if (!valid)
+   {
+      cout << "usage: ccsim [scenario|all] [udt|bbr|tcp|blast|all] [seed]" << endl;
+      for (int i = 0; i < scenarios; ++ i)
+         cout << "   " << setw(8) << left << g_Scenarios[i].m_pcName << right << " " << g_Scenarios[i].m_pcDesc << endl;
+      return 0;
+   }
+
+   cout << setw(9) << "scenario" << setw(7) << "cc" << setw(11) << "goodput" << setw(8) << "util%" << setw(8) << "jain"
+        << setw(11) << "qdelay_avg" << setw(11) << "qdelay_max" << setw(10) << "retrans%"
+        << setw(9) << "dropped" << setw(9) << "lost" << setw(6) << "exp" << "  flows(Mb/s)" << endl;
+
+   for (int i = 0; i < scenarios; ++ i)
+   {
+      if ((scenario != "all") && (scenario != g_Scenarios[i].m_pcName))
+         continue;
+
+      for (int j = 0; j < ccs; ++ j)
+      {
+         if ((cc == "all") || (cc == g_pcCCs[j]))
+            runScenario(g_Scenarios[i], g_pcCCs[j], seed);
+      }
+   }
+
+   return 0;
+}
@@ -0,0 +1,263 @@
+// Connection storm benchmark: many clients connect asynchronously at once, as agents do after a
+// server restart, and complete the connect via epoll while the server takes them with acceptBatch.
+// A connection set up before the storm keeps exchanging small messages, to show how much the
+// handshakes delay the data packets of established connections.
+
+#include <unistd.h>
+#include <cstdlib>
+#include <cstring>
+#include <arpa/inet.h>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <udt.h>
+#include <common.h>
+
+using namespace std;
+
+static const int g_iMsgSize = 64;
+
+struct Server
+{
+   UDTSOCKET m_Listener;
+   vector<UDTSOCKET> m_Accepted;
+   volatile bool m_bStop;
+   pthread_mutex_t m_Lock;
+};
+
+struct Probe
+{
+   UDTSOCKET m_Client;
+   UDTSOCKET m_Server;
+   volatile bool m_bStop;
+   vector<double> m_vRTT;              // round trip times in milliseconds
+};
+
+static void* accepter(void* param)
+{
+   Server* s = (Server*)param;
+   UDTSOCKET socks[256];
+
+   while (!s->m_bStop)
+   {
+      int n = UDT::acceptBatch(s->m_Listener, socks, 256);
+      if (UDT::ERROR == n)
+         break;
+
+      pthread_mutex_lock(&s->m_Lock);
+      s->m_Accepted.insert(s->m_Accepted.end(), socks, socks + n);
+      pthread_mutex_unlock(&s->m_Lock);
+   }
+
+   return NULL;
+}
+
+static void* echo(void* param)
+{
+   Probe* p = (Probe*)param;
+   char data[g_iMsgSize];
+
+   while (UDT::ERROR != UDT::recvmsg(p->m_Server, data, g_iMsgSize))
+   {
+      if (UDT::ERROR == UDT::sendmsg(p->m_Server, data, g_iMsgSize))
+         break;
+   }
+
+   return NULL;
+}
+
+static void* ping(void* param)
+{
+   Probe* p = (Probe*)param;
+   char data[g_iMsgSize];
+   memset(data, 0, g_iMsgSize);
+
+   while (!p->m_bStop)
+   {
+      uint64_t start = CTimer::getTime();
+
+      if ((UDT::ERROR == UDT::sendmsg(p->m_Client, data, g_iMsgSize)) || (UDT::ERROR == UDT::recvmsg(p->m_Client, data, g_iMsgSize)))
+         break;
+
+      p->m_vRTT.push_back((CTimer::getTime() - start) / 1000.0);
+      usleep(1000);
+   }
+
+   return NULL;
+}
+
+static double percentile(vector<double> values, const double& p)
+{
+   if (values.empty())
+      return 0;
+
+   sort(values.begin(), values.end());
+   return values[(size_t)(p * (values.size() - 1))];
+}
+
+int main(int argc, char* argv[])
+{
+   // clients connecting at once, number of rounds
+   int clients = 500;
+   int rounds = 5;
+   if (argc > 1)
+      clients = atoi(argv[1]);
+   if (argc > 2)
+      rounds = atoi(argv[2]);
+
+   if ((argc > 3) || (clients <= 0) || (rounds <= 0))
+   {
+      cout << "usage: connbench [clients] [rounds]" << endl;
+      return 0;
+   }
+
+   UDT::startup();
+
+   sockaddr_in addr;
+   memset(&addr, 0, sizeof(addr));
+   addr.sin_family = AF_INET;
+   addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+   Server server;
+   server.m_Listener = UDT::socket(AF_INET, SOCK_DGRAM, 0);
+   server.m_bStop = false;
+   pthread_mutex_init(&server.m_Lock, NULL);
+
+   int addrlen = sizeof(addr);
+   if ((UDT::ERROR == UDT::bind(server.m_Listener, (sockaddr*)&addr, sizeof(addr))) || (UDT::ERROR == UDT::listen(server.m_Listener, clients + 1)))
+   {
+      cout << "listen: " << UDT::getlasterror().getErrorMessage() << endl;
+      return 1;
+   }
+   UDT::getsockname(server.m_Listener, (sockaddr*)&addr, &addrlen);
+
+   // the probe connection is set up before the storm
+   Probe probe;
+   probe.m_Client = UDT::socket(AF_INET, SOCK_DGRAM, 0);
+   if ((UDT::ERROR == UDT::connect(probe.m_Client, (sockaddr*)&addr, sizeof(addr))) || (UDT::INVALID_SOCK == (probe.m_Server = UDT::accept(server.m_Listener, NULL, NULL))))
+   {
+      cout << "probe: " << UDT::getlasterror().getErrorMessage() << endl;
+      return 1;
+   }
+
+   pthread_t accepter_thread, echo_thread;
+   pthread_create(&accepter_thread, NULL, accepter, &server);
+   pthread_create(&echo_thread, NULL, echo, &probe);
+
+   cout << setw(8) << "round" << setw(10) << "clients" << setw(10) << "failed" << setw(12) << "conn/s"
+        << setw(16) << "connect p50 ms" << setw(16) << "connect p99 ms" << setw(14) << "ping p50 ms" << setw(14) << "ping p99 ms" << endl;
+
+   vector<UDTSOCKET> socks(clients);
+   map<UDTSOCKET, uint64_t> starts;
+   vector<UDTSOCKET> ready(clients);
+
+   for (int r = 0; r < rounds; ++ r)
+   {
+      probe.m_bStop = false;
+      probe.m_vRTT.clear();
+      pthread_t ping_thread;
+      pthread_create(&ping_thread, NULL, ping, &probe);
+
+      int eid = UDT::epoll_create();
+      bool rcvsyn = false;
+      int events = UDT_EPOLL_OUT;
+
+      // the clients share one UDP port, otherwise each one would start its own sending and receiving threads
+      sockaddr_in local;
+      memset(&local, 0, sizeof(local));
+      local.sin_family = AF_INET;
+      local.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+      int locallen = sizeof(local);
+
+      for (int i = 0; i < clients; ++ i)
+      {
+         socks[i] = UDT::socket(AF_INET, SOCK_DGRAM, 0);
+         UDT::setsockopt(socks[i], 0, UDT_RCVSYN, &rcvsyn, sizeof(bool));
+         UDT::bind(socks[i], (sockaddr*)&local, sizeof(local));
+         if (0 == i)
+            UDT::getsockname(socks[i], (sockaddr*)&local, &locallen);
+         UDT::epoll_add_usock(eid, socks[i], &events);
+      }
+
+      uint64_t start = CTimer::getTime();
+
+      for (int i = 0; i < clients; ++ i)
+      {
+         starts[socks[i]] = CTimer::getTime();
+         UDT::connect(socks[i], (sockaddr*)&addr, sizeof(addr));
+      }
+
+      // complete the connects as epoll reports them
+      vector<double> times;
+      int failed = 0;
+      int pending = clients;
+      while (pending > 0)
+      {
+         int wnum = clients;
+         if (UDT::ERROR == UDT::epoll_wait2(eid, NULL, NULL, &ready[0], &wnum, 1000))
+            break;
+
+         uint64_t now = CTimer::getTime();
+         for (int i = 0; i < wnum; ++ i)
+         {
+            UDTSTATUS status = UDT::getsockstate(ready[i]);
+            if (CONNECTING == status)
+               continue;
+
+            if (CONNECTED == status)
+               times.push_back((now - starts[ready[i]]) / 1000.0);
+            else
+               ++ failed;
+
+            UDT::epoll_remove_usock(eid, ready[i]);
+            -- pending;
+         }
+      }
+
+      // the round ends when the server has taken all connections
+      for (int wait = 0; wait < 10000; ++ wait)
+      {
+         pthread_mutex_lock(&server.m_Lock);
+         int accepted = server.m_Accepted.size();
+         pthread_mutex_unlock(&server.m_Lock);
+
+         if (accepted >= clients - failed)
+            break;
+         usleep(100);
+      }
+
+      double duration = (CTimer::getTime() - start) / 1000000.0;
+
+      probe.m_bStop = true;
+      pthread_join(ping_thread, NULL);
+
+      cout << setw(8) << r << setw(10) << clients << setw(10) << failed << fixed << setprecision(0) << setw(12) << (clients - failed) / duration
+           << setprecision(2) << setw(16) << percentile(times, 0.5) << setw(16) << percentile(times, 0.99)
+           << setw(14) << percentile(probe.m_vRTT, 0.5) << setw(14) << percentile(probe.m_vRTT, 0.99) << endl;
+
+      UDT::epoll_release(eid);
+      starts.clear();
+
+      for (int i = 0; i < clients; ++ i)
+         UDT::close(socks[i]);
+
+      pthread_mutex_lock(&server.m_Lock);
+      for (vector<UDTSOCKET>::iterator i = server.m_Accepted.begin(); i != server.m_Accepted.end(); ++ i)
+         UDT::close(*i);
+      server.m_Accepted.clear();
+      pthread_mutex_unlock(&server.m_Lock);
+   }
+
+   server.m_bStop = true;
+   UDT::close(server.m_Listener);
+   UDT::close(probe.m_Client);
+   UDT::close(probe.m_Server);
+   pthread_join(accepter_thread, NULL);
+   pthread_join(echo_thread, NULL);
+
+   UDT::cleanup();
+
+   return 0;
+}
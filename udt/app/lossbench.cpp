@@ -0,0 +1,185 @@
+// Loss list benchmark: replays the loss list traffic of a sender and a receiver over windows of
+// packets with random, bursty and tail loss. The receiver records gaps, reports them in NAKs and
+// removes retransmitted packets; the sender merges the NAKs, hands out the lost packets and drops
+// them on ACK. It reports the cost of the loss list operations per packet and per lost packet.
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <iomanip>
+#include <common.h>
+#include <list.h>
+
+using namespace std;
+
+enum Pattern {RANDOM, BURSTY, TAIL};
+
+static const char* patternName(Pattern p)
+{
+   switch (p)
+   {
+   case RANDOM:
+      return "random";
+   case BURSTY:
+      return "bursty";
+   default:
+      return "tail";
+   }
+}
+
+// decides which packets of a window are lost; the last packet of a window always arrives
+class CLossModel
+{
+public:
+   CLossModel(Pattern p, const double& rate, const int& window):
+   m_Pattern(p),
+   m_dRate(rate),
+   m_iWindow(window),
+   m_iBurst(0)
+   {
+   }
+
+   bool lost(const int& pos)
+   {
+      if (pos == m_iWindow - 1)
+         return false;
+
+      switch (m_Pattern)
+      {
+      case RANDOM:
+         return rand() < m_dRate * RAND_MAX;
+
+      case BURSTY:
+         // bursts of 50 to 500 packets, as many of them as give the same average rate
+         if (m_iBurst > 0)
+         {
+            -- m_iBurst;
+            return true;
+         }
+         if (rand() < m_dRate / 275 * RAND_MAX)
+         {
+            m_iBurst = 49 + rand() % 451;
+            return true;
+         }
+         return false;
+
+      default:
+         return pos >= m_iWindow * (1 - m_dRate);
+      }
+   }
+
+private:
+   Pattern m_Pattern;
+   double m_dRate;
+   int m_iWindow;
+   int m_iBurst;
+};
+
+static void run(Pattern p, const double& rate, const int& window, const int& rounds)
+{
+   CSndLossList snd(window * 2);
+   CRcvLossList rcv(window);
+   CLossModel model(p, rate, window);
+
+   // the NAK array is limited by the payload size, as in CUDT::sendCtrl()
+   const int limit = 1456 / 4;
+   int32_t nak[limit];
+
+   // start close to the largest seq. no. so that the seq. no. wraps during the run
+   int32_t base = CSeqNo::m_iMaxSeqNo - window * rounds / 2;
+   int64_t lost = 0;
+   int64_t naks = 0;
+
+   uint64_t start = CTimer::getTime();
+
+   for (int r = 0; r < rounds; ++ r)
+   {
+      // first transmission: the receiver detects the gaps and acknowledges periodically
+      int32_t curr = CSeqNo::decseq(base);
+      for (int i = 0; i < window; ++ i)
+      {
+         int32_t seqno = CSeqNo::incseq(base, i);
+         if (model.lost(i))
+         {
+            ++ lost;
+            continue;
+         }
+
+         if (CSeqNo::incseq(curr) != seqno)
+            rcv.insert(CSeqNo::incseq(curr), CSeqNo::decseq(seqno));
+         curr = seqno;
+
+         if (0 == (i & 63))
+            rcv.getFirstLostSeq();
+      }
+
+      // loss recovery: NAK, merge at the sender, retransmit until nothing is missing
+      while (rcv.getLossLength() > 0)
+      {
+         int len;
+         rcv.getLossArray(nak, len, limit);
+         ++ naks;
+
+         for (int i = 0; i < len; ++ i)
+         {
+            if (0 != (nak[i] & 0x80000000))
+            {
+               snd.insert(nak[i] & 0x7FFFFFFF, nak[i + 1]);
+               ++ i;
+            }
+            else
+               snd.insert(nak[i], nak[i]);
+         }
+
+         int32_t seqno;
+         while ((seqno = snd.getLostSeq()) >= 0)
+         {
+            rcv.remove(seqno);
+            rcv.find(seqno, seqno);
+         }
+      }
+
+      // the ACK covers the whole window
+      snd.remove(curr);
+      base = CSeqNo::incseq(curr);
+   }
+
+   uint64_t duration = CTimer::getTime() - start;
+   int64_t packets = int64_t(window) * rounds;
+
+   cout << setw(8) << patternName(p) << setw(9) << fixed << setprecision(2) << 100.0 * lost / packets << "%"
+        << setw(12) << lost << setw(10) << naks
+        << setw(14) << setprecision(1) << duration * 1000.0 / packets
+        << setw(14) << ((lost > 0) ? duration * 1000.0 / lost : 0.0) << endl;
+}
+
+int main(int argc, char* argv[])
+{
+   // loss rate in percent, window size in packets, number of windows per pattern
+   double rate = 5;
+   int window = 25600;
+   int rounds = 200;
+   if (argc > 1)
+      rate = atof(argv[1]);
+   if (argc > 2)
+      window = atoi(argv[2]);
+   if (argc > 3)
+      rounds = atoi(argv[3]);
+
+   if ((argc > 4) || (rate < 0) || (rate >= 100) || (window < 2) || (rounds <= 0))
+   {
+      cout << "usage: lossbench [loss_percent] [window_packets] [rounds]" << endl;
+      return 0;
+   }
+
+   srand(1);
+
+   cout << setw(8) << "pattern" << setw(10) << "loss" << setw(12) << "lost" << setw(10) << "NAKs"
+        << setw(14) << "ns/packet" << setw(14) << "ns/lost" << endl;
+
+   run(RANDOM, rate / 100, window, rounds);
+   run(BURSTY, rate / 100, window, rounds);
+   run(TAIL, rate / 100, window, rounds);
+
+   return 0;
+}
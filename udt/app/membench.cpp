@@ -0,0 +1,216 @@
+// Packet memory benchmark: long-lived connections send one burst each and then stay idle, as agent
+// sessions do between transfers. It reports how much memory the library holds during the burst and
+// how much it gives back while the connections are idle, with and without a UDT_MEMBUDGET limit.
+
+#include <unistd.h>
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <arpa/inet.h>
+#include <vector>
+#include <iostream>
+#include <iomanip>
+#include <udt.h>
+#include <common.h>
+#include <pool.h>
+
+using namespace std;
+
+static const int g_iBlockSize = 1024 * 1024;
+
+struct Pair
+{
+   UDTSOCKET m_Client;
+   UDTSOCKET m_Server;
+   int64_t m_llBurst;                  // bytes to send
+   volatile bool m_bDone;              // the receiver has got the whole burst
+   pthread_t m_Sender;
+   pthread_t m_Receiver;
+};
+
+static void* sender(void* param)
+{
+   Pair* p = (Pair*)param;
+   char* data = new char[g_iBlockSize];
+   memset(data, 0, g_iBlockSize);
+
+   for (int64_t sent = 0; sent < p->m_llBurst; )
+   {
+      int size = int((p->m_llBurst - sent < g_iBlockSize) ? p->m_llBurst - sent : g_iBlockSize);
+      int ss = UDT::send(p->m_Client, data, size, 0);
+      if (UDT::ERROR == ss)
+         break;
+      sent += ss;
+   }
+
+   delete [] data;
+   return NULL;
+}
+
+static void* receiver(void* param)
+{
+   Pair* p = (Pair*)param;
+   char* data = new char[g_iBlockSize];
+
+   for (int64_t received = 0; received < p->m_llBurst; )
+   {
+      int rs = UDT::recv(p->m_Server, data, g_iBlockSize, 0);
+      if (UDT::ERROR == rs)
+         break;
+      received += rs;
+   }
+
+   p->m_bDone = true;
+
+   delete [] data;
+   return NULL;
+}
+
+// resident set size of the process in MB
+static double rss()
+{
+   long pages = 0;
+   long resident = 0;
+   FILE* f = fopen("/proc/self/statm", "r");
+   if (NULL != f)
+   {
+      if (2 != fscanf(f, "%ld %ld", &pages, &resident))
+         resident = 0;
+      fclose(f);
+   }
+
+   return resident * double(sysconf(_SC_PAGESIZE)) / 1048576.0;
+}
+
+static void report(const char* phase, const double& seconds)
+{
+   int64_t reserved, used;
+   CMemPool::getStats(reserved, used);
+
+   cout << setw(10) << phase << fixed << setprecision(1) << setw(10) << seconds
+        << setw(14) << used / 1048576.0 << setw(16) << reserved / 1048576.0 << setw(12) << rss() << endl;
+}
+
+int main(int argc, char* argv[])
+{
+   // number of connections, burst size per connection in MB, memory budget in MB (0 for no limit), idle time in seconds
+   int connections = 16;
+   int burst = 64;
+   int budget = 0;
+   int idle = 15;
+   if (argc > 1)
+      connections = atoi(argv[1]);
+   if (argc > 2)
+      burst = atoi(argv[2]);
+   if (argc > 3)
+      budget = atoi(argv[3]);
+   if (argc > 4)
+      idle = atoi(argv[4]);
+
+   if ((argc > 5) || (connections <= 0) || (burst <= 0) || (budget < 0) || (idle < 0))
+   {
+      cout << "usage: membench [connections] [burst_MB] [budget_MB] [idle_seconds]" << endl;
+      return 0;
+   }
+
+   UDT::startup();
+
+   sockaddr_in addr;
+   memset(&addr, 0, sizeof(addr));
+   addr.sin_family = AF_INET;
+   addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+   UDTSOCKET serv = UDT::socket(AF_INET, SOCK_STREAM, 0);
+
+   // the budget is process-wide, any socket can set it
+   int64_t limit = int64_t(budget) * 1024 * 1024;
+   UDT::setsockopt(serv, 0, UDT_MEMBUDGET, &limit, sizeof(int64_t));
+
+   int addrlen = sizeof(addr);
+   if ((UDT::ERROR == UDT::bind(serv, (sockaddr*)&addr, sizeof(addr))) || (UDT::ERROR == UDT::listen(serv, connections)))
+   {
+      cout << "listen: " << UDT::getlasterror().getErrorMessage() << endl;
+      return 1;
+   }
+   UDT::getsockname(serv, (sockaddr*)&addr, &addrlen);
+
+   // the clients share one UDP port, like the sessions of an agent
+   sockaddr_in local;
+   memset(&local, 0, sizeof(local));
+   local.sin_family = AF_INET;
+   local.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+   int locallen = sizeof(local);
+
+   vector<Pair> pairs(connections);
+   for (int i = 0; i < connections; ++ i)
+   {
+      pairs[i].m_llBurst = int64_t(burst) * 1024 * 1024;
+      pairs[i].m_bDone = false;
+      pairs[i].m_Client = UDT::socket(AF_INET, SOCK_STREAM, 0);
+      UDT::bind(pairs[i].m_Client, (sockaddr*)&local, sizeof(local));
+      if (0 == i)
+         UDT::getsockname(pairs[i].m_Client, (sockaddr*)&local, &locallen);
+
+      if ((UDT::ERROR == UDT::connect(pairs[i].m_Client, (sockaddr*)&addr, sizeof(addr))) || (UDT::INVALID_SOCK == (pairs[i].m_Server = UDT::accept(serv, NULL, NULL))))
+      {
+         cout << "connect: " << UDT::getlasterror().getErrorMessage() << endl;
+         return 1;
+      }
+   }
+
+   cout << setw(10) << "phase" << setw(10) << "seconds" << setw(14) << "pool used MB" << setw(16) << "pool mapped MB" << setw(12) << "RSS MB" << endl;
+   report("connected", 0);
+
+   uint64_t start = CTimer::getTime();
+
+   for (int i = 0; i < connections; ++ i)
+   {
+      pthread_create(&pairs[i].m_Sender, NULL, sender, &pairs[i]);
+      pthread_create(&pairs[i].m_Receiver, NULL, receiver, &pairs[i]);
+   }
+
+   // the peak is sampled while the bursts are in flight
+   int64_t peak = 0;
+   int done = 0;
+   while (done < connections)
+   {
+      usleep(100000);
+
+      int64_t reserved, used;
+      CMemPool::getStats(reserved, used);
+      if (used > peak)
+         peak = used;
+
+      done = 0;
+      for (int i = 0; i < connections; ++ i)
+         done += pairs[i].m_bDone ? 1 : 0;
+   }
+
+   double duration = (CTimer::getTime() - start) / 1000000.0;
+   report("burst", duration);
+   cout << "throughput " << fixed << setprecision(1) << double(connections) * burst / duration << " MB/s, peak pool used " << peak / 1048576.0 << " MB" << endl;
+
+   for (int i = 0; i < connections; ++ i)
+   {
+      pthread_join(pairs[i].m_Sender, NULL);
+      pthread_join(pairs[i].m_Receiver, NULL);
+   }
+
+   for (int s = 1; s <= idle; ++ s)
+   {
+      sleep(1);
+      if ((0 == s % 5) || (s == idle))
+         report("idle", duration + s);
+   }
+
+   for (int i = 0; i < connections; ++ i)
+   {
+      UDT::close(pairs[i].m_Client);
+      UDT::close(pairs[i].m_Server);
+   }
+   UDT::close(serv);
+
+   UDT::cleanup();
+
+   return 0;
+}
@@ -0,0 +1,132 @@
+// Pacing benchmark: compares CTimer::sleepto() against a pure busy-wait loop and a plain
+// clock_nanosleep(), reporting how late each wake-up is and how much CPU the waiting thread uses.
+
+#include <unistd.h>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <vector>
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <common.h>
+
+using namespace std;
+
+enum Mode {HYBRID, SPIN, NANOSLEEP};
+
+static const char* modeName(Mode m)
+{
+   switch (m)
+   {
+   case HYBRID:
+      return "sleepto";
+   case SPIN:
+      return "spin";
+   default:
+      return "nanosleep";
+   }
+}
+
+static double threadCPUTime()
+{
+   timespec ts;
+   clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+   return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+}
+
+static void wait(Mode m, CTimer& timer, const uint64_t& deadline, const uint64_t& freq)
+{
+   uint64_t t;
+   CTimer::rdtsc(t);
+
+   switch (m)
+   {
+   case HYBRID:
+      timer.sleepto(deadline);
+      break;
+
+   case SPIN:
+      while (t < deadline)
+         CTimer::rdtsc(t);
+      break;
+
+   case NANOSLEEP:
+      if (t < deadline)
+      {
+         timespec ts;
+         uint64_t interval = (deadline - t) / freq;
+         ts.tv_sec = interval / 1000000;
+         ts.tv_nsec = (interval % 1000000) * 1000;
+         clock_nanosleep(CLOCK_MONOTONIC, 0, &ts, NULL);
+      }
+      break;
+   }
+}
+
+int main(int argc, char* argv[])
+{
+   // total time spent on each interval and mode, in milliseconds
+   int duration = 500;
+   if (argc > 1)
+      duration = atoi(argv[1]);
+
+   if ((argc > 2) || (duration <= 0))
+   {
+      cout << "usage: pacebench [duration_ms]" << endl;
+      return 0;
+   }
+
+   const int intervals[] = {10, 50, 100, 500, 1000, 5000};
+   const Mode modes[] = {HYBRID, SPIN, NANOSLEEP};
+
+   uint64_t freq = CTimer::getCPUFrequency();
+   CTimer timer;
+
+   cout << setw(10) << "mode" << setw(14) << "interval(us)" << setw(10) << "ticks" << setw(14) << "late_avg(us)" << setw(14) << "late_p99(us)" << setw(14) << "late_max(us)" << setw(8) << "cpu%" << endl;
+
+   for (size_t i = 0; i < sizeof(intervals) / sizeof(int); ++ i)
+   {
+      for (size_t j = 0; j < sizeof(modes) / sizeof(Mode); ++ j)
+      {
+         int ticks = duration * 1000 / intervals[i];
+         if (ticks < 10)
+            ticks = 10;
+
+         vector<double> late;
+         late.reserve(ticks);
+
+         uint64_t start;
+         CTimer::rdtsc(start);
+         uint64_t step = intervals[i] * freq;
+         double cpu = threadCPUTime();
+         uint64_t wall = CTimer::getTime();
+
+         // deadlines are absolute, like the send queue, so lateness does not accumulate
+         for (int k = 1; k <= ticks; ++ k)
+         {
+            uint64_t deadline = start + k * step;
+            wait(modes[j], timer, deadline, freq);
+
+            uint64_t t;
+            CTimer::rdtsc(t);
+            late.push_back((t > deadline) ? double(t - deadline) / freq : 0);
+         }
+
+         cpu = threadCPUTime() - cpu;
+         double elapsed = (CTimer::getTime() - wall) / 1000000.0;
+
+         double sum = 0;
+         for (vector<double>::iterator l = late.begin(); l != late.end(); ++ l)
+            sum += *l;
+         sort(late.begin(), late.end());
+
+         cout << setw(10) << modeName(modes[j]) << setw(14) << intervals[i] << setw(10) << ticks
+              << fixed << setprecision(2)
+              << setw(14) << sum / ticks << setw(14) << late[ticks * 99 / 100] << setw(14) << late.back()
+              << setprecision(1) << setw(8) << cpu * 100 / elapsed << endl;
+      }
+   }
+
+   return 0;
+}
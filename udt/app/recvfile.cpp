@@ -1,6 +1,8 @@
 #ifndef WIN32
    #include <arpa/inet.h>
    #include <netdb.h>
+   #include <fcntl.h>
+   #include <unistd.h>
 #else
    #include <winsock2.h>
    #include <ws2tcpip.h>
@@ -80,11 +82,19 @@ int main(int argc, char* argv[])
    }
 
    // receive the file
-   fstream ofs(argv[4], ios::out | ios::binary | ios::trunc);
+   #ifndef WIN32
+      int ofd = open(argv[4], O_WRONLY | O_CREAT | O_TRUNC, 0644);
+   #else
+      fstream ofs(argv[4], ios::out | ios::binary | ios::trunc);
+   #endif
    int64_t recvsize; 
    int64_t offset = 0;
 
-   if (UDT::ERROR == (recvsize = UDT::recvfile(fhandle, ofs, offset, size)))
+   #ifndef WIN32
+      if (UDT::ERROR == (recvsize = UDT::recvfile(fhandle, ofd, offset, size)))
+   #else
+      if (UDT::ERROR == (recvsize = UDT::recvfile(fhandle, ofs, offset, size)))
+   #endif
    {
       cout << "recvfile: " << UDT::getlasterror().getErrorMessage() << endl;
       return -1;
@@ -92,7 +102,11 @@ int main(int argc, char* argv[])
 
    UDT::close(fhandle);
 
-   ofs.close();
+   #ifndef WIN32
+      close(ofd);
+   #else
+      ofs.close();
+   #endif
 
    // use this function to release the UDT library
    UDT::cleanup();
@@ -1,6 +1,9 @@
 #ifndef WIN32
    #include <cstdlib>
    #include <netdb.h>
+   #include <fcntl.h>
+   #include <unistd.h>
+   #include <sys/stat.h>
 #else
    #include <winsock2.h>
    #include <ws2tcpip.h>
@@ -131,11 +134,18 @@ DWORD WINAPI sendfile(LPVOID usocket)
    file[len] = '\0';
 
    // open the file
-   fstream ifs(file, ios::in | ios::binary);
+   #ifndef WIN32
+      int ifd = open(file, O_RDONLY);
 
-   ifs.seekg(0, ios::end);
-   int64_t size = ifs.tellg();
-   ifs.seekg(0, ios::beg);
+      struct stat st;
+      int64_t size = ((ifd >= 0) && (0 == fstat(ifd, &st))) ? st.st_size : -1;
+   #else
+      fstream ifs(file, ios::in | ios::binary);
+
+      ifs.seekg(0, ios::end);
+      int64_t size = ifs.tellg();
+      ifs.seekg(0, ios::beg);
+   #endif
 
    // send file size information
    if (UDT::ERROR == UDT::send(fhandle, (char*)&size, sizeof(int64_t), 0))
@@ -149,7 +159,11 @@ DWORD WINAPI sendfile(LPVOID usocket)
 
    // send the file
    int64_t offset = 0;
-   if (UDT::ERROR == UDT::sendfile(fhandle, ifs, offset, size))
+   #ifndef WIN32
+      if (UDT::ERROR == UDT::sendfile(fhandle, ifd, offset, size))
+   #else
+      if (UDT::ERROR == UDT::sendfile(fhandle, ifs, offset, size))
+   #endif
    {
       cout << "sendfile: " << UDT::getlasterror().getErrorMessage() << endl;
       return 0;
@@ -160,7 +174,11 @@ DWORD WINAPI sendfile(LPVOID usocket)
 
    UDT::close(fhandle);
 
-   ifs.close();
+   #ifndef WIN32
+      close(ifd);
+   #else
+      ifs.close();
+   #endif
 
    #ifndef WIN32
       return NULL;
@@ -0,0 +1,186 @@
+// Socket table contention benchmark: every thread works on its own connected loopback socket pair,
+// so the only state the threads share inside the library is the socket table of CUDTUnited.
+// "getsockopt" measures the API lookup path alone; "sendrecv" sends a batch of small messages on
+// the pair and receives them back. Extra idle sockets make the table as large as on a busy server.
+
+#include <unistd.h>
+#include <cstdlib>
+#include <cstring>
+#include <arpa/inet.h>
+#include <vector>
+#include <iostream>
+#include <iomanip>
+#include <udt.h>
+#include <common.h>
+
+using namespace std;
+
+enum Mode {GETSOCKOPT, SENDRECV};
+
+static const int g_iBatch = 16;
+static const int g_iMsgSize = 64;
+
+struct Worker
+{
+   UDTSOCKET m_Client;
+   UDTSOCKET m_Server;
+   Mode m_Mode;
+   volatile bool* m_pbStop;
+   int64_t m_llOps;
+   pthread_t m_Thread;
+};
+
+static void* work(void* param)
+{
+   Worker* w = (Worker*)param;
+   char data[g_iMsgSize];
+   memset(data, 0, g_iMsgSize);
+
+   while (!*w->m_pbStop)
+   {
+      if (GETSOCKOPT == w->m_Mode)
+      {
+         int value;
+         int size = sizeof(int);
+         UDT::getsockopt(w->m_Client, 0, UDT_SNDDATA, &value, &size);
+         ++ w->m_llOps;
+      }
+      else
+      {
+         for (int i = 0; i < g_iBatch; ++ i)
+         {
+            if (UDT::ERROR == UDT::sendmsg(w->m_Client, data, g_iMsgSize))
+               return NULL;
+         }
+
+         for (int i = 0; i < g_iBatch; ++ i)
+         {
+            if (UDT::ERROR == UDT::recvmsg(w->m_Server, data, g_iMsgSize))
+               return NULL;
+         }
+
+         w->m_llOps += g_iBatch * 2;
+      }
+   }
+
+   return NULL;
+}
+
+static double run(vector<Worker>& workers, const int& threads, const Mode& mode, const int& duration)
+{
+   volatile bool stop = false;
+
+   for (int i = 0; i < threads; ++ i)
+   {
+      workers[i].m_Mode = mode;
+      workers[i].m_pbStop = &stop;
+      workers[i].m_llOps = 0;
+      pthread_create(&workers[i].m_Thread, NULL, work, &workers[i]);
+   }
+
+   uint64_t start = CTimer::getTime();
+   usleep(duration * 1000);
+   stop = true;
+
+   int64_t ops = 0;
+   for (int i = 0; i < threads; ++ i)
+   {
+      pthread_join(workers[i].m_Thread, NULL);
+      ops += workers[i].m_llOps;
+   }
+
+   return ops * 1000000.0 / (CTimer::getTime() - start);
+}
+
+int main(int argc, char* argv[])
+{
+   // maximum number of threads, idle sockets added to the table, time spent on each test in milliseconds
+   int maxthreads = 16;
+   int idle = 1000;
+   int duration = 1000;
+   if (argc > 1)
+      maxthreads = atoi(argv[1]);
+   if (argc > 2)
+      idle = atoi(argv[2]);
+   if (argc > 3)
+      duration = atoi(argv[3]);
+
+   if ((argc > 4) || (maxthreads <= 0) || (idle < 0) || (duration <= 0))
+   {
+      cout << "usage: sockbench [max_threads] [idle_sockets] [duration_ms]" << endl;
+      return 0;
+   }
+
+   UDT::startup();
+
+   vector<UDTSOCKET> idlesockets;
+   for (int i = 0; i < idle; ++ i)
+      idlesockets.push_back(UDT::socket(AF_INET, SOCK_DGRAM, 0));
+
+   sockaddr_in addr;
+   memset(&addr, 0, sizeof(addr));
+   addr.sin_family = AF_INET;
+   addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+   UDTSOCKET serv = UDT::socket(AF_INET, SOCK_DGRAM, 0);
+   int addrlen = sizeof(addr);
+   if ((UDT::ERROR == UDT::bind(serv, (sockaddr*)&addr, sizeof(addr))) || (UDT::ERROR == UDT::listen(serv, maxthreads)))
+   {
+      cout << "listen: " << UDT::getlasterror().getErrorMessage() << endl;
+      return 1;
+   }
+   UDT::getsockname(serv, (sockaddr*)&addr, &addrlen);
+
+   vector<Worker> workers(maxthreads);
+   for (int i = 0; i < maxthreads; ++ i)
+   {
+      workers[i].m_Client = UDT::socket(AF_INET, SOCK_DGRAM, 0);
+      if (UDT::ERROR == UDT::connect(workers[i].m_Client, (sockaddr*)&addr, sizeof(addr)))
+      {
+         cout << "connect: " << UDT::getlasterror().getErrorMessage() << endl;
+         return 1;
+      }
+
+      workers[i].m_Server = UDT::accept(serv, NULL, NULL);
+      if (UDT::INVALID_SOCK == workers[i].m_Server)
+      {
+         cout << "accept: " << UDT::getlasterror().getErrorMessage() << endl;
+         return 1;
+      }
+   }
+
+   const Mode modes[] = {GETSOCKOPT, SENDRECV};
+   const char* names[] = {"getsockopt", "sendrecv"};
+
+   cout << setw(12) << "mode" << setw(10) << "threads" << setw(16) << "ops/s" << setw(16) << "ops/s/thread" << endl;
+
+   for (size_t m = 0; m < sizeof(modes) / sizeof(Mode); ++ m)
+   {
+      for (int threads = 1; ; threads *= 2)
+      {
+         if (threads > maxthreads)
+            threads = maxthreads;
+
+         double rate = run(workers, threads, modes[m], duration);
+
+         cout << setw(12) << names[m] << setw(10) << threads << fixed << setprecision(0)
+              << setw(16) << rate << setw(16) << rate / threads << endl;
+
+         if (threads == maxthreads)
+            break;
+      }
+   }
+
+   for (int i = 0; i < maxthreads; ++ i)
+   {
+      UDT::close(workers[i].m_Client);
+      UDT::close(workers[i].m_Server);
+   }
+   UDT::close(serv);
+   for (vector<UDTSOCKET>::iterator i = idlesockets.begin(); i != idlesockets.end(); ++ i)
+      UDT::close(*i);
+
+   UDT::cleanup();
+
+   return 0;
+}
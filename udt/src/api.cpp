@@ -47,6 +47,7 @@ written by
 #else
    #include <unistd.h>
 #endif
+#include <cstdlib>
 #include <cstring>
 #include "api.h"
 #include "core.h"
@@ -123,6 +124,7 @@ m_TLSError(),
 m_mMultiplexer(),
 m_MultiplexerLock(),
 m_pCache(NULL),
+m_pPathCache(NULL),
 m_bClosing(false),
 m_GCStopLock(),
 m_GCStopCond(),
@@ -154,6 +156,7 @@ m_ClosedSockets()
    #endif
 
    m_pCache = new CCache<CInfoBlock>;
+   m_pPathCache = new CPathCache;
 }
 
 CUDTUnited::~CUDTUnited()
@@ -175,6 +178,7 @@ CUDTUnited::~CUDTUnited()
       CloseHandle(m_TLSLock);
    #endif
 
+   delete m_pPathCache;
    delete m_pCache;
 }
 
@@ -200,6 +204,11 @@ int CUDTUnited::startup()
    if (m_bGCStatus)
       return true;
 
+   // path information saved by earlier processes, so that new connections start from the last known RTT and rate
+   const char* pathcache = getenv("UDT_PATH_CACHE");
+   if ((NULL != pathcache) && ('\0' != *pathcache) && (0 == m_pPathCache->open(pathcache)))
+      m_pPathCache->load(m_pCache);
+
    m_bClosing = false;
    #ifndef WIN32
       pthread_mutex_init(&m_GCStopLock, NULL);
@@ -245,6 +254,9 @@ int CUDTUnited::cleanup()
 
    m_bGCStatus = false;
 
+   // all sockets have been closed and have saved their path information by now
+   m_pPathCache->close();
+
    // Global destruction code
    #ifdef WIN32
       WSACleanup();
@@ -291,12 +303,13 @@ UDTSOCKET CUDTUnited::newSocket(const int& af, const int& type)
    ns->m_pUDT->m_iSockType = (SOCK_STREAM == type) ? UDT_STREAM : UDT_DGRAM;
    ns->m_pUDT->m_iIPversion = ns->m_iIPversion = af;
    ns->m_pUDT->m_pCache = m_pCache;
+   ns->m_pUDT->m_pPathCache = m_pPathCache;
 
    // protect the m_Sockets structure.
    CGuard::enterCS(m_ControlLock);
    try
    {
-      m_Sockets[ns->m_SocketID] = ns;
+      m_Sockets.insert(ns->m_SocketID, ns);
    }
    catch (...)
    {
@@ -415,8 +428,8 @@ int CUDTUnited::newConnection(const UDTSOCKET listen, const sockaddr* peer, CHan
    CGuard::enterCS(m_ControlLock);
    try
    {
-      m_Sockets[ns->m_SocketID] = ns;
-      m_PeerRec[(ns->m_PeerID << 30) + ns->m_iISN].insert(ns->m_SocketID);
+      m_Sockets.insert(ns->m_SocketID, ns);
+      m_PeerRec.insert((ns->m_PeerID << 30) + ns->m_iISN, ns->m_SocketID);
    }
    catch (...)
    {
@@ -464,36 +477,39 @@ int CUDTUnited::newConnection(const UDTSOCKET listen, const sockaddr* peer, CHan
 
 CUDT* CUDTUnited::lookup(const UDTSOCKET u)
 {
-   // protects the m_Sockets structure
-   CGuard cg(m_ControlLock);
-
-   map<UDTSOCKET, CUDTSocket*>::iterator i = m_Sockets.find(u);
+   CUDTSocket* s = locate(u);
 
-   if ((i == m_Sockets.end()) || (i->second->m_Status == CLOSED))
+   if (NULL == s)
       throw CUDTException(5, 4, 0);
 
-   return i->second->m_pUDT;
+   return s->m_pUDT;
 }
 
 UDTSTATUS CUDTUnited::getStatus(const UDTSOCKET u)
 {
-   // protects the m_Sockets structure
-   CGuard cg(m_ControlLock);
-
-   map<UDTSOCKET, CUDTSocket*>::iterator i = m_Sockets.find(u);
+   CUDTSocket* s;
 
-   if (i == m_Sockets.end())
+   if (!m_Sockets.find(u, s))
    {
+      // the socket may be moving to m_ClosedSockets right now, which is done under m_ControlLock
+      CGuard cg(m_ControlLock);
+
       if (m_ClosedSockets.find(u) != m_ClosedSockets.end())
          return CLOSED;
 
-      return NONEXIST;
+      if (!m_Sockets.find(u, s))
+         return NONEXIST;
    }
 
-   if (i->second->m_pUDT->m_bBroken)
+   if (s->m_pUDT->m_bBroken)
       return BROKEN;
 
-   return i->second->m_Status;   
+   // an asynchronous connect that timed out or was rejected stays in CONNECTING otherwise; only those
+   // two paths set the flag, so a connect that is completing is never reported as broken
+   if ((CONNECTING == s->m_Status) && s->m_pUDT->m_bConnFailed)
+      return BROKEN;
+
+   return s->m_Status;   
 }
 
 int CUDTUnited::bind(const UDTSOCKET u, const sockaddr* name, const int& namelen)
@@ -620,6 +636,28 @@ UDTSOCKET CUDTUnited::accept(const UDTSOCKET listen, sockaddr* addr, int* addrle
    if ((NULL != addr) && (NULL == addrlen))
       throw CUDTException(5, 3, 0);
 
+   UDTSOCKET u = CUDT::INVALID_SOCK;
+   acceptBatch(listen, &u, 1);
+
+   if ((addr != NULL) && (addrlen != NULL))
+   {
+      if (AF_INET == locate(u)->m_iIPversion)
+         *addrlen = sizeof(sockaddr_in);
+      else
+         *addrlen = sizeof(sockaddr_in6);
+
+      // copy address information of peer node
+      memcpy(addr, locate(u)->m_pPeerAddr, *addrlen);
+   }
+
+   return u;
+}
+
+int CUDTUnited::acceptBatch(const UDTSOCKET listen, UDTSOCKET* socks, const int& size)
+{
+   if ((NULL == socks) || (size <= 0))
+      throw CUDTException(5, 3, 0);
+
    CUDTSocket* ls = locate(listen);
 
    if (ls == NULL)
@@ -633,10 +671,10 @@ UDTSOCKET CUDTUnited::accept(const UDTSOCKET listen, sockaddr* addr, int* addrle
    if (ls->m_pUDT->m_bRendezvous)
       throw CUDTException(5, 7, 0);
 
-   UDTSOCKET u = CUDT::INVALID_SOCK;
+   int count = 0;
    bool accepted = false;
 
-   // !!only one conection can be set up each time!!
+   // wait for the first connection, then take all that are queued (up to size) with one lock
    #ifndef WIN32
       while (!accepted)
       {
@@ -649,9 +687,7 @@ UDTSOCKET CUDTUnited::accept(const UDTSOCKET listen, sockaddr* addr, int* addrle
          }
          else if (ls->m_pQueuedSockets->size() > 0)
          {
-            u = *(ls->m_pQueuedSockets->begin());
-            ls->m_pAcceptSockets->insert(ls->m_pAcceptSockets->end(), u);
-            ls->m_pQueuedSockets->erase(ls->m_pQueuedSockets->begin());
+            count = takeQueued(ls, socks, size);
             accepted = true;
          }
          else if (!ls->m_pUDT->m_bSynRecving)
@@ -674,10 +710,7 @@ UDTSOCKET CUDTUnited::accept(const UDTSOCKET listen, sockaddr* addr, int* addrle
 
          if (ls->m_pQueuedSockets->size() > 0)
          {
-            u = *(ls->m_pQueuedSockets->begin());
-            ls->m_pAcceptSockets->insert(ls->m_pAcceptSockets->end(), u);
-            ls->m_pQueuedSockets->erase(ls->m_pQueuedSockets->begin());
-
+            count = takeQueued(ls, socks, size);
             accepted = true;
          }
          else if (!ls->m_pUDT->m_bSynRecving)
@@ -700,7 +733,7 @@ UDTSOCKET CUDTUnited::accept(const UDTSOCKET listen, sockaddr* addr, int* addrle
       }
    #endif
 
-   if (u == CUDT::INVALID_SOCK)
+   if (0 == count)
    {
       // non-blocking receiving, no connection available
       if (!ls->m_pUDT->m_bSynRecving)
@@ -710,18 +743,23 @@ UDTSOCKET CUDTUnited::accept(const UDTSOCKET listen, sockaddr* addr, int* addrle
       throw CUDTException(5, 6, 0);
    }
 
-   if ((addr != NULL) && (addrlen != NULL))
-   {
-      if (AF_INET == locate(u)->m_iIPversion)
-         *addrlen = sizeof(sockaddr_in);
-      else
-         *addrlen = sizeof(sockaddr_in6);
+   return count;
+}
 
-      // copy address information of peer node
-      memcpy(addr, locate(u)->m_pPeerAddr, *addrlen);
+int CUDTUnited::takeQueued(CUDTSocket* ls, UDTSOCKET* socks, const int& size)
+{
+   // the caller holds ls->m_AcceptLock
+   int count = 0;
+
+   while ((count < size) && !ls->m_pQueuedSockets->empty())
+   {
+      UDTSOCKET u = *(ls->m_pQueuedSockets->begin());
+      ls->m_pAcceptSockets->insert(ls->m_pAcceptSockets->end(), u);
+      ls->m_pQueuedSockets->erase(ls->m_pQueuedSockets->begin());
+      socks[count ++] = u;
    }
 
-   return u;
+   return count;
 }
 
 int CUDTUnited::connect(const UDTSOCKET u, const sockaddr* name, const int& namelen)
@@ -838,10 +876,8 @@ int CUDTUnited::close(const UDTSOCKET u)
    CGuard manager_cg(m_ControlLock);
 
    // since "s" is located before m_ControlLock, locate it again in case it became invalid
-   map<UDTSOCKET, CUDTSocket*>::iterator i = m_Sockets.find(u);
-   if ((i == m_Sockets.end()) || (i->second->m_Status == CLOSED))
+   if (!m_Sockets.find(u, s) || (s->m_Status == CLOSED))
       return 0;
-   s = i->second;
 
    s->m_Status = CLOSED;
 
@@ -1133,40 +1169,45 @@ int CUDTUnited::epoll_wait(const int eid, set<UDTSOCKET>* readfds, set<UDTSOCKET
    return m_EPoll.wait(eid, readfds, writefds, msTimeOut, lrfds, lwfds);
 }
 
+int CUDTUnited::epoll_wait2(const int eid, UDTSOCKET* readfds, int* rnum, UDTSOCKET* writefds, int* wnum, int64_t msTimeOut, SYSSOCKET* lrfds, int* lrnum, SYSSOCKET* lwfds, int* lwnum)
+{
+   return m_EPoll.wait(eid, readfds, rnum, writefds, wnum, msTimeOut, lrfds, lrnum, lwfds, lwnum);
+}
+
 int CUDTUnited::epoll_release(const int eid)
 {
    return m_EPoll.release(eid);
 }
 
+// The lookups below do not take m_ControlLock. A socket removed from m_Sockets stays in
+// m_ClosedSockets for at least one second before it is deleted, so the returned pointer
+// remains valid for the duration of an API call, as it did when m_ControlLock was released
+// on return.
+
 CUDTSocket* CUDTUnited::locate(const UDTSOCKET u)
 {
-   CGuard cg(m_ControlLock);
-
-   map<UDTSOCKET, CUDTSocket*>::iterator i = m_Sockets.find(u);
+   CUDTSocket* s;
 
-   if ((i == m_Sockets.end()) || (i->second->m_Status == CLOSED))
+   if (!m_Sockets.find(u, s) || (s->m_Status == CLOSED))
       return NULL;
 
-   return i->second;
+   return s;
 }
 
 CUDTSocket* CUDTUnited::locate(const sockaddr* peer, const UDTSOCKET& id, const int32_t& isn)
 {
-   CGuard cg(m_ControlLock);
-
-   map<int64_t, set<UDTSOCKET> >::iterator i = m_PeerRec.find((id << 30) + isn);
-   if (i == m_PeerRec.end())
-      return NULL;
+   vector<UDTSOCKET> ids;
+   m_PeerRec.findAll((id << 30) + isn, ids);
 
-   for (set<UDTSOCKET>::iterator j = i->second.begin(); j != i->second.end(); ++ j)
+   for (vector<UDTSOCKET>::iterator j = ids.begin(); j != ids.end(); ++ j)
    {
-      map<UDTSOCKET, CUDTSocket*>::iterator k = m_Sockets.find(*j);
+      CUDTSocket* s;
       // this socket might have been closed and moved m_ClosedSockets
-      if (k == m_Sockets.end())
+      if (!m_Sockets.find(*j, s))
          continue;
 
-      if (CIPAddress::ipcmp(peer, k->second->m_pPeerAddr, k->second->m_iIPversion))
-         return k->second;
+      if (CIPAddress::ipcmp(peer, s->m_pPeerAddr, s->m_iIPversion))
+         return s;
    }
 
    return NULL;
@@ -1180,42 +1221,55 @@ void CUDTUnited::checkBrokenSockets()
    vector<UDTSOCKET> tbc;
    vector<UDTSOCKET> tbr;
 
-   for (map<UDTSOCKET, CUDTSocket*>::iterator i = m_Sockets.begin(); i != m_Sockets.end(); ++ i)
+   // m_Sockets only changes under m_ControlLock, so this copy stays accurate until the erase below
+   vector<CUDTSocket*> sockets;
+   m_Sockets.getValues(sockets);
+
+   uint64_t currtime = CTimer::getTime();
+
+   for (vector<CUDTSocket*>::iterator i = sockets.begin(); i != sockets.end(); ++ i)
    {
+      CUDTSocket* s = *i;
+
+      // connections without traffic give the memory of their last burst back
+      if (!s->m_pUDT->m_bBroken)
+         s->m_pUDT->releaseIdleMemory(currtime);
+
       // check broken connection
-      if (i->second->m_pUDT->m_bBroken)
+      if (s->m_pUDT->m_bBroken)
       {
-         if (i->second->m_Status == LISTENING)
+         if (s->m_Status == LISTENING)
          {
             // for a listening socket, it should wait an extra 3 seconds in case a client is connecting
-            if (CTimer::getTime() - i->second->m_TimeStamp < 3000000)
+            if (CTimer::getTime() - s->m_TimeStamp < 3000000)
                continue;
          }
-         else if ((i->second->m_pUDT->m_pRcvBuffer != NULL) && (i->second->m_pUDT->m_pRcvBuffer->getRcvDataSize() > 0) && (i->second->m_pUDT->m_iBrokenCounter -- > 0))
+         else if ((s->m_pUDT->m_pRcvBuffer != NULL) && (s->m_pUDT->m_pRcvBuffer->getRcvDataSize() > 0) && (s->m_pUDT->m_iBrokenCounter -- > 0))
          {
             // if there is still data in the receiver buffer, wait longer
             continue;
          }
 
          //close broken connections and start removal timer
-         i->second->m_Status = CLOSED;
-         i->second->m_TimeStamp = CTimer::getTime();
-         tbc.push_back(i->first);
-         m_ClosedSockets[i->first] = i->second;
+         s->m_Status = CLOSED;
+         s->m_TimeStamp = CTimer::getTime();
+         tbc.push_back(s->m_SocketID);
+         m_ClosedSockets[s->m_SocketID] = s;
 
          // remove from listener's queue
-         map<UDTSOCKET, CUDTSocket*>::iterator ls = m_Sockets.find(i->second->m_ListenSocket);
-         if (ls == m_Sockets.end())
+         CUDTSocket* ls;
+         if (!m_Sockets.find(s->m_ListenSocket, ls))
          {
-            ls = m_ClosedSockets.find(i->second->m_ListenSocket);
-            if (ls == m_ClosedSockets.end())
+            map<UDTSOCKET, CUDTSocket*>::iterator c = m_ClosedSockets.find(s->m_ListenSocket);
+            if (c == m_ClosedSockets.end())
                continue;
+            ls = c->second;
          }
 
-         CGuard::enterCS(ls->second->m_AcceptLock);
-         ls->second->m_pQueuedSockets->erase(i->second->m_SocketID);
-         ls->second->m_pAcceptSockets->erase(i->second->m_SocketID);
-         CGuard::leaveCS(ls->second->m_AcceptLock);
+         CGuard::enterCS(ls->m_AcceptLock);
+         ls->m_pQueuedSockets->erase(s->m_SocketID);
+         ls->m_pAcceptSockets->erase(s->m_SocketID);
+         CGuard::leaveCS(ls->m_AcceptLock);
       }
    }
 
@@ -1266,11 +1320,15 @@ void CUDTUnited::removeSocket(const UDTSOCKET u)
       // if it is a listener, close all un-accepted sockets in its queue and remove them later
       for (set<UDTSOCKET>::iterator q = i->second->m_pQueuedSockets->begin(); q != i->second->m_pQueuedSockets->end(); ++ q)
       {
-         m_Sockets[*q]->m_pUDT->m_bBroken = true;
-         m_Sockets[*q]->m_pUDT->close();
-         m_Sockets[*q]->m_TimeStamp = CTimer::getTime();
-         m_Sockets[*q]->m_Status = CLOSED;
-         m_ClosedSockets[*q] = m_Sockets[*q];
+         CUDTSocket* as;
+         if (!m_Sockets.find(*q, as))
+            continue;
+
+         as->m_pUDT->m_bBroken = true;
+         as->m_pUDT->close();
+         as->m_TimeStamp = CTimer::getTime();
+         as->m_Status = CLOSED;
+         m_ClosedSockets[*q] = as;
          m_Sockets.erase(*q);
       }
 
@@ -1278,13 +1336,7 @@ void CUDTUnited::removeSocket(const UDTSOCKET u)
    }
 
    // remove from peer rec
-   map<int64_t, set<UDTSOCKET> >::iterator j = m_PeerRec.find((i->second->m_PeerID << 30) + i->second->m_iISN);
-   if (j != m_PeerRec.end())
-   {
-      j->second.erase(u);
-      if (j->second.empty())
-         m_PeerRec.erase(j);
-   }
+   m_PeerRec.erase((i->second->m_PeerID << 30) + i->second->m_iISN, u);
 
    // delete this one
    i->second->m_pUDT->close();
@@ -1386,6 +1438,7 @@ void CUDTUnited::updateMux(CUDTSocket* s, const sockaddr* addr, const UDPSOCKET*
                // reuse the existing multiplexer
                ++ i->second.m_iRefCount;
                s->m_pUDT->m_pSndQueue = i->second.m_pSndQueue;
+               s->m_pUDT->m_pSndUList = i->second.m_pSndQueue->getSndUList(s->m_SocketID);
                s->m_pUDT->m_pRcvQueue = i->second.m_pRcvQueue;
                s->m_iMuxID = i->second.m_iID;
                return;
@@ -1405,6 +1458,8 @@ void CUDTUnited::updateMux(CUDTSocket* s, const sockaddr* addr, const UDPSOCKET*
    m.m_pChannel = new CChannel(s->m_pUDT->m_iIPversion);
    m.m_pChannel->setSndBufSize(s->m_pUDT->m_iUDPSndBufSize);
    m.m_pChannel->setRcvBufSize(s->m_pUDT->m_iUDPRcvBufSize);
+   m.m_pChannel->setGSO(s->m_pUDT->m_bUDPGSO);
+   m.m_pChannel->setGRO(s->m_pUDT->m_bUDPGRO);
 
    try
    {
@@ -1428,13 +1483,15 @@ void CUDTUnited::updateMux(CUDTSocket* s, const sockaddr* addr, const UDPSOCKET*
    m.m_pTimer = new CTimer;
 
    m.m_pSndQueue = new CSndQueue;
-   m.m_pSndQueue->init(m.m_pChannel, m.m_pTimer);
+   m.m_pSndQueue->init(m.m_pChannel, m.m_pTimer, s->m_pUDT->m_iSndWorkers, s->m_pUDT->m_iSndCPU);
    m.m_pRcvQueue = new CRcvQueue;
-   m.m_pRcvQueue->init(32, s->m_pUDT->m_iPayloadSize, m.m_iIPversion, 1024, m.m_pChannel, m.m_pTimer);
+   m.m_pRcvQueue->init(32, s->m_pUDT->m_iPayloadSize, m.m_iIPversion, 1024, m.m_pChannel, m.m_pTimer, s->m_pUDT->m_iRcvWorkers);
 
    m_mMultiplexer[m.m_iID] = m;
 
    s->m_pUDT->m_pSndQueue = m.m_pSndQueue;
+
+   s->m_pUDT->m_pSndUList = m.m_pSndQueue->getSndUList(s->m_SocketID);
    s->m_pUDT->m_pRcvQueue = m.m_pRcvQueue;
    s->m_iMuxID = m.m_iID;
 }
@@ -1453,6 +1510,7 @@ void CUDTUnited::updateMux(CUDTSocket* s, const CUDTSocket* ls)
          // reuse the existing multiplexer
          ++ i->second.m_iRefCount;
          s->m_pUDT->m_pSndQueue = i->second.m_pSndQueue;
+         s->m_pUDT->m_pSndUList = i->second.m_pSndQueue->getSndUList(s->m_SocketID);
          s->m_pUDT->m_pRcvQueue = i->second.m_pRcvQueue;
          s->m_iMuxID = i->second.m_iID;
          return;
@@ -1493,27 +1551,32 @@ void CUDTUnited::updateMux(CUDTSocket* s, const CUDTSocket* ls)
 
    // remove all sockets and multiplexers
    CGuard::enterCS(self->m_ControlLock);
-   for (map<UDTSOCKET, CUDTSocket*>::iterator i = self->m_Sockets.begin(); i != self->m_Sockets.end(); ++ i)
+   vector<CUDTSocket*> sockets;
+   self->m_Sockets.getValues(sockets);
+   for (vector<CUDTSocket*>::iterator i = sockets.begin(); i != sockets.end(); ++ i)
    {
-      i->second->m_pUDT->m_bBroken = true;
-      i->second->m_pUDT->close();
-      i->second->m_Status = CLOSED;
-      i->second->m_TimeStamp = CTimer::getTime();
-      self->m_ClosedSockets[i->first] = i->second;
+      CUDTSocket* s = *i;
+
+      s->m_pUDT->m_bBroken = true;
+      s->m_pUDT->close();
+      s->m_Status = CLOSED;
+      s->m_TimeStamp = CTimer::getTime();
+      self->m_ClosedSockets[s->m_SocketID] = s;
 
       // remove from listener's queue
-      map<UDTSOCKET, CUDTSocket*>::iterator ls = self->m_Sockets.find(i->second->m_ListenSocket);
-      if (ls == self->m_Sockets.end())
+      CUDTSocket* ls;
+      if (!self->m_Sockets.find(s->m_ListenSocket, ls))
       {
-         ls = self->m_ClosedSockets.find(i->second->m_ListenSocket);
-         if (ls == self->m_ClosedSockets.end())
+         map<UDTSOCKET, CUDTSocket*>::iterator c = self->m_ClosedSockets.find(s->m_ListenSocket);
+         if (c == self->m_ClosedSockets.end())
             continue;
+         ls = c->second;
       }
 
-      CGuard::enterCS(ls->second->m_AcceptLock);
-      ls->second->m_pQueuedSockets->erase(i->second->m_SocketID);
-      ls->second->m_pAcceptSockets->erase(i->second->m_SocketID);
-      CGuard::leaveCS(ls->second->m_AcceptLock);
+      CGuard::enterCS(ls->m_AcceptLock);
+      ls->m_pQueuedSockets->erase(s->m_SocketID);
+      ls->m_pAcceptSockets->erase(s->m_SocketID);
+      CGuard::leaveCS(ls->m_AcceptLock);
    }
    self->m_Sockets.clear();
 
@@ -1669,6 +1732,24 @@ UDTSOCKET CUDT::accept(UDTSOCKET u, sockaddr* addr, int* addrlen)
    }
 }
 
+int CUDT::acceptBatch(UDTSOCKET u, UDTSOCKET* socks, int size)
+{
+   try
+   {
+      return s_UDTUnited.acceptBatch(u, socks, size);
+   }
+   catch (CUDTException& e)
+   {
+      s_UDTUnited.setError(new CUDTException(e));
+      return ERROR;
+   }
+   catch (...)
+   {
+      s_UDTUnited.setError(new CUDTException(-1, 0, 0));
+      return ERROR;
+   }
+}
+
 int CUDT::connect(UDTSOCKET u, const sockaddr* name, int namelen)
 {
    try
@@ -1853,6 +1934,30 @@ int CUDT::sendmsg(UDTSOCKET u, const char* buf, int len, int ttl, bool inorder)
    }
 }
 
+int CUDT::sendzc(UDTSOCKET u, const char* buf, int len, UDTZCCALLBACK release, void* param)
+{
+   try
+   {
+      CUDT* udt = s_UDTUnited.lookup(u);
+      return udt->sendzc(buf, len, release, param);
+   }
+   catch (CUDTException e)
+   {
+      s_UDTUnited.setError(new CUDTException(e));
+      return ERROR;
+   }
+   catch (bad_alloc&)
+   {
+      s_UDTUnited.setError(new CUDTException(3, 2, 0));
+      return ERROR;
+   }
+   catch (...)
+   {
+      s_UDTUnited.setError(new CUDTException(-1, 0, 0));
+      return ERROR;
+   }
+}
+
 int CUDT::recvmsg(UDTSOCKET u, char* buf, int len)
 {
    try
@@ -1872,6 +1977,44 @@ int CUDT::recvmsg(UDTSOCKET u, char* buf, int len)
    }
 }
 
+int CUDT::recvpeek(UDTSOCKET u, UDTIOVEC* iov, int iovcnt)
+{
+   try
+   {
+      CUDT* udt = s_UDTUnited.lookup(u);
+      return udt->recvpeek(iov, iovcnt);
+   }
+   catch (CUDTException e)
+   {
+      s_UDTUnited.setError(new CUDTException(e));
+      return ERROR;
+   }
+   catch (...)
+   {
+      s_UDTUnited.setError(new CUDTException(-1, 0, 0));
+      return ERROR;
+   }
+}
+
+int CUDT::recvconsume(UDTSOCKET u, int len)
+{
+   try
+   {
+      CUDT* udt = s_UDTUnited.lookup(u);
+      return udt->recvconsume(len);
+   }
+   catch (CUDTException e)
+   {
+      s_UDTUnited.setError(new CUDTException(e));
+      return ERROR;
+   }
+   catch (...)
+   {
+      s_UDTUnited.setError(new CUDTException(-1, 0, 0));
+      return ERROR;
+   }
+}
+
 int64_t CUDT::sendfile(UDTSOCKET u, fstream& ifs, int64_t& offset, const int64_t& size, const int& block)
 {
    try
@@ -1915,6 +2058,51 @@ int64_t CUDT::recvfile(UDTSOCKET u, fstream& ofs, int64_t& offset, const int64_t
    }
 }
 
+#ifndef WIN32
+int64_t CUDT::sendfile(UDTSOCKET u, int fd, int64_t& offset, const int64_t& size, const int& block)
+{
+   try
+   {
+      CUDT* udt = s_UDTUnited.lookup(u);
+      return udt->sendfile(fd, offset, size, block);
+   }
+   catch (CUDTException e)
+   {
+      s_UDTUnited.setError(new CUDTException(e));
+      return ERROR;
+   }
+   catch (bad_alloc&)
+   {
+      s_UDTUnited.setError(new CUDTException(3, 2, 0));
+      return ERROR;
+   }
+   catch (...)
+   {
+      s_UDTUnited.setError(new CUDTException(-1, 0, 0));
+      return ERROR;
+   }
+}
+
+int64_t CUDT::recvfile(UDTSOCKET u, int fd, int64_t& offset, const int64_t& size, const int& block)
+{
+   try
+   {
+      CUDT* udt = s_UDTUnited.lookup(u);
+      return udt->recvfile(fd, offset, size, block);
+   }
+   catch (CUDTException e)
+   {
+      s_UDTUnited.setError(new CUDTException(e));
+      return ERROR;
+   }
+   catch (...)
+   {
+      s_UDTUnited.setError(new CUDTException(-1, 0, 0));
+      return ERROR;
+   }
+}
+#endif
+
 int CUDT::select(int, ud_set* readfds, ud_set* writefds, ud_set* exceptfds, const timeval* timeout)
 {
    if ((NULL == readfds) && (NULL == writefds) && (NULL == exceptfds))
@@ -2081,6 +2269,24 @@ int CUDT::epoll_wait(const int eid, set<UDTSOCKET>* readfds, set<UDTSOCKET>* wri
    }
 }
 
+int CUDT::epoll_wait2(const int eid, UDTSOCKET* readfds, int* rnum, UDTSOCKET* writefds, int* wnum, int64_t msTimeOut, SYSSOCKET* lrfds, int* lrnum, SYSSOCKET* lwfds, int* lwnum)
+{
+   try
+   {
+      return s_UDTUnited.epoll_wait2(eid, readfds, rnum, writefds, wnum, msTimeOut, lrfds, lrnum, lwfds, lwnum);
+   }
+   catch (CUDTException e)
+   {
+      s_UDTUnited.setError(new CUDTException(e));
+      return ERROR;
+   }
+   catch (...)
+   {
+      s_UDTUnited.setError(new CUDTException(-1, 0, 0));
+      return ERROR;
+   }
+}
+
 int CUDT::epoll_release(const int eid)
 {
    try
@@ -2190,6 +2396,11 @@ UDTSOCKET accept(UDTSOCKET u, struct sockaddr* addr, int* addrlen)
    return CUDT::accept(u, addr, addrlen);
 }
 
+int acceptBatch(UDTSOCKET u, UDTSOCKET* socks, int size)
+{
+   return CUDT::acceptBatch(u, socks, size);
+}
+
 int connect(UDTSOCKET u, const struct sockaddr* name, int namelen)
 {
    return CUDT::connect(u, name, namelen);
@@ -2235,11 +2446,26 @@ int sendmsg(UDTSOCKET u, const char* buf, int len, int ttl, bool inorder)
    return CUDT::sendmsg(u, buf, len, ttl, inorder);
 }
 
+int sendzc(UDTSOCKET u, const char* buf, int len, UDTZCCALLBACK release, void* param)
+{
+   return CUDT::sendzc(u, buf, len, release, param);
+}
+
 int recvmsg(UDTSOCKET u, char* buf, int len)
 {
    return CUDT::recvmsg(u, buf, len);
 }
 
+int recvpeek(UDTSOCKET u, UDTIOVEC* iov, int iovcnt)
+{
+   return CUDT::recvpeek(u, iov, iovcnt);
+}
+
+int recvconsume(UDTSOCKET u, int len)
+{
+   return CUDT::recvconsume(u, len);
+}
+
 int64_t sendfile(UDTSOCKET u, fstream& ifs, int64_t& offset, int64_t size, int block)
 {
    return CUDT::sendfile(u, ifs, offset, size, block);
@@ -2250,6 +2476,18 @@ int64_t recvfile(UDTSOCKET u, fstream& ofs, int64_t& offset, int64_t size, int b
    return CUDT::recvfile(u, ofs, offset, size, block);
 }
 
+#ifndef WIN32
+int64_t sendfile(UDTSOCKET u, int fd, int64_t& offset, int64_t size, int block)
+{
+   return CUDT::sendfile(u, fd, offset, size, block);
+}
+
+int64_t recvfile(UDTSOCKET u, int fd, int64_t& offset, int64_t size, int block)
+{
+   return CUDT::recvfile(u, fd, offset, size, block);
+}
+#endif
+
 int select(int nfds, UDSET* readfds, UDSET* writefds, UDSET* exceptfds, const struct timeval* timeout)
 {
    return CUDT::select(nfds, readfds, writefds, exceptfds, timeout);
@@ -2290,6 +2528,11 @@ int epoll_wait(const int eid, set<int>* readfds, set<int>* writefds, int64_t msT
    return CUDT::epoll_wait(eid, readfds, writefds, msTimeOut, lrfds, lwfds);
 }
 
+int epoll_wait2(const int eid, UDTSOCKET* readfds, int* rnum, UDTSOCKET* writefds, int* wnum, int64_t msTimeOut, SYSSOCKET* lrfds, int* lrnum, SYSSOCKET* lwfds, int* lwnum)
+{
+   return CUDT::epoll_wait2(eid, readfds, rnum, writefds, wnum, msTimeOut, lrfds, lrnum, lwfds, lwnum);
+}
+
 int epoll_release(const int eid)
 {
    return CUDT::epoll_release(eid);
@@ -49,6 +49,7 @@ written by
 #include "queue.h"
 #include "cache.h"
 #include "epoll.h"
+#include "table.h"
 
 class CUDT;
 
@@ -167,6 +168,7 @@ public:
    int bind(const UDTSOCKET u, UDPSOCKET udpsock);
    int listen(const UDTSOCKET u, const int& backlog);
    UDTSOCKET accept(const UDTSOCKET listen, sockaddr* addr, int* addrlen);
+   int acceptBatch(const UDTSOCKET listen, UDTSOCKET* socks, const int& size);
    int connect(const UDTSOCKET u, const sockaddr* name, const int& namelen);
    int close(const UDTSOCKET u);
    int getpeername(const UDTSOCKET u, sockaddr* name, int* namelen);
@@ -179,6 +181,7 @@ public:
    int epoll_remove_usock(const int eid, const UDTSOCKET u);
    int epoll_remove_ssock(const int eid, const SYSSOCKET s);
    int epoll_wait(const int eid, std::set<UDTSOCKET>* readfds, std::set<UDTSOCKET>* writefds, int64_t msTimeOut, std::set<SYSSOCKET>* lrfds = NULL, std::set<SYSSOCKET>* lwfds = NULL);
+   int epoll_wait2(const int eid, UDTSOCKET* readfds, int* rnum, UDTSOCKET* writefds, int* wnum, int64_t msTimeOut, SYSSOCKET* lrfds = NULL, int* lrnum = NULL, SYSSOCKET* lwfds = NULL, int* lwnum = NULL);
    int epoll_release(const int eid);
 
       // Functionality:
@@ -200,14 +203,14 @@ public:
    CUDTException* getError();
 
 private:
-   std::map<UDTSOCKET, CUDTSocket*> m_Sockets;       // stores all the socket structures
+   CHashTable<UDTSOCKET, CUDTSocket*> m_Sockets;     // stores all the socket structures, lookups do not need m_ControlLock
 
-   pthread_mutex_t m_ControlLock;                    // used to synchronize UDT API
+   pthread_mutex_t m_ControlLock;                    // used to synchronize UDT API, held by every writer of m_Sockets, m_PeerRec and m_ClosedSockets
 
    pthread_mutex_t m_IDLock;                         // used to synchronize ID generation
    UDTSOCKET m_SocketID;                             // seed to generate a new unique socket ID
 
-   std::map<int64_t, std::set<UDTSOCKET> > m_PeerRec;// record sockets from peers to avoid repeated connection request, int64_t = (socker_id << 30) + isn
+   CHashTable<int64_t, UDTSOCKET> m_PeerRec;         // record sockets from peers to avoid repeated connection request, int64_t = (socker_id << 30) + isn
 
 private:
    pthread_key_t m_TLSError;                         // thread local error record (last error)
@@ -221,6 +224,7 @@ private:
 
 private:
    void connect_complete(const UDTSOCKET u);
+   int takeQueued(CUDTSocket* ls, UDTSOCKET* socks, const int& size);
    CUDTSocket* locate(const UDTSOCKET u);
    CUDTSocket* locate(const sockaddr* peer, const UDTSOCKET& id, const int32_t& isn);
    void updateMux(CUDTSocket* s, const sockaddr* addr = NULL, const UDPSOCKET* = NULL);
@@ -232,6 +236,7 @@ private:
 
 private:
    CCache<CInfoBlock>* m_pCache;			// UDT network information cache
+   CPathCache* m_pPathCache;			// persistent copy of m_pCache, enabled by UDT_PATH_CACHE
 
 private:
    volatile bool m_bClosing;
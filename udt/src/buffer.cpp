@@ -38,13 +38,23 @@ written by
    Yunhong Gu, last updated 03/12/2011
 *****************************************************************************/
 
+#ifndef WIN32
+   #include <sys/uio.h>
+   #include <cerrno>
+#endif
 #include <cstring>
 #include <cmath>
 #include "buffer.h"
+#include "pool.h"
 
 using namespace std;
 
-CSndBuffer::CSndBuffer(const int& size, const int& mss):
+#ifndef WIN32
+// maximum number of packets passed to one preadv/pwritev call
+static const int s_iMaxIOV = 1024;
+#endif
+
+CSndBuffer::CSndBuffer(const int& size, const int& mss, const int& node):
 m_BufLock(),
 m_pBlock(NULL),
 m_pFirstBlock(NULL),
@@ -53,34 +63,17 @@ m_pLastBlock(NULL),
 m_pBuffer(NULL),
 m_iNextMsgNo(1),
 m_iSize(size),
+m_iChunkSize(size),
 m_iMSS(mss),
+m_iNode(node),
 m_iCount(0)
 {
    // initial physical buffer of "size"
-   m_pBuffer = new Buffer;
-   m_pBuffer->m_pcData = new char [m_iSize * m_iMSS];
-   m_pBuffer->m_iSize = m_iSize;
-   m_pBuffer->m_pNext = NULL;
+   m_pBuffer = newBuffer(m_iSize);
 
    // circular linked list for out bound packets
-   m_pBlock = new Block;
-   Block* pb = m_pBlock;
-   for (int i = 1; i < m_iSize; ++ i)
-   {
-      pb->m_pNext = new Block;
-      pb->m_iMsgNo = 0;
-      pb = pb->m_pNext;
-   }
-   pb->m_pNext = m_pBlock;
-
-   pb = m_pBlock;
-   char* pc = m_pBuffer->m_pcData;
-   for (int i = 0; i < m_iSize; ++ i)
-   {
-      pb->m_pcData = pc;
-      pb = pb->m_pNext;
-      pc += m_iMSS;
-   }
+   m_pBlock = m_pBuffer->m_pBlocks;
+   m_pBlock[m_iSize - 1].m_pNext = m_pBlock;
 
    m_pFirstBlock = m_pCurrBlock = m_pLastBlock = m_pBlock;
 
@@ -93,20 +86,17 @@ m_iCount(0)
 
 CSndBuffer::~CSndBuffer()
 {
-   Block* pb = m_pBlock->m_pNext;
-   while (pb != m_pBlock)
-   {
-      Block* temp = pb;
-      pb = pb->m_pNext;
-      delete temp;
-   }
-   delete m_pBlock;
+   // user buffers that have not been acknowledged are released now
+   vector<ZCRef*> released;
+   releaseZC(m_pFirstBlock, m_pLastBlock, released);
+   notifyReleased(released);
 
    while (m_pBuffer != NULL)
    {
       Buffer* temp = m_pBuffer;
       m_pBuffer = m_pBuffer->m_pNext;
-      delete [] temp->m_pcData;
+      CMemPool::release(temp->m_pcData, temp->m_iSize * m_iMSS, temp->m_iNode);
+      delete [] temp->m_pBlocks;
       delete temp;
    }
 
@@ -140,6 +130,7 @@ void CSndBuffer::addBuffer(const char* data, const int& len, const int& ttl, con
 
       memcpy(s->m_pcData, data + i * m_iMSS, pktlen);
       s->m_iLength = pktlen;
+      s->m_pZCRef = NULL;
 
       s->m_iMsgNo = m_iNextMsgNo | inorder;
       if (i == 0)
@@ -197,6 +188,7 @@ int CSndBuffer::addBufferFromFile(fstream& ifs, const int& len)
 
       s->m_iLength = pktlen;
       s->m_iTTL = -1;
+      s->m_pZCRef = NULL;
       s = s->m_pNext;
 
       total += pktlen;
@@ -214,13 +206,155 @@ int CSndBuffer::addBufferFromFile(fstream& ifs, const int& len)
    return total;
 }
 
+#ifndef WIN32
+int CSndBuffer::addBufferFromFile(int fd, const int64_t& offset, const int& len)
+{
+   int size = len / m_iMSS;
+   if ((len % m_iMSS) != 0)
+      size ++;
+
+   // dynamically increase sender buffer
+   while (size + m_iCount >= m_iSize)
+      increase();
+
+   iovec iov[s_iMaxIOV];
+   Block* s = m_pLastBlock;
+   int total = 0;
+   int count = 0;
+
+   // read straight into consecutive blocks, up to s_iMaxIOV packets per system call
+   while (count < size)
+   {
+      Block* b = s;
+      int n = 0;
+      int toread = 0;
+      for (; (n < s_iMaxIOV) && (count + n < size); ++ n)
+      {
+         int pktlen = len - (count + n) * m_iMSS;
+         if (pktlen > m_iMSS)
+            pktlen = m_iMSS;
+
+         iov[n].iov_base = b->m_pcData;
+         iov[n].iov_len = pktlen;
+         toread += pktlen;
+         b = b->m_pNext;
+      }
+
+      ssize_t res = preadv(fd, iov, n, offset + total);
+      if (res < 0)
+      {
+         if (EINTR == errno)
+            continue;
+         if (0 == total)
+            return -1;
+         break;
+      }
+
+      bool eof = (res < toread);
+
+      for (int i = 0; (i < n) && (res > 0); ++ i)
+      {
+         int pktlen = int(iov[i].iov_len);
+         if (pktlen > res)
+            pktlen = int(res);
+
+         // currently file transfer is only available in streaming mode, message is always in order, ttl = infinite
+         s->m_iMsgNo = m_iNextMsgNo | 0x20000000;
+         if (count == 0)
+            s->m_iMsgNo |= 0x80000000;
+         if (count == size - 1)
+            s->m_iMsgNo |= 0x40000000;
+
+         s->m_iLength = pktlen;
+         s->m_iTTL = -1;
+         s->m_pZCRef = NULL;
+         s = s->m_pNext;
+
+         total += pktlen;
+         res -= pktlen;
+         ++ count;
+      }
+
+      // a short read means the end of the file
+      if (eof)
+         break;
+   }
+
+   m_pLastBlock = s;
+
+   CGuard::enterCS(m_BufLock);
+   m_iCount += count;
+   CGuard::leaveCS(m_BufLock);
+
+   m_iNextMsgNo ++;
+   if (m_iNextMsgNo == CMsgNo::m_iMaxMsgNo)
+      m_iNextMsgNo = 1;
+
+   return total;
+}
+#endif
+
+void CSndBuffer::addBufferZC(const char* data, const int& len, UDTZCCALLBACK release, void* param)
+{
+   int size = len / m_iMSS;
+   if ((len % m_iMSS) != 0)
+      size ++;
+
+   // dynamically increase sender buffer
+   while (size + m_iCount >= m_iSize)
+      increase();
+
+   ZCRef* ref = new ZCRef;
+   ref->m_pcData = data;
+   ref->m_iLength = len;
+   ref->m_iRefCount = size;
+   ref->m_pRelease = release;
+   ref->m_pParam = param;
+
+   uint64_t time = CTimer::getTime();
+
+   Block* s = m_pLastBlock;
+   for (int i = 0; i < size; ++ i)
+   {
+      int pktlen = len - i * m_iMSS;
+      if (pktlen > m_iMSS)
+         pktlen = m_iMSS;
+
+      // the packet is read from the user buffer when it is (re)sent
+      s->m_pcUserData = data + i * m_iMSS;
+      s->m_pZCRef = ref;
+      s->m_iLength = pktlen;
+
+      // zero-copy sending is only available in streaming mode, message is always in order, ttl = infinite
+      s->m_iMsgNo = m_iNextMsgNo | 0x20000000;
+      if (i == 0)
+         s->m_iMsgNo |= 0x80000000;
+      if (i == size - 1)
+         s->m_iMsgNo |= 0x40000000;
+
+      s->m_OriginTime = time;
+      s->m_iTTL = -1;
+
+      s = s->m_pNext;
+   }
+   m_pLastBlock = s;
+
+   CGuard::enterCS(m_BufLock);
+   m_iCount += size;
+   CGuard::leaveCS(m_BufLock);
+
+   m_iNextMsgNo ++;
+   if (m_iNextMsgNo == CMsgNo::m_iMaxMsgNo)
+      m_iNextMsgNo = 1;
+}
+
 int CSndBuffer::readData(char** data, int32_t& msgno)
 {
    // No data to read
    if (m_pCurrBlock == m_pLastBlock)
       return 0;
 
-   *data = m_pCurrBlock->m_pcData;
+   *data = (NULL == m_pCurrBlock->m_pZCRef) ? m_pCurrBlock->m_pcData : (char*)m_pCurrBlock->m_pcUserData;
    int readlen = m_pCurrBlock->m_iLength;
    msgno = m_pCurrBlock->m_iMsgNo;
 
@@ -258,48 +392,117 @@ int CSndBuffer::readData(char** data, const int offset, int32_t& msgno, int& msg
       return -1;
    }
 
-   *data = p->m_pcData;
+   *data = (NULL == p->m_pZCRef) ? p->m_pcData : (char*)p->m_pcUserData;
    int readlen = p->m_iLength;
    msgno = p->m_iMsgNo;
 
    return readlen;
 }
 
-void CSndBuffer::ackData(const int& offset)
+void CSndBuffer::ackData(const int& offset, vector<ZCRef*>& released)
 {
-   CGuard bufferguard(m_BufLock);
+   {
+      CGuard bufferguard(m_BufLock);
 
-   for (int i = 0; i < offset; ++ i)
-      m_pFirstBlock = m_pFirstBlock->m_pNext;
+      Block* first = m_pFirstBlock;
+      for (int i = 0; i < offset; ++ i)
+         m_pFirstBlock = m_pFirstBlock->m_pNext;
+
+      releaseZC(first, m_pFirstBlock, released);
 
-   m_iCount -= offset;
+      m_iCount -= offset;
+   }
 
    CTimer::triggerEvent();
 }
 
+void CSndBuffer::notifyReleased(vector<ZCRef*>& released)
+{
+   for (vector<ZCRef*>::iterator i = released.begin(); i != released.end(); ++ i)
+   {
+      (*i)->m_pRelease((*i)->m_pcData, (*i)->m_iLength, (*i)->m_pParam);
+      delete *i;
+   }
+
+   released.clear();
+}
+
 int CSndBuffer::getCurrBufSize() const
 {
    return m_iCount;
 }
 
-void CSndBuffer::increase()
+int CSndBuffer::getAvailBufSize(const int& limit, const int& atonce) const
 {
-   int unitsize = m_pBuffer->m_iSize;
+   int avail = limit - m_iCount;
+   if (avail <= 0)
+      return 0;
 
-   // new physical buffer
-   Buffer* nbuf = NULL;
-   try
-   {
-      nbuf  = new Buffer;
-      nbuf->m_pcData = new char [unitsize * m_iMSS];
-   }
-   catch (...)
+   int64_t headroom = CMemPool::getHeadroom();
+   if (headroom < 0)
+      return avail;
+
+   // half of the budget is left to the receiving queues, which every packet in flight needs
+   headroom -= CMemPool::getBudget() / 2;
+   if (headroom < 0)
+      headroom = 0;
+
+   // free blocks (one always stays unused), plus the physical buffers that still fit into the budget
+   int room = m_iSize - 1 - m_iCount + int(headroom / (int64_t(m_iChunkSize) * m_iMSS)) * m_iChunkSize;
+
+   // an empty buffer has no acknowledgement to wait for, so it must not be held back by the budget
+   if ((0 == m_iCount) && (room < atonce))
+      room = atonce;
+
+   return (room < avail) ? room : avail;
+}
+
+int CSndBuffer::shrink()
+{
+   CGuard bufferguard(m_BufLock);
+
+   if ((m_iCount > 0) || (NULL == m_pBuffer->m_pNext))
+      return 0;
+
+   // the sending thread may still compare m_pCurrBlock with m_pLastBlock, so the block they point to
+   // does not move: its physical buffer is kept and becomes the whole ring
+   Buffer* keep = NULL;
+   int released = 0;
+
+   for (Buffer* p = m_pBuffer; NULL != p; )
    {
-      delete nbuf;
-      throw CUDTException(3, 2, 0);
+      Buffer* temp = p;
+      p = p->m_pNext;
+
+      if ((m_pLastBlock >= temp->m_pBlocks) && (m_pLastBlock < temp->m_pBlocks + temp->m_iSize))
+      {
+         keep = temp;
+         continue;
+      }
+
+      CMemPool::release(temp->m_pcData, temp->m_iSize * m_iMSS, temp->m_iNode, true);
+      delete [] temp->m_pBlocks;
+      released += temp->m_iSize;
+      delete temp;
    }
-   nbuf->m_iSize = unitsize;
-   nbuf->m_pNext = NULL;
+
+   // the blocks of a physical buffer are linked in order
+   keep->m_pBlocks[keep->m_iSize - 1].m_pNext = keep->m_pBlocks;
+   keep->m_pNext = NULL;
+
+   m_pBuffer = keep;
+   m_pBlock = keep->m_pBlocks;
+   m_iSize = keep->m_iSize;
+
+   return released;
+}
+
+void CSndBuffer::increase()
+{
+   int unitsize = m_iChunkSize;
+
+   // new physical buffer
+   Buffer* nbuf = newBuffer(unitsize);
 
    // insert the buffer at the end of the buffer list
    Buffer* p = m_pBuffer;
@@ -307,38 +510,64 @@ void CSndBuffer::increase()
       p = p->m_pNext;
    p->m_pNext = nbuf;
 
-   // new packet blocks
+   // insert the new blocks onto the existing one
+   Block* nblk = nbuf->m_pBlocks;
+   nblk[unitsize - 1].m_pNext = m_pLastBlock->m_pNext;
+   m_pLastBlock->m_pNext = nblk;
+
+   m_iSize += unitsize;
+}
+
+CSndBuffer::Buffer* CSndBuffer::newBuffer(const int& size)
+{
+   Buffer* nbuf = NULL;
    Block* nblk = NULL;
+   int node = m_iNode;
+
    try
    {
-      nblk = new Block;
+      nbuf = new Buffer;
+      nblk = new Block [size];
+      if (NULL == (nbuf->m_pcData = CMemPool::allocate(size * m_iMSS, node)))
+         throw CUDTException(3, 2, 0);
    }
    catch (...)
    {
-      delete nblk;
+      delete nbuf;
+      delete [] nblk;
       throw CUDTException(3, 2, 0);
    }
-   Block* pb = nblk;
-   for (int i = 1; i < unitsize; ++ i)
-   {
-      pb->m_pNext = new Block;
-      pb = pb->m_pNext;
-   }
 
-   // insert the new blocks onto the existing one
-   pb->m_pNext = m_pLastBlock->m_pNext;
-   m_pLastBlock->m_pNext = nblk;
+   nbuf->m_iSize = size;
+   nbuf->m_iNode = node;
+   nbuf->m_pBlocks = nblk;
+   nbuf->m_pNext = NULL;
 
-   pb = nblk;
+   // the blocks are consecutive in memory as well, so walking the list touches fewer cache lines
    char* pc = nbuf->m_pcData;
-   for (int i = 0; i < unitsize; ++ i)
+   for (int i = 0; i < size; ++ i)
    {
-      pb->m_pcData = pc;
-      pb = pb->m_pNext;
+      nblk[i].m_pcData = pc;
+      nblk[i].m_iMsgNo = 0;
+      nblk[i].m_pZCRef = NULL;
+      nblk[i].m_pNext = (i + 1 < size) ? nblk + i + 1 : NULL;
       pc += m_iMSS;
    }
 
-   m_iSize += unitsize;
+   return nbuf;
+}
+
+void CSndBuffer::releaseZC(Block* first, Block* last, vector<ZCRef*>& released)
+{
+   for (Block* p = first; p != last; p = p->m_pNext)
+   {
+      if (NULL == p->m_pZCRef)
+         continue;
+
+      if (0 == -- p->m_pZCRef->m_iRefCount)
+         released.push_back(p->m_pZCRef);
+      p->m_pZCRef = NULL;
+   }
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -364,7 +593,7 @@ CRcvBuffer::~CRcvBuffer()
       if (NULL != m_pUnit[i])
       {
          m_pUnit[i]->m_iFlag = 0;
-         -- m_pUnitQueue->m_iCount;
+         m_pUnitQueue->addCount(-1);
       }
    }
 
@@ -383,7 +612,7 @@ int CRcvBuffer::addData(CUnit* unit, int offset)
    m_pUnit[pos] = unit;
 
    unit->m_iFlag = 1;
-   ++ m_pUnitQueue->m_iCount;
+   m_pUnitQueue->addCount(1);
 
    return 0;
 }
@@ -408,7 +637,7 @@ int CRcvBuffer::readBuffer(char* data, const int& len)
          CUnit* tmp = m_pUnit[p];
          m_pUnit[p] = NULL;
          tmp->m_iFlag = 0;
-         -- m_pUnitQueue->m_iCount;
+         m_pUnitQueue->addCount(-1);
 
          if (++ p == m_iSize)
             p = 0;
@@ -446,7 +675,7 @@ int CRcvBuffer::readBufferToFile(fstream& ofs, const int& len)
          CUnit* tmp = m_pUnit[p];
          m_pUnit[p] = NULL;
          tmp->m_iFlag = 0;
-         -- m_pUnitQueue->m_iCount;
+         m_pUnitQueue->addCount(-1);
 
          if (++ p == m_iSize)
             p = 0;
@@ -464,6 +693,117 @@ int CRcvBuffer::readBufferToFile(fstream& ofs, const int& len)
    return len - rs;
 }
 
+#ifndef WIN32
+int CRcvBuffer::readBufferToFile(int fd, const int64_t& offset, const int& len)
+{
+   iovec iov[s_iMaxIOV];
+   int total = 0;
+
+   while (total < len)
+   {
+      int p = m_iStartPos;
+      int lastack = m_iLastAckPos;
+      int notch = m_iNotch;
+      int n = 0;
+      int towrite = 0;
+
+      // gather the continuous units, the first one may be partially read
+      while ((p != lastack) && (n < s_iMaxIOV) && (total + towrite < len))
+      {
+         int unitsize = m_pUnit[p]->m_Packet.getLength() - notch;
+         if (unitsize > len - total - towrite)
+            unitsize = len - total - towrite;
+
+         iov[n].iov_base = m_pUnit[p]->m_Packet.m_pcData + notch;
+         iov[n].iov_len = unitsize;
+         towrite += unitsize;
+         ++ n;
+
+         if (++ p == m_iSize)
+            p = 0;
+
+         notch = 0;
+      }
+
+      if (0 == n)
+         break;
+
+      ssize_t res = pwritev(fd, iov, n, offset + total);
+      if (res < 0)
+      {
+         if (EINTR == errno)
+            continue;
+         if (0 == total)
+            return -1;
+         break;
+      }
+
+      // release only what has reached the file
+      total += consumeBuffer(int(res));
+
+      if (res < towrite)
+         break;
+   }
+
+   return total;
+}
+#endif
+
+int CRcvBuffer::peekBuffer(UDTIOVEC* iov, const int& iovcnt) const
+{
+   int p = m_iStartPos;
+   int lastack = m_iLastAckPos;
+   int notch = m_iNotch;
+   int n = 0;
+
+   while ((p != lastack) && (n < iovcnt))
+   {
+      iov[n].iov_base = m_pUnit[p]->m_Packet.m_pcData + notch;
+      iov[n].iov_len = m_pUnit[p]->m_Packet.getLength() - notch;
+      ++ n;
+
+      if (++ p == m_iSize)
+         p = 0;
+
+      notch = 0;
+   }
+
+   return n;
+}
+
+int CRcvBuffer::consumeBuffer(const int& len)
+{
+   int p = m_iStartPos;
+   int lastack = m_iLastAckPos;
+   int rs = len;
+
+   while ((p != lastack) && (rs > 0))
+   {
+      int unitsize = m_pUnit[p]->m_Packet.getLength() - m_iNotch;
+
+      if (unitsize > rs)
+      {
+         m_iNotch += rs;
+         rs = 0;
+         break;
+      }
+
+      CUnit* tmp = m_pUnit[p];
+      m_pUnit[p] = NULL;
+      tmp->m_iFlag = 0;
+      m_pUnitQueue->addCount(-1);
+
+      if (++ p == m_iSize)
+         p = 0;
+
+      m_iNotch = 0;
+      rs -= unitsize;
+   }
+
+   m_iStartPos = p;
+   return len - rs;
+}
+
 void CRcvBuffer::ackData(const int& len)
 {
    m_iLastAckPos = (m_iLastAckPos + len) % m_iSize;
@@ -521,7 +861,7 @@ int CRcvBuffer::readMsg(char* data, const int& len)
          CUnit* tmp = m_pUnit[p];
          m_pUnit[p] = NULL;
          tmp->m_iFlag = 0;
-         -- m_pUnitQueue->m_iCount;
+         m_pUnitQueue->addCount(-1);
       }
       else
          m_pUnit[p]->m_iFlag = 2;
@@ -586,7 +926,7 @@ bool CRcvBuffer::scanMsg(int& p, int& q, bool& passack)
       CUnit* tmp = m_pUnit[m_iStartPos];
       m_pUnit[m_iStartPos] = NULL;
       tmp->m_iFlag = 0;
-      -- m_pUnitQueue->m_iCount;
+      m_pUnitQueue->addCount(-1);
 
       if (++ m_iStartPos == m_iSize)
          m_iStartPos = 0;
@@ -46,11 +46,14 @@ written by
 #include "list.h"
 #include "queue.h"
 #include <fstream>
+#include <vector>
 
 class CSndBuffer
 {
 public:
-   CSndBuffer(const int& size = 32, const int& mss = 1500);
+      // node: NUMA node for the packet memory, normally the one of the sending thread; -1 for the calling thread
+
+   CSndBuffer(const int& size = 32, const int& mss = 1500, const int& node = -1);
    ~CSndBuffer();
 
       // Functionality:
@@ -75,6 +78,32 @@ public:
 
    int addBufferFromFile(std::fstream& ifs, const int& len);
 
+#ifndef WIN32
+      // Functionality:
+      //    Read a block of data from a file descriptor with positioned reads and insert it into the sending list.
+      // Parameters:
+      //    0) [in] fd: input file descriptor.
+      //    1) [in] offset: file offset of the block.
+      //    2) [in] len: size of the block.
+      // Returned value:
+      //    actual size of data added from the file, 0 at the end of the file, -1 on read error.
+
+   int addBufferFromFile(int fd, const int64_t& offset, const int& len);
+#endif
+
+      // Functionality:
+      //    Insert a user buffer into the sending list without copying it. The buffer is referenced in place
+      //    until all of its packets are acknowledged or the sending buffer is destroyed, then "release" is called.
+      // Parameters:
+      //    0) [in] data: pointer to the user data block.
+      //    1) [in] len: size of the block.
+      //    2) [in] release: callback invoked when the block is no longer referenced.
+      //    3) [in] param: user parameter passed to "release".
+      // Returned value:
+      //    None.
+
+   void addBufferZC(const char* data, const int& len, UDTZCCALLBACK release, void* param);
+
       // Functionality:
       //    Find data position to pack a DATA packet from the furthest reading point.
       // Parameters:
@@ -97,14 +126,34 @@ public:
 
    int readData(char** data, const int offset, int32_t& msgno, int& msglen);
 
+   struct ZCRef                         // user buffer passed to sendzc()
+   {
+      const char* m_pcData;             // user buffer passed to addBufferZC()
+      int m_iLength;                    // length of the user buffer
+      int m_iRefCount;                  // number of blocks still referencing the user buffer
+      UDTZCCALLBACK m_pRelease;         // called when m_iRefCount reaches 0
+      void* m_pParam;                   // user parameter of m_pRelease
+   };
+
       // Functionality:
       //    Update the ACK point and may release/unmap/return the user data according to the flag.
       // Parameters:
       //    0) [in] offset: number of packets acknowledged.
+      //    1) [out] released: user buffers of sendzc() that are no longer referenced, to be passed to notifyReleased().
+      // Returned value:
+      //    None.
+
+   void ackData(const int& offset, std::vector<ZCRef*>& released);
+
+      // Functionality:
+      //    Call the release callbacks of user buffers returned by ackData() and free their records.
+      //    It is called after the caller has left its locks, as the callbacks may call into UDT.
+      // Parameters:
+      //    0) [in, out] released: user buffers to release, the vector is cleared.
       // Returned value:
       //    None.
 
-   void ackData(const int& offset);
+   static void notifyReleased(std::vector<ZCRef*>& released);
 
       // Functionality:
       //    Read size of data still in the sending list.
@@ -115,6 +164,26 @@ public:
 
    int getCurrBufSize() const;
 
+      // Functionality:
+      //    Query how many packets can be added now without exceeding the limit or the memory budget of CMemPool.
+      // Parameters:
+      //    0) [in] limit: maximum number of packets in the buffer.
+      //    1) [in] atonce: number of packets that can only be added together; an empty buffer always takes them.
+      // Returned value:
+      //    Number of packets that can be added.
+
+   int getAvailBufSize(const int& limit, const int& atonce = 1) const;
+
+      // Functionality:
+      //    Return the physical buffers added by increase() to the memory pool if the buffer is empty.
+      //    Data must not be added at the same time.
+      // Parameters:
+      //    None.
+      // Returned value:
+      //    Number of packets released.
+
+   int shrink();
+
 private:
    void increase();
 
@@ -130,6 +199,9 @@ private:
       uint64_t m_OriginTime;            // original request time
       int m_iTTL;                       // time to live (milliseconds)
 
+      const char* m_pcUserData;         // data referenced in place, used instead of m_pcData if m_pZCRef is not NULL
+      ZCRef* m_pZCRef;                  // user buffer this block references, NULL if the data was copied
+
       Block* m_pNext;                   // next block
    } *m_pBlock, *m_pFirstBlock, *m_pCurrBlock, *m_pLastBlock;
 
@@ -140,18 +212,43 @@ private:
 
    struct Buffer
    {
-      char* m_pcData;			// buffer
+      char* m_pcData;			// buffer, a slab of CMemPool
       int m_iSize;			// size
+      int m_iNode;			// NUMA node of m_pcData
+      Block* m_pBlocks;			// blocks of the packets stored in m_pcData, linked in order
       Buffer* m_pNext;			// next buffer
    } *m_pBuffer;			// physical buffer
 
    int32_t m_iNextMsgNo;                // next message number
 
    int m_iSize;				// buffer size (number of packets)
+   int m_iChunkSize;			// size of each physical buffer (number of packets)
    int m_iMSS;                          // maximum seqment/packet size
+   int m_iNode;                         // NUMA node for new physical buffers
 
    int m_iCount;			// number of used blocks
 
+private:
+      // Functionality:
+      //    Allocate a physical buffer and the blocks of its packets.
+      // Parameters:
+      //    0) [in] size: number of packets.
+      // Returned value:
+      //    The new buffer; its last block is not linked to any other block.
+
+   Buffer* newBuffer(const int& size);
+
+      // Functionality:
+      //    Drop the user buffer references of blocks [first, last) and collect the buffers that are released.
+      // Parameters:
+      //    0) [in] first: first block.
+      //    1) [in] last: block after the last one.
+      //    2) [out] released: user buffers that are no longer referenced.
+      // Returned value:
+      //    None.
+
+   void releaseZC(Block* first, Block* last, std::vector<ZCRef*>& released);
+
 private:
    CSndBuffer(const CSndBuffer&);
    CSndBuffer& operator=(const CSndBuffer&);
@@ -195,6 +292,38 @@ public:
 
    int readBufferToFile(std::fstream& ofs, const int& len);
 
+#ifndef WIN32
+      // Functionality:
+      //    Write data directly into a file descriptor with positioned writes.
+      // Parameters:
+      //    0) [in] fd: output file descriptor.
+      //    1) [in] offset: file offset to write the data at.
+      //    2) [in] len: expected length of data to write into the file.
+      // Returned value:
+      //    size of data written, -1 on write error.
+
+   int readBufferToFile(int fd, const int64_t& offset, const int& len);
+#endif
+
+      // Functionality:
+      //    Expose continuously received data as spans of the protocol buffer, without copying or releasing it.
+      // Parameters:
+      //    0) [out] iov: array receiving the spans.
+      //    1) [in] iovcnt: number of entries in "iov".
+      // Returned value:
+      //    number of spans filled.
+
+   int peekBuffer(UDTIOVEC* iov, const int& iovcnt) const;
+
+      // Functionality:
+      //    Release data from the head of the buffer without copying it.
+      // Parameters:
+      //    0) [in] len: size of data to release.
+      // Returned value:
+      //    size of data released.
+
+   int consumeBuffer(const int& len);
+
       // Functionality:
       //    Update the ACK point of the buffer.
       // Parameters:
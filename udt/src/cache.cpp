@@ -46,7 +46,16 @@ written by
    #endif
 #endif
 
+#ifndef WIN32
+   #include <fcntl.h>
+   #include <unistd.h>
+   #include <sys/file.h>
+   #include <sys/mman.h>
+   #include <sys/stat.h>
+#endif
+
 #include <cstring>
+#include <ctime>
 #include "cache.h"
 #include "core.h"
 
@@ -54,7 +63,7 @@ using namespace std;
 
 CInfoBlock& CInfoBlock::operator=(const CInfoBlock& obj)
 {
-   std::copy(obj.m_piIP, obj.m_piIP + 3, m_piIP);
+   std::copy(obj.m_piIP, obj.m_piIP + 4, m_piIP);
    m_iIPversion = obj.m_iIPversion;
    m_ullTimeStamp = obj.m_ullTimeStamp;
    m_iRTT = obj.m_iRTT;
@@ -88,7 +97,7 @@ CInfoBlock* CInfoBlock::clone()
 {
    CInfoBlock* obj = new CInfoBlock;
 
-   std::copy(m_piIP, m_piIP + 3, obj->m_piIP);
+   std::copy(m_piIP, m_piIP + 4, obj->m_piIP);
    obj->m_iIPversion = m_iIPversion;
    obj->m_ullTimeStamp = m_ullTimeStamp;
    obj->m_iRTT = m_iRTT;
@@ -103,10 +112,11 @@ CInfoBlock* CInfoBlock::clone()
 
 int CInfoBlock::getKey()
 {
+   // the key must not be negative, or the item is not cached at all
    if (m_iIPversion == AF_INET)
-      return m_piIP[0];
+      return m_piIP[0] & 0x7FFFFFFF;
 
-   return m_piIP[0] + m_piIP[1] + m_piIP[2] + m_piIP[3];
+   return (m_piIP[0] + m_piIP[1] + m_piIP[2] + m_piIP[3]) & 0x7FFFFFFF;
 }
 
 void CInfoBlock::convert(const sockaddr* addr, const int& ver, uint32_t ip[])
@@ -121,3 +131,233 @@ void CInfoBlock::convert(const sockaddr* addr, const int& ver, uint32_t ip[])
       memcpy((char*)ip, (char*)((sockaddr_in6*)addr)->sin6_addr.s6_addr, 16);
    }
 }
+
+
+static const char s_pcPathCacheMagic[8] = {'U', 'D', 'T', 'P', 'A', 'T', 'H', '\0'};
+static const int s_iPathCacheVersion = 1;
+
+CPathCache::CPathCache():
+#ifndef WIN32
+m_iFile(-1),
+#else
+m_hFile(INVALID_HANDLE_VALUE),
+m_hMapping(NULL),
+#endif
+m_pHeader(NULL),
+m_pRecords(NULL)
+{
+   CGuard::createMutex(m_Lock);
+}
+
+CPathCache::~CPathCache()
+{
+   close();
+   CGuard::releaseMutex(m_Lock);
+}
+
+int CPathCache::open(const char* path)
+{
+   CGuard cacheguard(m_Lock);
+
+   if (NULL != m_pHeader)
+      return 0;
+
+   const int size = sizeof(CHeader) + m_iRecords * sizeof(CRecord);
+   void* data = NULL;
+
+   #ifndef WIN32
+      m_iFile = ::open(path, O_RDWR | O_CREAT, 0644);
+      if (m_iFile < 0)
+         return -1;
+
+      lock();
+
+      // a file of another size is from another version, start over
+      struct stat st;
+      bool valid = (0 == fstat(m_iFile, &st));
+      if (valid && (st.st_size != size))
+         valid = (0 == ftruncate(m_iFile, 0)) && (0 == ftruncate(m_iFile, size));
+      if (valid)
+      {
+         data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, m_iFile, 0);
+         if (MAP_FAILED == data)
+            data = NULL;
+      }
+   #else
+      m_hFile = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+      if (INVALID_HANDLE_VALUE == m_hFile)
+         return -1;
+
+      lock();
+
+      m_hMapping = CreateFileMapping(m_hFile, NULL, PAGE_READWRITE, 0, size, NULL);
+      if (NULL != m_hMapping)
+         data = MapViewOfFile(m_hMapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+   #endif
+
+   if (NULL != data)
+   {
+      m_pHeader = (CHeader*)data;
+      m_pRecords = (CRecord*)(m_pHeader + 1);
+
+      if ((0 != memcmp(m_pHeader->m_pcMagic, s_pcPathCacheMagic, sizeof(s_pcPathCacheMagic))) || (s_iPathCacheVersion != m_pHeader->m_iVersion) || (m_iRecords != m_pHeader->m_iRecords))
+      {
+         memset(data, 0, size);
+         memcpy(m_pHeader->m_pcMagic, s_pcPathCacheMagic, sizeof(s_pcPathCacheMagic));
+         m_pHeader->m_iVersion = s_iPathCacheVersion;
+         m_pHeader->m_iRecords = m_iRecords;
+      }
+   }
+
+   unlock();
+
+   if (NULL == data)
+   {
+      #ifndef WIN32
+         ::close(m_iFile);
+         m_iFile = -1;
+      #else
+         if (NULL != m_hMapping)
+            CloseHandle(m_hMapping);
+         CloseHandle(m_hFile);
+         m_hMapping = NULL;
+         m_hFile = INVALID_HANDLE_VALUE;
+      #endif
+      return -1;
+   }
+
+   return 0;
+}
+
+void CPathCache::close()
+{
+   CGuard cacheguard(m_Lock);
+
+   if (NULL == m_pHeader)
+      return;
+
+   #ifndef WIN32
+      munmap(m_pHeader, sizeof(CHeader) + m_iRecords * sizeof(CRecord));
+      ::close(m_iFile);
+      m_iFile = -1;
+   #else
+      UnmapViewOfFile(m_pHeader);
+      CloseHandle(m_hMapping);
+      CloseHandle(m_hFile);
+      m_hMapping = NULL;
+      m_hFile = INVALID_HANDLE_VALUE;
+   #endif
+
+   m_pHeader = NULL;
+   m_pRecords = NULL;
+}
+
+int CPathCache::load(CCache<CInfoBlock>* cache)
+{
+   CGuard cacheguard(m_Lock);
+
+   if (NULL == m_pHeader)
+      return -1;
+
+   int64_t now = time(NULL);
+   int count = 0;
+
+   lock();
+
+   for (int i = 0; i < m_iRecords; ++ i)
+   {
+      const CRecord& r = m_pRecords[i];
+      if ((0 == r.m_llTimeStamp) || (now - r.m_llTimeStamp > m_iExpiry))
+         continue;
+
+      CInfoBlock ib;
+      std::copy(r.m_piIP, r.m_piIP + 4, ib.m_piIP);
+      ib.m_iIPversion = (4 == r.m_iIPversion) ? AF_INET : AF_INET6;
+      ib.m_ullTimeStamp = CTimer::getTime() - uint64_t((now > r.m_llTimeStamp) ? now - r.m_llTimeStamp : 0) * 1000000;
+      ib.m_iRTT = r.m_iRTT;
+      ib.m_iBandwidth = r.m_iBandwidth;
+      ib.m_iLossRate = 0;
+      ib.m_iReorderDistance = 0;
+      ib.m_dInterval = (r.m_iDeliveryRate > 0) ? 1000000.0 / r.m_iDeliveryRate : 0;
+      ib.m_dCWnd = 0;
+
+      if (cache->update(&ib) >= 0)
+         ++ count;
+   }
+
+   unlock();
+
+   return count;
+}
+
+int CPathCache::update(const CInfoBlock* ib)
+{
+   CGuard cacheguard(m_Lock);
+
+   if (NULL == m_pHeader)
+      return -1;
+
+   int32_t ver = (AF_INET == ib->m_iIPversion) ? 4 : 6;
+
+   lock();
+
+   // the record of the peer, or else the least recently updated one
+   CRecord* r = m_pRecords;
+   for (int i = 0; i < m_iRecords; ++ i)
+   {
+      CRecord* p = m_pRecords + i;
+      if ((0 != p->m_llTimeStamp) && (p->m_iIPversion == ver) && (0 == memcmp(p->m_piIP, ib->m_piIP, sizeof(p->m_piIP))))
+      {
+         r = p;
+         break;
+      }
+      if (p->m_llTimeStamp < r->m_llTimeStamp)
+         r = p;
+   }
+
+   std::copy(ib->m_piIP, ib->m_piIP + 4, r->m_piIP);
+   r->m_iIPversion = ver;
+   r->m_iRTT = ib->m_iRTT;
+   r->m_iBandwidth = ib->m_iBandwidth;
+   r->m_iDeliveryRate = (ib->m_dInterval > 0) ? int32_t(1000000.0 / ib->m_dInterval) : 0;
+   // an entry that kept the rate of an earlier connection keeps its age, so that the rate still expires
+   r->m_llTimeStamp = time(NULL);
+   if (0 != ib->m_ullTimeStamp)
+      r->m_llTimeStamp -= int64_t((CTimer::getTime() - ib->m_ullTimeStamp) / 1000000);
+
+   unlock();
+
+   return 0;
+}
+
+bool CPathCache::isFresh(const CInfoBlock* ib)
+{
+   CGuard cacheguard(m_Lock);
+
+   if ((NULL == m_pHeader) || (0 == ib->m_ullTimeStamp))
+      return false;
+
+   return CTimer::getTime() - ib->m_ullTimeStamp <= uint64_t(m_iExpiry) * 1000000;
+}
+
+void CPathCache::lock()
+{
+   #ifndef WIN32
+      flock(m_iFile, LOCK_EX);
+   #else
+      OVERLAPPED ov;
+      memset(&ov, 0, sizeof(OVERLAPPED));
+      LockFileEx(m_hFile, LOCKFILE_EXCLUSIVE_LOCK, 0, MAXDWORD, MAXDWORD, &ov);
+   #endif
+}
+
+void CPathCache::unlock()
+{
+   #ifndef WIN32
+      flock(m_iFile, LOCK_UN);
+   #else
+      OVERLAPPED ov;
+      memset(&ov, 0, sizeof(OVERLAPPED));
+      UnlockFileEx(m_hFile, 0, MAXDWORD, MAXDWORD, &ov);
+   #endif
+}
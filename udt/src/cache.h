@@ -259,7 +259,7 @@ class CInfoBlock
 public:
    uint32_t m_piIP[4];		// IP address, machine read only, not human readable format
    int m_iIPversion;		// IP version
-   uint64_t m_ullTimeStamp;	// last update time
+   uint64_t m_ullTimeStamp;	// last update time, on the CTimer::getTime() clock, 0 if unknown
    int m_iRTT;			// RTT
    int m_iBandwidth;		// estimated bandwidth
    int m_iLossRate;		// average loss rate
@@ -289,5 +289,103 @@ public:
    static void convert(const sockaddr* addr, const int& ver, uint32_t ip[]);
 };
 
+// Persistent copy of the path information (RTT, bandwidth, delivery rate) in a memory mapped
+// file, shared by all processes that use the same file, so that a new process can start a
+// connection from what the last one learnt about the path instead of from scratch.
+
+class CPathCache
+{
+public:
+   CPathCache();
+   ~CPathCache();
+
+public:
+
+      // Functionality:
+      //    open (and create if necessary) the cache file and map it into memory.
+      // Parameters:
+      //    0) [in] path: name of the cache file.
+      // Returned value:
+      //    0 if success, otherwise -1.
+
+   int open(const char* path);
+
+      // Functionality:
+      //    unmap and close the cache file.
+      // Parameters:
+      //    None.
+      // Returned value:
+      //    None.
+
+   void close();
+
+      // Functionality:
+      //    copy the entries that are not older than the expiry time into an in-memory cache.
+      // Parameters:
+      //    0) [in/out] cache: the cache to be loaded.
+      // Returned value:
+      //    number of entries loaded, or -1 if the file is not open.
+
+   int load(CCache<CInfoBlock>* cache);
+
+      // Functionality:
+      //    update the entry of a peer, or replace the oldest one if there is none.
+      // Parameters:
+      //    0) [in] ib: path information, keyed by its IP address.
+      // Returned value:
+      //    0 if success, otherwise -1.
+
+   int update(const CInfoBlock* ib);
+
+      // Functionality:
+      //    check if the rate of an entry may start a connection: the file is open and the entry is not expired.
+      // Parameters:
+      //    0) [in] ib: path information from the in-memory cache.
+      // Returned value:
+      //    true if the entry can be used, otherwise false.
+
+   bool isFresh(const CInfoBlock* ib);
+
+private:
+   struct CRecord
+   {
+      uint32_t m_piIP[4];		// IP address, same format as CInfoBlock
+      int32_t m_iIPversion;		// 4 or 6, the AF_ values differ between platforms
+      int32_t m_iRTT;			// RTT, microseconds
+      int32_t m_iBandwidth;		// estimated bandwidth, packets per second
+      int32_t m_iDeliveryRate;		// receiving rate reported by the peer, packets per second, 0 if unknown
+      int64_t m_llTimeStamp;		// last update, seconds since the epoch, 0 for a free record
+   };
+
+   struct CHeader
+   {
+      char m_pcMagic[8];
+      int32_t m_iVersion;
+      int32_t m_iRecords;
+   };
+
+   static const int m_iRecords = 256;	// number of peers in the file
+   static const int m_iExpiry = 3600;	// entries older than this (seconds) are not loaded
+
+   void lock();
+   void unlock();
+
+private:
+   #ifndef WIN32
+      int m_iFile;			// file descriptor of the cache file, -1 if not open
+   #else
+      HANDLE m_hFile;
+      HANDLE m_hMapping;
+   #endif
+   CHeader* m_pHeader;			// mapped file, NULL if not open
+   CRecord* m_pRecords;			// records following the header
+
+   pthread_mutex_t m_Lock;		// the file lock does not exclude threads of the same process
+
+private:
+   CPathCache(const CPathCache&);
+   CPathCache& operator=(const CPathCache&);
+};
+
 
 #endif
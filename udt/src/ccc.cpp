@@ -54,6 +54,7 @@ m_iMSS(),
 m_iSndCurrSeqNo(),
 m_iRcvRate(),
 m_iRTT(),
+m_iCachedRate(),
 m_pcParam(NULL),
 m_iPSize(0),
 m_UDT(),
@@ -146,6 +147,11 @@ void CCC::setRTT(const int& rtt)
    m_iRTT = rtt;
 }
 
+void CCC::setCachedRate(const int& rate)
+{
+   m_iCachedRate = rate;
+}
+
 void CCC::setUserParam(const char* param, const int& size)
 {
    delete [] m_pcParam;
@@ -187,6 +193,14 @@ void CUDTCC::init()
 
    m_dCWndSize = 16;
    m_dPktSndPeriod = 1;
+
+   // the path has been used recently (see CPathCache::isFresh): skip slow start and continue from the rate it delivered then
+   if (m_iCachedRate > 0)
+   {
+      m_bSlowStart = false;
+      m_dPktSndPeriod = 1000000.0 / m_iCachedRate;
+      m_dCWndSize = m_iCachedRate / 1000000.0 * (m_iRTT + m_iRCInterval) + 16;
+   }
 }
 
 void CUDTCC::onACK(const int32_t& ack)
@@ -318,3 +332,395 @@ void CUDTCC::onTimeout()
       */
    }
 }
+
+
+// 2/ln(2): the smallest gain that lets STARTUP double the delivery rate every round trip
+static const double s_dBBRHighGain = 2.885;
+// PROBE_BW probes for more bandwidth for one phase, drains the queue it built for one phase, then cruises
+static const double s_pdBBRCycleGain[] = {1.25, 0.75, 1, 1, 1, 1, 1, 1};
+static const int s_iBBRMinCWnd = 4;
+static const uint64_t s_ullBBRMinRTTWindow = 10000000;
+static const uint64_t s_ullBBRProbeRTTTime = 200000;
+static const double s_dBBRStartupLossRate = 0.02;
+
+CBBRCC::CBBRCC():
+m_Mode(STARTUP),
+m_dPacingGain(),
+m_dCWndGain(),
+m_dBtlBw(),
+m_iRound(),
+m_iRoundEndSeq(),
+m_bRoundStart(),
+m_bAppLimited(),
+m_bIdleRestart(),
+m_bRecovery(),
+m_iRecoverySeq(),
+m_iLastAck(),
+m_iSampleAck(),
+m_iSampleSndSeq(),
+m_SampleTime(),
+m_iPrevSampleSndSeq(),
+m_PrevSampleTime(),
+m_iMinRTT(),
+m_MinRTTStamp(),
+m_dFullBw(),
+m_iFullBwCount(),
+m_bFilledPipe(),
+m_iStartupSeq(),
+m_iStartupLost(),
+m_iCycleIndex(),
+m_CycleStamp(),
+m_ProbeRTTDoneStamp()
+{
+   memset(m_pdRoundBw, 0, sizeof(m_pdRoundBw));
+}
+
+void CBBRCC::init()
+{
+   setACKTimer(m_iSYNInterval);
+
+   uint64_t currtime = CTimer::getTime();
+
+   memset(m_pdRoundBw, 0, sizeof(m_pdRoundBw));
+   m_dBtlBw = 0;
+   m_iRound = 0;
+   m_iRoundEndSeq = m_iSndCurrSeqNo;
+   m_bRoundStart = false;
+   m_bAppLimited = false;
+   m_bIdleRestart = false;
+   m_bRecovery = false;
+   m_iRecoverySeq = m_iSndCurrSeqNo;
+
+   m_iLastAck = CSeqNo::incseq(m_iSndCurrSeqNo);
+   m_iSampleAck = m_iLastAck;
+   m_iSampleSndSeq = m_iSndCurrSeqNo;
+   m_SampleTime = currtime;
+   m_iPrevSampleSndSeq = m_iSampleSndSeq;
+   m_PrevSampleTime = m_SampleTime;
+
+   m_iMinRTT = m_iRTT;
+   m_MinRTTStamp = currtime;
+
+   m_dFullBw = 0;
+   m_iFullBwCount = 0;
+   m_bFilledPipe = false;
+
+   m_iCycleIndex = 0;
+   m_CycleStamp = currtime;
+   m_ProbeRTTDoneStamp = 0;
+
+   enterStartup();
+
+   // until the first bandwidth sample, pace the initial window over the (default) RTT
+   m_dCWndSize = 16;
+   m_dPktSndPeriod = m_iRTT / (m_dPacingGain * m_dCWndSize);
+
+   // the path has been used recently: STARTUP begins from the rate it delivered then, which
+   // leaves the max filter after m_iBwRounds round trips if the path does not deliver it anymore
+   if (m_iCachedRate > 0)
+   {
+      m_pdRoundBw[0] = m_dBtlBw = m_iCachedRate;
+      m_dCWndSize = getBDP(m_dCWndGain);
+      setRateAndWindow(0);
+   }
+}
+
+void CBBRCC::onACK(const int32_t& ack)
+{
+   int acked = CSeqNo::seqoff(m_iLastAck, ack);
+   if (acked <= 0)
+      return;
+
+   uint64_t currtime = CTimer::getTime();
+
+   updateBandwidth(ack, currtime);
+   bool rttexpired = updateMinRTT(currtime);
+   updateMode(ack, currtime, rttexpired);
+   setRateAndWindow(acked);
+
+   m_iLastAck = ack;
+   if (CSeqNo::seqcmp(ack, m_iSndCurrSeqNo) > 0)
+      m_bIdleRestart = true;
+}
+
+void CBBRCC::onLoss(const int32_t* losslist, const int& size)
+{
+   // loss is not a congestion signal here: a full queue shows up as a higher RTT and a flat
+   // delivery rate, both of which are already in the model. The exception is STARTUP, which
+   // overflows the bottleneck buffer long before the bandwidth stops growing when the buffer
+   // is shallow, or while no rate sample can be taken because of the repairs.
+   startRecovery();
+
+   if ((STARTUP != m_Mode) || (m_dBtlBw <= 0))
+      return;
+
+   for (int i = 0; i < size; ++ i)
+   {
+      if ((losslist[i] & 0x80000000) && (i + 1 < size))
+      {
+         m_iStartupLost += CSeqNo::seqlen(losslist[i] & 0x7FFFFFFF, losslist[i + 1]);
+         ++ i;
+      }
+      else
+         ++ m_iStartupLost;
+   }
+
+   if (m_iStartupLost > CSeqNo::seqlen(m_iStartupSeq, m_iSndCurrSeqNo) * s_dBBRStartupLossRate)
+      m_bFilledPipe = true;
+}
+
+void CBBRCC::onTimeout()
+{
+   // keep the model, but restart from a small window until ACKs come back
+   m_dCWndSize = s_iBBRMinCWnd;
+   startRecovery();
+}
+
+void CBBRCC::startRecovery()
+{
+   if (m_bRecovery)
+      return;
+
+   m_bRecovery = true;
+   m_iRecoverySeq = m_iSndCurrSeqNo;
+}
+
+void CBBRCC::updateBandwidth(const int32_t& ack, const uint64_t& currtime)
+{
+   m_bRoundStart = false;
+
+   // the sender ran out of data: start over with the first ACK of the next flight, so that the
+   // idle time in between is not taken for a low delivery rate
+   if (m_bIdleRestart)
+   {
+      m_bIdleRestart = false;
+      m_iSampleAck = ack;
+      m_iSampleSndSeq = m_iSndCurrSeqNo;
+      m_SampleTime = currtime;
+      m_iPrevSampleSndSeq = m_iSampleSndSeq;
+      m_PrevSampleTime = m_SampleTime;
+      return;
+   }
+
+   // ACKs handled in one wakeup arrive back to back, so a sample spans at least one SYN interval,
+   // and at least one RTT so that counting whole packets does not round the rate up by a percent
+   if (currtime - m_SampleTime < (uint64_t)((m_iMinRTT > m_iSYNInterval) ? m_iMinRTT : m_iSYNInterval))
+      return;
+
+   // the ACK stalls at a hole and then jumps over everything received behind it once the hole is
+   // repaired, so a sample cut during recovery would count that jump as delivered in one interval;
+   // the sample is extended until the packets outstanding at the loss are all acknowledged
+   if (m_bRecovery)
+   {
+      if (CSeqNo::seqcmp(ack, m_iRecoverySeq) <= 0)
+         return;
+      m_bRecovery = false;
+   }
+
+   // delivery rate over the sample, bounded by the sending rate so that an ACK covering a repaired
+   // loss does not count the packets queued behind it as new delivery. The packets acknowledged in
+   // a sample may also have been sent during the previous one when the RTT is shorter than the SYN
+   // interval (a window sent in one burst is split over two ACKs), so the bound is then the higher
+   // rate over one or both samples
+   double interval = double(currtime - m_SampleTime);
+   double delivered = CSeqNo::seqoff(m_iSampleAck, ack) * 1000000.0 / interval;
+   double sent = CSeqNo::seqoff(m_iSampleSndSeq, m_iSndCurrSeqNo) * 1000000.0 / interval;
+   if (m_iMinRTT < m_iSYNInterval)
+   {
+      double prevsent = CSeqNo::seqoff(m_iPrevSampleSndSeq, m_iSndCurrSeqNo) * 1000000.0 / double(currtime - m_PrevSampleTime);
+      if (prevsent > sent)
+         sent = prevsent;
+   }
+   double rate = (delivered < sent) ? delivered : sent;
+
+   // the application did not keep up with the pacing rate or the window: such a sample
+   // says nothing about the path and must not lower the estimate
+   double pacing = 1000000.0 / m_dPktSndPeriod;
+   int inflight = CSeqNo::seqoff(ack, m_iSndCurrSeqNo) + 1;
+   m_bAppLimited = (sent < pacing * 0.8) && (inflight < m_dCWndSize * 0.8);
+
+   // a round trip ends when the packets sent at its start are acknowledged
+   if (CSeqNo::seqcmp(ack, m_iRoundEndSeq) > 0)
+   {
+      ++ m_iRound;
+      m_iRoundEndSeq = m_iSndCurrSeqNo;
+      m_bRoundStart = true;
+      m_pdRoundBw[m_iRound % m_iBwRounds] = 0;
+   }
+
+   // an app limited sample is not recorded either, or it would keep an old maximum alive
+   double& roundbw = m_pdRoundBw[m_iRound % m_iBwRounds];
+   if ((rate > roundbw) && (!m_bAppLimited || (rate > m_dBtlBw)))
+      roundbw = rate;
+
+   // keep the last estimate if the application was idle for the whole filter length
+   double btlbw = 0;
+   for (int i = 0; i < m_iBwRounds; ++ i)
+   {
+      if (m_pdRoundBw[i] > btlbw)
+         btlbw = m_pdRoundBw[i];
+   }
+   if (btlbw > 0)
+      m_dBtlBw = btlbw;
+
+   m_iPrevSampleSndSeq = m_iSampleSndSeq;
+   m_PrevSampleTime = m_SampleTime;
+   m_iSampleAck = ack;
+   m_iSampleSndSeq = m_iSndCurrSeqNo;
+   m_SampleTime = currtime;
+}
+
+bool CBBRCC::updateMinRTT(const uint64_t& currtime)
+{
+   // m_iRTT is smoothed by UDT, its lowest recent value is the best available propagation delay estimate
+   bool expired = (currtime - m_MinRTTStamp > s_ullBBRMinRTTWindow);
+
+   if ((m_iRTT <= m_iMinRTT) || expired)
+   {
+      m_iMinRTT = m_iRTT;
+      m_MinRTTStamp = currtime;
+   }
+
+   return expired;
+}
+
+void CBBRCC::updateMode(const int32_t& ack, const uint64_t& currtime, const bool& rttexpired)
+{
+   int inflight = CSeqNo::seqoff(ack, m_iSndCurrSeqNo) + 1;
+
+   // the pipe is full once the bandwidth has not grown by 25% for 3 round trips
+   if (m_bRoundStart && !m_bAppLimited && !m_bFilledPipe)
+   {
+      if (m_dBtlBw >= m_dFullBw * 1.25)
+      {
+         m_dFullBw = m_dBtlBw;
+         m_iFullBwCount = 0;
+      }
+      else if (++ m_iFullBwCount >= 3)
+         m_bFilledPipe = true;
+   }
+
+   if ((STARTUP == m_Mode) && m_bFilledPipe)
+   {
+      // drain the queue STARTUP has built
+      m_Mode = DRAIN;
+      m_dPacingGain = 1.0 / s_dBBRHighGain;
+      m_dCWndGain = s_dBBRHighGain;
+   }
+
+   if ((DRAIN == m_Mode) && (inflight <= getBDP(1.0)))
+      enterProbeBW(currtime);
+
+   // each phase lasts a round trip, but no less than a rate sample
+   if ((PROBE_BW == m_Mode) && (currtime - m_CycleStamp > (uint64_t)((m_iMinRTT > m_iSYNInterval) ? m_iMinRTT : m_iSYNInterval)))
+   {
+      m_iCycleIndex = (m_iCycleIndex + 1) % m_iCycleLen;
+      m_CycleStamp = currtime;
+      m_dPacingGain = s_pdBBRCycleGain[m_iCycleIndex];
+   }
+
+   // the min RTT has not been seen for a while, the queue may be hiding it: drain the window to measure it again
+   if (rttexpired && (PROBE_RTT != m_Mode))
+   {
+      m_Mode = PROBE_RTT;
+      m_dPacingGain = 1;
+      m_dCWndGain = 1;
+      m_ProbeRTTDoneStamp = 0;
+   }
+
+   if (PROBE_RTT == m_Mode)
+   {
+      if ((0 == m_ProbeRTTDoneStamp) && (inflight <= s_iBBRMinCWnd))
+         m_ProbeRTTDoneStamp = currtime + ((m_iMinRTT > (int)s_ullBBRProbeRTTTime) ? m_iMinRTT : s_ullBBRProbeRTTTime);
+      else if ((0 != m_ProbeRTTDoneStamp) && (currtime > m_ProbeRTTDoneStamp))
+      {
+         m_MinRTTStamp = currtime;
+
+         if (m_bFilledPipe)
+            enterProbeBW(currtime);
+         else
+            enterStartup();
+      }
+   }
+}
+
+void CBBRCC::enterStartup()
+{
+   m_iStartupSeq = m_iSndCurrSeqNo;
+   m_iStartupLost = 0;
+
+   m_Mode = STARTUP;
+   m_dPacingGain = s_dBBRHighGain;
+   m_dCWndGain = s_dBBRHighGain;
+}
+
+void CBBRCC::enterProbeBW(const uint64_t& currtime)
+{
+   m_Mode = PROBE_BW;
+   m_dCWndGain = 2;
+
+   // start at a random phase other than the draining one, so that flows sharing a link do not probe in step
+   m_iCycleIndex = int(currtime % (m_iCycleLen - 1));
+   if (m_iCycleIndex >= 1)
+      ++ m_iCycleIndex;
+
+   m_CycleStamp = currtime;
+   m_dPacingGain = s_pdBBRCycleGain[m_iCycleIndex];
+}
+
+double CBBRCC::getBDP(const double& gain) const
+{
+   if (m_dBtlBw <= 0)
+      return 16;
+
+   // ACKs only come back every SYN interval, so the window also has to cover what is sent in
+   // between. The gain applies to the longer of the two, or STARTUP could not grow the window
+   // on paths where the RTT is much shorter than the SYN interval (loopback, LAN)
+   if (m_iMinRTT >= m_iSYNInterval)
+      return m_dBtlBw * (gain * m_iMinRTT + m_iSYNInterval) / 1000000.0;
+   return m_dBtlBw * (m_iMinRTT + gain * m_iSYNInterval) / 1000000.0;
+}
+
+void CBBRCC::setRateAndWindow(const int& acked)
+{
+   // until the pipe is filled the rate only goes up, so that slow samples taken while the
+   // connection is still idle do not hold back STARTUP
+   if (m_dBtlBw > 0)
+   {
+      double period = 1000000.0 / (m_dPacingGain * m_dBtlBw);
+      if (m_bFilledPipe || (period < m_dPktSndPeriod))
+         m_dPktSndPeriod = period;
+   }
+
+   double target = getBDP(m_dCWndGain);
+
+   if (PROBE_RTT == m_Mode)
+   {
+      m_dCWndSize = s_iBBRMinCWnd;
+   }
+   else if (m_bFilledPipe)
+   {
+      m_dCWndSize += acked;
+      if (m_dCWndSize > target)
+         m_dCWndSize = target;
+   }
+   else if (m_dCWndSize < target)
+      m_dCWndSize += acked;
+
+   if (m_dCWndSize < s_iBBRMinCWnd)
+      m_dCWndSize = s_iBBRMinCWnd;
+   if (m_dCWndSize > m_dMaxCWndSize)
+      m_dCWndSize = m_dMaxCWndSize;
+
+   //set maximum transfer rate
+   if ((NULL != m_pcParam) && (m_iPSize == 8))
+   {
+      int64_t maxSR = *(int64_t*)m_pcParam;
+      if (maxSR <= 0)
+         return;
+
+      double minSP = 1000000.0 / (double(maxSR) / m_iMSS);
+      if (m_dPktSndPeriod < minSP)
+         m_dPktSndPeriod = minSP;
+   }
+}
@@ -50,6 +50,7 @@ written by
 class UDT_API CCC
 {
 friend class CUDT;
+friend class CSimulator;
 
 public:
    CCC();
@@ -201,6 +202,7 @@ private:
    void setSndCurrSeqNo(const int32_t& seqno);
    void setRcvRate(const int& rcvrate);
    void setRTT(const int& rtt);
+   void setCachedRate(const int& rate);
 
 protected:
    const int32_t& m_iSYNInterval;	// UDT constant parameter, SYN
@@ -215,6 +217,7 @@ protected:
    int32_t m_iSndCurrSeqNo;		// current maximum seq no sent out
    int m_iRcvRate;			// packet arrive rate at receiver side, packets per second
    int m_iRTT;				// current estimated RTT, microsecond
+   int m_iCachedRate;			// delivery rate of the last connection to the same peer, packets per second, 0 if unknown
 
    char* m_pcParam;			// user defined parameter
    int m_iPSize;			// size of m_pcParam
@@ -275,4 +278,70 @@ private:
    int m_iDecCount;			// number of decreases in a congestion epoch
 };
 
+// Model based congestion control: estimates the bottleneck bandwidth and the minimum RTT,
+// paces packets at the estimated bandwidth and keeps about one BDP in flight. Random loss is
+// not treated as congestion, a standing queue is detected through the RTT instead.
+class UDT_API CBBRCC: public CCC
+{
+public:
+   CBBRCC();
+
+public:
+   virtual void init();
+   virtual void onACK(const int32_t&);
+   virtual void onLoss(const int32_t*, const int&);
+   virtual void onTimeout();
+
+private:
+   void updateBandwidth(const int32_t& ack, const uint64_t& currtime);
+   bool updateMinRTT(const uint64_t& currtime);
+   void updateMode(const int32_t& ack, const uint64_t& currtime, const bool& rttexpired);
+   void enterStartup();
+   void enterProbeBW(const uint64_t& currtime);
+   void startRecovery();
+   void setRateAndWindow(const int& acked);
+   double getBDP(const double& gain) const;
+
+private:
+   enum Mode {STARTUP, DRAIN, PROBE_BW, PROBE_RTT};
+
+   static const int m_iBwRounds = 10;	// length of the bandwidth max filter, in round trips
+   static const int m_iCycleLen = 8;	// number of phases in a PROBE_BW gain cycle
+
+   Mode m_Mode;				// current state of the controller
+   double m_dPacingGain;		// pacing rate relative to the estimated bandwidth
+   double m_dCWndGain;			// congestion window relative to the BDP
+
+   double m_pdRoundBw[m_iBwRounds];	// highest delivery rate sampled in each of the recent round trips, packets per second
+   double m_dBtlBw;			// estimated bottleneck bandwidth (max of m_pdRoundBw), packets per second
+   int m_iRound;			// number of round trips since init, at most one per rate sample
+   int32_t m_iRoundEndSeq;		// the current round trip ends when this seq no is acknowledged
+   bool m_bRoundStart;			// if the last ACK started a new round trip
+   bool m_bAppLimited;			// if the last rate sample was limited by the application, not the path
+   bool m_bIdleRestart;			// if all data was acknowledged, so that the next ACK starts a new sample
+   bool m_bRecovery;			// if lost packets are being repaired
+   int32_t m_iRecoverySeq;		// max seq no sent out when the loss was detected
+
+   int32_t m_iLastAck;			// last ACKed seq no
+   int32_t m_iSampleAck;		// ACKed seq no at the start of the current delivery rate sample
+   int32_t m_iSampleSndSeq;		// max seq no sent out at the start of the current sample
+   uint64_t m_SampleTime;		// start time of the current sample
+   int32_t m_iPrevSampleSndSeq;		// max seq no sent out at the start of the previous sample
+   uint64_t m_PrevSampleTime;		// start time of the previous sample
+
+   int m_iMinRTT;			// estimated propagation RTT, microseconds
+   uint64_t m_MinRTTStamp;		// when m_iMinRTT was last lowered or confirmed
+
+   double m_dFullBw;			// bandwidth when the pipe was last seen growing
+   int m_iFullBwCount;			// round trips without 25% bandwidth growth
+   bool m_bFilledPipe;			// if STARTUP has found the bottleneck bandwidth
+   int32_t m_iStartupSeq;		// max seq no sent out when STARTUP began
+   int m_iStartupLost;			// packets reported lost since STARTUP began
+
+   int m_iCycleIndex;			// current phase of the PROBE_BW gain cycle
+   uint64_t m_CycleStamp;		// when the current phase started
+
+   uint64_t m_ProbeRTTDoneStamp;	// when PROBE_RTT may end, 0 if the window has not drained yet
+};
+
 #endif
@@ -46,6 +46,10 @@ written by
    #include <cstring>
    #include <cstdio>
    #include <cerrno>
+   #include <poll.h>
+   #ifdef LINUX
+      #include <netinet/udp.h>
+   #endif
 #else
    #include <winsock2.h>
    #include <ws2tcpip.h>
@@ -66,27 +70,62 @@ written by
    #define NET_ERROR WSAGetLastError()
 #endif
 
+#ifdef LINUX
+   // older C library headers may not define the offload options (Linux 4.18 and 5.0)
+   #ifndef UDP_SEGMENT
+      #define UDP_SEGMENT 103
+   #endif
+   #ifndef UDP_GRO
+      #define UDP_GRO 104
+   #endif
+#endif
+
 
 CChannel::CChannel():
 m_iIPversion(AF_INET),
 m_iSockAddrSize(sizeof(sockaddr_in)),
 m_iSocket(),
+m_piWakePipe(),
 m_iSndBufSize(65536),
-m_iRcvBufSize(65536)
+m_iRcvBufSize(65536),
+m_bGSO(true),
+m_bGRO(false),
+m_pGROEntry(NULL),
+m_pcGROBuffer(NULL),
+m_iGROHead(0),
+m_iGROCount(0)
 {
 }
 
 CChannel::CChannel(const int& version):
 m_iIPversion(version),
 m_iSocket(),
+m_piWakePipe(),
 m_iSndBufSize(65536),
-m_iRcvBufSize(65536)
+m_iRcvBufSize(65536),
+m_bGSO(true),
+m_bGRO(false),
+m_pGROEntry(NULL),
+m_pcGROBuffer(NULL),
+m_iGROHead(0),
+m_iGROCount(0)
 {
    m_iSockAddrSize = (AF_INET == m_iIPversion) ? sizeof(sockaddr_in) : sizeof(sockaddr_in6);
 }
 
 CChannel::~CChannel()
 {
+   // the receiving worker may still wait on the pipe after close(), so it is released here
+   #ifndef WIN32
+      if (m_piWakePipe[0] > 0)
+      {
+         ::close(m_piWakePipe[0]);
+         ::close(m_piWakePipe[1]);
+      }
+   #endif
+
+   delete [] m_pGROEntry;
+   delete [] m_pcGROBuffer;
 }
 
 void CChannel::open(const sockaddr* addr)
@@ -164,6 +203,12 @@ void CChannel::setUDPSockOpt()
       tv.tv_usec = 100;
    #endif
 
+   #ifdef LINUX
+      // let recvBatch() report the time each packet arrived, optional
+      int on = 1;
+      setsockopt(m_iSocket, SOL_SOCKET, SO_TIMESTAMP, (char *)&on, sizeof(int));
+   #endif
+
    #ifdef UNIX
       // Set non-blocking I/O
       // UNIX does not support SO_RCVTIMEO
@@ -179,6 +224,71 @@ void CChannel::setUDPSockOpt()
       if (0 != setsockopt(m_iSocket, SOL_SOCKET, SO_RCVTIMEO, (char *)&tv, sizeof(timeval)))
          throw CUDTException(1, 3, NET_ERROR);
    #endif
+
+   setOffloadOpt();
+   openWakePipe();
+}
+
+void CChannel::openWakePipe()
+{
+   #ifndef WIN32
+      if (m_piWakePipe[0] > 0)
+         return;
+
+      if (0 != pipe(m_piWakePipe))
+         throw CUDTException(1, 3, NET_ERROR);
+
+      for (int i = 0; i < 2; ++ i)
+      {
+         int opts = fcntl(m_piWakePipe[i], F_GETFL);
+         fcntl(m_piWakePipe[i], F_SETFL, opts | O_NONBLOCK);
+      }
+   #endif
+}
+
+void CChannel::setOffloadOpt()
+{
+   #ifdef LINUX
+      // segmentation offload is set per datagram; kernels that support it also allow reading the socket option
+      if (m_bGSO)
+      {
+         int segsize = 0;
+         socklen_t size = sizeof(int);
+         m_bGSO = (0 == getsockopt(m_iSocket, IPPROTO_UDP, UDP_SEGMENT, (char *)&segsize, &size));
+      }
+
+      if (m_bGRO)
+      {
+         int on = 1;
+         m_bGRO = (0 == setsockopt(m_iSocket, IPPROTO_UDP, UDP_GRO, (char *)&on, sizeof(int)));
+      }
+
+      if (m_bGRO && (NULL == m_pcGROBuffer))
+      {
+         try
+         {
+            m_pGROEntry = new CGROEntry[m_iGROEntries];
+            m_pcGROBuffer = new char[m_iGROEntries * m_iGROBufSize];
+         }
+         catch (...)
+         {
+            delete [] m_pGROEntry;
+            m_pGROEntry = NULL;
+
+            // without the buffer coalesced datagrams would be truncated, so turn receive offload off again
+            int off = 0;
+            setsockopt(m_iSocket, IPPROTO_UDP, UDP_GRO, (char *)&off, sizeof(int));
+            m_bGRO = false;
+            return;
+         }
+
+         for (int i = 0; i < m_iGROEntries; ++ i)
+            m_pGROEntry[i].m_pcData = m_pcGROBuffer + i * m_iGROBufSize;
+      }
+   #else
+      m_bGSO = false;
+      m_bGRO = false;
+   #endif
 }
 
 void CChannel::close() const
@@ -218,6 +328,26 @@ void CChannel::setRcvBufSize(const int& size)
    m_iRcvBufSize = size;
 }
 
+void CChannel::setGSO(const bool& gso)
+{
+   m_bGSO = gso;
+}
+
+void CChannel::setGRO(const bool& gro)
+{
+   m_bGRO = gro;
+}
+
+bool CChannel::getGSO() const
+{
+   return m_bGSO;
+}
+
+bool CChannel::getGRO() const
+{
+   return m_bGRO;
+}
+
 void CChannel::getSockAddr(sockaddr* addr) const
 {
    socklen_t namelen = m_iSockAddrSize;
@@ -232,7 +362,13 @@ void CChannel::getPeerAddr(sockaddr* addr) const
    getpeername(m_iSocket, addr, &namelen);
 }
 
-int CChannel::sendto(const sockaddr* addr, CPacket& packet) const
+const int CChannel::m_iMaxBatchSize;
+const int CChannel::m_iGROEntries;
+const int CChannel::m_iGROBufSize;
+const int CChannel::m_iMaxGSOSegments;
+const int CChannel::m_iMaxGSOSize;
+
+void CChannel::toNetworkOrder(CPacket& packet)
 {
    // convert control information into network order
    if (packet.getFlag())
@@ -248,6 +384,30 @@ int CChannel::sendto(const sockaddr* addr, CPacket& packet) const
       *p = htonl(*p);
       ++ p;
    }
+}
+
+void CChannel::toHostOrder(CPacket& packet)
+{
+   // convert back into local host order
+   //for (int k = 0; k < 4; ++ k)
+   //   packet.m_nHeader[k] = ntohl(packet.m_nHeader[k]);
+   uint32_t* p = packet.m_nHeader;
+   for (int k = 0; k < 4; ++ k)
+   {
+      *p = ntohl(*p);
+       ++ p;
+   }
+
+   if (packet.getFlag())
+   {
+      for (int l = 0, n = packet.getLength() / 4; l < n; ++ l)
+         *((uint32_t *)packet.m_pcData + l) = ntohl(*((uint32_t *)packet.m_pcData + l));
+   }
+}
+
+int CChannel::sendto(const sockaddr* addr, CPacket& packet) const
+{
+   toNetworkOrder(packet);
 
    #ifndef WIN32
       msghdr mh;
@@ -267,21 +427,7 @@ int CChannel::sendto(const sockaddr* addr, CPacket& packet) const
       res = (0 == res) ? size : -1;
    #endif
 
-   // convert back into local host order
-   //for (int k = 0; k < 4; ++ k)
-   //   packet.m_nHeader[k] = ntohl(packet.m_nHeader[k]);
-   p = packet.m_nHeader;
-   for (int k = 0; k < 4; ++ k)
-   {
-      *p = ntohl(*p);
-       ++ p;
-   }
-
-   if (packet.getFlag())
-   {
-      for (int l = 0, n = packet.getLength() / 4; l < n; ++ l)
-         *((uint32_t *)packet.m_pcData + l) = ntohl(*((uint32_t *)packet.m_pcData + l));
-   }
+   toHostOrder(packet);
 
    return res;
 }
@@ -298,16 +444,6 @@ int CChannel::recvfrom(sockaddr* addr, CPacket& packet) const
       mh.msg_controllen = 0;
       mh.msg_flags = 0;
 
-      #ifdef UNIX
-         fd_set set;
-         timeval tv;
-         FD_ZERO(&set);
-         FD_SET(m_iSocket, &set);
-         tv.tv_sec = 0;
-         tv.tv_usec = 10000;
-         select(m_iSocket+1, &set, NULL, &set, &tv);
-      #endif
-
       int res = recvmsg(m_iSocket, &mh, 0);
    #else
       DWORD size = CPacket::m_iPktHdrSize + packet.getLength();
@@ -326,21 +462,374 @@ int CChannel::recvfrom(sockaddr* addr, CPacket& packet) const
 
    packet.setLength(res - CPacket::m_iPktHdrSize);
 
-   // convert back into local host order
-   //for (int i = 0; i < 4; ++ i)
-   //   packet.m_nHeader[i] = ntohl(packet.m_nHeader[i]);
-   uint32_t* p = packet.m_nHeader;
-   for (int i = 0; i < 4; ++ i)
-   {
-      *p = ntohl(*p);
-      ++ p;
-   }
-
-   if (packet.getFlag())
-   {
-      for (int j = 0, n = packet.getLength() / 4; j < n; ++ j)
-         *((uint32_t *)packet.m_pcData + j) = ntohl(*((uint32_t *)packet.m_pcData + j));
-   }
+   toHostOrder(packet);
 
    return packet.getLength();
 }
+
+bool CChannel::dropSegment()
+{
+   #ifdef LINUX
+      if (!m_bGRO || (m_iGROHead == m_iGROCount))
+         return false;
+
+      CGROEntry& e = m_pGROEntry[m_iGROHead];
+      e.m_iOffset += e.m_iSegSize;
+      if (e.m_iOffset >= e.m_iLength)
+         ++ m_iGROHead;
+
+      return true;
+   #else
+      return false;
+   #endif
+}
+
+bool CChannel::waitRecv(const int64_t& timeout, const bool& pending)
+{
+   #ifndef WIN32
+      // segments of a coalesced datagram are still waiting to be returned
+      if (pending && m_bGRO && (m_iGROHead < m_iGROCount))
+         return true;
+
+      pollfd pfd[2];
+      pfd[0].fd = m_iSocket;
+      pfd[0].events = POLLIN;
+      pfd[0].revents = 0;
+      pfd[1].fd = m_piWakePipe[0];
+      pfd[1].events = POLLIN;
+      pfd[1].revents = 0;
+
+      #ifdef LINUX
+         timespec ts;
+         ts.tv_sec = timeout / 1000000;
+         ts.tv_nsec = (timeout % 1000000) * 1000;
+         int res = ppoll(pfd, 2, (timeout < 0) ? NULL : &ts, NULL);
+      #else
+         int res = poll(pfd, 2, (timeout < 0) ? -1 : (int)((timeout + 999) / 1000));
+      #endif
+
+      if (res <= 0)
+         return false;
+
+      if (0 != pfd[1].revents)
+      {
+         char buf[64];
+         while (read(m_piWakePipe[0], buf, sizeof(buf)) > 0) {}
+      }
+
+      return (0 != pfd[0].revents);
+   #else
+      // on Windows the socket has a 1 ms receiving timeout (SO_RCVTIMEO)
+      return true;
+   #endif
+}
+
+void CChannel::interrupt() const
+{
+   #ifndef WIN32
+      if (m_piWakePipe[1] > 0)
+      {
+         char c = 0;
+         if (write(m_piWakePipe[1], &c, 1) < 0)
+         {
+            // the pipe is full, so the waiting thread will wake up anyway
+         }
+      }
+   #endif
+}
+
+int CChannel::sendBatch(sockaddr* const* addr, CPacket* const* packet, const int& count)
+{
+   #ifdef LINUX
+      mmsghdr mh[m_iMaxBatchSize];
+      iovec iov[m_iMaxBatchSize * 2];
+      char ctrl[m_iMaxBatchSize][CMSG_SPACE(sizeof(uint16_t))];
+      int first[m_iMaxBatchSize + 1];   // index of the first packet in each message
+
+      for (int i = 0; i < count; ++ i)
+      {
+         toNetworkOrder(*packet[i]);
+
+         iov[i * 2] = packet[i]->m_PacketVector[0];
+         iov[i * 2 + 1] = packet[i]->m_PacketVector[1];
+      }
+
+      int msgs = 0;
+      for (int i = 0; i < count; )
+      {
+         int size = CPacket::m_iPktHdrSize + packet[i]->getLength();
+         int j = i + 1;
+
+         // with segmentation offload, a run of packets to the same address goes out as one datagram
+         // that the kernel (or NIC) splits every "size" bytes; only the last packet may be shorter
+         if (m_bGSO)
+         {
+            while ((j < count) && (j - i < m_iMaxGSOSegments) && ((j - i + 1) * size <= m_iMaxGSOSize)
+               && (CPacket::m_iPktHdrSize + packet[j - 1]->getLength() == size)
+               && (CPacket::m_iPktHdrSize + packet[j]->getLength() <= size)
+               && CIPAddress::ipcmp(addr[i], addr[j], m_iIPversion))
+               ++ j;
+         }
+
+         mh[msgs].msg_hdr.msg_name = addr[i];
+         mh[msgs].msg_hdr.msg_namelen = m_iSockAddrSize;
+         mh[msgs].msg_hdr.msg_iov = iov + i * 2;
+         mh[msgs].msg_hdr.msg_iovlen = (j - i) * 2;
+         mh[msgs].msg_hdr.msg_control = NULL;
+         mh[msgs].msg_hdr.msg_controllen = 0;
+         mh[msgs].msg_hdr.msg_flags = 0;
+         mh[msgs].msg_len = 0;
+
+         if (j - i > 1)
+         {
+            mh[msgs].msg_hdr.msg_control = ctrl[msgs];
+            mh[msgs].msg_hdr.msg_controllen = sizeof(ctrl[msgs]);
+
+            cmsghdr* cm = CMSG_FIRSTHDR(&mh[msgs].msg_hdr);
+            cm->cmsg_level = IPPROTO_UDP;
+            cm->cmsg_type = UDP_SEGMENT;
+            cm->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+            uint16_t segsize = size;
+            memcpy(CMSG_DATA(cm), &segsize, sizeof(uint16_t));
+         }
+
+         first[msgs] = i;
+         ++ msgs;
+         i = j;
+      }
+      first[msgs] = count;
+
+      // sendmmsg may stop early (e.g., the socket buffer is full), continue from where it stopped
+      int sent = 0;
+      bool fallback = false;
+      while (sent < msgs)
+      {
+         int res = ::sendmmsg(m_iSocket, mh + sent, msgs - sent, 0);
+         if (res > 0)
+         {
+            sent += res;
+            continue;
+         }
+
+         // the outgoing device may not support segmentation (EIO), or the segment size is not acceptable (EINVAL)
+         if ((mh[sent].msg_hdr.msg_controllen > 0) && ((EIO == errno) || (EINVAL == errno)))
+         {
+            m_bGSO = false;
+            fallback = true;
+         }
+         break;
+      }
+
+      for (int i = 0; i < count; ++ i)
+         toHostOrder(*packet[i]);
+
+      int pkts = first[sent];
+
+      // send the rest again, one datagram per packet
+      if (fallback)
+      {
+         int res = sendBatch(addr + pkts, packet + pkts, count - pkts);
+         if (res > 0)
+            pkts += res;
+      }
+
+      return (pkts > 0) ? pkts : -1;
+   #else
+      int sent = 0;
+      for (int i = 0; i < count; ++ i)
+      {
+         if (sendto(addr[i], *packet[i]) < 0)
+            break;
+         ++ sent;
+      }
+
+      return (sent > 0) ? sent : -1;
+   #endif
+}
+
+#ifdef LINUX
+// the kernel stamps packets with the wall clock, CTimer::getTime() may be on a different clock;
+// the difference is read once per system call and added to every stamp of that call
+static int64_t getStampOffset()
+{
+   timeval now;
+   gettimeofday(&now, 0);
+   return int64_t(CTimer::getTime()) - int64_t(now.tv_sec * 1000000ULL + now.tv_usec);
+}
+
+static uint64_t getArrivalTime(const cmsghdr* cm, const int64_t& offset)
+{
+   timeval tv;
+   memcpy(&tv, CMSG_DATA(cm), sizeof(timeval));
+   return tv.tv_sec * 1000000ULL + tv.tv_usec + offset;
+}
+#endif
+
+int CChannel::recvBatch(sockaddr* const* addr, CPacket* const* packet, uint64_t* arrtime, const int& count)
+{
+   #ifdef LINUX
+      if (m_bGRO)
+         return recvGROBatch(addr, packet, arrtime, count);
+
+      mmsghdr mh[m_iMaxBatchSize];
+      char ctrl[m_iMaxBatchSize][CMSG_SPACE(sizeof(timeval))];
+
+      for (int i = 0; i < count; ++ i)
+      {
+         mh[i].msg_hdr.msg_name = addr[i];
+         mh[i].msg_hdr.msg_namelen = m_iSockAddrSize;
+         mh[i].msg_hdr.msg_iov = packet[i]->m_PacketVector;
+         mh[i].msg_hdr.msg_iovlen = 2;
+         mh[i].msg_hdr.msg_control = ctrl[i];
+         mh[i].msg_hdr.msg_controllen = sizeof(ctrl[i]);
+         mh[i].msg_hdr.msg_flags = 0;
+         mh[i].msg_len = 0;
+      }
+
+      // the socket is non-blocking: this returns whatever is already queued, up to count packets
+      int res = ::recvmmsg(m_iSocket, mh, count, 0, NULL);
+
+      if (res <= 0)
+      {
+         for (int i = 0; i < count; ++ i)
+            packet[i]->setLength(-1);
+         return -1;
+      }
+
+      int64_t offset = getStampOffset();
+
+      for (int i = 0; i < count; ++ i)
+      {
+         arrtime[i] = 0;
+
+         if ((i >= res) || ((int)mh[i].msg_len < CPacket::m_iPktHdrSize))
+         {
+            packet[i]->setLength(-1);
+            continue;
+         }
+
+         // SO_TIMESTAMP is enabled in setUDPSockOpt()
+         for (cmsghdr* cm = CMSG_FIRSTHDR(&mh[i].msg_hdr); NULL != cm; cm = CMSG_NXTHDR(&mh[i].msg_hdr, cm))
+         {
+            if ((SOL_SOCKET == cm->cmsg_level) && (SCM_TIMESTAMP == cm->cmsg_type))
+               arrtime[i] = getArrivalTime(cm, offset);
+         }
+
+         packet[i]->setLength(mh[i].msg_len - CPacket::m_iPktHdrSize);
+
+         toHostOrder(*packet[i]);
+      }
+
+      return res;
+   #else
+      // without a batch system call only a single packet is read, so that the receiver does not wait more than once
+      for (int i = 0; i < count; ++ i)
+         arrtime[i] = 0;
+      for (int i = 1; i < count; ++ i)
+         packet[i]->setLength(-1);
+
+      return (recvfrom(addr[0], *packet[0]) < 0) ? -1 : 1;
+   #endif
+}
+
+int CChannel::recvGROBatch(sockaddr* const* addr, CPacket* const* packet, uint64_t* arrtime, const int& count)
+{
+   #ifdef LINUX
+      // read new datagrams only when every segment of the previous ones has been returned
+      if (m_iGROHead == m_iGROCount)
+      {
+         mmsghdr mh[m_iGROEntries];
+         iovec iov[m_iGROEntries];
+         char ctrl[m_iGROEntries][CMSG_SPACE(sizeof(int)) + CMSG_SPACE(sizeof(timeval))];
+
+         for (int i = 0; i < m_iGROEntries; ++ i)
+         {
+            iov[i].iov_base = m_pGROEntry[i].m_pcData;
+            iov[i].iov_len = m_iGROBufSize;
+
+            mh[i].msg_hdr.msg_name = &m_pGROEntry[i].m_Addr;
+            mh[i].msg_hdr.msg_namelen = m_iSockAddrSize;
+            mh[i].msg_hdr.msg_iov = iov + i;
+            mh[i].msg_hdr.msg_iovlen = 1;
+            mh[i].msg_hdr.msg_control = ctrl[i];
+            mh[i].msg_hdr.msg_controllen = sizeof(ctrl[i]);
+            mh[i].msg_hdr.msg_flags = 0;
+            mh[i].msg_len = 0;
+         }
+
+         int res = ::recvmmsg(m_iSocket, mh, m_iGROEntries, 0, NULL);
+
+         if (res <= 0)
+         {
+            for (int i = 0; i < count; ++ i)
+               packet[i]->setLength(-1);
+            return -1;
+         }
+
+         int64_t offset = getStampOffset();
+
+         for (int i = 0; i < res; ++ i)
+         {
+            CGROEntry& e = m_pGROEntry[i];
+            e.m_iLength = mh[i].msg_len;
+            e.m_iSegSize = mh[i].msg_len;
+            e.m_iOffset = 0;
+            e.m_llArrTime = 0;
+
+            for (cmsghdr* cm = CMSG_FIRSTHDR(&mh[i].msg_hdr); NULL != cm; cm = CMSG_NXTHDR(&mh[i].msg_hdr, cm))
+            {
+               if ((IPPROTO_UDP == cm->cmsg_level) && (UDP_GRO == cm->cmsg_type))
+               {
+                  int segsize;
+                  memcpy(&segsize, CMSG_DATA(cm), sizeof(int));
+                  if (segsize > 0)
+                     e.m_iSegSize = segsize;
+               }
+               else if ((SOL_SOCKET == cm->cmsg_level) && (SCM_TIMESTAMP == cm->cmsg_type))
+                  e.m_llArrTime = getArrivalTime(cm, offset);
+            }
+         }
+
+         m_iGROHead = 0;
+         m_iGROCount = res;
+      }
+
+      // split the coalesced datagrams, one segment (UDT packet) per unit
+      int n = 0;
+      while ((n < count) && (m_iGROHead < m_iGROCount))
+      {
+         CGROEntry& e = m_pGROEntry[m_iGROHead];
+
+         char* seg = e.m_pcData + e.m_iOffset;
+         int len = e.m_iLength - e.m_iOffset;
+         if (len > e.m_iSegSize)
+            len = e.m_iSegSize;
+
+         e.m_iOffset += len;
+         if ((e.m_iOffset >= e.m_iLength) || (len <= 0))
+            ++ m_iGROHead;
+
+         // skip segments that are too short or do not fit in the unit
+         if ((len < CPacket::m_iPktHdrSize) || (len - CPacket::m_iPktHdrSize > packet[n]->getLength()))
+            continue;
+
+         memcpy(packet[n]->m_nHeader, seg, CPacket::m_iPktHdrSize);
+         memcpy(packet[n]->m_pcData, seg + CPacket::m_iPktHdrSize, len - CPacket::m_iPktHdrSize);
+         packet[n]->setLength(len - CPacket::m_iPktHdrSize);
+
+         toHostOrder(*packet[n]);
+
+         memcpy(addr[n], &e.m_Addr, m_iSockAddrSize);
+         arrtime[n] = e.m_llArrTime;
+
+         ++ n;
+      }
+
+      for (int i = n; i < count; ++ i)
+         packet[i]->setLength(-1);
+
+      return (n > 0) ? n : -1;
+   #else
+      return recvBatch(addr, packet, arrtime, count);
+   #endif
+}
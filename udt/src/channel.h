@@ -44,6 +44,7 @@ written by
 
 #include "udt.h"
 #include "packet.h"
+#include "common.h"
 
 
 class CChannel
@@ -116,6 +117,44 @@ public:
 
    void setRcvBufSize(const int& size);
 
+      // Functionality:
+      //    Request UDP generic segmentation offload (UDP_SEGMENT) for batched sending.
+      //    It is only enabled if the kernel supports it, see getGSO().
+      // Parameters:
+      //    0) [in] gso: if segmentation offload should be used.
+      // Returned value:
+      //    None.
+
+   void setGSO(const bool& gso);
+
+      // Functionality:
+      //    Request UDP generic receive offload (UDP_GRO) for batched receiving.
+      //    It is only enabled if the kernel supports it, see getGRO().
+      // Parameters:
+      //    0) [in] gro: if receive offload should be used.
+      // Returned value:
+      //    None.
+
+   void setGRO(const bool& gro);
+
+      // Functionality:
+      //    Query if segmentation offload is in use.
+      // Parameters:
+      //    None.
+      // Returned value:
+      //    true if sendBatch() sends runs of equal sized packets as one datagram.
+
+   bool getGSO() const;
+
+      // Functionality:
+      //    Query if receive offload is in use.
+      // Parameters:
+      //    None.
+      // Returned value:
+      //    true if recvBatch() splits coalesced datagrams.
+
+   bool getGRO() const;
+
       // Functionality:
       //    Query the socket address that the channel is using.
       // Parameters:
@@ -154,17 +193,101 @@ public:
 
    int recvfrom(sockaddr* addr, CPacket& packet) const;
 
+      // Functionality:
+      //    Send a batch of packets, each to its own address, with as few system calls as possible.
+      // Parameters:
+      //    0) [in] addr: array of pointers to the destination addresses.
+      //    1) [in] packet: array of pointers to CPacket entities.
+      //    2) [in] count: number of packets in the batch, at most m_iMaxBatchSize.
+      // Returned value:
+      //    Number of packets sent, -1 if the first packet could not be sent.
+
+   int sendBatch(sockaddr* const* addr, CPacket* const* packet, const int& count);
+
+      // Functionality:
+      //    Receive up to "count" packets that are already queued on the channel.
+      // Parameters:
+      //    0) [in] addr: array of pointers to the source addresses.
+      //    1) [in] packet: array of pointers to CPacket entities, with their lengths set to the buffer sizes.
+      //    2) [out] arrtime: time each packet was received by the kernel, 0 if not available.
+      //    3) [in] count: maximum number of packets to receive, at most m_iMaxBatchSize.
+      // Returned value:
+      //    Number of packets received, -1 if nothing has been received.
+
+   int recvBatch(sockaddr* const* addr, CPacket* const* packet, uint64_t* arrtime, const int& count);
+
+      // Functionality:
+      //    Drop the next segment of a coalesced datagram without reading the socket.
+      // Parameters:
+      //    None.
+      // Returned value:
+      //    true if a segment was dropped, false if none is pending.
+
+   bool dropSegment();
+
+      // Functionality:
+      //    Wait until a packet can be read, the timeout expires, or interrupt() is called.
+      // Parameters:
+      //    0) [in] timeout: maximum waiting time in microseconds, -1 to wait without a limit.
+      //    1) [in] pending: if pending segments of coalesced datagrams end the wait; false while nothing can store them.
+      // Returned value:
+      //    true if a packet can be read, false otherwise.
+
+   bool waitRecv(const int64_t& timeout, const bool& pending = true);
+
+      // Functionality:
+      //    Wake up a thread blocked in waitRecv().
+      // Parameters:
+      //    None.
+      // Returned value:
+      //    None.
+
+   void interrupt() const;
+
+public:
+   static const int m_iMaxBatchSize = 32;       // maximum number of packets handled by one sendBatch/recvBatch call
+
 private:
    void setUDPSockOpt();
+   void setOffloadOpt();
+   void openWakePipe();
+
+   int recvGROBatch(sockaddr* const* addr, CPacket* const* packet, uint64_t* arrtime, const int& count);
+
+   static void toNetworkOrder(CPacket& packet);
+   static void toHostOrder(CPacket& packet);
 
 private:
    int m_iIPversion;                    // IP version
    int m_iSockAddrSize;                 // socket address structure size (pre-defined to avoid run-time test)
 
    UDPSOCKET m_iSocket;                 // socket descriptor
+   int m_piWakePipe[2];                 // self-pipe used by interrupt() to end waitRecv()
 
    int m_iSndBufSize;                   // UDP sending buffer size
    int m_iRcvBufSize;                   // UDP receiving buffer size
+
+   bool m_bGSO;                         // if UDP segmentation offload is requested/in use
+   bool m_bGRO;                         // if UDP receive offload is requested/in use
+
+   struct CGROEntry
+   {
+      char* m_pcData;                   // coalesced datagram
+      int m_iLength;                    // total length of the datagram
+      int m_iSegSize;                   // length of each segment, the last one may be shorter
+      int m_iOffset;                    // next segment to be returned
+      uint64_t m_llArrTime;             // kernel arrival time, on the CTimer::getTime() clock
+      sockaddr_in6 m_Addr;              // source address (large enough for both IP versions)
+   };
+   CGROEntry* m_pGROEntry;              // coalesced datagrams received but not yet returned by recvBatch()
+   char* m_pcGROBuffer;                 // storage for the coalesced datagrams
+   int m_iGROHead;                      // first entry with segments left
+   int m_iGROCount;                     // number of valid entries
+
+   static const int m_iGROEntries = 8;          // number of coalesced datagrams read per system call
+   static const int m_iGROBufSize = 65536;      // maximum size of a coalesced datagram
+   static const int m_iMaxGSOSegments = 64;     // maximum number of segments per GSO datagram (UDP_MAX_SEGMENTS)
+   static const int m_iMaxGSOSize = 65507;      // maximum size of a GSO datagram (largest UDP payload)
 };
 
 
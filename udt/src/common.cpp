@@ -46,6 +46,16 @@ written by
    #ifdef OSX
       #include <mach/mach_time.h>
    #endif
+   #ifdef LINUX
+      #include <time.h>
+      #include <fcntl.h>
+      #include <sched.h>
+      #include <cstdio>
+      #if defined(IA32) || defined(AMD64)
+         #include <cpuid.h>
+      #endif
+      #include <sys/timerfd.h>
+   #endif
 #else
    #include <winsock2.h>
    #include <ws2tcpip.h>
@@ -58,7 +68,12 @@ written by
 #include "md5.h"
 #include "common.h"
 
+// the order matters: readCPUFrequency() needs to know which clock rdtsc() reads
+bool CTimer::s_bUseTSC = CTimer::checkTSC();
 uint64_t CTimer::s_ullCPUFrequency = CTimer::readCPUFrequency();
+#ifdef UDT_SIM
+uint64_t (*CTimer::s_pClock)() = NULL;
+#endif
 #ifndef WIN32
    pthread_mutex_t CTimer::m_EventLock = PTHREAD_MUTEX_INITIALIZER;
    pthread_cond_t CTimer::m_EventCond = PTHREAD_COND_INITIALIZER;
@@ -75,6 +90,13 @@ m_TickLock()
    #ifndef WIN32
       pthread_mutex_init(&m_TickLock, NULL);
       pthread_cond_init(&m_TickCond, NULL);
+      #ifdef LINUX
+         m_iTimerFD = timerfd_create(CLOCK_MONOTONIC, 0);
+         if (m_iTimerFD >= 0)
+            fcntl(m_iTimerFD, F_SETFD, FD_CLOEXEC);
+         m_ullSpinTime = s_ullCPUFrequency * 50;
+         m_bSleeping = false;
+      #endif
    #else
       m_TickLock = CreateMutex(NULL, false, NULL);
       m_TickCond = CreateEvent(NULL, false, false, NULL);
@@ -86,6 +108,10 @@ CTimer::~CTimer()
    #ifndef WIN32
       pthread_mutex_destroy(&m_TickLock);
       pthread_cond_destroy(&m_TickCond);
+      #ifdef LINUX
+         if (m_iTimerFD >= 0)
+            close(m_iTimerFD);
+      #endif
    #else
       CloseHandle(m_TickLock);
       CloseHandle(m_TickCond);
@@ -103,26 +129,27 @@ void CTimer::rdtsc(uint64_t &x)
          x = getTime() * s_ullCPUFrequency;
    #elif OSX
       x = mach_absolute_time();
-   #elif IA32
+   #elif IA32 || AMD64
+      #ifdef LINUX
+         // the TSC is not trusted, count nanoseconds of the monotonic clock instead
+         if (!s_bUseTSC)
+         {
+            timespec t;
+            clock_gettime(CLOCK_MONOTONIC, &t);
+            x = (uint64_t)t.tv_sec * (uint64_t)1000000000 + (uint64_t)t.tv_nsec;
+            return;
+         }
+      #endif
+
       uint32_t lval, hval;
-      //asm volatile ("push %eax; push %ebx; push %ecx; push %edx");
-      //asm volatile ("xor %eax, %eax; cpuid");
       asm volatile ("rdtsc" : "=a" (lval), "=d" (hval));
-      //asm volatile ("pop %edx; pop %ecx; pop %ebx; pop %eax");
       x = hval;
       x = (x << 32) | lval;
    #elif IA64
       asm ("mov %0=ar.itc" : "=r"(x) :: "memory");
-   #elif AMD64
-      uint32_t lval, hval;
-      asm ("rdtsc" : "=a" (lval), "=d" (hval));
-      x = hval;
-      x = (x << 32) | lval;
    #else
       // use system call to read time clock for other archs
-      timeval t;
-      gettimeofday(&t, 0);
-      x = (uint64_t)t.tv_sec * (uint64_t)1000000 + (uint64_t)t.tv_usec;
+      x = getTime();
    #endif
 }
 
@@ -135,22 +162,54 @@ uint64_t CTimer::readCPUFrequency()
       else
          return 1;
    #elif IA32 || IA64 || AMD64
-      uint64_t t1, t2;
+      #ifdef LINUX
+         if (!s_bUseTSC)
+            return 1000;
+      #endif
 
+      uint64_t t1, t2, s1, s2;
+
+      // measure the sleep rather than trusting its length
+      s1 = getTime();
       rdtsc(t1);
       timespec ts;
       ts.tv_sec = 0;
       ts.tv_nsec = 100000000;
       nanosleep(&ts, NULL);
       rdtsc(t2);
+      s2 = getTime();
 
       // CPU clocks per microsecond
-      return (t2 - t1) / 100000;
+      return (s2 > s1) ? (t2 - t1) / (s2 - s1) : (t2 - t1) / 100000;
    #else
       return 1;
    #endif
 }
 
+bool CTimer::checkTSC()
+{
+   #if defined(LINUX) && (defined(IA32) || defined(AMD64))
+      // the TSC must tick at a constant rate in every power state ("invariant TSC")
+      unsigned int eax, ebx, ecx, edx;
+      if ((0 == __get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx)) || (eax < 0x80000007))
+         return false;
+      __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx);
+      if (0 == (edx & (1 << 8)))
+         return false;
+
+      // and the kernel must not have found it unstable, which it often does on virtual machines
+      FILE* f = fopen("/sys/devices/system/clocksource/clocksource0/current_clocksource", "r");
+      if (NULL == f)
+         return true;
+      char source[32] = "";
+      bool tsc = (NULL != fgets(source, sizeof(source), f)) && (0 == strncmp(source, "tsc", 3));
+      fclose(f);
+      return tsc;
+   #else
+      return true;
+   #endif
+}
+
 uint64_t CTimer::getCPUFrequency()
 {
    return s_ullCPUFrequency;
@@ -176,13 +235,15 @@ void CTimer::sleepto(const uint64_t& nexttime)
    while (t < m_ullSchedTime)
    {
       #ifndef NO_BUSY_WAITING
-         #ifdef IA32
-            __asm__ volatile ("pause; rep; nop; nop; nop; nop; nop;");
-         #elif IA64
-            __asm__ volatile ("nop 0; nop 0; nop 0; nop 0; nop 0;");
-         #elif AMD64
-            __asm__ volatile ("nop; nop; nop; nop; nop;");
-         #endif
+         spin();
+      #elif defined(LINUX)
+         // sleep in the kernel until shortly before the deadline, then spin the rest to absorb the wake-up latency;
+         // the spin yields so that a loaded CPU still runs the other threads
+         uint64_t schedtime = m_ullSchedTime;
+         if ((schedtime > t) && (schedtime - t > m_ullSpinTime + s_ullCPUFrequency))
+            sleepCoarse(schedtime, t);
+         else
+            sched_yield();
       #else
          #ifndef WIN32
             timeval now;
@@ -215,9 +276,90 @@ void CTimer::interrupt()
    // schedule the sleepto time to the current CCs, so that it will stop
    rdtsc(m_ullSchedTime);
 
+   #if defined(LINUX) && defined(NO_BUSY_WAITING)
+      // fire the timer immediately to end a coarse sleep; this is called for almost every packet, so skip the
+      // system call when sleepto() is not blocked on the timer
+      __sync_synchronize();
+      if ((m_iTimerFD >= 0) && m_bSleeping)
+      {
+         itimerspec its;
+         memset(&its, 0, sizeof(itimerspec));
+         its.it_value.tv_nsec = 1;
+         timerfd_settime(m_iTimerFD, 0, &its, NULL);
+      }
+   #endif
+
    tick();
 }
 
+void CTimer::spin()
+{
+   #ifdef IA32
+      __asm__ volatile ("pause; rep; nop; nop; nop; nop; nop;");
+   #elif IA64
+      __asm__ volatile ("nop 0; nop 0; nop 0; nop 0; nop 0;");
+   #elif AMD64
+      __asm__ volatile ("nop; nop; nop; nop; nop;");
+   #endif
+}
+
+#ifdef LINUX
+void CTimer::sleepCoarse(const uint64_t& schedtime, const uint64_t& now)
+{
+   // wake up m_ullSpinTime CCs before the deadline
+   uint64_t target = schedtime - m_ullSpinTime;
+   uint64_t interval = (target - now) / s_ullCPUFrequency;
+   bool timed = true;
+
+   if (m_iTimerFD >= 0)
+   {
+      itimerspec its;
+      memset(&its, 0, sizeof(itimerspec));
+      its.it_value.tv_sec = interval / 1000000;
+      its.it_value.tv_nsec = (interval % 1000000) * 1000;
+      m_bSleeping = true;
+      timerfd_settime(m_iTimerFD, 0, &its, NULL);
+
+      // interrupt() may have moved the deadline before it could see m_bSleeping
+      uint64_t expirations;
+      if ((m_ullSchedTime != schedtime) || (read(m_iTimerFD, &expirations, sizeof(uint64_t)) < 0))
+      {
+         m_bSleeping = false;
+         return;
+      }
+
+      m_bSleeping = false;
+   }
+   else
+   {
+      // without timerfd the sleep cannot be interrupted, so keep each step short
+      if (interval > 1000)
+      {
+         interval = 1000;
+         timed = false;
+      }
+
+      timespec ts;
+      ts.tv_sec = 0;
+      ts.tv_nsec = interval * 1000;
+      clock_nanosleep(CLOCK_MONOTONIC, 0, &ts, NULL);
+   }
+
+   if (!timed || (m_ullSchedTime != schedtime))
+      return;
+
+   // spin for about twice the average lateness, between 5us and 100us
+   uint64_t t;
+   rdtsc(t);
+   uint64_t late = (t > target) ? t - target : 0;
+   m_ullSpinTime = (m_ullSpinTime * 7 + late * 2) / 8;
+   if (m_ullSpinTime < s_ullCPUFrequency * 5)
+      m_ullSpinTime = s_ullCPUFrequency * 5;
+   else if (m_ullSpinTime > s_ullCPUFrequency * 100)
+      m_ullSpinTime = s_ullCPUFrequency * 100;
+}
+#endif
+
 void CTimer::tick()
 {
    #ifndef WIN32
@@ -229,12 +371,22 @@ void CTimer::tick()
 
 uint64_t CTimer::getTime()
 {
+   #ifdef UDT_SIM
+      if (NULL != s_pClock)
+         return s_pClock();
+   #endif
+
    //For Cygwin and other systems without microsecond level resolution, uncomment the following three lines
    //uint64_t x;
    //rdtsc(x);
    //return x / s_ullCPUFrequency;
 
-   #ifndef WIN32
+   #ifdef LINUX
+      // monotonic, so that timers do not jump when the wall clock is set; read through the vDSO
+      timespec t;
+      clock_gettime(CLOCK_MONOTONIC, &t);
+      return t.tv_sec * 1000000ULL + t.tv_nsec / 1000;
+   #elif !defined(WIN32)
       timeval t;
       gettimeofday(&t, 0);
       return t.tv_sec * 1000000ULL + t.tv_usec;
@@ -257,6 +409,13 @@ uint64_t CTimer::getTime()
    #endif
 }
 
+#ifdef UDT_SIM
+void CTimer::setClock(uint64_t (*clock)())
+{
+   s_pClock = clock;
+}
+#endif
+
 void CTimer::triggerEvent()
 {
    #ifndef WIN32
@@ -363,7 +522,13 @@ void CGuard::releaseMutex(pthread_mutex_t& lock)
 
 void CGuard::createCond(pthread_cond_t& cond)
 {
-   #ifndef WIN32
+   #ifdef LINUX
+      pthread_condattr_t attr;
+      pthread_condattr_init(&attr);
+      pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+      pthread_cond_init(&cond, &attr);
+      pthread_condattr_destroy(&attr);
+   #elif !defined(WIN32)
       pthread_cond_init(&cond, NULL);
    #else
       cond = CreateEvent(NULL, false, false, NULL);
@@ -111,7 +111,8 @@ public:
 public:
 
       // Functionality:
-      //    Read the CPU clock cycle into x.
+      //    Read the CPU clock cycle into x. On Linux, if the TSC is not invariant or the kernel does not trust it,
+      //    this reads the monotonic clock in nanoseconds instead.
       // Parameters:
       //    0) [out] x: to record cpu clock cycles.
       // Returned value:
@@ -129,7 +130,7 @@ public:
    static uint64_t getCPUFrequency();
 
       // Functionality:
-      //    check the current time, 64bit, in microseconds.
+      //    check the current time, 64bit, in microseconds. On Linux this is the monotonic clock, not the wall clock.
       // Parameters:
       //    None.
       // Returned value:
@@ -137,6 +138,18 @@ public:
 
    static uint64_t getTime();
 
+#ifdef UDT_SIM
+      // Functionality:
+      //    Replace the clock behind getTime(), so that congestion control code run by a simulator sees simulated time.
+      //    It is only built into the simulator library (libudtsim), never into libudt.
+      // Parameters:
+      //    0) [in] clock: function returning the current time in microseconds, or NULL for the system clock.
+      // Returned value:
+      //    None.
+
+   static void setClock(uint64_t (*clock)());
+#endif
+
       // Functionality:
       //    trigger an event such as new connection, close, new data, etc. for "select" call.
       // Parameters:
@@ -170,11 +183,38 @@ private:
    pthread_cond_t m_TickCond;
    pthread_mutex_t m_TickLock;
 
+   #ifdef LINUX
+      int m_iTimerFD;                   // timerfd for the coarse part of sleepto(), -1 if not available
+      uint64_t m_ullSpinTime;           // CCs spun before each deadline, adapted to the observed wake-up latency
+      volatile bool m_bSleeping;        // if sleepto() is blocked on the timerfd
+   #endif
+
    static pthread_cond_t m_EventCond;
    static pthread_mutex_t m_EventLock;
 
 private:
+   static void spin();
+
+   #ifdef LINUX
+      // Functionality:
+      //    Sleep on the timerfd (or clock_nanosleep) until m_ullSpinTime CCs before "schedtime", and adapt m_ullSpinTime.
+      // Parameters:
+      //    0) [in] schedtime: the deadline sleepto() is waiting for.
+      //    1) [in] now: current CC.
+      // Returned value:
+      //    None.
+
+   void sleepCoarse(const uint64_t& schedtime, const uint64_t& now);
+   #endif
+
+private:
+   static bool s_bUseTSC;		// if rdtsc() reads the TSC; it is only used when invariant and trusted by the kernel
+   static bool checkTSC();
+
    static uint64_t s_ullCPUFrequency;	// CPU frequency : clock cycles per microsecond
+#ifdef UDT_SIM
+   static uint64_t (*s_pClock)();	// replacement clock for getTime(), NULL for the system clock
+#endif
    static uint64_t readCPUFrequency();
 };
 
@@ -193,6 +233,7 @@ public:
    static void createMutex(pthread_mutex_t& lock);
    static void releaseMutex(pthread_mutex_t& lock);
 
+   // pthread_cond_timedwait() deadlines for this condition are on the CTimer::getTime() clock
    static void createCond(pthread_cond_t& cond);
    static void releaseCond(pthread_cond_t& cond);
 
@@ -56,6 +56,7 @@ written by
 #include <sstream>
 #include "queue.h"
 #include "core.h"
+#include "pool.h"
 
 using namespace std;
 
@@ -90,6 +91,7 @@ CUDT::CUDT()
    m_pRcvTimeWindow = NULL;
 
    m_pSndQueue = NULL;
+   m_pSndUList = NULL;
    m_pRcvQueue = NULL;
    m_pPeerAddr = NULL;
    m_pSNode = NULL;
@@ -116,15 +118,22 @@ CUDT::CUDT()
    m_iRcvTimeOut = -1;
    m_bReuseAddr = true;
    m_llMaxBW = -1;
+   m_bUDPGSO = true;
+   m_bUDPGRO = false;
+   m_iRcvWorkers = 1;
+   m_iSndWorkers = 1;
+   m_iSndCPU = -1;
 
    m_pCCFactory = new CCCFactory<CUDTCC>;
    m_pCC = NULL;
    m_pCache = NULL;
+   m_pPathCache = NULL;
 
    // Initial status
    m_bOpened = false;
    m_bListening = false;
    m_bConnecting = false;
+   m_bConnFailed = false;
    m_bConnected = false;
    m_bClosing = false;
    m_bShutdown = false;
@@ -144,6 +153,7 @@ CUDT::CUDT(const CUDT& ancestor)
    m_pRcvTimeWindow = NULL;
 
    m_pSndQueue = NULL;
+   m_pSndUList = NULL;
    m_pRcvQueue = NULL;
    m_pPeerAddr = NULL;
    m_pSNode = NULL;
@@ -169,15 +179,22 @@ CUDT::CUDT(const CUDT& ancestor)
    m_iRcvTimeOut = ancestor.m_iRcvTimeOut;
    m_bReuseAddr = true;	// this must be true, because all accepted sockets shared the same port with the listener
    m_llMaxBW = ancestor.m_llMaxBW;
+   m_bUDPGSO = ancestor.m_bUDPGSO;
+   m_bUDPGRO = ancestor.m_bUDPGRO;
+   m_iRcvWorkers = ancestor.m_iRcvWorkers;
+   m_iSndWorkers = ancestor.m_iSndWorkers;
+   m_iSndCPU = ancestor.m_iSndCPU;
 
    m_pCCFactory = ancestor.m_pCCFactory->clone();
    m_pCC = NULL;
    m_pCache = ancestor.m_pCache;
+   m_pPathCache = ancestor.m_pPathCache;
 
    // Initial status
    m_bOpened = false;
    m_bListening = false;
    m_bConnecting = false;
+   m_bConnFailed = false;
    m_bConnected = false;
    m_bClosing = false;
    m_bShutdown = false;
@@ -347,6 +364,46 @@ void CUDT::setOpt(UDTOpt optName, const void* optval, const int&)
          throw CUDTException(5, 1, 0);
       m_llMaxBW = *(int64_t*)optval;
       break;
+
+   case UDT_GSO:
+      if (m_bOpened)
+         throw CUDTException(5, 1, 0);
+      m_bUDPGSO = *(bool*)optval;
+      break;
+
+   case UDT_GRO:
+      if (m_bOpened)
+         throw CUDTException(5, 1, 0);
+      m_bUDPGRO = *(bool*)optval;
+      break;
+
+   case UDT_RCVWORKERS:
+      if (m_bOpened)
+         throw CUDTException(5, 1, 0);
+      if (*(int*)optval < 1)
+         throw CUDTException(5, 3);
+      m_iRcvWorkers = *(int*)optval;
+      break;
+
+   case UDT_SNDWORKERS:
+      if (m_bOpened)
+         throw CUDTException(5, 1, 0);
+      if (*(int*)optval < 1)
+         throw CUDTException(5, 3);
+      m_iSndWorkers = *(int*)optval;
+      break;
+
+   case UDT_SNDCPU:
+      if (m_bOpened)
+         throw CUDTException(5, 1, 0);
+      m_iSndCPU = (*(int*)optval < 0) ? -1 : *(int*)optval;
+      break;
+
+   case UDT_MEMBUDGET:
+      if (*(int64_t*)optval < 0)
+         throw CUDTException(5, 3);
+      CMemPool::setBudget(*(int64_t*)optval);
+      break;
     
    default:
       throw CUDTException(5, 0, 0);
@@ -440,6 +497,50 @@ void CUDT::getOpt(UDTOpt optName, void* optval, int& optlen)
       optlen = sizeof(int64_t);
       break;
 
+   case UDT_GSO:
+      // once opened, report if the (shared) UDP channel actually uses it
+      if (m_bOpened)
+         *(bool*)optval = m_pSndQueue->m_pChannel->getGSO();
+      else
+         *(bool*)optval = m_bUDPGSO;
+      optlen = sizeof(bool);
+      break;
+
+   case UDT_GRO:
+      if (m_bOpened)
+         *(bool*)optval = m_pSndQueue->m_pChannel->getGRO();
+      else
+         *(bool*)optval = m_bUDPGRO;
+      optlen = sizeof(bool);
+      break;
+
+   case UDT_RCVWORKERS:
+      // a socket sharing an existing UDP port uses the workers of that port
+      if (m_bOpened)
+         *(int*)optval = m_pRcvQueue->m_iWorkers;
+      else
+         *(int*)optval = m_iRcvWorkers;
+      optlen = sizeof(int);
+      break;
+
+   case UDT_SNDWORKERS:
+      if (m_bOpened)
+         *(int*)optval = m_pSndQueue->m_iWorkers;
+      else
+         *(int*)optval = m_iSndWorkers;
+      optlen = sizeof(int);
+      break;
+
+   case UDT_SNDCPU:
+      *(int*)optval = m_iSndCPU;
+      optlen = sizeof(int);
+      break;
+
+   case UDT_MEMBUDGET:
+      *(int64_t*)optval = CMemPool::getBudget();
+      optlen = sizeof(int64_t);
+      break;
+
    case UDT_STATE:
       *(int32_t*)optval = s_UDTUnited.getStatus(m_SocketID);
       optlen = sizeof(int32_t);
@@ -454,7 +555,7 @@ void CUDT::getOpt(UDTOpt optName, void* optval, int& optlen)
       {
          if (m_pRcvBuffer && (m_pRcvBuffer->getRcvDataSize() > 0))
             event |= UDT_EPOLL_IN;
-         if (m_pSndBuffer && (m_iSndBufSize > m_pSndBuffer->getCurrBufSize()))
+         if (m_pSndBuffer && (getSndBufAvail() > 0))
             event |= UDT_EPOLL_OUT;
       }
       *(int32_t*)optval = event;
@@ -503,6 +604,8 @@ void CUDT::open()
    m_LastSampleTime = CTimer::getTime();
    m_llTraceSent = m_llTraceRecv = m_iTraceSndLoss = m_iTraceRcvLoss = m_iTraceRetrans = m_iSentACK = m_iRecvACK = m_iSentNAK = m_iRecvNAK = 0;
    m_llSndDuration = m_llSndDurationTotal = 0;
+   m_llIdleTraffic = -1;
+   m_ullIdleTime = 0;
 
    // structures for queue
    if (NULL == m_pSNode)
@@ -537,6 +640,7 @@ void CUDT::open()
    m_ullLastRspTime = currtime;
    m_ullNextACKTime = currtime + m_ullSYNInt;
    m_ullNextNAKTime = currtime + m_ullNAKInt;
+   m_ullNextCheckTime = currtime;
 
    m_iPktCount = 0;
    m_iLightACKCount = 1;
@@ -628,6 +732,7 @@ void CUDT::connect(const sockaddr* serv_addr)
    m_pSndQueue->sendto(serv_addr, request);
    m_llLastReqTime = CTimer::getTime();
 
+   m_bConnFailed = false;
    m_bConnecting = true;
 
    // asynchronous connect, return immediately
@@ -738,6 +843,17 @@ int CUDT::connect(const CPacket& response) throw ()
          m_llLastReqTime = 0;
          return 1;
       }
+
+      // the listener rejected the request (e.g., its backlog is full), stop connecting
+      // the blocking connect() reports the rejection, an asynchronous one is acknowledged via epoll
+      if (1002 == m_ConnRes.m_iReqType)
+      {
+         m_bConnFailed = true;
+         m_bConnecting = false;
+         m_pRcvQueue->removeConnector(m_SocketID);
+         s_UDTUnited.m_EPoll.enable_write(m_SocketID, m_sPollID);
+         return -1;
+      }
    }
 
 POST_CONNECT:
@@ -759,7 +875,7 @@ POST_CONNECT:
    // Prepare all data structures
    try
    {
-      m_pSndBuffer = new CSndBuffer(32, m_iPayloadSize);
+      m_pSndBuffer = new CSndBuffer(32, m_iPayloadSize, m_pSndQueue->getNode(m_SocketID));
       m_pRcvBuffer = new CRcvBuffer(&(m_pRcvQueue->m_UnitQueue), m_iRcvBufSize);
       // after introducing lite ACK, the sndlosslist may not be cleared in time, so it requires twice space.
       m_pSndLossList = new CSndLossList(m_iFlowWindowSize * 2);
@@ -776,10 +892,15 @@ POST_CONNECT:
    CInfoBlock ib;
    ib.m_iIPversion = m_iIPversion;
    CInfoBlock::convert(m_pPeerAddr, m_iIPversion, ib.m_piIP);
+   int cachedrate = 0;
    if (m_pCache->lookup(&ib) >= 0)
    {
       m_iRTT = ib.m_iRTT;
       m_iBandwidth = ib.m_iBandwidth;
+
+      // start from the rate the last connection to this peer sent at, only with the path cache and while it is recent
+      if ((ib.m_dInterval > 0) && m_pPathCache->isFresh(&ib))
+         m_iDeliveryRate = cachedrate = int(1000000.0 / ib.m_dInterval);
    }
 
    m_pCC = m_pCCFactory->create();
@@ -790,6 +911,7 @@ POST_CONNECT:
    m_pCC->setRcvRate(m_iDeliveryRate);
    m_pCC->setRTT(m_iRTT);
    m_pCC->setBandwidth(m_iBandwidth);
+   m_pCC->setCachedRate(cachedrate);
    if (m_llMaxBW > 0)
       m_pCC->setUserParam((char*)&(m_llMaxBW), 8);
    m_pCC->init();
@@ -860,7 +982,7 @@ void CUDT::connect(const sockaddr* peer, CHandShake* hs)
    // Prepare all structures
    try
    {
-      m_pSndBuffer = new CSndBuffer(32, m_iPayloadSize);
+      m_pSndBuffer = new CSndBuffer(32, m_iPayloadSize, m_pSndQueue->getNode(m_SocketID));
       m_pRcvBuffer = new CRcvBuffer(&(m_pRcvQueue->m_UnitQueue), m_iRcvBufSize);
       m_pSndLossList = new CSndLossList(m_iFlowWindowSize * 2);
       m_pRcvLossList = new CRcvLossList(m_iFlightFlagSize);
@@ -876,10 +998,15 @@ void CUDT::connect(const sockaddr* peer, CHandShake* hs)
    CInfoBlock ib;
    ib.m_iIPversion = m_iIPversion;
    CInfoBlock::convert(peer, m_iIPversion, ib.m_piIP);
+   int cachedrate = 0;
    if (m_pCache->lookup(&ib) >= 0)
    {
       m_iRTT = ib.m_iRTT;
       m_iBandwidth = ib.m_iBandwidth;
+
+      // start from the rate the last connection to this peer sent at, only with the path cache and while it is recent
+      if ((ib.m_dInterval > 0) && m_pPathCache->isFresh(&ib))
+         m_iDeliveryRate = cachedrate = int(1000000.0 / ib.m_dInterval);
    }
 
    m_pCC = m_pCCFactory->create();
@@ -890,6 +1017,7 @@ void CUDT::connect(const sockaddr* peer, CHandShake* hs)
    m_pCC->setRcvRate(m_iDeliveryRate);
    m_pCC->setRTT(m_iRTT);
    m_pCC->setBandwidth(m_iBandwidth);
+   m_pCC->setCachedRate(cachedrate);
    if (m_llMaxBW > 0) m_pCC->setUserParam((char*)&(m_llMaxBW), 8);
    m_pCC->init();
 
@@ -954,7 +1082,7 @@ void CUDT::close()
 
    // remove this socket from the snd queue
    if (m_bConnected)
-      m_pSndQueue->m_pSndUList->remove(this);
+      m_pSndUList->remove(this);
 
    // remove itself from all epoll monitoring
    try
@@ -997,9 +1125,25 @@ void CUDT::close()
       CInfoBlock ib;
       ib.m_iIPversion = m_iIPversion;
       CInfoBlock::convert(m_pPeerAddr, m_iIPversion, ib.m_piIP);
-      ib.m_iRTT = m_iRTT;
-      ib.m_iBandwidth = m_iBandwidth;
+
+      // the rate is the one the connection sent at while it had data queued. Bandwidth and
+      // rate say little about the path unless a fair amount of data was sent, a connection
+      // that mostly received or exchanged a few messages keeps those of the last one
+      bool measured = (m_llSentTotal >= 1000) && (m_llSndDurationTotal > 0);
+      if (!measured && (m_pCache->lookup(&ib) >= 0))
+         ib.m_iRTT = m_iRTT;
+      else
+      {
+         ib.m_ullTimeStamp = CTimer::getTime();
+         ib.m_iRTT = m_iRTT;
+         ib.m_iBandwidth = m_iBandwidth;
+         ib.m_iLossRate = 0;
+         ib.m_iReorderDistance = 0;
+         ib.m_dInterval = measured ? double(m_llSndDurationTotal) / m_llSentTotal : 0;
+         ib.m_dCWnd = 0;
+      }
       m_pCache->update(&ib);
+      m_pPathCache->update(&ib);
 
       m_bConnected = false;
    }
@@ -1036,61 +1180,15 @@ int CUDT::send(const char* data, const int& len)
       m_ullLastRspTime = currtime;
    }
 
-   if (m_iSndBufSize <= m_pSndBuffer->getCurrBufSize())
+   if (0 == getSndBufAvail())
    {
       if (!m_bSynSending)
          throw CUDTException(6, 1, 0);
       else
-      {
-         // wait here during a blocking sending
-         #ifndef WIN32
-            pthread_mutex_lock(&m_SendBlockLock);
-            if (m_iSndTimeOut < 0) 
-            { 
-               while (!m_bBroken && m_bConnected && !m_bClosing && (m_iSndBufSize <= m_pSndBuffer->getCurrBufSize()) && m_bPeerHealth)
-                  pthread_cond_wait(&m_SendBlockCond, &m_SendBlockLock);
-            }
-            else
-            {
-               uint64_t exptime = CTimer::getTime() + m_iSndTimeOut * 1000ULL;
-               timespec locktime; 
-    
-               locktime.tv_sec = exptime / 1000000;
-               locktime.tv_nsec = (exptime % 1000000) * 1000;
-
-               while (!m_bBroken && m_bConnected && !m_bClosing && (m_iSndBufSize <= m_pSndBuffer->getCurrBufSize()) && m_bPeerHealth && (CTimer::getTime() < exptime))
-                  pthread_cond_timedwait(&m_SendBlockCond, &m_SendBlockLock, &locktime);
-            }
-            pthread_mutex_unlock(&m_SendBlockLock);
-         #else
-            if (m_iSndTimeOut < 0)
-            {
-               while (!m_bBroken && m_bConnected && !m_bClosing && (m_iSndBufSize <= m_pSndBuffer->getCurrBufSize()) && m_bPeerHealth)
-                  WaitForSingleObject(m_SendBlockCond, INFINITE);
-            }
-            else 
-            {
-               uint64_t exptime = CTimer::getTime() + m_iSndTimeOut * 1000ULL;
-
-               while (!m_bBroken && m_bConnected && !m_bClosing && (m_iSndBufSize <= m_pSndBuffer->getCurrBufSize()) && m_bPeerHealth && (CTimer::getTime() < exptime))
-                  WaitForSingleObject(m_SendBlockCond, DWORD((exptime - CTimer::getTime()) / 1000)); 
-            }
-         #endif
-
-         // check the connection status
-         if (m_bBroken || m_bClosing)
-            throw CUDTException(2, 1, 0);
-         else if (!m_bConnected)
-            throw CUDTException(2, 2, 0);
-         else if (!m_bPeerHealth)
-         {
-            m_bPeerHealth = true;
-            throw CUDTException(7);
-         }
-      }
+         waitSndBuf(0, true);
    }
 
-   if (m_iSndBufSize <= m_pSndBuffer->getCurrBufSize())
+   if (0 == getSndBufAvail())
    {
       if (m_iSndTimeOut >= 0)
          throw CUDTException(6, 1, 0); 
@@ -1098,7 +1196,7 @@ int CUDT::send(const char* data, const int& len)
       return 0;
    }
 
-   int size = (m_iSndBufSize - m_pSndBuffer->getCurrBufSize()) * m_iPayloadSize;
+   int size = getSndBufAvail() * m_iPayloadSize;
    if (size > len)
       size = len;
 
@@ -1110,9 +1208,9 @@ int CUDT::send(const char* data, const int& len)
    m_pSndBuffer->addBuffer(data, size);
 
    // insert this socket to snd list if it is not on the list yet
-   m_pSndQueue->m_pSndUList->update(this, false);
+   m_pSndUList->update(this, false);
 
-   if (m_iSndBufSize <= m_pSndBuffer->getCurrBufSize())
+   if (0 == getSndBufAvail())
    {
       // write is not available any more
       s_UDTUnited.m_EPoll.disable_write(m_SocketID, m_sPollID);
@@ -1137,62 +1235,7 @@ int CUDT::recv(char* data, const int& len)
 
    CGuard recvguard(m_RecvLock);
 
-   if (0 == m_pRcvBuffer->getRcvDataSize())
-   {
-      if (!m_bSynRecving)
-         throw CUDTException(6, 2, 0);
-      else
-      {
-         #ifndef WIN32
-            pthread_mutex_lock(&m_RecvDataLock);
-            if (m_iRcvTimeOut < 0) 
-            { 
-               while (!m_bBroken && m_bConnected && !m_bClosing && (0 == m_pRcvBuffer->getRcvDataSize()))
-                  pthread_cond_wait(&m_RecvDataCond, &m_RecvDataLock);
-            }
-            else
-            {
-               uint64_t exptime = CTimer::getTime() + m_iRcvTimeOut * 1000ULL; 
-               timespec locktime; 
-    
-               locktime.tv_sec = exptime / 1000000;
-               locktime.tv_nsec = (exptime % 1000000) * 1000;
-
-               while (!m_bBroken && m_bConnected && !m_bClosing && (0 == m_pRcvBuffer->getRcvDataSize()))
-               {
-                  pthread_cond_timedwait(&m_RecvDataCond, &m_RecvDataLock, &locktime); 
-                  if (CTimer::getTime() >= exptime)
-                     break;
-               }
-            }
-            pthread_mutex_unlock(&m_RecvDataLock);
-         #else
-            if (m_iRcvTimeOut < 0)
-            {
-               while (!m_bBroken && m_bConnected && !m_bClosing && (0 == m_pRcvBuffer->getRcvDataSize()))
-                  WaitForSingleObject(m_RecvDataCond, INFINITE);
-            }
-            else
-            {
-               uint64_t enter_time = CTimer::getTime();
-
-               while (!m_bBroken && m_bConnected && !m_bClosing && (0 == m_pRcvBuffer->getRcvDataSize()))
-               {
-                  int diff = int(CTimer::getTime() - enter_time) / 1000;
-                  if (diff >= m_iRcvTimeOut)
-                      break;
-                  WaitForSingleObject(m_RecvDataCond, DWORD(m_iRcvTimeOut - diff ));
-               }
-            }
-         #endif
-      }
-   }
-
-   // throw an exception if not connected
-   if (!m_bConnected)
-      throw CUDTException(2, 2, 0);
-   else if ((m_bBroken || m_bClosing) && (0 == m_pRcvBuffer->getRcvDataSize()))
-      throw CUDTException(2, 1, 0);
+   waitRcvData();
 
    int res = m_pRcvBuffer->readBuffer(data, len);
 
@@ -1235,56 +1278,80 @@ int CUDT::sendmsg(const char* data, const int& len, const int& msttl, const bool
       m_ullLastRspTime = currtime;
    }
 
-   if ((m_iSndBufSize - m_pSndBuffer->getCurrBufSize()) * m_iPayloadSize < len)
+   if (getSndBufAvail(len) * m_iPayloadSize < len)
    {
       if (!m_bSynSending)
          throw CUDTException(6, 1, 0);
       else
-      {
-         // wait here during a blocking sending
-         #ifndef WIN32
-            pthread_mutex_lock(&m_SendBlockLock);
-            if (m_iSndTimeOut < 0)
-            {
-               while (!m_bBroken && m_bConnected && !m_bClosing && ((m_iSndBufSize - m_pSndBuffer->getCurrBufSize()) * m_iPayloadSize < len))
-                  pthread_cond_wait(&m_SendBlockCond, &m_SendBlockLock);
-            }
-            else
-            {
-               uint64_t exptime = CTimer::getTime() + m_iSndTimeOut * 1000ULL;
-               timespec locktime;
+         waitSndBuf(len, false);
+   }
+
+   if (getSndBufAvail(len) * m_iPayloadSize < len)
+   {
+      if (m_iSndTimeOut >= 0)
+         throw CUDTException(6, 1, 0);
 
-               locktime.tv_sec = exptime / 1000000;
-               locktime.tv_nsec = (exptime % 1000000) * 1000;
+      return 0;
+   }
 
-               while (!m_bBroken && m_bConnected && !m_bClosing && ((m_iSndBufSize - m_pSndBuffer->getCurrBufSize()) * m_iPayloadSize < len) && (CTimer::getTime() < exptime))
-                  pthread_cond_timedwait(&m_SendBlockCond, &m_SendBlockLock, &locktime);
-            }
-            pthread_mutex_unlock(&m_SendBlockLock);
-         #else
-            if (m_iSndTimeOut < 0)
-            {
-               while (!m_bBroken && m_bConnected && !m_bClosing && ((m_iSndBufSize - m_pSndBuffer->getCurrBufSize()) * m_iPayloadSize < len))
-                  WaitForSingleObject(m_SendBlockCond, INFINITE);
-            }
-            else
-            {
-               uint64_t exptime = CTimer::getTime() + m_iSndTimeOut * 1000ULL;
+   // record total time used for sending
+   if (0 == m_pSndBuffer->getCurrBufSize())
+      m_llSndDurationCounter = CTimer::getTime();
 
-               while (!m_bBroken && m_bConnected && !m_bClosing && ((m_iSndBufSize - m_pSndBuffer->getCurrBufSize()) * m_iPayloadSize < len) && (CTimer::getTime() < exptime))
-                  WaitForSingleObject(m_SendBlockCond, DWORD((exptime - CTimer::getTime()) / 1000));
-            }
-         #endif
+   // insert the user buffer into the sening list
+   m_pSndBuffer->addBuffer(data, len, msttl, inorder);
 
-         // check the connection status
-         if (m_bBroken || m_bClosing)
-            throw CUDTException(2, 1, 0);
-         else if (!m_bConnected)
-            throw CUDTException(2, 2, 0);
-      }
+   // insert this socket to the snd list if it is not on the list yet
+   m_pSndUList->update(this, false);
+
+   if (0 == getSndBufAvail())
+   {
+      // write is not available any more
+      s_UDTUnited.m_EPoll.disable_write(m_SocketID, m_sPollID);
    }
 
-   if ((m_iSndBufSize - m_pSndBuffer->getCurrBufSize()) * m_iPayloadSize < len)
+   return len;   
+}
+
+int CUDT::sendzc(const char* data, const int& len, UDTZCCALLBACK release, void* param)
+{
+   if (UDT_DGRAM == m_iSockType)
+      throw CUDTException(5, 10, 0);
+
+   if (NULL == release)
+      throw CUDTException(5, 3, 0);
+
+   // throw an exception if not connected
+   if (m_bBroken || m_bClosing)
+      throw CUDTException(2, 1, 0);
+   else if (!m_bConnected)
+      throw CUDTException(2, 2, 0);
+
+   if (len <= 0)
+      return 0;
+
+   if (len > m_iSndBufSize * m_iPayloadSize)
+      throw CUDTException(5, 12, 0);
+
+   CGuard sendguard(m_SendLock);
+
+   if (m_pSndBuffer->getCurrBufSize() == 0)
+   {
+      // delay the EXP timer to avoid mis-fired timeout
+      uint64_t currtime;
+      CTimer::rdtsc(currtime);
+      m_ullLastRspTime = currtime;
+   }
+
+   if (getSndBufAvail(len) * m_iPayloadSize < len)
+   {
+      if (!m_bSynSending)
+         throw CUDTException(6, 1, 0);
+      else
+         waitSndBuf(len, false);
+   }
+
+   if (getSndBufAvail(len) * m_iPayloadSize < len)
    {
       if (m_iSndTimeOut >= 0)
          throw CUDTException(6, 1, 0);
@@ -1296,19 +1363,19 @@ int CUDT::sendmsg(const char* data, const int& len, const int& msttl, const bool
    if (0 == m_pSndBuffer->getCurrBufSize())
       m_llSndDurationCounter = CTimer::getTime();
 
-   // insert the user buffer into the sening list
-   m_pSndBuffer->addBuffer(data, len, msttl, inorder);
+   // reference the user buffer from the sending list, it is released once acknowledged
+   m_pSndBuffer->addBufferZC(data, len, release, param);
 
    // insert this socket to the snd list if it is not on the list yet
-   m_pSndQueue->m_pSndUList->update(this, false);
+   m_pSndUList->update(this, false);
 
-   if (m_iSndBufSize <= m_pSndBuffer->getCurrBufSize())
+   if (0 == getSndBufAvail())
    {
       // write is not available any more
       s_UDTUnited.m_EPoll.disable_write(m_SocketID, m_sPollID);
    }
 
-   return len;   
+   return len;
 }
 
 int CUDT::recvmsg(char* data, const int& len)
@@ -1410,6 +1477,60 @@ int CUDT::recvmsg(char* data, const int& len)
    return res;
 }
 
+int CUDT::recvpeek(UDTIOVEC* iov, const int& iovcnt)
+{
+   if (UDT_DGRAM == m_iSockType)
+      throw CUDTException(5, 10, 0);
+
+   // throw an exception if not connected
+   if (!m_bConnected)
+      throw CUDTException(2, 2, 0);
+   else if ((m_bBroken || m_bClosing) && (0 == m_pRcvBuffer->getRcvDataSize()))
+      throw CUDTException(2, 1, 0);
+
+   if (NULL == iov)
+      throw CUDTException(5, 3, 0);
+
+   if (iovcnt <= 0)
+      return 0;
+
+   CGuard recvguard(m_RecvLock);
+
+   waitRcvData();
+
+   // the spans stay valid until they are consumed, only this socket's reader releases units
+   int res = m_pRcvBuffer->peekBuffer(iov, iovcnt);
+
+   if ((res <= 0) && (m_iRcvTimeOut >= 0))
+      throw CUDTException(6, 2, 0);
+
+   return res;
+}
+
+int CUDT::recvconsume(const int& len)
+{
+   if (UDT_DGRAM == m_iSockType)
+      throw CUDTException(5, 10, 0);
+
+   if (!m_bConnected)
+      throw CUDTException(2, 2, 0);
+
+   if (len <= 0)
+      return 0;
+
+   CGuard recvguard(m_RecvLock);
+
+   int res = m_pRcvBuffer->consumeBuffer(len);
+
+   if (m_pRcvBuffer->getRcvDataSize() <= 0)
+   {
+      // read is not available any more
+      s_UDTUnited.m_EPoll.disable_read(m_SocketID, m_sPollID);
+   }
+
+   return res;
+}
+
 int64_t CUDT::sendfile(fstream& ifs, int64_t& offset, const int64_t& size, const int& block)
 {
    if (UDT_DGRAM == m_iSockType)
@@ -1459,11 +1580,11 @@ int64_t CUDT::sendfile(fstream& ifs, int64_t& offset, const int64_t& size, const
 
       #ifndef WIN32
          pthread_mutex_lock(&m_SendBlockLock);
-         while (!m_bBroken && m_bConnected && !m_bClosing && (m_iSndBufSize <= m_pSndBuffer->getCurrBufSize()) && m_bPeerHealth)
+         while (!m_bBroken && m_bConnected && !m_bClosing && (0 == getSndBufAvail()) && m_bPeerHealth)
             pthread_cond_wait(&m_SendBlockCond, &m_SendBlockLock);
          pthread_mutex_unlock(&m_SendBlockLock);
       #else
-         while (!m_bBroken && m_bConnected && !m_bClosing && (m_iSndBufSize <= m_pSndBuffer->getCurrBufSize()) && m_bPeerHealth)
+         while (!m_bBroken && m_bConnected && !m_bClosing && (0 == getSndBufAvail()) && m_bPeerHealth)
             WaitForSingleObject(m_SendBlockCond, INFINITE);
       #endif
 
@@ -1478,6 +1599,11 @@ int64_t CUDT::sendfile(fstream& ifs, int64_t& offset, const int64_t& size, const
          throw CUDTException(7);
       }
 
+      // take no more than the sending buffer can hold now
+      int avail = getSndBufAvail() * m_iPayloadSize;
+      if (unitsize > avail)
+         unitsize = avail;
+
       // record total time used for sending
       if (0 == m_pSndBuffer->getCurrBufSize())
          m_llSndDurationCounter = CTimer::getTime();
@@ -1491,10 +1617,10 @@ int64_t CUDT::sendfile(fstream& ifs, int64_t& offset, const int64_t& size, const
       }
 
       // insert this socket to snd list if it is not on the list yet
-      m_pSndQueue->m_pSndUList->update(this, false);
+      m_pSndUList->update(this, false);
    }
 
-   if (m_iSndBufSize <= m_pSndBuffer->getCurrBufSize())
+   if (0 == getSndBufAvail())
    {
       // write is not available any more
       s_UDTUnited.m_EPoll.disable_write(m_SocketID, m_sPollID);
@@ -1578,6 +1704,152 @@ int64_t CUDT::recvfile(fstream& ofs, int64_t& offset, const int64_t& size, const
    return size - torecv;
 }
 
+#ifndef WIN32
+int64_t CUDT::sendfile(int fd, int64_t& offset, const int64_t& size, const int& block)
+{
+   if (UDT_DGRAM == m_iSockType)
+      throw CUDTException(5, 10, 0);
+
+   if (m_bBroken || m_bClosing)
+      throw CUDTException(2, 1, 0);
+   else if (!m_bConnected)
+      throw CUDTException(2, 2, 0);
+
+   if (size <= 0)
+      return 0;
+
+   CGuard sendguard(m_SendLock);
+
+   if (m_pSndBuffer->getCurrBufSize() == 0)
+   {
+      // delay the EXP timer to avoid mis-fired timeout
+      uint64_t currtime;
+      CTimer::rdtsc(currtime);
+      m_ullLastRspTime = currtime;
+   }
+
+   int64_t tosend = size;
+   int unitsize;
+
+   // sending block by block, each one read at its own offset so the file position is never used
+   while (tosend > 0)
+   {
+      unitsize = int((tosend >= block) ? block : tosend);
+
+      pthread_mutex_lock(&m_SendBlockLock);
+      while (!m_bBroken && m_bConnected && !m_bClosing && (0 == getSndBufAvail()) && m_bPeerHealth)
+         pthread_cond_wait(&m_SendBlockCond, &m_SendBlockLock);
+      pthread_mutex_unlock(&m_SendBlockLock);
+
+      if (m_bBroken || m_bClosing)
+         throw CUDTException(2, 1, 0);
+      else if (!m_bConnected)
+         throw CUDTException(2, 2, 0);
+      else if (!m_bPeerHealth)
+      {
+         // reset peer health status, once this error returns, the app should handle the situation at the peer side
+         m_bPeerHealth = true;
+         throw CUDTException(7);
+      }
+
+      // take no more than the sending buffer can hold now
+      int avail = getSndBufAvail() * m_iPayloadSize;
+      if (unitsize > avail)
+         unitsize = avail;
+
+      // record total time used for sending
+      if (0 == m_pSndBuffer->getCurrBufSize())
+         m_llSndDurationCounter = CTimer::getTime();
+
+      int64_t sentsize = m_pSndBuffer->addBufferFromFile(fd, offset, unitsize);
+
+      if (sentsize < 0)
+         throw CUDTException(4, 4);
+
+      if (sentsize > 0)
+      {
+         tosend -= sentsize;
+         offset += sentsize;
+      }
+
+      // insert this socket to snd list if it is not on the list yet
+      m_pSndUList->update(this, false);
+
+      // end of file
+      if (sentsize < unitsize)
+         break;
+   }
+
+   if (0 == getSndBufAvail())
+   {
+      // write is not available any more
+      s_UDTUnited.m_EPoll.disable_write(m_SocketID, m_sPollID);
+   }
+
+   return size - tosend;
+}
+
+int64_t CUDT::recvfile(int fd, int64_t& offset, const int64_t& size, const int& block)
+{
+   if (UDT_DGRAM == m_iSockType)
+      throw CUDTException(5, 10, 0);
+
+   if (!m_bConnected)
+      throw CUDTException(2, 2, 0);
+   else if ((m_bBroken || m_bClosing) && (0 == m_pRcvBuffer->getRcvDataSize()))
+      throw CUDTException(2, 1, 0);
+
+   if (size <= 0)
+      return 0;
+
+   CGuard recvguard(m_RecvLock);
+
+   int64_t torecv = size;
+   int unitsize = block;
+   int recvsize;
+
+   // receiving... "recvfile" is always blocking
+   while (torecv > 0)
+   {
+      pthread_mutex_lock(&m_RecvDataLock);
+      while (!m_bBroken && m_bConnected && !m_bClosing && (0 == m_pRcvBuffer->getRcvDataSize()))
+         pthread_cond_wait(&m_RecvDataCond, &m_RecvDataLock);
+      pthread_mutex_unlock(&m_RecvDataLock);
+
+      if (!m_bConnected)
+         throw CUDTException(2, 2, 0);
+      else if ((m_bBroken || m_bClosing) && (0 == m_pRcvBuffer->getRcvDataSize()))
+         throw CUDTException(2, 1, 0);
+
+      unitsize = int((torecv >= block) ? block : torecv);
+      recvsize = m_pRcvBuffer->readBufferToFile(fd, offset, unitsize);
+
+      if (recvsize < 0)
+      {
+         // send the sender a signal so it will not be blocked forever
+         int32_t err_code = CUDTException::EFILE;
+         sendCtrl(8, &err_code);
+
+         throw CUDTException(4, 4);
+      }
+
+      if (recvsize > 0)
+      {
+         torecv -= recvsize;
+         offset += recvsize;
+      }
+   }
+
+   if (m_pRcvBuffer->getRcvDataSize() <= 0)
+   {
+      // read is not available any more
+      s_UDTUnited.m_EPoll.disable_read(m_SocketID, m_sPollID);
+   }
+
+   return size - torecv;
+}
+#endif
+
 void CUDT::sample(CPerfMon* perf, bool clear)
 {
    if (!m_bConnected)
@@ -1628,7 +1900,7 @@ void CUDT::sample(CPerfMon* perf, bool clear)
       if (WAIT_OBJECT_0 == WaitForSingleObject(m_ConnectionLock, 0))
    #endif
    {
-      perf->byteAvailSndBuf = (NULL == m_pSndBuffer) ? 0 : (m_iSndBufSize - m_pSndBuffer->getCurrBufSize()) * m_iMSS;
+      perf->byteAvailSndBuf = (NULL == m_pSndBuffer) ? 0 : getSndBufAvail() * m_iMSS;
       perf->byteAvailRcvBuf = (NULL == m_pRcvBuffer) ? 0 : m_pRcvBuffer->getAvailBufSize() * m_iMSS;
 
       #ifndef WIN32
@@ -1655,9 +1927,9 @@ void CUDT::initSynch()
 {
    #ifndef WIN32
       pthread_mutex_init(&m_SendBlockLock, NULL);
-      pthread_cond_init(&m_SendBlockCond, NULL);
+      CGuard::createCond(m_SendBlockCond);
       pthread_mutex_init(&m_RecvDataLock, NULL);
-      pthread_cond_init(&m_RecvDataCond, NULL);
+      CGuard::createCond(m_RecvDataCond);
       pthread_mutex_init(&m_SendLock, NULL);
       pthread_mutex_init(&m_RecvLock, NULL);
       pthread_mutex_init(&m_AckLock, NULL);
@@ -1799,6 +2071,10 @@ void CUDT::sendCtrl(const int& pkttype, void* lparam, void* rparam, const int& s
          data[1] = m_iRTT;
          data[2] = m_iRTTVar;
          data[3] = m_pRcvBuffer->getAvailBufSize();
+         // with a memory budget, the UDP port may not be able to store as many packets
+         int units = m_pRcvQueue->m_UnitQueue.getAvailSize();
+         if ((units >= 0) && (units < data[3]))
+            data[3] = units;
          // a minimum flow window of 2 is used, even if buffer is full, to break potential deadlock
          if (data[3] < 2)
             data[3] = 2;
@@ -1974,7 +2250,7 @@ void CUDT::processCtrl(CPacket& ctrlpkt)
       // send ACK acknowledgement
       // number of ACK2 can be much less than number of ACK
       uint64_t now = CTimer::getTime();
-      if ((currtime - m_ullSndLastAck2Time > (uint64_t)m_iSYNInterval) || (ack == m_iSndLastAck2))
+      if ((now - m_ullSndLastAck2Time > (uint64_t)m_iSYNInterval) || (ack == m_iSndLastAck2))
       {
          sendCtrl(6, &ack);
          m_iSndLastAck2 = ack;
@@ -2011,13 +2287,15 @@ void CUDT::processCtrl(CPacket& ctrlpkt)
          break;
       }
 
-      // acknowledge the sending buffer
-      m_pSndBuffer->ackData(offset);
+      // acknowledge the sending buffer; the sendzc() callbacks are called after m_AckLock is left
+      vector<CSndBuffer::ZCRef*> released;
+      m_pSndBuffer->ackData(offset, released);
 
-      // record total time used for sending
-      m_llSndDuration += currtime - m_llSndDurationCounter;
-      m_llSndDurationTotal += currtime - m_llSndDurationCounter;
-      m_llSndDurationCounter = currtime;
+      // record total time used for sending, the duration counter is kept in getTime() units
+      int64_t sndtime = CTimer::getTime();
+      m_llSndDuration += sndtime - m_llSndDurationCounter;
+      m_llSndDurationTotal += sndtime - m_llSndDurationCounter;
+      m_llSndDurationCounter = sndtime;
 
       // update sending variables
       m_iSndLastDataAck = ack;
@@ -2025,6 +2303,9 @@ void CUDT::processCtrl(CPacket& ctrlpkt)
 
       CGuard::leaveCS(m_AckLock);
 
+      if (!released.empty())
+         CSndBuffer::notifyReleased(released);
+
       #ifndef WIN32
          pthread_mutex_lock(&m_SendBlockLock);
          if (m_bSynSending)
@@ -2039,7 +2320,7 @@ void CUDT::processCtrl(CPacket& ctrlpkt)
       s_UDTUnited.m_EPoll.enable_write(m_SocketID, m_sPollID);
 
       // insert this socket to snd list if it is not on the list yet
-      m_pSndQueue->m_pSndUList->update(this, false);
+      m_pSndUList->update(this, false);
 
       // Update RTT
       //m_iRTT = *((int32_t *)ctrlpkt.m_pcData + 1);
@@ -2159,7 +2440,7 @@ void CUDT::processCtrl(CPacket& ctrlpkt)
       }
 
       // the lost packet (retransmission) should be sent out immediately
-      m_pSndQueue->m_pSndUList->update(this);
+      m_pSndUList->update(this);
 
       ++ m_iRecvNAK;
       ++ m_iRecvNAKTotal;
@@ -2391,13 +2672,15 @@ int CUDT::processData(CUnit* unit)
    m_pCC->onPktReceived(&packet);
    ++ m_iPktCount;
    // update time information
-   m_pRcvTimeWindow->onPktArrival();
+   // packets received in a batch are processed back to back, so prefer the time the kernel received the packet
+   uint64_t arrtime = (0 != unit->m_llArrivalTime) ? unit->m_llArrivalTime : CTimer::getTime();
+   m_pRcvTimeWindow->onPktArrival(arrtime);
 
    // check if it is probing packet pair
    if (0 == (packet.m_iSeqNo & 0xF))
-      m_pRcvTimeWindow->probe1Arrival();
+      m_pRcvTimeWindow->probe1Arrival(arrtime);
    else if (1 == (packet.m_iSeqNo & 0xF))
-      m_pRcvTimeWindow->probe2Arrival();
+      m_pRcvTimeWindow->probe2Arrival(arrtime);
 
    ++ m_llTraceRecv;
    ++ m_llRecvTotal;
@@ -2477,7 +2760,10 @@ int CUDT::listen(sockaddr* addr, CPacket& packet)
    {
       if (hs.m_iCookie != *(int*)cookie)
       {
+         // the cookie may have been issued in the previous minute; the string must be rebuilt, not appended to,
+         // or a handshake that straddles a minute boundary is dropped and the connect times out
          timestamp --;
+         cookiestr.str("");
          cookiestr << clienthost << ":" << clientport << ":" << timestamp;
          CMD5::compute(cookiestr.str().c_str(), cookie);
 
@@ -2569,16 +2855,7 @@ void CUDT::checkTimers()
    //   m_ullNextNAKTime = currtime + m_ullNAKInt;
    //}
 
-   uint64_t next_exp_time;
-   if (m_pCC->m_bUserDefinedRTO)
-      next_exp_time = m_ullLastRspTime + m_pCC->m_iRTO * m_ullCPUFrequency;
-   else
-   {
-      uint64_t exp_int = (m_iEXPCount * (m_iRTT + 4 * m_iRTTVar) + m_iSYNInterval) * m_ullCPUFrequency;
-      if (exp_int < m_iEXPCount * m_ullMinExpInt)
-         exp_int = m_iEXPCount * m_ullMinExpInt;
-      next_exp_time = m_ullLastRspTime + exp_int;
-   }
+   uint64_t next_exp_time = getNextEXPTime();
 
    if (currtime > next_exp_time)
    {
@@ -2596,7 +2873,7 @@ void CUDT::checkTimers()
          m_iBrokenCounter = 30;
 
          // update snd U list to remove this socket
-         m_pSndQueue->m_pSndUList->update(this);
+         m_pSndUList->update(this);
 
          releaseSynch();
 
@@ -2628,7 +2905,7 @@ void CUDT::checkTimers()
          m_dCongestionWindow = m_pCC->m_dCWndSize;
 
          // immediately restart transmission
-         m_pSndQueue->m_pSndUList->update(this);
+         m_pSndUList->update(this);
       }
       else
       {
@@ -2638,7 +2915,185 @@ void CUDT::checkTimers()
       ++ m_iEXPCount;
       // Reset last response time since we just sent a heart-beat.
       m_ullLastRspTime = currtime;
+
+      next_exp_time = getNextEXPTime();
    }
+
+   // the next ACK or EXP event, but check at least every 100ms so that closed sockets are removed in time
+   m_ullNextCheckTime = currtime + 100000 * m_ullCPUFrequency;
+   if (m_ullNextACKTime < m_ullNextCheckTime)
+      m_ullNextCheckTime = m_ullNextACKTime;
+   if (next_exp_time < m_ullNextCheckTime)
+      m_ullNextCheckTime = next_exp_time;
+}
+
+uint64_t CUDT::getNextEXPTime() const
+{
+   if (m_pCC->m_bUserDefinedRTO)
+      return m_ullLastRspTime + m_pCC->m_iRTO * m_ullCPUFrequency;
+
+   uint64_t exp_int = (m_iEXPCount * (m_iRTT + 4 * m_iRTTVar) + m_iSYNInterval) * m_ullCPUFrequency;
+   if (exp_int < m_iEXPCount * m_ullMinExpInt)
+      exp_int = m_iEXPCount * m_ullMinExpInt;
+   return m_ullLastRspTime + exp_int;
+}
+
+int CUDT::getSndBufAvail(const int& len) const
+{
+   return m_pSndBuffer->getAvailBufSize(m_iSndBufSize, (len + m_iPayloadSize - 1) / m_iPayloadSize);
+}
+
+void CUDT::waitSndBuf(const int& len, const bool& health)
+{
+   // wait here during a blocking sending
+   #ifndef WIN32
+      pthread_mutex_lock(&m_SendBlockLock);
+      if (m_iSndTimeOut < 0)
+      {
+         while (!m_bBroken && m_bConnected && !m_bClosing && isSndBufFull(len) && (!health || m_bPeerHealth))
+            pthread_cond_wait(&m_SendBlockCond, &m_SendBlockLock);
+      }
+      else
+      {
+         uint64_t exptime = CTimer::getTime() + m_iSndTimeOut * 1000ULL;
+         timespec locktime;
+
+         locktime.tv_sec = exptime / 1000000;
+         locktime.tv_nsec = (exptime % 1000000) * 1000;
+
+         while (!m_bBroken && m_bConnected && !m_bClosing && isSndBufFull(len) && (!health || m_bPeerHealth) && (CTimer::getTime() < exptime))
+            pthread_cond_timedwait(&m_SendBlockCond, &m_SendBlockLock, &locktime);
+      }
+      pthread_mutex_unlock(&m_SendBlockLock);
+   #else
+      if (m_iSndTimeOut < 0)
+      {
+         while (!m_bBroken && m_bConnected && !m_bClosing && isSndBufFull(len) && (!health || m_bPeerHealth))
+            WaitForSingleObject(m_SendBlockCond, INFINITE);
+      }
+      else
+      {
+         uint64_t exptime = CTimer::getTime() + m_iSndTimeOut * 1000ULL;
+
+         while (!m_bBroken && m_bConnected && !m_bClosing && isSndBufFull(len) && (!health || m_bPeerHealth) && (CTimer::getTime() < exptime))
+            WaitForSingleObject(m_SendBlockCond, DWORD((exptime - CTimer::getTime()) / 1000));
+      }
+   #endif
+
+   // check the connection status
+   if (m_bBroken || m_bClosing)
+      throw CUDTException(2, 1, 0);
+   else if (!m_bConnected)
+      throw CUDTException(2, 2, 0);
+   else if (health && !m_bPeerHealth)
+   {
+      m_bPeerHealth = true;
+      throw CUDTException(7);
+   }
+}
+
+bool CUDT::isSndBufFull(const int& len) const
+{
+   // a message must fit as a whole, a stream send takes any space
+   if (len > 0)
+      return getSndBufAvail(len) * m_iPayloadSize < len;
+
+   return 0 == getSndBufAvail();
+}
+
+void CUDT::waitRcvData()
+{
+   if (0 == m_pRcvBuffer->getRcvDataSize())
+   {
+      if (!m_bSynRecving)
+         throw CUDTException(6, 2, 0);
+
+      // wait here during a blocking receiving
+      #ifndef WIN32
+         pthread_mutex_lock(&m_RecvDataLock);
+         if (m_iRcvTimeOut < 0)
+         {
+            while (!m_bBroken && m_bConnected && !m_bClosing && (0 == m_pRcvBuffer->getRcvDataSize()))
+               pthread_cond_wait(&m_RecvDataCond, &m_RecvDataLock);
+         }
+         else
+         {
+            uint64_t exptime = CTimer::getTime() + m_iRcvTimeOut * 1000ULL;
+            timespec locktime;
+
+            locktime.tv_sec = exptime / 1000000;
+            locktime.tv_nsec = (exptime % 1000000) * 1000;
+
+            while (!m_bBroken && m_bConnected && !m_bClosing && (0 == m_pRcvBuffer->getRcvDataSize()))
+            {
+               pthread_cond_timedwait(&m_RecvDataCond, &m_RecvDataLock, &locktime);
+               if (CTimer::getTime() >= exptime)
+                  break;
+            }
+         }
+         pthread_mutex_unlock(&m_RecvDataLock);
+      #else
+         if (m_iRcvTimeOut < 0)
+         {
+            while (!m_bBroken && m_bConnected && !m_bClosing && (0 == m_pRcvBuffer->getRcvDataSize()))
+               WaitForSingleObject(m_RecvDataCond, INFINITE);
+         }
+         else
+         {
+            uint64_t enter_time = CTimer::getTime();
+
+            while (!m_bBroken && m_bConnected && !m_bClosing && (0 == m_pRcvBuffer->getRcvDataSize()))
+            {
+               int diff = int(CTimer::getTime() - enter_time) / 1000;
+               if (diff >= m_iRcvTimeOut)
+                   break;
+               WaitForSingleObject(m_RecvDataCond, DWORD(m_iRcvTimeOut - diff ));
+            }
+         }
+      #endif
+   }
+
+   // throw an exception if not connected
+   if (!m_bConnected)
+      throw CUDTException(2, 2, 0);
+   else if ((m_bBroken || m_bClosing) && (0 == m_pRcvBuffer->getRcvDataSize()))
+      throw CUDTException(2, 1, 0);
+}
+
+int CUDT::releaseIdleMemory(const uint64_t& currtime)
+{
+   if (!m_bConnected || m_bBroken || m_bClosing)
+      return 0;
+
+   int64_t traffic = m_llSentTotal + m_llRecvTotal;
+   if (traffic != m_llIdleTraffic)
+   {
+      m_llIdleTraffic = traffic;
+      m_ullIdleTime = currtime;
+      return 0;
+   }
+
+   if (currtime - m_ullIdleTime < uint64_t(CMemPool::m_iIdleTime))
+      return 0;
+
+   // a sending call in progress keeps the memory, the buffer is checked again on the next round
+   #ifndef WIN32
+      if (0 != pthread_mutex_trylock(&m_SendLock))
+         return 0;
+   #else
+      if (WAIT_OBJECT_0 != WaitForSingleObject(m_SendLock, 0))
+         return 0;
+   #endif
+
+   int released = m_pSndBuffer->shrink() * m_iPayloadSize;
+
+   #ifndef WIN32
+      pthread_mutex_unlock(&m_SendLock);
+   #else
+      ReleaseMutex(m_SendLock);
+   #endif
+
+   return released;
 }
 
 void CUDT::addEPoll(const int eid)
@@ -2655,7 +3110,7 @@ void CUDT::addEPoll(const int eid)
    else if ((UDT_DGRAM == m_iSockType) && (m_pRcvBuffer->getRcvMsgNum() > 0))
       s_UDTUnited.m_EPoll.enable_read(m_SocketID, m_sPollID);
 
-   if (m_iSndBufSize > m_pSndBuffer->getCurrBufSize())
+   if (getSndBufAvail() > 0)
       s_UDTUnited.m_EPoll.enable_write(m_SocketID, m_sPollID);
 }
 
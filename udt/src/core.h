@@ -83,6 +83,7 @@ public: //API
    static int bind(UDTSOCKET u, UDPSOCKET udpsock);
    static int listen(UDTSOCKET u, int backlog);
    static UDTSOCKET accept(UDTSOCKET u, sockaddr* addr, int* addrlen);
+   static int acceptBatch(UDTSOCKET u, UDTSOCKET* socks, int size);
    static int connect(UDTSOCKET u, const sockaddr* name, int namelen);
    static int close(UDTSOCKET u);
    static int getpeername(UDTSOCKET u, sockaddr* name, int* namelen);
@@ -92,9 +93,16 @@ public: //API
    static int send(UDTSOCKET u, const char* buf, int len, int flags);
    static int recv(UDTSOCKET u, char* buf, int len, int flags);
    static int sendmsg(UDTSOCKET u, const char* buf, int len, int ttl = -1, bool inorder = false);
+   static int sendzc(UDTSOCKET u, const char* buf, int len, UDTZCCALLBACK release, void* param);
    static int recvmsg(UDTSOCKET u, char* buf, int len);
+   static int recvpeek(UDTSOCKET u, UDTIOVEC* iov, int iovcnt);
+   static int recvconsume(UDTSOCKET u, int len);
    static int64_t sendfile(UDTSOCKET u, std::fstream& ifs, int64_t& offset, const int64_t& size, const int& block = 364000);
    static int64_t recvfile(UDTSOCKET u, std::fstream& ofs, int64_t& offset, const int64_t& size, const int& block = 7280000);
+#ifndef WIN32
+   static int64_t sendfile(UDTSOCKET u, int fd, int64_t& offset, const int64_t& size, const int& block = 364000);
+   static int64_t recvfile(UDTSOCKET u, int fd, int64_t& offset, const int64_t& size, const int& block = 7280000);
+#endif
    static int select(int nfds, ud_set* readfds, ud_set* writefds, ud_set* exceptfds, const timeval* timeout);
    static int selectEx(const std::vector<UDTSOCKET>& fds, std::vector<UDTSOCKET>* readfds, std::vector<UDTSOCKET>* writefds, std::vector<UDTSOCKET>* exceptfds, int64_t msTimeOut);
    static int epoll_create();
@@ -103,6 +111,7 @@ public: //API
    static int epoll_remove_usock(const int eid, const UDTSOCKET u);
    static int epoll_remove_ssock(const int eid, const SYSSOCKET s);
    static int epoll_wait(const int eid, std::set<UDTSOCKET>* readfds, std::set<UDTSOCKET>* writefds, int64_t msTimeOut, std::set<SYSSOCKET>* lrfds = NULL, std::set<SYSSOCKET>* wrfds = NULL);
+   static int epoll_wait2(const int eid, UDTSOCKET* readfds, int* rnum, UDTSOCKET* writefds, int* wnum, int64_t msTimeOut, SYSSOCKET* lrfds = NULL, int* lrnum = NULL, SYSSOCKET* lwfds = NULL, int* lwnum = NULL);
    static int epoll_release(const int eid);
    static CUDTException& getlasterror();
    static int perfmon(UDTSOCKET u, CPerfMon* perf, bool clear = true);
@@ -199,6 +208,19 @@ private:
 
    int sendmsg(const char* data, const int& len, const int& ttl, const bool& inorder);
 
+      // Functionality:
+      //    send a memory block "data" with size of "len" without copying it. The block must stay valid and
+      //    unmodified until "release" is called, once the whole block has been acknowledged or the socket is closed.
+      // Parameters:
+      //    0) [in] data: The address of the application data to be sent.
+      //    1) [in] len: The size of the data block.
+      //    2) [in] release: callback invoked when UDT no longer references the data block.
+      //    3) [in] param: user parameter passed to "release".
+      // Returned value:
+      //    len if the block was queued, 0 if it was not and the application still owns it.
+
+   int sendzc(const char* data, const int& len, UDTZCCALLBACK release, void* param);
+
       // Functionality:
       //    Receive a message to buffer "data".
       // Parameters:
@@ -209,6 +231,25 @@ private:
 
    int recvmsg(char* data, const int& len);
 
+      // Functionality:
+      //    Expose the in-order received data as spans pointing into the protocol buffer, without consuming it.
+      // Parameters:
+      //    0) [out] iov: array receiving the spans, the first span starts at the current read point.
+      //    1) [in] iovcnt: number of entries in "iov".
+      // Returned value:
+      //    Number of spans filled.
+
+   int recvpeek(UDTIOVEC* iov, const int& iovcnt);
+
+      // Functionality:
+      //    Release received data previously exposed by "recvpeek".
+      // Parameters:
+      //    0) [in] len: number of bytes to consume from the current read point.
+      // Returned value:
+      //    Actual size of data consumed.
+
+   int recvconsume(const int& len);
+
       // Functionality:
       //    Request UDT to send out a file described as "fd", starting from "offset", with size of "size".
       // Parameters:
@@ -233,6 +274,32 @@ private:
 
    int64_t recvfile(std::fstream& ofs, int64_t& offset, const int64_t& size, const int& block = 7320000);
 
+#ifndef WIN32
+      // Functionality:
+      //    Request UDT to send out a file described as "fd" with positioned reads, starting from "offset", with size of "size".
+      // Parameters:
+      //    0) [in] fd: The input file descriptor, its file position is not used or changed.
+      //    1) [in, out] offset: From where to read and send data; output is the new offset when the call returns.
+      //    2) [in] size: How many data to be sent.
+      //    3) [in] block: size of block per read from disk
+      // Returned value:
+      //    Actual size of data sent, less than "size" if the end of the file is reached.
+
+   int64_t sendfile(int fd, int64_t& offset, const int64_t& size, const int& block = 366000);
+
+      // Functionality:
+      //    Request UDT to receive data into a file described as "fd" with positioned writes, starting from "offset", with expected size of "size".
+      // Parameters:
+      //    0) [in] fd: The output file descriptor, its file position is not used or changed.
+      //    1) [in, out] offset: From where to write data; output is the new offset when the call returns.
+      //    2) [in] size: How many data to be received.
+      //    3) [in] block: size of block per write to disk
+      // Returned value:
+      //    Actual size of data received.
+
+   int64_t recvfile(int fd, int64_t& offset, const int64_t& size, const int& block = 7320000);
+#endif
+
       // Functionality:
       //    Configure UDT options.
       // Parameters:
@@ -298,15 +365,22 @@ private: // Options
    int m_iRcvTimeOut;                           // receiving timeout in milliseconds
    bool m_bReuseAddr;				// reuse an exiting port or not, for UDP multiplexer
    int64_t m_llMaxBW;				// maximum data transfer rate (threshold)
+   bool m_bUDPGSO;				// use UDP segmentation offload, for UDP multiplexer
+   bool m_bUDPGRO;				// use UDP receive offload, for UDP multiplexer
+   int m_iRcvWorkers;				// number of receiving worker threads, for UDP multiplexer
+   int m_iSndWorkers;				// number of sending worker threads, for UDP multiplexer
+   int m_iSndCPU;				// first CPU the sending threads are pinned to, -1 for none, for UDP multiplexer
 
 private: // congestion control
    CCCVirtualFactory* m_pCCFactory;             // Factory class to create a specific CC instance
    CCC* m_pCC;                                  // congestion control class
    CCache<CInfoBlock>* m_pCache;		// network information cache
+   CPathCache* m_pPathCache;			// persistent network information cache, shared between processes
 
 private: // Status
    volatile bool m_bListening;                  // If the UDT entit is listening to connection
    volatile bool m_bConnecting;			// The short phase when connect() is called but not yet completed
+   volatile bool m_bConnFailed;                 // An asynchronous connect was rejected or timed out
    volatile bool m_bConnected;                  // Whether the connection is on or off
    volatile bool m_bClosing;                    // If the UDT entity is closing
    volatile bool m_bShutdown;                   // If the peer side has shutdown the connection
@@ -422,6 +496,7 @@ private: // Timers
 
    uint64_t m_ullNextACKTime;			// Next ACK time, in CPU clock cycles, same below
    uint64_t m_ullNextNAKTime;			// Next NAK time
+   uint64_t m_ullNextCheckTime;			// Next time checkTimers() has work to do, the receiving worker waits until then
 
    volatile uint64_t m_ullSYNInt;		// SYN interval
    volatile uint64_t m_ullACKInt;		// ACK interval
@@ -437,9 +512,11 @@ private: // Timers
    uint64_t m_ullTargetTime;			// scheduled time of next packet sending
 
    void checkTimers();
+   uint64_t getNextEXPTime() const;
 
 private: // for UDP multiplexer
    CSndQueue* m_pSndQueue;			// packet sending queue
+   CSndUList* m_pSndUList;			// list of the sending thread that serves this socket
    CRcvQueue* m_pRcvQueue;			// packet receiving queue
    sockaddr* m_pPeerAddr;			// peer address
    uint32_t m_piSelfIP[4];			// local UDP IP address
@@ -450,6 +527,56 @@ private: // for epoll
    std::set<int> m_sPollID;                     // set of epoll ID to trigger
    void addEPoll(const int eid);
    void removeEPoll(const int eid);
+
+private: // packet memory
+   int64_t m_llIdleTraffic;                     // packets sent and received when the connection was last found active
+   uint64_t m_ullIdleTime;                      // time since which the connection has had no traffic
+
+      // Functionality:
+      //    Query how many packets the sending buffer can take now, within UDT_SNDBUF and the memory budget.
+      // Parameters:
+      //    0) [in] len: size of a message that can only be added as a whole.
+      // Returned value:
+      //    Number of packets.
+
+   int getSndBufAvail(const int& len = 0) const;
+
+      // Functionality:
+      //    Block a blocking send until the sending buffer can take the data, the connection fails or UDT_SNDTIMEO expires.
+      // Parameters:
+      //    0) [in] len: size of a message that can only be added as a whole, 0 for a stream send that takes any space.
+      //    1) [in] health: also stop when the peer is found unhealthy.
+      // Returned value:
+      //    None. An exception is thrown if the connection is broken, closed or, with "health", the peer is unhealthy.
+
+   void waitSndBuf(const int& len, const bool& health);
+
+      // Functionality:
+      //    Check if the sending buffer is too full for the data.
+      // Parameters:
+      //    0) [in] len: size of a message that can only be added as a whole, 0 for any space.
+      // Returned value:
+      //    true if the data cannot be added now.
+
+   bool isSndBufFull(const int& len) const;
+
+      // Functionality:
+      //    Block a blocking receive until data arrives, the connection fails or UDT_RCVTIMEO expires.
+      // Parameters:
+      //    None.
+      // Returned value:
+      //    None. An exception is thrown if nothing can be read in non-blocking mode or the connection is broken or closed.
+
+   void waitRcvData();
+
+      // Functionality:
+      //    Return the extra memory of the sending buffer to the pool once the connection has been idle for a while.
+      // Parameters:
+      //    0) [in] currtime: current time in microseconds.
+      // Returned value:
+      //    Number of bytes released.
+
+   int releaseIdleMemory(const uint64_t& currtime);
 };
 
 
@@ -46,6 +46,7 @@ written by
 #include <cerrno>
 #include <cstring>
 #include <iterator>
+#include <vector>
 
 #include "common.h"
 #include "epoll.h"
@@ -53,6 +54,213 @@ written by
 
 using namespace std;
 
+// Receiver of the sockets found ready by CEPoll::wait(): the std::set outputs of
+// epoll_wait(), or the caller-provided arrays of epoll_wait2().
+class CEPollSink
+{
+public:
+   enum EKind {UDT_READ = 0, UDT_WRITE, SYS_READ, SYS_WRITE};
+
+   virtual ~CEPollSink() {}
+
+   // false if this kind of event was not requested, or there is no space left for it
+   virtual bool room(const int kind) const = 0;
+
+   virtual void addUDT(const int kind, const UDTSOCKET& u) = 0;
+   virtual void addSys(const int kind, const SYSSOCKET& s) = 0;
+};
+
+class CEPollSetSink: public CEPollSink
+{
+public:
+   CEPollSetSink(set<UDTSOCKET>* readfds, set<UDTSOCKET>* writefds, set<SYSSOCKET>* lrfds, set<SYSSOCKET>* lwfds)
+   {
+      m_pUDTFDs[UDT_READ] = readfds;
+      m_pUDTFDs[UDT_WRITE] = writefds;
+      m_pSysFDs[SYS_READ - SYS_READ] = lrfds;
+      m_pSysFDs[SYS_WRITE - SYS_READ] = lwfds;
+
+      // Clear these sets in case the app forget to do it.
+      for (int i = 0; i < 2; ++ i)
+      {
+         if (NULL != m_pUDTFDs[i])
+            m_pUDTFDs[i]->clear();
+         if (NULL != m_pSysFDs[i])
+            m_pSysFDs[i]->clear();
+      }
+   }
+
+   virtual bool room(const int kind) const
+   {
+      if (kind < SYS_READ)
+         return NULL != m_pUDTFDs[kind];
+      return NULL != m_pSysFDs[kind - SYS_READ];
+   }
+
+   virtual void addUDT(const int kind, const UDTSOCKET& u)
+   {
+      m_pUDTFDs[kind]->insert(u);
+   }
+
+   virtual void addSys(const int kind, const SYSSOCKET& s)
+   {
+      m_pSysFDs[kind - SYS_READ]->insert(s);
+   }
+
+private:
+   set<UDTSOCKET>* m_pUDTFDs[2];
+   set<SYSSOCKET>* m_pSysFDs[2];
+};
+
+class CEPollArraySink: public CEPollSink
+{
+public:
+   CEPollArraySink(UDTSOCKET* readfds, int* rnum, UDTSOCKET* writefds, int* wnum, SYSSOCKET* lrfds, int* lrnum, SYSSOCKET* lwfds, int* lwnum)
+   {
+      m_pUDTFDs[UDT_READ] = readfds;
+      m_pUDTFDs[UDT_WRITE] = writefds;
+      m_pSysFDs[SYS_READ - SYS_READ] = lrfds;
+      m_pSysFDs[SYS_WRITE - SYS_READ] = lwfds;
+
+      int* num[4] = {rnum, wnum, lrnum, lwnum};
+      bool valid[4] = {NULL != readfds, NULL != writefds, NULL != lrfds, NULL != lwfds};
+      for (int i = 0; i < 4; ++ i)
+      {
+         m_piSize[i] = 0;
+         m_piNum[i] = num[i];
+         if (NULL == num[i])
+            continue;
+
+         if (valid[i] && (*num[i] > 0))
+            m_piSize[i] = *num[i];
+         *num[i] = 0;
+      }
+   }
+
+   virtual bool room(const int kind) const
+   {
+      return (m_piSize[kind] > 0) && (*m_piNum[kind] < m_piSize[kind]);
+   }
+
+   virtual void addUDT(const int kind, const UDTSOCKET& u)
+   {
+      m_pUDTFDs[kind][(*m_piNum[kind]) ++] = u;
+   }
+
+   virtual void addSys(const int kind, const SYSSOCKET& s)
+   {
+      m_pSysFDs[kind - SYS_READ][(*m_piNum[kind]) ++] = s;
+   }
+
+private:
+   UDTSOCKET* m_pUDTFDs[2];
+   SYSSOCKET* m_pSysFDs[2];
+   int* m_piNum[4];                 // number of sockets stored, in the caller's variables
+   int m_piSize[4];                 // capacity of each array
+};
+
+// Report the sockets in "ready" to "sink", starting after the one reported last, so that a sink too
+// small for all of them does not keep receiving the same ones. Edge-triggered sockets are reported once.
+static int report(set<UDTSOCKET>& ready, UDTSOCKET& last, const set<UDTSOCKET>& edges, CEPollSink& sink, const int kind)
+{
+   int count = 0;
+
+   set<UDTSOCKET>::iterator i = ready.upper_bound(last);
+   for (size_t n = ready.size(); (n > 0) && sink.room(kind); -- n)
+   {
+      if (i == ready.end())
+         i = ready.begin();
+
+      last = *i;
+      sink.addUDT(kind, *i);
+      ++ count;
+
+      if (edges.find(*i) != edges.end())
+         ready.erase(i ++);
+      else
+         ++ i;
+   }
+
+   return count;
+}
+
+// Poll the system sockets of an EPoll without blocking.
+static int pollLocals(const CEPollDesc& desc, CEPollSink& sink)
+{
+   int total = 0;
+
+   #ifdef LINUX
+   vector<epoll_event> ev(desc.m_sLocals.size());
+   int nfds = epoll_wait(desc.m_iLocalID, &ev[0], ev.size(), 0);
+
+   for (int i = 0; i < nfds; ++ i)
+   {
+      if ((ev[i].events & EPOLLIN) && sink.room(CEPollSink::SYS_READ))
+      {
+         sink.addSys(CEPollSink::SYS_READ, ev[i].data.fd);
+         ++ total;
+      }
+      if ((ev[i].events & EPOLLOUT) && sink.room(CEPollSink::SYS_WRITE))
+      {
+         sink.addSys(CEPollSink::SYS_WRITE, ev[i].data.fd);
+         ++ total;
+      }
+   }
+   #else
+   //currently "select" is used for all non-Linux platforms.
+   //faster approaches can be applied for specific systems in the future.
+
+   //"select" has a limitation on the number of sockets
+
+   const bool lr = sink.room(CEPollSink::SYS_READ);
+   const bool lw = sink.room(CEPollSink::SYS_WRITE);
+
+   fd_set readfds;
+   fd_set writefds;
+   FD_ZERO(&readfds);
+   FD_ZERO(&writefds);
+
+   for (set<SYSSOCKET>::const_iterator i = desc.m_sLocals.begin(); i != desc.m_sLocals.end(); ++ i)
+   {
+      if (lr)
+         FD_SET(*i, &readfds);
+      if (lw)
+         FD_SET(*i, &writefds);
+   }
+
+   timeval tv;
+   tv.tv_sec = 0;
+   tv.tv_usec = 0;
+   if (select(0, &readfds, &writefds, NULL, &tv) > 0)
+   {
+      for (set<SYSSOCKET>::const_iterator i = desc.m_sLocals.begin(); i != desc.m_sLocals.end(); ++ i)
+      {
+         if (FD_ISSET(*i, &readfds) && sink.room(CEPollSink::SYS_READ))
+         {
+            sink.addSys(CEPollSink::SYS_READ, *i);
+            ++ total;
+         }
+         if (FD_ISSET(*i, &writefds) && sink.room(CEPollSink::SYS_WRITE))
+         {
+            sink.addSys(CEPollSink::SYS_WRITE, *i);
+            ++ total;
+         }
+      }
+   }
+   #endif
+
+   return total;
+}
+
+static void wakeup(CEPollDesc& desc)
+{
+   #ifndef WIN32
+      pthread_cond_broadcast(&desc.m_WaitCond);
+   #else
+      SetEvent(desc.m_WaitCond);
+   #endif
+}
+
 CEPoll::CEPoll():
 m_iIDSeed(0)
 {
@@ -61,6 +269,9 @@ m_iIDSeed(0)
 
 CEPoll::~CEPoll()
 {
+   for (map<int, CEPollDesc>::iterator i = m_mPolls.begin(); i != m_mPolls.end(); ++ i)
+      CGuard::releaseCond(i->second.m_WaitCond);
+
    CGuard::releaseMutex(m_EPollLock);
 }
 
@@ -83,10 +294,14 @@ int CEPoll::create()
    if (++ m_iIDSeed >= 0x7FFFFFFF)
       m_iIDSeed = 0;
 
-   CEPollDesc desc;
+   CEPollDesc& desc = m_mPolls[m_iIDSeed];
    desc.m_iID = m_iIDSeed;
    desc.m_iLocalID = localid;
-   m_mPolls[desc.m_iID] = desc;
+   desc.m_LastWrite = 0;
+   desc.m_LastRead = 0;
+   desc.m_iWaiters = 0;
+   desc.m_bReleased = false;
+   CGuard::createCond(desc.m_WaitCond);
 
    return desc.m_iID;
 }
@@ -95,7 +310,7 @@ int CEPoll::add_usock(const int eid, const UDTSOCKET& u, const int* events)
 {
    CGuard pg(m_EPollLock);
 
-   map<int, CEPollDesc>::iterator p = m_mPolls.find(eid);
+   map<int, CEPollDesc>::iterator p = locate(eid);
    if (p == m_mPolls.end())
       throw CUDTException(5, 13);
 
@@ -104,6 +319,11 @@ int CEPoll::add_usock(const int eid, const UDTSOCKET& u, const int* events)
    if (!events || (*events & UDT_EPOLL_OUT))
       p->second.m_sUDTSocksOut.insert(u);
 
+   if (events && (*events & UDT_EPOLL_ET))
+      p->second.m_sUDTEdges.insert(u);
+   else
+      p->second.m_sUDTEdges.erase(u);
+
    return 0;
 }
 
@@ -111,7 +331,7 @@ int CEPoll::add_ssock(const int eid, const SYSSOCKET& s, const int* events)
 {
    CGuard pg(m_EPollLock);
 
-   map<int, CEPollDesc>::iterator p = m_mPolls.find(eid);
+   map<int, CEPollDesc>::iterator p = locate(eid);
    if (p == m_mPolls.end())
       throw CUDTException(5, 13);
 
@@ -146,12 +366,13 @@ int CEPoll::remove_usock(const int eid, const UDTSOCKET& u)
 {
    CGuard pg(m_EPollLock);
 
-   map<int, CEPollDesc>::iterator p = m_mPolls.find(eid);
+   map<int, CEPollDesc>::iterator p = locate(eid);
    if (p == m_mPolls.end())
       throw CUDTException(5, 13);
 
    p->second.m_sUDTSocksIn.erase(u);
    p->second.m_sUDTSocksOut.erase(u);
+   p->second.m_sUDTEdges.erase(u);
 
    // when the socket is removed from a monitoring, it is not available anymore for any IO notification
    p->second.m_sUDTReads.erase(u);
@@ -164,7 +385,7 @@ int CEPoll::remove_ssock(const int eid, const SYSSOCKET& s)
 {
    CGuard pg(m_EPollLock);
 
-   map<int, CEPollDesc>::iterator p = m_mPolls.find(eid);
+   map<int, CEPollDesc>::iterator p = locate(eid);
    if (p == m_mPolls.end())
       throw CUDTException(5, 13);
 
@@ -181,129 +402,104 @@ int CEPoll::remove_ssock(const int eid, const SYSSOCKET& s)
 
 int CEPoll::wait(const int eid, set<UDTSOCKET>* readfds, set<UDTSOCKET>* writefds, int64_t msTimeOut, set<SYSSOCKET>* lrfds, set<SYSSOCKET>* lwfds)
 {
+   CEPollSetSink sink(readfds, writefds, lrfds, lwfds);
+
+   return wait(eid, sink, msTimeOut);
+}
+
+int CEPoll::wait(const int eid, UDTSOCKET* readfds, int* rnum, UDTSOCKET* writefds, int* wnum, int64_t msTimeOut, SYSSOCKET* lrfds, int* lrnum, SYSSOCKET* lwfds, int* lwnum)
+{
+   CEPollArraySink sink(readfds, rnum, writefds, wnum, lrfds, lrnum, lwfds, lwnum);
+
+   return wait(eid, sink, msTimeOut);
+}
+
+int CEPoll::wait(const int eid, CEPollSink& sink, int64_t msTimeOut)
+{
+   const bool locals = sink.room(CEPollSink::SYS_READ) || sink.room(CEPollSink::SYS_WRITE);
+
    // if all fields is NULL and waiting time is infinite, then this would be a deadlock
-   if (!readfds && !writefds && !lrfds && lwfds && (msTimeOut < 0))
+   if (!sink.room(CEPollSink::UDT_READ) && !sink.room(CEPollSink::UDT_WRITE) && !locals && (msTimeOut < 0))
       throw CUDTException(5, 3, 0);
 
-   // Clear these sets in case the app forget to do it.
-   if (readfds) readfds->clear();
-   if (writefds) writefds->clear();
-   if (lrfds) lrfds->clear();
-   if (lwfds) lwfds->clear();
+   const uint64_t exptime = CTimer::getTime() + msTimeOut * 1000ULL;
 
-   int total = 0;
+   CGuard pg(m_EPollLock);
 
-   int64_t entertime = CTimer::getTime();
    while (true)
    {
-      CGuard::enterCS(m_EPollLock);
-
-      map<int, CEPollDesc>::iterator p = m_mPolls.find(eid);
+      map<int, CEPollDesc>::iterator p = locate(eid);
       if (p == m_mPolls.end())
-      {
-         CGuard::leaveCS(m_EPollLock);
          throw CUDTException(5, 13);
-      }
 
-      if (p->second.m_sUDTSocksIn.empty() && p->second.m_sUDTSocksOut.empty() && p->second.m_sLocals.empty() && (msTimeOut < 0))
+      CEPollDesc& desc = p->second;
+
+      if (desc.m_sUDTSocksIn.empty() && desc.m_sUDTSocksOut.empty() && desc.m_sLocals.empty() && (msTimeOut < 0))
       {
          // no socket is being monitored, this may be a deadlock
-         CGuard::leaveCS(m_EPollLock);
          throw CUDTException(5, 3);
       }
 
-      if ((NULL != readfds) && !p->second.m_sUDTReads.empty())
-      {
-         *readfds = p->second.m_sUDTReads;
-         total += p->second.m_sUDTReads.size();
-      }
+      int total = report(desc.m_sUDTReads, desc.m_LastRead, desc.m_sUDTEdges, sink, CEPollSink::UDT_READ);
+      total += report(desc.m_sUDTWrites, desc.m_LastWrite, desc.m_sUDTEdges, sink, CEPollSink::UDT_WRITE);
 
-      if ((NULL != writefds) && !p->second.m_sUDTWrites.empty())
-      {
-         *writefds = p->second.m_sUDTWrites;
-         total += p->second.m_sUDTWrites.size();
-      }
+      if (locals && !desc.m_sLocals.empty())
+         total += pollLocals(desc, sink);
 
-      if (lrfds || lwfds)
-      {
-         #ifdef LINUX
-         const int max_events = p->second.m_sLocals.size();
-         epoll_event ev[max_events];
-         int nfds = epoll_wait(p->second.m_iLocalID, ev, max_events, 0);
+      if (total > 0)
+         return total;
 
-         for (int i = 0; i < nfds; ++ i)
-         {
-            if ((NULL != lrfds) && (ev[i].events & EPOLLIN))
-           {
-               lrfds->insert(ev[i].data.fd);
-               ++ total;
-            }
-            if ((NULL != lwfds) && (ev[i].events & EPOLLOUT))
-            {
-               lwfds->insert(ev[i].data.fd);
-               ++ total;
-            }
-         }
-         #else
-         //currently "select" is used for all non-Linux platforms.
-         //faster approaches can be applied for specific systems in the future.
+      uint64_t currtime = CTimer::getTime();
+      if ((msTimeOut >= 0) && (currtime >= exptime))
+         return 0;
 
-         //"select" has a limitation on the number of sockets
+      // UDT sockets signal m_WaitCond when they become ready, system sockets do not and are still polled every 10ms
+      uint64_t deadline = (msTimeOut >= 0) ? exptime : 0;
+      if (locals && !desc.m_sLocals.empty() && ((0 == deadline) || (deadline > currtime + 10000)))
+         deadline = currtime + 10000;
 
-         fd_set readfds;
-         fd_set writefds;
-         FD_ZERO(&readfds);
-         FD_ZERO(&writefds);
+      ++ desc.m_iWaiters;
 
-         for (set<SYSSOCKET>::const_iterator i = p->second.m_sLocals.begin(); i != p->second.m_sLocals.end(); ++ i)
+      #ifndef WIN32
+         if (0 == deadline)
+            pthread_cond_wait(&desc.m_WaitCond, &m_EPollLock);
+         else
          {
-            if (lrfds)
-               FD_SET(*i, &readfds);
-            if (lwfds)
-               FD_SET(*i, &writefds);
+            timespec locktime;
+            locktime.tv_sec = deadline / 1000000;
+            locktime.tv_nsec = (deadline % 1000000) * 1000;
+            pthread_cond_timedwait(&desc.m_WaitCond, &m_EPollLock, &locktime);
          }
-
-         timeval tv;
-         tv.tv_sec = 0;
-         tv.tv_usec = 0;
-         if (select(0, &readfds, &writefds, NULL, &tv) > 0)
+      #else
+         // an auto-reset event wakes up one waiter only, so the others check again at least every 10ms
+         if ((0 == deadline) || (deadline > currtime + 10000))
+            deadline = currtime + 10000;
+         ReleaseMutex(m_EPollLock);
+         WaitForSingleObject(desc.m_WaitCond, DWORD((deadline - currtime + 999) / 1000));
+         WaitForSingleObject(m_EPollLock, INFINITE);
+      #endif
+
+      -- desc.m_iWaiters;
+
+      // "desc" is still valid here: a released EPoll is erased by its last waiter
+      if (desc.m_bReleased)
+      {
+         if (0 == desc.m_iWaiters)
          {
-            for (set<SYSSOCKET>::const_iterator i = p->second.m_sLocals.begin(); i != p->second.m_sLocals.end(); ++ i)
-            {
-               if (lrfds && FD_ISSET(*i, &readfds))
-               {
-                  lrfds->insert(*i);
-                  ++ total;
-               }
-               if (lwfds && FD_ISSET(*i, &writefds))
-               {
-                  lwfds->insert(*i);
-                  ++ total;
-               }
-            }
+            CGuard::releaseCond(desc.m_WaitCond);
+            m_mPolls.erase(p);
          }
-         #endif
-      }
-
-      CGuard::leaveCS(m_EPollLock);
 
-      if (total > 0)
-         return total;
-
-      if ((msTimeOut >= 0) && (int64_t(CTimer::getTime() - entertime) >= msTimeOut * 1000LL))
-         break;
-
-      CTimer::waitForEvent();
+         throw CUDTException(5, 13);
+      }
    }
-
-   return 0;
 }
 
 int CEPoll::release(const int eid)
 {
    CGuard pg(m_EPollLock);
 
-   map<int, CEPollDesc>::iterator i = m_mPolls.find(eid);
+   map<int, CEPollDesc>::iterator i = locate(eid);
    if (i == m_mPolls.end())
       throw CUDTException(5, 13);
 
@@ -312,6 +508,15 @@ int CEPoll::release(const int eid)
    ::close(i->second.m_iLocalID);
    #endif
 
+   if (i->second.m_iWaiters > 0)
+   {
+      // wake up the waiters, the last one to leave erases the EPoll
+      i->second.m_bReleased = true;
+      wakeup(i->second);
+      return 0;
+   }
+
+   CGuard::releaseCond(i->second.m_WaitCond);
    m_mPolls.erase(i);
 
    return 0;
@@ -319,96 +524,86 @@ int CEPoll::release(const int eid)
 
 int CEPoll::enable_write(const UDTSOCKET& uid, set<int>& eids)
 {
-   CGuard pg(m_EPollLock);
-
-   map<int, CEPollDesc>::iterator p;
-
-   vector<int> lost;
-   for (set<int>::iterator i = eids.begin(); i != eids.end(); ++ i)
-   {
-      p = m_mPolls.find(*i);
-      if (p == m_mPolls.end())
-      {
-         lost.push_back(*i);
-      }
-      else if (p->second.m_sUDTSocksOut.find(uid) != p->second.m_sUDTSocksOut.end())
-      {
-         p->second.m_sUDTWrites.insert(uid);
-      }
-   }
-
-   for (vector<int>::iterator i = lost.begin(); i != lost.end(); ++ i)
-      eids.erase(*i);
+   enable(uid, eids, true);
 
    return 0;
 }
 
 int CEPoll::enable_read(const UDTSOCKET& uid, set<int>& eids)
 {
-   CGuard pg(m_EPollLock);
+   enable(uid, eids, false);
 
-   map<int, CEPollDesc>::iterator p;
+   return 0;
+}
 
-   vector<int> lost;
-   for (set<int>::iterator i = eids.begin(); i != eids.end(); ++ i)
-   {
-      p = m_mPolls.find(*i);
-      if (p == m_mPolls.end())
-      {
-         lost.push_back(*i);
-      }
-      else if (p->second.m_sUDTSocksIn.find(uid) != p->second.m_sUDTSocksIn.end())
-      {
-         p->second.m_sUDTReads.insert(uid);
-      }
-   }
+int CEPoll::disable_write(const UDTSOCKET& uid, set<int>& eids)
+{
+   disable(uid, eids, true);
 
-   for (vector<int>::iterator i = lost.begin(); i != lost.end(); ++ i)
-      eids.erase(*i);
+   return 0;
+}
+
+int CEPoll::disable_read(const UDTSOCKET& uid, set<int>& eids)
+{
+   disable(uid, eids, false);
 
    return 0;
 }
 
-int CEPoll::disable_write(const UDTSOCKET& uid, set<int>& eids)
+map<int, CEPollDesc>::iterator CEPoll::locate(const int eid)
 {
-   CGuard pg(m_EPollLock);
+   map<int, CEPollDesc>::iterator p = m_mPolls.find(eid);
+   if ((p != m_mPolls.end()) && p->second.m_bReleased)
+      return m_mPolls.end();
+
+   return p;
+}
 
-   map<int, CEPollDesc>::iterator p;
+void CEPoll::enable(const UDTSOCKET& uid, set<int>& eids, const bool& write)
+{
+   CGuard pg(m_EPollLock);
 
    vector<int> lost;
    for (set<int>::iterator i = eids.begin(); i != eids.end(); ++ i)
    {
-      p = m_mPolls.find(*i);
+      map<int, CEPollDesc>::iterator p = locate(*i);
       if (p == m_mPolls.end())
       {
          lost.push_back(*i);
+         continue;
       }
-      else
-      {
-         p->second.m_sUDTWrites.erase(uid);
-      }
+
+      CEPollDesc& desc = p->second;
+      const set<UDTSOCKET>& watched = write ? desc.m_sUDTSocksOut : desc.m_sUDTSocksIn;
+      if (watched.find(uid) == watched.end())
+         continue;
+
+      // waiters only need to know about a socket that was not ready before
+      set<UDTSOCKET>& ready = write ? desc.m_sUDTWrites : desc.m_sUDTReads;
+      if (ready.insert(uid).second && (desc.m_iWaiters > 0))
+         wakeup(desc);
    }
 
    for (vector<int>::iterator i = lost.begin(); i != lost.end(); ++ i)
       eids.erase(*i);
-
-   return 0;
 }
 
-int CEPoll::disable_read(const UDTSOCKET& uid, set<int>& eids)
+void CEPoll::disable(const UDTSOCKET& uid, set<int>& eids, const bool& write)
 {
    CGuard pg(m_EPollLock);
 
-   map<int, CEPollDesc>::iterator p;
-
    vector<int> lost;
    for (set<int>::iterator i = eids.begin(); i != eids.end(); ++ i)
    {
-      p = m_mPolls.find(*i);
+      map<int, CEPollDesc>::iterator p = locate(*i);
       if (p == m_mPolls.end())
       {
          lost.push_back(*i);
       }
+      else if (write)
+      {
+         p->second.m_sUDTWrites.erase(uid);
+      }
       else
       {
          p->second.m_sUDTReads.erase(uid);
@@ -417,6 +612,4 @@ int CEPoll::disable_read(const UDTSOCKET& uid, set<int>& eids)
 
    for (vector<int>::iterator i = lost.begin(); i != lost.end(); ++ i)
       eids.erase(*i);
-
-   return 0;
 }
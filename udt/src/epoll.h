@@ -44,6 +44,7 @@ written by
 
 #include <map>
 #include <set>
+#include "common.h"
 #include "udt.h"
 
 
@@ -58,8 +59,18 @@ struct CEPollDesc
 
    std::set<UDTSOCKET> m_sUDTWrites;         // UDT sockets ready for write
    std::set<UDTSOCKET> m_sUDTReads;          // UDT sockets ready for read
+   std::set<UDTSOCKET> m_sUDTEdges;          // UDT sockets watched in edge-triggered mode (UDT_EPOLL_ET)
+
+   UDTSOCKET m_LastWrite;                    // last socket reported for write, the next wait() starts after it
+   UDTSOCKET m_LastRead;                     // last socket reported for read
+
+   pthread_cond_t m_WaitCond;                // signalled when a watched UDT socket becomes ready
+   int m_iWaiters;                           // number of threads blocked in wait()
+   bool m_bReleased;                         // release() was called while threads were waiting
 };
 
+class CEPollSink;
+
 class CEPoll
 {
 friend class CUDT;
@@ -136,6 +147,24 @@ public: // for CUDTUnited API
 
    int wait(const int eid, std::set<UDTSOCKET>* readfds, std::set<UDTSOCKET>* writefds, int64_t msTimeOut, std::set<SYSSOCKET>* lrfds, std::set<SYSSOCKET>* lwfds);
 
+      // Functionality:
+      //    wait for EPoll events or timeout, storing the ready sockets in arrays supplied by the caller.
+      // Parameters:
+      //    0) [in] eid: EPoll ID.
+      //    1) [out] readfds: UDT sockets available for reading.
+      //    2) [in, out] rnum: size of readfds; number of sockets stored on return.
+      //    3) [out] writefds: UDT sockets available for writing.
+      //    4) [in, out] wnum: size of writefds; number of sockets stored on return.
+      //    5) [in] msTimeOut: timeout threshold, in milliseconds.
+      //    6) [out] lrfds: system file descriptors for reading.
+      //    7) [in, out] lrnum: size of lrfds; number of descriptors stored on return.
+      //    8) [out] lwfds: system file descriptors for writing.
+      //    9) [in, out] lwnum: size of lwfds; number of descriptors stored on return.
+      // Returned value:
+      //    number of sockets stored.
+
+   int wait(const int eid, UDTSOCKET* readfds, int* rnum, UDTSOCKET* writefds, int* wnum, int64_t msTimeOut, SYSSOCKET* lrfds, int* lrnum, SYSSOCKET* lwfds, int* lwnum);
+
       // Functionality:
       //    close and release an EPoll.
       // Parameters:
@@ -187,6 +216,50 @@ public: // for CUDT to acknowledge IO status
 
    int disable_read(const UDTSOCKET& uid, std::set<int>& eids);
 
+private:
+
+      // Functionality:
+      //    find a live EPoll.
+      // Parameters:
+      //    0) [in] eid: EPoll ID.
+      // Returned value:
+      //    the EPoll, or m_mPolls.end() if it does not exist or has been released.
+
+   std::map<int, CEPollDesc>::iterator locate(const int eid);
+
+      // Functionality:
+      //    block until any watched socket is ready or timeout, and report the ready sockets to "sink".
+      // Parameters:
+      //    0) [in] eid: EPoll ID.
+      //    1) [out] sink: receiver of the ready sockets.
+      //    2) [in] msTimeOut: timeout threshold, in milliseconds.
+      // Returned value:
+      //    number of sockets reported.
+
+   int wait(const int eid, CEPollSink& sink, int64_t msTimeOut);
+
+      // Functionality:
+      //    mark a UDT socket ready in each EPoll watching it and wake up their waiters.
+      // Parameters:
+      //    0) [in] uid: UDT socket ID.
+      //    1) [in] eids: EPoll IDs to be set.
+      //    2) [in] write: true for write events, false for read events.
+      // Returned value:
+      //    None.
+
+   void enable(const UDTSOCKET& uid, std::set<int>& eids, const bool& write);
+
+      // Functionality:
+      //    clear the ready status of a UDT socket in each EPoll.
+      // Parameters:
+      //    0) [in] uid: UDT socket ID.
+      //    1) [in] eids: EPoll IDs to be set.
+      //    2) [in] write: true for write events, false for read events.
+      // Returned value:
+      //    None.
+
+   void disable(const UDTSOCKET& uid, std::set<int>& eids, const bool& write);
+
 private:
    int m_iIDSeed;                            // seed to generate a new ID
    pthread_mutex_t m_SeedLock;
@@ -38,332 +38,310 @@ written by
    Yunhong Gu, last updated 01/22/2011
 *****************************************************************************/
 
+#ifdef WIN32
+   #include <intrin.h>
+#endif
+#include <cstring>
 #include "list.h"
 
-CSndLossList::CSndLossList(const int& size):
-m_piData1(NULL),
-m_piData2(NULL),
-m_piNext(NULL),
-m_iHead(-1),
-m_iLength(0),
-m_iSize(size),
-m_iLastInsertPos(-1),
-m_ListLock()
+// bits [from, to) of a word, 0 <= from < to <= 64
+static inline uint64_t bitrange(const int& from, const int& to)
 {
-   m_piData1 = new int32_t [m_iSize];
-   m_piData2 = new int32_t [m_iSize];
-   m_piNext = new int [m_iSize];
-
-   // -1 means there is no data in the node
-   for (int i = 0; i < size; ++ i)
-   {
-      m_piData1[i] = -1;
-      m_piData2[i] = -1;
-   }
+   return ((64 == to) ? ~0ULL : ((1ULL << to) - 1)) & ~((1ULL << from) - 1);
+}
 
-   // sender list needs mutex protection
+// index of the lowest set bit of a word that is not zero
+static inline int lowbit(const uint64_t& word)
+{
    #ifndef WIN32
-      pthread_mutex_init(&m_ListLock, 0);
+      return __builtin_ctzll(word);
    #else
-      m_ListLock = CreateMutex(NULL, false, NULL);
+      unsigned long i;
+      _BitScanForward64(&i, word);
+      return int(i);
    #endif
 }
 
-CSndLossList::~CSndLossList()
+static inline int bitcount(const uint64_t& word)
 {
-   delete [] m_piData1;
-   delete [] m_piData2;
-   delete [] m_piNext;
-
    #ifndef WIN32
-      pthread_mutex_destroy(&m_ListLock);
+      return __builtin_popcountll(word);
    #else
-      CloseHandle(m_ListLock);
+      return int(__popcnt64(word));
    #endif
 }
 
-int CSndLossList::insert(const int32_t& seqno1, const int32_t& seqno2)
+CLossBitmap::CLossBitmap(const int& size):
+m_pullBits(NULL),
+m_pullSummary(NULL),
+m_iCapacity(64),
+m_iWords(0)
 {
-   CGuard listguard(m_ListLock);
+   // the seq. no. space is a power of 2 as well, so the mapping stays continuous when the seq. no. wraps
+   while (m_iCapacity < size)
+      m_iCapacity <<= 1;
 
-   if (0 == m_iLength)
-   {
-      // insert data into an empty list
+   m_iWords = m_iCapacity / 64;
+   m_pullBits = new uint64_t [m_iWords];
+   m_pullSummary = new uint64_t [(m_iWords + 63) / 64];
 
-      m_iHead = 0;
-      m_piData1[m_iHead] = seqno1;
-      if (seqno2 != seqno1)
-         m_piData2[m_iHead] = seqno2;
+   memset(m_pullBits, 0, m_iWords * sizeof(uint64_t));
+   memset(m_pullSummary, 0, (m_iWords + 63) / 64 * sizeof(uint64_t));
+}
 
-      m_piNext[m_iHead] = -1;
-      m_iLastInsertPos = m_iHead;
+CLossBitmap::~CLossBitmap()
+{
+   delete [] m_pullBits;
+   delete [] m_pullSummary;
+}
 
-      m_iLength += CSeqNo::seqlen(seqno1, seqno2);
+int CLossBitmap::set(const int32_t& seqno1, const int32_t& seqno2)
+{
+   int len = CSeqNo::seqlen(seqno1, seqno2);
+   if (len > m_iCapacity)
+      len = m_iCapacity;
 
-      return m_iLength;
-   }
+   int lo = seqno1 & (m_iCapacity - 1);
+   if (lo + len <= m_iCapacity)
+      return setBits(lo, lo + len);
 
-   // otherwise find the position where the data can be inserted
-   int origlen = m_iLength;
-   int offset = CSeqNo::seqoff(m_piData1[m_iHead], seqno1);
-   int loc = (m_iHead + offset + m_iSize) % m_iSize;
+   return setBits(lo, m_iCapacity) + setBits(0, lo + len - m_iCapacity);
+}
 
-   if (offset < 0)
+int CLossBitmap::clear(const int32_t& seqno1, const int32_t& seqno2)
+{
+   if (seqno1 == seqno2)
    {
-      // Insert data prior to the head pointer
+      // a single retransmission or a packet handed out for retransmission, the common case
+      int i = seqno1 & (m_iCapacity - 1);
+      uint64_t bit = 1ULL << (i & 63);
+      if (0 == (m_pullBits[i >> 6] & bit))
+         return 0;
+
+      if (0 == (m_pullBits[i >> 6] &= ~bit))
+         m_pullSummary[i >> 12] &= ~(1ULL << ((i >> 6) & 63));
+      return 1;
+   }
 
-      m_piData1[loc] = seqno1;
-      if (seqno2 != seqno1)
-         m_piData2[loc] = seqno2;
+   int len = CSeqNo::seqlen(seqno1, seqno2);
+   if (len > m_iCapacity)
+      len = m_iCapacity;
 
-      // new node becomes head
-      m_piNext[loc] = m_iHead;
-      m_iHead = loc;
-      m_iLastInsertPos = loc;
+   int lo = seqno1 & (m_iCapacity - 1);
+   if (lo + len <= m_iCapacity)
+      return clearBits(lo, lo + len);
 
-      m_iLength += CSeqNo::seqlen(seqno1, seqno2);
-   }
-   else if (offset > 0)
+   return clearBits(lo, m_iCapacity) + clearBits(0, lo + len - m_iCapacity);
+}
+
+int32_t CLossBitmap::findSet(const int32_t& seqno1, const int32_t& seqno2) const
+{
+   int len = CSeqNo::seqlen(seqno1, seqno2);
+   if (len > m_iCapacity)
+      len = m_iCapacity;
+
+   int lo = seqno1 & (m_iCapacity - 1);
+   int hi = (lo + len <= m_iCapacity) ? lo + len : m_iCapacity;
+
+   // most often the next loss is in the same word
+   uint64_t word = m_pullBits[lo >> 6] & bitrange(lo & 63, 64);
+   if (0 != word)
    {
-      if (seqno1 == m_piData1[loc])
-      {
-         m_iLastInsertPos = loc;
-
-         // first seqno is equivlent, compare the second
-         if (-1 == m_piData2[loc])
-         {
-            if (seqno2 != seqno1)
-            {
-               m_iLength += CSeqNo::seqlen(seqno1, seqno2) - 1;
-               m_piData2[loc] = seqno2;
-            }
-         }
-         else if (CSeqNo::seqcmp(seqno2, m_piData2[loc]) > 0)
-         {
-            // new seq pair is longer than old pair, e.g., insert [3, 7] to [3, 5], becomes [3, 7]
-            m_iLength += CSeqNo::seqlen(m_piData2[loc], seqno2) - 1;
-            m_piData2[loc] = seqno2;
-         }
-         else
-            // Do nothing if it is already there
-            return 0;
-      }
-      else
-      {
-         // searching the prior node
-         int i;
-         if ((-1 != m_iLastInsertPos) && (CSeqNo::seqcmp(m_piData1[m_iLastInsertPos], seqno1) < 0))
-            i = m_iLastInsertPos;
-         else
-            i = m_iHead;
-
-         while ((-1 != m_piNext[i]) && (CSeqNo::seqcmp(m_piData1[m_piNext[i]], seqno1) < 0))
-            i = m_piNext[i];
-
-         if ((-1 == m_piData2[i]) || (CSeqNo::seqcmp(m_piData2[i], seqno1) < 0))
-         {
-            m_iLastInsertPos = loc;
-
-            // no overlap, create new node
-            m_piData1[loc] = seqno1;
-            if (seqno2 != seqno1)
-               m_piData2[loc] = seqno2;
-
-            m_piNext[loc] = m_piNext[i];
-            m_piNext[i] = loc;
-
-            m_iLength += CSeqNo::seqlen(seqno1, seqno2);
-         }
-         else
-         {
-            m_iLastInsertPos = i;
-
-            // overlap, coalesce with prior node, insert(3, 7) to [2, 5], ... becomes [2, 7]
-            if (CSeqNo::seqcmp(m_piData2[i], seqno2) < 0)
-            {
-               m_iLength += CSeqNo::seqlen(m_piData2[i], seqno2) - 1;
-               m_piData2[i] = seqno2;
-
-               loc = i;
-            }
-            else
-               return 0;
-         }
-      }
+      int i = (lo & ~63) + lowbit(word);
+      return (i < hi) ? CSeqNo::incseq(seqno1, i - lo) : -1;
    }
-   else
+
+   int i = findSetBits(lo, hi);
+   if (i >= 0)
+      return CSeqNo::incseq(seqno1, i - lo);
+
+   if ((lo + len > m_iCapacity) && ((i = findSetBits(0, lo + len - m_iCapacity)) >= 0))
+      return CSeqNo::incseq(seqno1, i + m_iCapacity - lo);
+
+   return -1;
+}
+
+int32_t CLossBitmap::findClear(const int32_t& seqno1, const int32_t& seqno2) const
+{
+   int len = CSeqNo::seqlen(seqno1, seqno2);
+   if (len > m_iCapacity)
+      len = m_iCapacity;
+
+   int lo = seqno1 & (m_iCapacity - 1);
+   int hi = (lo + len <= m_iCapacity) ? lo + len : m_iCapacity;
+
+   int i = findClearBits(lo, hi);
+   if (i >= 0)
+      return CSeqNo::incseq(seqno1, i - lo);
+
+   if ((lo + len > m_iCapacity) && ((i = findClearBits(0, lo + len - m_iCapacity)) >= 0))
+      return CSeqNo::incseq(seqno1, i + m_iCapacity - lo);
+
+   return -1;
+}
+
+int CLossBitmap::setBits(int lo, const int& hi)
+{
+   int count = 0;
+
+   while (lo < hi)
    {
-      m_iLastInsertPos = m_iHead;
+      int w = lo >> 6;
+      int end = ((w + 1) << 6 < hi) ? (w + 1) << 6 : hi;
+      uint64_t mask = bitrange(lo & 63, end - (w << 6));
 
-      // insert to head node
-      if (seqno2 != seqno1)
-      {
-         if (-1 == m_piData2[loc])
-         {
-            m_iLength += CSeqNo::seqlen(seqno1, seqno2) - 1;
-            m_piData2[loc] = seqno2;
-         }
-         else if (CSeqNo::seqcmp(seqno2, m_piData2[loc]) > 0)
-         {
-            m_iLength += CSeqNo::seqlen(m_piData2[loc], seqno2) - 1;
-            m_piData2[loc] = seqno2;
-         }
-         else 
-            return 0;
-      }
-      else
-         return 0;
+      count += bitcount(mask & ~m_pullBits[w]);
+      m_pullBits[w] |= mask;
+      m_pullSummary[w >> 6] |= 1ULL << (w & 63);
+
+      lo = end;
    }
 
-   // coalesce with next node. E.g., [3, 7], ..., [6, 9] becomes [3, 9] 
-   while ((-1 != m_piNext[loc]) && (-1 != m_piData2[loc]))
+   return count;
+}
+
+int CLossBitmap::clearBits(int lo, const int& hi)
+{
+   int count = 0;
+
+   while (lo < hi)
    {
-      int i = m_piNext[loc];
+      int w = lo >> 6;
+      int end = ((w + 1) << 6 < hi) ? (w + 1) << 6 : hi;
+      uint64_t mask = bitrange(lo & 63, end - (w << 6));
 
-      if (CSeqNo::seqcmp(m_piData1[i], CSeqNo::incseq(m_piData2[loc])) <= 0)
-      {
-         // coalesce if there is overlap
-         if (-1 != m_piData2[i])
-         {
-            if (CSeqNo::seqcmp(m_piData2[i], m_piData2[loc]) > 0)
-            {
-               if (CSeqNo::seqcmp(m_piData2[loc], m_piData1[i]) >= 0)
-                  m_iLength -= CSeqNo::seqlen(m_piData1[i], m_piData2[loc]);
-
-               m_piData2[loc] = m_piData2[i];
-            }
-            else
-               m_iLength -= CSeqNo::seqlen(m_piData1[i], m_piData2[i]);
-         }
-         else
-         {
-            if (m_piData1[i] == CSeqNo::incseq(m_piData2[loc]))
-               m_piData2[loc] = m_piData1[i];
-            else
-               m_iLength --;
-         }
-
-         m_piData1[i] = -1;
-         m_piData2[i] = -1;
-         m_piNext[loc] = m_piNext[i];
-      }
-      else
-         break;
+      count += bitcount(mask & m_pullBits[w]);
+      m_pullBits[w] &= ~mask;
+      if (0 == m_pullBits[w])
+         m_pullSummary[w >> 6] &= ~(1ULL << (w & 63));
+
+      lo = end;
    }
 
-   return m_iLength - origlen;
+   return count;
 }
 
-void CSndLossList::remove(const int32_t& seqno)
+int CLossBitmap::findSetBits(const int& lo, const int& hi) const
 {
-   CGuard listguard(m_ListLock);
-
-   if (0 == m_iLength)
-      return;
+   if (lo >= hi)
+      return -1;
 
-   // Remove all from the head pointer to a node with a larger seq. no. or the list is empty
-   int offset = CSeqNo::seqoff(m_piData1[m_iHead], seqno);
-   int loc = (m_iHead + offset + m_iSize) % m_iSize;
+   int w = lo >> 6;
+   uint64_t word = m_pullBits[w] & bitrange(lo & 63, 64);
 
-   if (0 == offset)
+   while (0 == word)
    {
-      // It is the head. Remove the head and point to the next node
-      loc = (loc + 1) % m_iSize;
+      // skip the empty words with the summary, 4096 seq. no. per summary word
+      if ((++ w << 6) >= hi)
+         return -1;
 
-      if (-1 == m_piData2[m_iHead])
-         loc = m_piNext[m_iHead];
-      else
+      int s = w >> 6;
+      uint64_t summary = m_pullSummary[s] & bitrange(w & 63, 64);
+      while (0 == summary)
       {
-         m_piData1[loc] = CSeqNo::incseq(seqno);
-         if (CSeqNo::seqcmp(m_piData2[m_iHead], CSeqNo::incseq(seqno)) > 0)
-            m_piData2[loc] = m_piData2[m_iHead];
+         if ((++ s << 12) >= hi)
+            return -1;
+         summary = m_pullSummary[s];
+      }
+
+      w = (s << 6) + lowbit(summary);
+      if ((w << 6) >= hi)
+         return -1;
+      word = m_pullBits[w];
+   }
 
-         m_piData2[m_iHead] = -1;
+   int i = (w << 6) + lowbit(word);
+   return (i < hi) ? i : -1;
+}
 
-         m_piNext[loc] = m_piNext[m_iHead];
+int CLossBitmap::findClearBits(const int& lo, const int& hi) const
+{
+   // a run of marked seq. no. is scanned word by word; it is reported or removed right after
+   for (int w = lo >> 6; (w << 6) < hi; ++ w)
+   {
+      uint64_t word = ~m_pullBits[w];
+      if (w == (lo >> 6))
+         word &= bitrange(lo & 63, 64);
+
+      if (0 != word)
+      {
+         int i = (w << 6) + lowbit(word);
+         return (i < hi) ? i : -1;
       }
+   }
 
-      m_piData1[m_iHead] = -1;
+   return -1;
+}
 
-      if (m_iLastInsertPos == m_iHead)
-         m_iLastInsertPos = -1;
+////////////////////////////////////////////////////////////////////////////////
 
-      m_iHead = loc;
+CSndLossList::CSndLossList(const int& size):
+m_Bitmap(size),
+m_iFirst(-1),
+m_iLast(-1),
+m_iLength(0),
+m_ListLock()
+{
+   // sender list needs mutex protection
+   #ifndef WIN32
+      pthread_mutex_init(&m_ListLock, 0);
+   #else
+      m_ListLock = CreateMutex(NULL, false, NULL);
+   #endif
+}
 
-      m_iLength --;
+CSndLossList::~CSndLossList()
+{
+   #ifndef WIN32
+      pthread_mutex_destroy(&m_ListLock);
+   #else
+      CloseHandle(m_ListLock);
+   #endif
+}
+
+int CSndLossList::insert(const int32_t& seqno1, const int32_t& seqno2)
+{
+   CGuard listguard(m_ListLock);
+
+   if (0 == m_iLength)
+   {
+      m_iFirst = seqno1;
+      m_iLast = seqno2;
    }
-   else if (offset > 0)
+   else
    {
-      int h = m_iHead;
+      if (CSeqNo::seqcmp(seqno1, m_iFirst) < 0)
+         m_iFirst = seqno1;
+      if (CSeqNo::seqcmp(seqno2, m_iLast) > 0)
+         m_iLast = seqno2;
+   }
 
-      if (seqno == m_piData1[loc])
-      {
-         // target node is not empty, remove part/all of the seqno in the node.
-         int temp = loc;
-         loc = (loc + 1) % m_iSize;
-
-         if (-1 == m_piData2[temp])
-            m_iHead = m_piNext[temp];
-         else
-         {
-            // remove part, e.g., [3, 7] becomes [], [4, 7] after remove(3)
-            m_piData1[loc] = CSeqNo::incseq(seqno);
-            if (CSeqNo::seqcmp(m_piData2[temp], m_piData1[loc]) > 0)
-               m_piData2[loc] = m_piData2[temp];
-            m_iHead = loc;
-            m_piNext[loc] = m_piNext[temp];
-            m_piNext[temp] = loc;
-            m_piData2[temp] = -1;
-         }
-      }
-      else
-      {
-         // target node is empty, check prior node
-         int i = m_iHead;
-         while ((-1 != m_piNext[i]) && (CSeqNo::seqcmp(m_piData1[m_piNext[i]], seqno) < 0))
-            i = m_piNext[i];
-
-         loc = (loc + 1) % m_iSize;
-
-         if (-1 == m_piData2[i])
-            m_iHead = m_piNext[i];
-         else if (CSeqNo::seqcmp(m_piData2[i], seqno) > 0)
-         {
-            // remove part/all seqno in the prior node
-            m_piData1[loc] = CSeqNo::incseq(seqno);
-            if (CSeqNo::seqcmp(m_piData2[i], m_piData1[loc]) > 0)
-               m_piData2[loc] = m_piData2[i];
-
-            m_piData2[i] = seqno;
-
-            m_piNext[loc] = m_piNext[i];
-            m_piNext[i] = loc;
-
-            m_iHead = loc;
-         }
-         else
-            m_iHead = m_piNext[i];
-      }
+   int num = m_Bitmap.set(seqno1, seqno2);
+   m_iLength += num;
 
-      // Remove all nodes prior to the new head
-      while (h != m_iHead)
-      {
-         if (m_piData2[h] != -1)
-         {
-            m_iLength -= CSeqNo::seqlen(m_piData1[h], m_piData2[h]);
-            m_piData2[h] = -1;
-         }
-         else
-            m_iLength --;
+   return num;
+}
 
-         m_piData1[h] = -1;
+void CSndLossList::remove(const int32_t& seqno)
+{
+   CGuard listguard(m_ListLock);
 
-         if (m_iLastInsertPos == h)
-            m_iLastInsertPos = -1;
+   if ((0 == m_iLength) || (CSeqNo::seqcmp(seqno, m_iFirst) < 0))
+      return;
 
-         h = m_piNext[h];
-      }
+   if (CSeqNo::seqcmp(seqno, m_iLast) >= 0)
+   {
+      // everything is acknowledged
+      m_Bitmap.clear(m_iFirst, m_iLast);
+      m_iLength = 0;
+      return;
    }
+
+   m_iLength -= m_Bitmap.clear(m_iFirst, seqno);
+
+   // the last seq. no. is only removed with all the others, so a new head always exists
+   if (m_iLength > 0)
+      m_iFirst = m_Bitmap.findSet(CSeqNo::incseq(seqno), m_iLast);
 }
 
 int CSndLossList::getLossLength()
@@ -383,71 +361,30 @@ int32_t CSndLossList::getLostSeq()
    if (0 == m_iLength)
      return -1;
 
-   if (m_iLastInsertPos == m_iHead)
-      m_iLastInsertPos = -1;
-
-   // return the first loss seq. no.
-   int32_t seqno = m_piData1[m_iHead];
-
-   // head moves to the next node
-   if (-1 == m_piData2[m_iHead])
-   {
-      //[3, -1] becomes [], and head moves to next node in the list
-      m_piData1[m_iHead] = -1;
-      m_iHead = m_piNext[m_iHead];
-   }
-   else
-   {
-      // shift to next node, e.g., [3, 7] becomes [], [4, 7]
-      int loc = (m_iHead + 1) % m_iSize;
-
-      m_piData1[loc] = CSeqNo::incseq(seqno);
-      if (CSeqNo::seqcmp(m_piData2[m_iHead], m_piData1[loc]) > 0)
-         m_piData2[loc] = m_piData2[m_iHead];
-
-      m_piData1[m_iHead] = -1;
-      m_piData2[m_iHead] = -1;
-
-      m_piNext[loc] = m_piNext[m_iHead];
-      m_iHead = loc;
-   }
+   // return the first loss seq. no. and move the head to the next one
+   int32_t seqno = m_iFirst;
 
+   m_Bitmap.clear(seqno, seqno);
    m_iLength --;
 
+   if (m_iLength > 0)
+      m_iFirst = m_Bitmap.findSet(CSeqNo::incseq(seqno), m_iLast);
+
    return seqno;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 
 CRcvLossList::CRcvLossList(const int& size):
-m_piData1(NULL),
-m_piData2(NULL),
-m_piNext(NULL),
-m_piPrior(NULL),
-m_iHead(-1),
-m_iTail(-1),
-m_iLength(0),
-m_iSize(size)
+m_Bitmap(size),
+m_iFirst(-1),
+m_iLast(-1),
+m_iLength(0)
 {
-   m_piData1 = new int32_t [m_iSize];
-   m_piData2 = new int32_t [m_iSize];
-   m_piNext = new int [m_iSize];
-   m_piPrior = new int [m_iSize];
-
-   // -1 means there is no data in the node
-   for (int i = 0; i < size; ++ i)
-   {
-      m_piData1[i] = -1;
-      m_piData2[i] = -1;
-   }
 }
 
 CRcvLossList::~CRcvLossList()
 {
-   delete [] m_piData1;
-   delete [] m_piData2;
-   delete [] m_piNext;
-   delete [] m_piPrior;
 }
 
 void CRcvLossList::insert(const int32_t& seqno1, const int32_t& seqno2)
@@ -456,192 +393,43 @@ void CRcvLossList::insert(const int32_t& seqno1, const int32_t& seqno2)
    // guaranteed by the UDT receiver
 
    if (0 == m_iLength)
-   {
-      // insert data into an empty list
-      m_iHead = 0;
-      m_iTail = 0;
-      m_piData1[m_iHead] = seqno1;
-      if (seqno2 != seqno1)
-         m_piData2[m_iHead] = seqno2;
-
-      m_piNext[m_iHead] = -1;
-      m_piPrior[m_iHead] = -1;
-      m_iLength += CSeqNo::seqlen(seqno1, seqno2);
-
-      return;
-   }
-
-   // otherwise searching for the position where the node should be
-   int offset = CSeqNo::seqoff(m_piData1[m_iHead], seqno1);
-   int loc = (m_iHead + offset) % m_iSize;
-
-   if ((-1 != m_piData2[m_iTail]) && (CSeqNo::incseq(m_piData2[m_iTail]) == seqno1))
-   {
-      // coalesce with prior node, e.g., [2, 5], [6, 7] becomes [2, 7]
-      loc = m_iTail;
-      m_piData2[loc] = seqno2;
-   }
-   else
-   {
-      // create new node
-      m_piData1[loc] = seqno1;
-
-      if (seqno2 != seqno1)
-         m_piData2[loc] = seqno2;
+      m_iFirst = seqno1;
+   m_iLast = seqno2;
 
-      m_piNext[m_iTail] = loc;
-      m_piPrior[loc] = m_iTail;
-      m_piNext[loc] = -1;
-      m_iTail = loc;
-   }
-
-   m_iLength += CSeqNo::seqlen(seqno1, seqno2);
+   m_iLength += m_Bitmap.set(seqno1, seqno2);
 }
 
 bool CRcvLossList::remove(const int32_t& seqno)
 {
-   if (0 == m_iLength)
-      return false; 
-
-   // locate the position of "seqno" in the list
-   int offset = CSeqNo::seqoff(m_piData1[m_iHead], seqno);
-   if (offset < 0)
+   if ((0 == m_iLength) || (CSeqNo::seqcmp(seqno, m_iFirst) < 0) || (CSeqNo::seqcmp(seqno, m_iLast) > 0))
       return false;
 
-   int loc = (m_iHead + offset) % m_iSize;
-
-   if (seqno == m_piData1[loc])
-   {
-      // This is a seq. no. that starts the loss sequence
-
-      if (-1 == m_piData2[loc])
-      {
-         // there is only 1 loss in the sequence, delete it from the node
-         if (m_iHead == loc)
-         {
-            m_iHead = m_piNext[m_iHead];
-            if (-1 != m_iHead)
-               m_piPrior[m_iHead] = -1;
-         }
-         else
-         {
-            m_piNext[m_piPrior[loc]] = m_piNext[loc];
-            if (-1 != m_piNext[loc])
-               m_piPrior[m_piNext[loc]] = m_piPrior[loc];
-            else
-               m_iTail = m_piPrior[loc];
-         }
-
-         m_piData1[loc] = -1;
-      }
-      else
-      {
-         // there are more than 1 loss in the sequence
-         // move the node to the next and update the starter as the next loss inSeqNo(seqno)
-
-         // find next node
-         int i = (loc + 1) % m_iSize;
-
-         // remove the "seqno" and change the starter as next seq. no.
-         m_piData1[i] = CSeqNo::incseq(m_piData1[loc]);
-
-         // process the sequence end
-         if (CSeqNo::seqcmp(m_piData2[loc], CSeqNo::incseq(m_piData1[loc])) > 0)
-            m_piData2[i] = m_piData2[loc];
-
-         // remove the current node
-         m_piData1[loc] = -1;
-         m_piData2[loc] = -1;
- 
-         // update list pointer
-         m_piNext[i] = m_piNext[loc];
-         m_piPrior[i] = m_piPrior[loc];
-
-         if (m_iHead == loc)
-            m_iHead = i;
-         else
-            m_piNext[m_piPrior[i]] = i;
-
-         if (m_iTail == loc)
-            m_iTail = i;
-         else
-            m_piPrior[m_piNext[i]] = i;
-      }
-
-      m_iLength --;
-
-      return true;
-   }
-
-   // There is no loss sequence in the current position
-   // the "seqno" may be contained in a previous node
-
-   // searching previous node
-   int i = (loc - 1 + m_iSize) % m_iSize;
-   while (-1 == m_piData1[i])
-      i = (i - 1 + m_iSize) % m_iSize;
-
-   // not contained in this node, return
-   if ((-1 == m_piData2[i]) || (CSeqNo::seqcmp(seqno, m_piData2[i]) > 0))
-       return false;
-
-   if (seqno == m_piData2[i])
-   {
-      // it is the sequence end
-
-      if (seqno == CSeqNo::incseq(m_piData1[i]))
-         m_piData2[i] = -1;
-      else
-         m_piData2[i] = CSeqNo::decseq(seqno);
-   }
-   else
-   {
-      // split the sequence
-
-      // construct the second sequence from CSeqNo::incseq(seqno) to the original sequence end
-      // located at "loc + 1"
-      loc = (loc + 1) % m_iSize;
-
-      m_piData1[loc] = CSeqNo::incseq(seqno);
-      if (CSeqNo::seqcmp(m_piData2[i], m_piData1[loc]) > 0)      
-         m_piData2[loc] = m_piData2[i];
-
-      // the first (original) sequence is between the original sequence start to CSeqNo::decseq(seqno)
-      if (seqno == CSeqNo::incseq(m_piData1[i]))
-         m_piData2[i] = -1;
-      else
-         m_piData2[i] = CSeqNo::decseq(seqno);
-
-      // update the list pointer
-      m_piNext[loc] = m_piNext[i];
-      m_piNext[i] = loc;
-      m_piPrior[loc] = i;
-
-      if (m_iTail == i)
-         m_iTail = loc;
-      else
-         m_piPrior[m_piNext[loc]] = loc;
-   }
+   if (0 == m_Bitmap.clear(seqno, seqno))
+      return false;
 
    m_iLength --;
 
+   if ((seqno == m_iFirst) && (m_iLength > 0))
+      m_iFirst = m_Bitmap.findSet(CSeqNo::incseq(seqno), m_iLast);
+
    return true;
 }
 
 bool CRcvLossList::remove(const int32_t& seqno1, const int32_t& seqno2)
 {
-   if (seqno1 <= seqno2)
-   {
-      for (int32_t i = seqno1; i <= seqno2; ++ i)
-         remove(i);
-   }
-   else
-   {
-      for (int32_t j = seqno1; j < CSeqNo::m_iMaxSeqNo; ++ j)
-         remove(j);
-      for (int32_t k = 0; k <= seqno2; ++ k)
-         remove(k);
-   }
+   if (0 == m_iLength)
+      return true;
+
+   // only the part that overlaps the list
+   int32_t lo = (CSeqNo::seqcmp(seqno1, m_iFirst) > 0) ? seqno1 : m_iFirst;
+   int32_t hi = (CSeqNo::seqcmp(seqno2, m_iLast) < 0) ? seqno2 : m_iLast;
+   if (CSeqNo::seqcmp(lo, hi) > 0)
+      return true;
+
+   m_iLength -= m_Bitmap.clear(lo, hi);
+
+   if ((lo == m_iFirst) && (m_iLength > 0))
+      m_iFirst = m_Bitmap.findSet(CSeqNo::incseq(hi), m_iLast);
 
    return true;
 }
@@ -651,19 +439,12 @@ bool CRcvLossList::find(const int32_t& seqno1, const int32_t& seqno2) const
    if (0 == m_iLength)
       return false;
 
-   int p = m_iHead;
-
-   while (-1 != p)
-   {
-      if ((CSeqNo::seqcmp(m_piData1[p], seqno1) == 0) ||
-          ((CSeqNo::seqcmp(m_piData1[p], seqno1) > 0) && (CSeqNo::seqcmp(m_piData1[p], seqno2) <= 0)) ||
-          ((CSeqNo::seqcmp(m_piData1[p], seqno1) < 0) && (m_piData2[p] != -1) && CSeqNo::seqcmp(m_piData2[p], seqno1) >= 0))
-          return true;
-
-      p = m_piNext[p];
-   }
+   int32_t lo = (CSeqNo::seqcmp(seqno1, m_iFirst) > 0) ? seqno1 : m_iFirst;
+   int32_t hi = (CSeqNo::seqcmp(seqno2, m_iLast) < 0) ? seqno2 : m_iLast;
+   if (CSeqNo::seqcmp(lo, hi) > 0)
+      return false;
 
-   return false;
+   return -1 != m_Bitmap.findSet(lo, hi);
 }
 
 int CRcvLossList::getLossLength() const
@@ -676,28 +457,38 @@ int CRcvLossList::getFirstLostSeq() const
    if (0 == m_iLength)
       return -1;
 
-   return m_piData1[m_iHead];
+   return m_iFirst;
 }
 
 void CRcvLossList::getLossArray(int32_t* array, int& len, const int& limit)
 {
    len = 0;
 
-   int i = m_iHead;
+   if (0 == m_iLength)
+      return;
+
+   int32_t seqno = m_iFirst;
 
-   while ((len < limit - 1) && (-1 != i))
+   while ((len < limit - 1) && (-1 != seqno))
    {
-      array[len] = m_piData1[i];
-      if (-1 != m_piData2[i])
+      // the run of lost seq. no. ends before the first one that is not lost
+      int32_t end = m_Bitmap.findClear(seqno, m_iLast);
+      end = (-1 == end) ? m_iLast : CSeqNo::decseq(end);
+
+      array[len] = seqno;
+      if (end != seqno)
       {
          // there are more than 1 loss in the sequence
          array[len] |= 0x80000000;
          ++ len;
-         array[len] = m_piData2[i];
+         array[len] = end;
       }
 
       ++ len;
 
-      i = m_piNext[i];
+      if (end == m_iLast)
+         break;
+
+      seqno = m_Bitmap.findSet(CSeqNo::incseq(end), m_iLast);
    }
 }
@@ -46,6 +46,71 @@ written by
 #include "common.h"
 
 
+class CLossBitmap
+{
+public:
+   CLossBitmap(const int& size);
+   ~CLossBitmap();
+
+      // Functionality:
+      //    Mark the seq. no. from seqno1 to seqno2 as lost.
+      // Parameters:
+      //    0) [in] seqno1: sequence number starts.
+      //    1) [in] seqno2: sequence number ends.
+      // Returned value:
+      //    number of seq. no. that were not marked before.
+
+   int set(const int32_t& seqno1, const int32_t& seqno2);
+
+      // Functionality:
+      //    Unmark the seq. no. from seqno1 to seqno2.
+      // Parameters:
+      //    0) [in] seqno1: sequence number starts.
+      //    1) [in] seqno2: sequence number ends.
+      // Returned value:
+      //    number of seq. no. that were marked before.
+
+   int clear(const int32_t& seqno1, const int32_t& seqno2);
+
+      // Functionality:
+      //    Find the first marked seq. no. from seqno1 to seqno2.
+      // Parameters:
+      //    0) [in] seqno1: sequence number starts.
+      //    1) [in] seqno2: sequence number ends.
+      // Returned value:
+      //    The seq. no. or -1 if none is marked.
+
+   int32_t findSet(const int32_t& seqno1, const int32_t& seqno2) const;
+
+      // Functionality:
+      //    Find the first seq. no. from seqno1 to seqno2 that is not marked.
+      // Parameters:
+      //    0) [in] seqno1: sequence number starts.
+      //    1) [in] seqno2: sequence number ends.
+      // Returned value:
+      //    The seq. no. or -1 if all are marked.
+
+   int32_t findClear(const int32_t& seqno1, const int32_t& seqno2) const;
+
+private:
+   int setBits(int lo, const int& hi);
+   int clearBits(int lo, const int& hi);
+   int findSetBits(const int& lo, const int& hi) const;
+   int findClearBits(const int& lo, const int& hi) const;
+
+private:
+   uint64_t* m_pullBits;                // one bit per seq. no., indexed by the seq. no. modulo the capacity
+   uint64_t* m_pullSummary;             // one bit per word of m_pullBits that is not zero
+   int m_iCapacity;                     // number of bits, a power of 2 not less than the size
+   int m_iWords;                        // number of words in m_pullBits
+
+private:
+   CLossBitmap(const CLossBitmap&);
+   CLossBitmap& operator=(const CLossBitmap&);
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
 class CSndLossList
 {
 public:
@@ -90,14 +155,11 @@ public:
    int32_t getLostSeq();
 
 private:
-   int32_t* m_piData1;                  // sequence number starts
-   int32_t* m_piData2;                  // seqnence number ends
-   int* m_piNext;                       // next node in the list
+   CLossBitmap m_Bitmap;                // lost seq. no.
 
-   int m_iHead;                         // first node
+   int32_t m_iFirst;                    // first (smallest) seq. no. in the list
+   int32_t m_iLast;                     // last (largest) seq. no. in the list
    int m_iLength;                       // loss length
-   int m_iSize;                         // size of the static array
-   int m_iLastInsertPos;                // position of last insert node
 
    pthread_mutex_t m_ListLock;          // used to synchronize list operation
 
@@ -183,15 +245,11 @@ public:
    void getLossArray(int32_t* array, int& len, const int& limit);
 
 private:
-   int32_t* m_piData1;                  // sequence number starts
-   int32_t* m_piData2;                  // sequence number ends
-   int* m_piNext;                       // next node in the list
-   int* m_piPrior;                      // prior node in the list;
+   CLossBitmap m_Bitmap;                // lost seq. no.
 
-   int m_iHead;                         // first node in the list
-   int m_iTail;                         // last node in the list;
+   int32_t m_iFirst;                    // first (smallest) seq. no. in the list
+   int32_t m_iLast;                     // no seq. no. in the list is larger than this
    int m_iLength;                       // loss length
-   int m_iSize;                         // size of the static array
 
 private:
    CRcvLossList(const CRcvLossList&);
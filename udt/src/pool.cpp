@@ -0,0 +1,301 @@
+/*****************************************************************************
+Copyright (c) 2001 - 2011, The Board of Trustees of the University of Illinois.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+
+* Redistributions of source code must retain the above
+  copyright notice, this list of conditions and the
+  following disclaimer.
+
+* Redistributions in binary form must reproduce the
+  above copyright notice, this list of conditions
+  and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the University of Illinois
+  nor the names of its contributors may be used to
+  endorse or promote products derived from this
+  software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*****************************************************************************/
+
+#ifndef WIN32
+   #include <unistd.h>
+   #include <sys/mman.h>
+   #include <sys/syscall.h>
+   #include <cstdio>
+#endif
+#include <cstdlib>
+#include <cstring>
+#include "pool.h"
+
+using namespace std;
+
+const int CMemPool::m_iArenaSize;
+const int CMemPool::m_iMaxNodes;
+const int CMemPool::m_iIdleTime;
+
+CMemPool::CMemPool():
+m_iNodes(1),
+m_bHugeTLB(true),
+m_StatLock(),
+m_llReserved(0),
+m_llUsed(0),
+m_llBudget(0)
+{
+   for (int i = 0; i < m_iMaxNodes; ++ i)
+   {
+      CGuard::createMutex(m_Nodes[i].m_Lock);
+      m_Nodes[i].m_pArena = NULL;
+      m_Nodes[i].m_iArenaUsed = m_iArenaSize;
+   }
+   CGuard::createMutex(m_StatLock);
+
+   #ifdef LINUX
+      // a list of ranges such as "0", "0-3" or "0,2,4-5"; nodes may be sparse, so take the highest one
+      FILE* f = fopen("/sys/devices/system/node/online", "r");
+      if (NULL != f)
+      {
+         char line[256] = "";
+         if (NULL != fgets(line, sizeof(line), f))
+         {
+            long highest = 0;
+            const char* p = line;
+            while (true)
+            {
+               char* end;
+               long node = strtol(p, &end, 10);
+               if (end == p)
+                  break;
+               if (node > highest)
+                  highest = node;
+               if (('-' != *end) && (',' != *end))
+                  break;
+               p = end + 1;
+            }
+            m_iNodes = int(highest) + 1;
+         }
+         fclose(f);
+      }
+   #endif
+}
+
+CMemPool& CMemPool::instance()
+{
+   // never destroyed: sockets may still release their buffers while static objects are destructed at exit
+   static CMemPool* pool = new CMemPool;
+   return *pool;
+}
+
+int CMemPool::getNode()
+{
+   #if defined(LINUX) && defined(SYS_getcpu)
+      unsigned cpu = 0;
+      unsigned node = 0;
+      if (0 == syscall(SYS_getcpu, &cpu, &node, NULL))
+         return node;
+   #endif
+
+   return 0;
+}
+
+char* CMemPool::allocate(const int& size, int& node)
+{
+   CMemPool& self = instance();
+
+   if (node < 0)
+      node = (self.m_iNodes > 1) ? getNode() : 0;
+   if (node >= m_iMaxNodes)
+      node = m_iMaxNodes - 1;
+
+   // slabs start on a cache line
+   int slabsize = (size + 63) & ~63;
+
+   CNodePool& np = self.m_Nodes[node];
+   char* slab = NULL;
+
+   CGuard::enterCS(np.m_Lock);
+
+   map<int, vector<char*> >::iterator i = np.m_mFree.find(slabsize);
+   if ((i != np.m_mFree.end()) && !i->second.empty())
+   {
+      slab = i->second.back();
+      i->second.pop_back();
+   }
+   else if (slabsize > m_iArenaSize / 2)
+   {
+      // large slabs get their own mapping, rounded up to whole huge pages
+      slab = self.mapArena((slabsize + m_iArenaSize - 1) & ~(m_iArenaSize - 1), node);
+   }
+   else
+   {
+      // the rest of the current arena is left unused if the slab does not fit
+      if (np.m_iArenaUsed + slabsize > m_iArenaSize)
+      {
+         char* arena = self.mapArena(m_iArenaSize, node);
+         if (NULL != arena)
+         {
+            np.m_pArena = arena;
+            np.m_iArenaUsed = 0;
+         }
+      }
+
+      if (np.m_iArenaUsed + slabsize <= m_iArenaSize)
+      {
+         slab = np.m_pArena + np.m_iArenaUsed;
+         np.m_iArenaUsed += slabsize;
+      }
+   }
+
+   CGuard::leaveCS(np.m_Lock);
+
+   if (NULL != slab)
+   {
+      CGuard sg(self.m_StatLock);
+      self.m_llUsed += slabsize;
+   }
+
+   return slab;
+}
+
+void CMemPool::release(char* slab, const int& size, const int& node, const bool& discard)
+{
+   if (NULL == slab)
+      return;
+
+   CMemPool& self = instance();
+   int slabsize = (size + 63) & ~63;
+
+   #if !defined(WIN32) && defined(MADV_DONTNEED)
+      if (discard)
+      {
+         // only the pages entirely inside the slab, the others are shared with its neighbours
+         uintptr_t pagesize = sysconf(_SC_PAGESIZE);
+         uintptr_t begin = ((uintptr_t)slab + pagesize - 1) & ~(pagesize - 1);
+         uintptr_t end = ((uintptr_t)slab + slabsize) & ~(pagesize - 1);
+         if (end > begin)
+            madvise((void*)begin, end - begin, MADV_DONTNEED);
+      }
+   #endif
+
+   CNodePool& np = self.m_Nodes[(node < m_iMaxNodes) ? node : m_iMaxNodes - 1];
+
+   CGuard::enterCS(np.m_Lock);
+   np.m_mFree[slabsize].push_back(slab);
+   CGuard::leaveCS(np.m_Lock);
+
+   CGuard sg(self.m_StatLock);
+   self.m_llUsed -= slabsize;
+}
+
+void CMemPool::getStats(int64_t& reserved, int64_t& used)
+{
+   CMemPool& self = instance();
+
+   CGuard sg(self.m_StatLock);
+   reserved = self.m_llReserved;
+   used = self.m_llUsed;
+}
+
+void CMemPool::setBudget(const int64_t& budget)
+{
+   CMemPool& self = instance();
+
+   CGuard sg(self.m_StatLock);
+   self.m_llBudget = (budget > 0) ? budget : 0;
+}
+
+int64_t CMemPool::getBudget()
+{
+   CMemPool& self = instance();
+
+   CGuard sg(self.m_StatLock);
+   return self.m_llBudget;
+}
+
+int64_t CMemPool::getHeadroom()
+{
+   CMemPool& self = instance();
+
+   // read without the lock first, the budget is rarely set
+   if (0 == self.m_llBudget)
+      return -1;
+
+   CGuard sg(self.m_StatLock);
+   return (self.m_llUsed < self.m_llBudget) ? self.m_llBudget - self.m_llUsed : 0;
+}
+
+char* CMemPool::mapArena(const int& size, const int& node)
+{
+   char* p = NULL;
+
+   #ifndef WIN32
+      #ifdef MAP_HUGETLB
+         // huge pages reserved by the administrator (vm.nr_hugepages), tried until the first failure
+         if (m_bHugeTLB)
+         {
+            void* h = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            if (MAP_FAILED != h)
+               p = (char*)h;
+            else
+               m_bHugeTLB = false;
+         }
+      #endif
+
+      if (NULL == p)
+      {
+         // transparent huge pages need a range aligned on the huge page size
+         void* m = mmap(NULL, size + m_iArenaSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+         if (MAP_FAILED == m)
+            return NULL;
+
+         char* base = (char*)m;
+         p = (char*)(((uintptr_t)base + m_iArenaSize - 1) & ~(uintptr_t)(m_iArenaSize - 1));
+         if (p > base)
+            munmap(base, p - base);
+         munmap(p + size, (base + size + m_iArenaSize) - (p + size));
+
+         #ifdef MADV_HUGEPAGE
+            madvise(p, size, MADV_HUGEPAGE);
+         #endif
+      }
+
+      #if defined(LINUX) && defined(SYS_mbind)
+         // pages are placed on first touch otherwise, which may happen on another node
+         if (m_iNodes > 1)
+         {
+            const int MPOL_PREFERRED = 1;
+            unsigned long mask = 1UL << node;
+            syscall(SYS_mbind, p, size, MPOL_PREFERRED, &mask, sizeof(mask) * 8, 0);
+         }
+      #endif
+   #else
+      try
+      {
+         p = new char [size];
+      }
+      catch (...)
+      {
+         return NULL;
+      }
+   #endif
+
+   CGuard sg(m_StatLock);
+   m_llReserved += size;
+
+   return p;
+}
@@ -0,0 +1,169 @@
+/*****************************************************************************
+Copyright (c) 2001 - 2011, The Board of Trustees of the University of Illinois.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+
+* Redistributions of source code must retain the above
+  copyright notice, this list of conditions and the
+  following disclaimer.
+
+* Redistributions in binary form must reproduce the
+  above copyright notice, this list of conditions
+  and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the University of Illinois
+  nor the names of its contributors may be used to
+  endorse or promote products derived from this
+  software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*****************************************************************************/
+
+
+#ifndef __UDT_POOL_H__
+#define __UDT_POOL_H__
+
+#include <map>
+#include <vector>
+
+#include "common.h"
+#include "udt.h"
+
+// Process-wide memory for packet storage: the units of CUnitQueue and the blocks of CSndBuffer.
+// Slabs are carved from 2MB arenas that are backed by huge pages when the system provides them,
+// which saves TLB misses when a queue walks through thousands of packets. Each NUMA node has its
+// own arenas and free lists, so a slab is placed on the node of the thread that uses it.
+// Released slabs are kept for the next allocation of the same size instead of going back to the heap.
+
+class CMemPool
+{
+public:
+
+      // Functionality:
+      //    Find the NUMA node the calling thread is running on.
+      // Parameters:
+      //    None.
+      // Returned value:
+      //    Node number, 0 if unknown.
+
+   static int getNode();
+
+      // Functionality:
+      //    Allocate a slab.
+      // Parameters:
+      //    0) [in] size: slab size in bytes.
+      //    1) [in, out] node: NUMA node to place the slab on, -1 for the node of the calling thread; the node used on return.
+      // Returned value:
+      //    Pointer to the slab, NULL if no memory is available.
+
+   static char* allocate(const int& size, int& node);
+
+      // Functionality:
+      //    Return a slab to the pool for reuse.
+      // Parameters:
+      //    0) [in] slab: slab returned by allocate().
+      //    1) [in] size: size passed to allocate().
+      //    2) [in] node: node returned by allocate().
+      //    3) [in] discard: give the physical pages back to the system, for slabs released after a period of inactivity.
+      // Returned value:
+      //    None.
+
+   static void release(char* slab, const int& size, const int& node, const bool& discard = false);
+
+      // Functionality:
+      //    Read the amount of memory held by the pool.
+      // Parameters:
+      //    0) [out] reserved: bytes obtained from the system.
+      //    1) [out] used: bytes in slabs that have not been released.
+      // Returned value:
+      //    None.
+
+   static void getStats(int64_t& reserved, int64_t& used);
+
+      // Functionality:
+      //    Set the process-wide budget for packet memory. Queues and buffers always get their initial
+      //    memory; beyond it they stop growing when the budget is used up.
+      // Parameters:
+      //    0) [in] budget: maximum number of bytes in use, 0 for no limit.
+      // Returned value:
+      //    None.
+
+   static void setBudget(const int64_t& budget);
+
+      // Functionality:
+      //    Read the process-wide budget for packet memory.
+      // Parameters:
+      //    None.
+      // Returned value:
+      //    Budget in bytes, 0 if there is no limit.
+
+   static int64_t getBudget();
+
+      // Functionality:
+      //    Query how much memory can still be allocated within the budget.
+      // Parameters:
+      //    None.
+      // Returned value:
+      //    Number of bytes, -1 if there is no budget.
+
+   static int64_t getHeadroom();
+
+public:
+   static const int m_iIdleTime = 10000000;             // microseconds without traffic before extra memory is returned
+
+private:
+   CMemPool();
+
+   static CMemPool& instance();
+
+   struct CNodePool
+   {
+      pthread_mutex_t m_Lock;
+      std::map<int, std::vector<char*> > m_mFree;      // released slabs by size
+      char* m_pArena;                                  // arena slabs are currently carved from
+      int m_iArenaUsed;                                // bytes of m_pArena given out
+   };
+
+      // Functionality:
+      //    Obtain memory from the system, with huge pages if possible and placed on a NUMA node.
+      // Parameters:
+      //    0) [in] size: multiple of m_iArenaSize.
+      //    1) [in] node: NUMA node.
+      // Returned value:
+      //    Pointer to the memory, NULL if no memory is available.
+
+   char* mapArena(const int& size, const int& node);
+
+private:
+   static const int m_iArenaSize = 2 * 1024 * 1024;     // huge page size on x86-64 and arm64
+   static const int m_iMaxNodes = 8;                    // nodes beyond share the last pool
+
+   CNodePool m_Nodes[m_iMaxNodes];
+   int m_iNodes;                                        // number of NUMA nodes of the system
+   volatile bool m_bHugeTLB;                            // reserved huge pages are available
+
+   pthread_mutex_t m_StatLock;
+   int64_t m_llReserved;
+   int64_t m_llUsed;
+   volatile int64_t m_llBudget;                         // 0 for no limit
+
+private:
+   CMemPool(const CMemPool&);
+   CMemPool& operator=(const CMemPool&);
+};
+
+#endif
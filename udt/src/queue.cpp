@@ -44,12 +44,18 @@ written by
    #ifdef LEGACY_WIN32
       #include <wspiapi.h>
    #endif
+#else
+   #include <unistd.h>
+   #ifdef LINUX
+      #include <sched.h>
+   #endif
 #endif
 #include <cstring>
 
 #include "common.h"
 #include "core.h"
 #include "queue.h"
+#include "pool.h"
 
 using namespace std;
 
@@ -71,7 +77,7 @@ CUnitQueue::~CUnitQueue()
    while (p != NULL)
    {
       delete [] p->m_pUnit;
-      delete [] p->m_pBuffer;
+      CMemPool::release(p->m_pBuffer, p->m_iSize * m_iMSS, p->m_iNode);
 
       CQEntry* q = p;
       if (p == m_pLastQueue)
@@ -87,18 +93,19 @@ int CUnitQueue::init(const int& size, const int& mss, const int& version)
    CQEntry* tempq = NULL;
    CUnit* tempu = NULL;
    char* tempb = NULL;
+   int node = -1;
 
    try
    {
       tempq = new CQEntry;
       tempu = new CUnit [size];
-      tempb = new char [size * mss];
+      if (NULL == (tempb = CMemPool::allocate(size * mss, node)))
+         throw CUDTException(3, 2, 0);
    }
    catch (...)
    {
       delete tempq;
       delete [] tempu;
-      delete [] tempb;
 
       return -1;
    }
@@ -106,11 +113,13 @@ int CUnitQueue::init(const int& size, const int& mss, const int& version)
    for (int i = 0; i < size; ++ i)
    {
       tempu[i].m_iFlag = 0;
+      tempu[i].m_llArrivalTime = 0;
       tempu[i].m_Packet.m_pcData = tempb + i * mss;
    }
    tempq->m_pUnit = tempu;
    tempq->m_pBuffer = tempb;
    tempq->m_iSize = size;
+   tempq->m_iNode = node;
 
    m_pQEntry = m_pCurrQueue = m_pLastQueue = tempq;
    m_pQEntry->m_pNext = m_pQEntry;
@@ -124,9 +133,18 @@ int CUnitQueue::init(const int& size, const int& mss, const int& version)
    return 0;
 }
 
-int CUnitQueue::increase()
+int CUnitQueue::increase(const bool& full)
 {
-   // adjust/correct m_iCount
+   // memory beyond the first queue is only taken within the budget
+   int64_t headroom = CMemPool::getHeadroom();
+   bool limited = (headroom >= 0) && (headroom < int64_t(m_pQEntry->m_iSize) * m_iMSS);
+
+   // beyond the budget, the queue still grows when no unit is free: otherwise the units held by out-of-order
+   // packets could block the retransmissions that release them; the flow window limits this growth
+   if (limited && !full)
+      return -1;
+
+   // adjust/correct m_iCount; updates made during the scan may be lost, the next correction catches them
    int real_count = 0;
    CQEntry* p = m_pQEntry;
    while (p != NULL)
@@ -142,27 +160,29 @@ int CUnitQueue::increase()
          p = p->m_pNext;
    }
    m_iCount = real_count;
-   if (double(m_iCount) / m_iSize < 0.9)
+   if ((limited && (m_iCount < m_iSize)) || (double(m_iCount) / m_iSize < 0.9))
       return -1;
 
    CQEntry* tempq = NULL;
    CUnit* tempu = NULL;
    char* tempb = NULL;
+   int node = -1;
 
    // all queues have the same size
    int size = m_pQEntry->m_iSize;
 
+   // called by the receiving thread, so the new units are placed on its NUMA node
    try
    {
       tempq = new CQEntry;
       tempu = new CUnit [size];
-      tempb = new char [size * m_iMSS];
+      if (NULL == (tempb = CMemPool::allocate(size * m_iMSS, node)))
+         throw CUDTException(3, 2, 0);
    }
    catch (...)
    {
       delete tempq;
       delete [] tempu;
-      delete [] tempb;
 
       return -1;
    }
@@ -170,11 +190,13 @@ int CUnitQueue::increase()
    for (int i = 0; i < size; ++ i)
    {
       tempu[i].m_iFlag = 0;
+      tempu[i].m_llArrivalTime = 0;
       tempu[i].m_Packet.m_pcData = tempb + i * m_iMSS;
    }
    tempq->m_pUnit = tempu;
    tempq->m_pBuffer = tempb;
    tempq->m_iSize = size;
+   tempq->m_iNode = node;
 
    m_pLastQueue->m_pNext = tempq;
    m_pLastQueue = tempq;
@@ -187,14 +209,76 @@ int CUnitQueue::increase()
 
 int CUnitQueue::shrink()
 {
-   // currently queue cannot be shrunk.
-   return -1;
+   int released = 0;
+
+   // the first queue is always kept; units are only taken by the receiving thread, which calls this,
+   // so a queue without packets stays unused while it is released
+   CQEntry* prev = m_pQEntry;
+   CQEntry* p = m_pQEntry->m_pNext;
+   while (p != m_pQEntry)
+   {
+      CQEntry* next = p->m_pNext;
+
+      bool used = false;
+      CUnit* u = p->m_pUnit;
+      for (CUnit* end = u + p->m_iSize; (u != end) && !used; ++ u)
+         used = (u->m_iFlag != 0);
+
+      if (used)
+      {
+         prev = p;
+         p = next;
+         continue;
+      }
+
+      prev->m_pNext = next;
+      if (p == m_pLastQueue)
+         m_pLastQueue = prev;
+      if (p == m_pCurrQueue)
+      {
+         m_pCurrQueue = m_pQEntry;
+         m_pAvailUnit = m_pQEntry->m_pUnit;
+      }
+
+      delete [] p->m_pUnit;
+      CMemPool::release(p->m_pBuffer, p->m_iSize * m_iMSS, p->m_iNode, true);
+
+      m_iSize -= p->m_iSize;
+      released += p->m_iSize;
+      delete p;
+
+      p = next;
+   }
+
+   return released;
+}
+
+void CUnitQueue::addCount(const int& delta)
+{
+   #ifndef WIN32
+      __sync_add_and_fetch(&m_iCount, delta);
+   #else
+      InterlockedExchangeAdd((volatile LONG*)&m_iCount, delta);
+   #endif
+}
+
+int CUnitQueue::getAvailSize() const
+{
+   int64_t headroom = CMemPool::getHeadroom();
+   if (headroom < 0)
+      return -1;
+
+   // all queues have the same size
+   int size = m_pQEntry->m_iSize;
+   int avail = m_iSize - m_iCount + int(headroom / (int64_t(size) * m_iMSS)) * size;
+
+   return (avail > 0) ? avail : 0;
 }
 
 CUnit* CUnitQueue::getNextAvailUnit()
 {
    if (m_iCount * 10 > m_iSize * 9)
-      increase();
+      increase(m_iCount >= m_iSize);
 
    if (m_iCount >= m_iSize)
       return NULL;
@@ -217,7 +301,7 @@ CUnit* CUnitQueue::getNextAvailUnit()
       m_pAvailUnit = m_pCurrQueue->m_pUnit;
    } while (m_pCurrQueue != entrance);
 
-   increase();
+   increase(true);
 
    return NULL;
 }
@@ -324,7 +408,14 @@ int CSndUList::pop(sockaddr*& addr, CPacket& pkt)
 
    // pack a packet from the socket
    if (u->packData(pkt, ts) <= 0)
+   {
+      // a stale or dropped loss entry was skipped (ts is kept), so the socket may still have data to send;
+      // without an entry it would wait for the next ACK or EXP event, and none comes if nothing is in flight
+      if (ts > 0)
+         insert_(ts, u);
+
       return -1;
+   }
 
    addr = u->m_pPeerAddr;
 
@@ -443,71 +534,107 @@ void CSndUList::remove_(const CUDT* u)
 
 //
 CSndQueue::CSndQueue():
-m_WorkerThread(),
-m_pSndUList(NULL),
+m_pShard(NULL),
+m_iWorkers(0),
 m_pChannel(NULL),
 m_pTimer(NULL),
-m_WindowLock(),
-m_WindowCond(),
-m_bClosing(false),
-m_ExitCond()
+m_bClosing(false)
 {
-   #ifndef WIN32
-      pthread_cond_init(&m_WindowCond, NULL);
-      pthread_mutex_init(&m_WindowLock, NULL);
-   #else
-      m_WindowLock = CreateMutex(NULL, false, NULL);
-      m_WindowCond = CreateEvent(NULL, false, false, NULL);
-      m_ExitCond = CreateEvent(NULL, false, false, NULL);
-   #endif
 }
 
 CSndQueue::~CSndQueue()
 {
    m_bClosing = true;
 
-   #ifndef WIN32
-      pthread_mutex_lock(&m_WindowLock);
-      pthread_cond_signal(&m_WindowCond);
-      pthread_mutex_unlock(&m_WindowLock);
-      if (0 != m_WorkerThread)
-         pthread_join(m_WorkerThread, NULL);
-      pthread_cond_destroy(&m_WindowCond);
-      pthread_mutex_destroy(&m_WindowLock);
-   #else
-      SetEvent(m_WindowCond);
-      if (NULL != m_WorkerThread)
-         WaitForSingleObject(m_ExitCond, INFINITE);
-      CloseHandle(m_WorkerThread);
-      CloseHandle(m_WindowLock);
-      CloseHandle(m_WindowCond);
-      CloseHandle(m_ExitCond);
-   #endif
+   for (int i = 0; i < m_iWorkers; ++ i)
+   {
+      CSndShard* s = m_pShard + i;
+
+      #ifndef WIN32
+         pthread_mutex_lock(&s->m_WindowLock);
+         pthread_cond_signal(&s->m_WindowCond);
+         pthread_mutex_unlock(&s->m_WindowLock);
+         if (0 != s->m_WorkerThread)
+            pthread_join(s->m_WorkerThread, NULL);
+         pthread_cond_destroy(&s->m_WindowCond);
+         pthread_mutex_destroy(&s->m_WindowLock);
+      #else
+         SetEvent(s->m_WindowCond);
+         if (NULL != s->m_WorkerThread)
+         {
+            WaitForSingleObject(s->m_WorkerThread, INFINITE);
+            CloseHandle(s->m_WorkerThread);
+         }
+         CloseHandle(s->m_WindowLock);
+         CloseHandle(s->m_WindowCond);
+      #endif
+
+      delete s->m_pSndUList;
+
+      // the first thread uses the timer of the multiplexer
+      if (s->m_pTimer != m_pTimer)
+         delete s->m_pTimer;
+   }
 
-   delete m_pSndUList;
+   delete [] m_pShard;
 }
 
-void CSndQueue::init(const CChannel* c, const CTimer* t)
+void CSndQueue::init(const CChannel* c, const CTimer* t, const int& workers, const int& cpu)
 {
    m_pChannel = (CChannel*)c;
    m_pTimer = (CTimer*)t;
-   m_pSndUList = new CSndUList;
-   m_pSndUList->m_pWindowLock = &m_WindowLock;
-   m_pSndUList->m_pWindowCond = &m_WindowCond;
-   m_pSndUList->m_pTimer = m_pTimer;
 
-   #ifndef WIN32
-      if (0 != pthread_create(&m_WorkerThread, NULL, CSndQueue::worker, this))
-      {
-         m_WorkerThread = 0;
-         throw CUDTException(3, 1);
-      }
-   #else
-      DWORD threadID;
-      m_WorkerThread = CreateThread(NULL, 0, CSndQueue::worker, this, 0, &threadID);
-      if (NULL == m_WorkerThread)
-         throw CUDTException(3, 1);
-   #endif
+   m_iWorkers = (workers > 1) ? workers : 1;
+   m_pShard = new CSndShard[m_iWorkers];
+
+   for (int i = 0; i < m_iWorkers; ++ i)
+   {
+      CSndShard* s = m_pShard + i;
+      s->m_pQueue = this;
+      s->m_pTimer = (0 == i) ? m_pTimer : new CTimer;
+      s->m_iCPU = (cpu < 0) ? -1 : cpu + i;
+      s->m_iNode = -1;
+      s->m_WorkerThread = 0;
+
+      #ifndef WIN32
+         pthread_cond_init(&s->m_WindowCond, NULL);
+         pthread_mutex_init(&s->m_WindowLock, NULL);
+      #else
+         s->m_WindowLock = CreateMutex(NULL, false, NULL);
+         s->m_WindowCond = CreateEvent(NULL, false, false, NULL);
+      #endif
+
+      s->m_pSndUList = new CSndUList;
+      s->m_pSndUList->m_pWindowLock = &s->m_WindowLock;
+      s->m_pSndUList->m_pWindowCond = &s->m_WindowCond;
+      s->m_pSndUList->m_pTimer = s->m_pTimer;
+   }
+
+   for (int i = 0; i < m_iWorkers; ++ i)
+   {
+      #ifndef WIN32
+         if (0 != pthread_create(&m_pShard[i].m_WorkerThread, NULL, CSndQueue::worker, m_pShard + i))
+         {
+            m_pShard[i].m_WorkerThread = 0;
+            throw CUDTException(3, 1);
+         }
+      #else
+         DWORD threadID;
+         m_pShard[i].m_WorkerThread = CreateThread(NULL, 0, CSndQueue::worker, m_pShard + i, 0, &threadID);
+         if (NULL == m_pShard[i].m_WorkerThread)
+            throw CUDTException(3, 1);
+      #endif
+   }
+}
+
+CSndUList* CSndQueue::getSndUList(const UDTSOCKET& id) const
+{
+   return m_pShard[id % m_iWorkers].m_pSndUList;
+}
+
+int CSndQueue::getNode(const UDTSOCKET& id) const
+{
+   return m_pShard[id % m_iWorkers].m_iNode;
 }
 
 #ifndef WIN32
@@ -516,11 +643,34 @@ void CSndQueue::init(const CChannel* c, const CTimer* t)
    DWORD WINAPI CSndQueue::worker(LPVOID param)
 #endif
 {
-   CSndQueue* self = (CSndQueue*)param;
+   CSndShard* shard = (CSndShard*)param;
+   CSndQueue* self = shard->m_pQueue;
+
+   if (shard->m_iCPU >= 0)
+   {
+      // pinning is a hint, the thread runs unpinned if the CPU is not available
+      #ifdef LINUX
+         int ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+         cpu_set_t cpuset;
+         CPU_ZERO(&cpuset);
+         CPU_SET(shard->m_iCPU % ((ncpu > 0) ? ncpu : 1), &cpuset);
+         pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
+      #elif defined(WIN32)
+         SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << (shard->m_iCPU % (8 * sizeof(DWORD_PTR))));
+      #endif
+   }
+
+   shard->m_iNode = CMemPool::getNode();
+
+   sockaddr* addr[CChannel::m_iMaxBatchSize];
+   CPacket pkt[CChannel::m_iMaxBatchSize];
+   CPacket* ppkt[CChannel::m_iMaxBatchSize];
+   for (int i = 0; i < CChannel::m_iMaxBatchSize; ++ i)
+      ppkt[i] = pkt + i;
 
    while (!self->m_bClosing)
    {
-      uint64_t ts = self->m_pSndUList->getNextProcTime();
+      uint64_t ts = shard->m_pSndUList->getNextProcTime();
 
       if (ts > 0)
       {
@@ -528,26 +678,37 @@ void CSndQueue::init(const CChannel* c, const CTimer* t)
          uint64_t currtime;
          CTimer::rdtsc(currtime);
          if (currtime < ts)
-            self->m_pTimer->sleepto(ts);
+            shard->m_pTimer->sleepto(ts);
 
-         // it is time to send the next pkt
-         sockaddr* addr;
-         CPacket pkt;
-         if (self->m_pSndUList->pop(addr, pkt) < 0)
-            continue;
+         // it is time to send the next pkt; collect every packet that is already due, so they go out in one system call
+         CTimer::rdtsc(currtime);
+         int n = 0;
+         while (n < CChannel::m_iMaxBatchSize)
+         {
+            if (shard->m_pSndUList->pop(addr[n], pkt[n]) > 0)
+            {
+               ++ n;
+               continue;
+            }
 
-         self->m_pChannel->sendto(addr, pkt);
+            ts = shard->m_pSndUList->getNextProcTime();
+            if ((0 == ts) || (ts > currtime))
+               break;
+         }
+
+         if (n > 0)
+            self->m_pChannel->sendBatch(addr, ppkt, n);
       }
       else
       {
          // wait here if there is no sockets with data to be sent
          #ifndef WIN32
-            pthread_mutex_lock(&self->m_WindowLock);
-            if (!self->m_bClosing && (self->m_pSndUList->m_iLastEntry < 0))
-               pthread_cond_wait(&self->m_WindowCond, &self->m_WindowLock);
-            pthread_mutex_unlock(&self->m_WindowLock);
+            pthread_mutex_lock(&shard->m_WindowLock);
+            if (!self->m_bClosing && (shard->m_pSndUList->m_iLastEntry < 0))
+               pthread_cond_wait(&shard->m_WindowCond, &shard->m_WindowLock);
+            pthread_mutex_unlock(&shard->m_WindowLock);
          #else
-            WaitForSingleObject(self->m_WindowCond, INFINITE);
+            WaitForSingleObject(shard->m_WindowCond, INFINITE);
          #endif
       }
    }
@@ -555,7 +716,6 @@ void CSndQueue::init(const CChannel* c, const CTimer* t)
    #ifndef WIN32
       return NULL;
    #else
-      SetEvent(self->m_ExitCond);
       return 0;
    #endif
 }
@@ -582,31 +742,65 @@ CRcvUList::~CRcvUList()
 void CRcvUList::insert(const CUDT* u)
 {
    CRNode* n = u->m_pRNode;
-   CTimer::rdtsc(n->m_llTimeStamp);
+   n->m_llTimeStamp = u->m_ullNextCheckTime;
 
-   if (NULL == m_pUList)
-   {
-      // empty list, insert as the single node
-      n->m_pPrev = n->m_pNext = NULL;
-      m_pLast = m_pUList = n;
+   link(n);
+}
+
+void CRcvUList::remove(const CUDT* u)
+{
+   CRNode* n = u->m_pRNode;
 
+   if (!n->m_bOnList)
       return;
-   }
 
-   // always insert at the end for RcvUList
-   n->m_pPrev = m_pLast;
-   n->m_pNext = NULL;
-   m_pLast->m_pNext = n;
-   m_pLast = n;
+   unlink(n);
 }
 
-void CRcvUList::remove(const CUDT* u)
+void CRcvUList::update(const CUDT* u)
 {
    CRNode* n = u->m_pRNode;
 
    if (!n->m_bOnList)
       return;
 
+   n->m_llTimeStamp = u->m_ullNextCheckTime;
+
+   // already in order, do not need to change
+   if (((NULL == n->m_pPrev) || (n->m_pPrev->m_llTimeStamp <= n->m_llTimeStamp)) && ((NULL == n->m_pNext) || (n->m_llTimeStamp <= n->m_pNext->m_llTimeStamp)))
+      return;
+
+   unlink(n);
+   link(n);
+}
+
+void CRcvUList::link(CRNode* n)
+{
+   // deadlines are mostly pushed forward, so search for the position from the end of the list
+   CRNode* p = m_pLast;
+   while ((NULL != p) && (p->m_llTimeStamp > n->m_llTimeStamp))
+      p = p->m_pPrev;
+
+   n->m_pPrev = p;
+   if (NULL == p)
+   {
+      n->m_pNext = m_pUList;
+      m_pUList = n;
+   }
+   else
+   {
+      n->m_pNext = p->m_pNext;
+      p->m_pNext = n;
+   }
+
+   if (NULL == n->m_pNext)
+      m_pLast = n;
+   else
+      n->m_pNext->m_pPrev = n;
+}
+
+void CRcvUList::unlink(CRNode* n)
+{
    if (NULL == n->m_pPrev)
    {
       // n is the first node
@@ -631,36 +825,6 @@ void CRcvUList::remove(const CUDT* u)
    n->m_pNext = n->m_pPrev = NULL;
 }
 
-void CRcvUList::update(const CUDT* u)
-{
-   CRNode* n = u->m_pRNode;
-
-   if (!n->m_bOnList)
-      return;
-
-   CTimer::rdtsc(n->m_llTimeStamp);
-
-   // if n is the last node, do not need to change
-   if (NULL == n->m_pNext)
-      return;
-
-   if (NULL == n->m_pPrev)
-   {
-      m_pUList = n->m_pNext;
-      m_pUList->m_pPrev = NULL;
-   }
-   else
-   {
-      n->m_pPrev->m_pNext = n->m_pNext;
-      n->m_pNext->m_pPrev = n->m_pPrev;
-   }
-
-   n->m_pPrev = m_pLast;
-   n->m_pNext = NULL;
-   m_pLast->m_pNext = n;
-   m_pLast = n;
-}
-
 //
 CHash::CHash():
 m_pBucket(NULL),
@@ -836,7 +1000,7 @@ void CRendezvousQueue::updateConnStatus()
 
    CGuard vg(m_RIDVectorLock);
 
-   for (list<CRL>::iterator i = m_lRendezvousID.begin(); i != m_lRendezvousID.end(); ++ i)
+   for (list<CRL>::iterator i = m_lRendezvousID.begin(); i != m_lRendezvousID.end();)
    {
       // avoid sending too many requests, at most 1 request per 250ms
       if (CTimer::getTime() - i->m_pUDT->m_llLastReqTime > 250000)
@@ -844,8 +1008,17 @@ void CRendezvousQueue::updateConnStatus()
          if (CTimer::getTime() >= i->m_ullTTL)
          {
             // connection timer expired, acknowledge app via epoll (UDT send will return error so that apps know this connection has failed)
+            // the entry is dropped so that the failed socket is reported once and no longer shortens the receiving timeout
+            i->m_pUDT->m_bConnFailed = true;
             i->m_pUDT->m_bConnecting = false;
             CUDT::s_UDTUnited.m_EPoll.enable_write(i->m_iID, i->m_pUDT->m_sPollID);
+
+            if (AF_INET == i->m_iIPversion)
+               delete (sockaddr_in*)i->m_pPeerAddr;
+            else
+               delete (sockaddr_in6*)i->m_pPeerAddr;
+
+            i = m_lRendezvousID.erase(i);
             continue;
          }
 
@@ -861,6 +1034,8 @@ void CRendezvousQueue::updateConnStatus()
          i->m_pUDT->m_llLastReqTime = CTimer::getTime();
          delete [] reqdata;
       }
+
+      ++ i;
    }
 }
 
@@ -868,8 +1043,8 @@ void CRendezvousQueue::updateConnStatus()
 CRcvQueue::CRcvQueue():
 m_WorkerThread(),
 m_UnitQueue(),
-m_pRcvUList(NULL),
-m_pHash(NULL),
+m_pShard(NULL),
+m_iWorkers(0),
 m_pChannel(NULL),
 m_pTimer(NULL),
 m_iPayloadSize(),
@@ -878,23 +1053,27 @@ m_ExitCond(),
 m_LSLock(),
 m_pListener(NULL),
 m_pRendezvousQueue(NULL),
-m_vNewEntry(),
-m_IDLock(),
+m_vConnReq(),
+m_ConnReqLock(),
+m_ConnReqCond(),
+m_ListenerThread(),
 m_mBuffer(),
 m_PassLock(),
 m_PassCond()
 {
    #ifndef WIN32
       pthread_mutex_init(&m_PassLock, NULL);
-      pthread_cond_init(&m_PassCond, NULL);
+      CGuard::createCond(m_PassCond);
       pthread_mutex_init(&m_LSLock, NULL);
-      pthread_mutex_init(&m_IDLock, NULL);
+      pthread_mutex_init(&m_ConnReqLock, NULL);
+      CGuard::createCond(m_ConnReqCond);
    #else
       m_PassLock = CreateMutex(NULL, false, NULL);
       m_PassCond = CreateEvent(NULL, false, false, NULL);
       m_LSLock = CreateMutex(NULL, false, NULL);
-      m_IDLock = CreateMutex(NULL, false, NULL);
       m_ExitCond = CreateEvent(NULL, false, false, NULL);
+      m_ConnReqLock = CreateMutex(NULL, false, NULL);
+      m_ConnReqCond = CreateEvent(NULL, false, false, NULL);
    #endif
 }
 
@@ -902,13 +1081,15 @@ CRcvQueue::~CRcvQueue()
 {
    m_bClosing = true;
 
+   if (NULL != m_pChannel)
+      m_pChannel->interrupt();
+
    #ifndef WIN32
       if (0 != m_WorkerThread)
          pthread_join(m_WorkerThread, NULL);
       pthread_mutex_destroy(&m_PassLock);
       pthread_cond_destroy(&m_PassCond);
       pthread_mutex_destroy(&m_LSLock);
-      pthread_mutex_destroy(&m_IDLock);
    #else
       if (NULL != m_WorkerThread)
          WaitForSingleObject(m_ExitCond, INFINITE);
@@ -916,12 +1097,68 @@ CRcvQueue::~CRcvQueue()
       CloseHandle(m_PassLock);
       CloseHandle(m_PassCond);
       CloseHandle(m_LSLock);
-      CloseHandle(m_IDLock);
       CloseHandle(m_ExitCond);
    #endif
 
-   delete m_pRcvUList;
-   delete m_pHash;
+   // the receiving thread has stopped, so no more connection requests are passed to the listener thread
+   #ifndef WIN32
+      if (0 != m_ListenerThread)
+      {
+         pthread_mutex_lock(&m_ConnReqLock);
+         pthread_cond_signal(&m_ConnReqCond);
+         pthread_mutex_unlock(&m_ConnReqLock);
+         pthread_join(m_ListenerThread, NULL);
+      }
+      pthread_mutex_destroy(&m_ConnReqLock);
+      pthread_cond_destroy(&m_ConnReqCond);
+   #else
+      if (NULL != m_ListenerThread)
+      {
+         SetEvent(m_ConnReqCond);
+         WaitForSingleObject(m_ListenerThread, INFINITE);
+         CloseHandle(m_ListenerThread);
+      }
+      CloseHandle(m_ConnReqLock);
+      CloseHandle(m_ConnReqCond);
+   #endif
+
+   for (std::vector<CConnReq>::iterator i = m_vConnReq.begin(); i != m_vConnReq.end(); ++ i)
+   {
+      delete [] i->m_pPacket->m_pcData;
+      delete i->m_pPacket;
+   }
+
+   // the receiving thread has stopped, so no more packets are passed to the shards
+   for (int i = 0; i < m_iWorkers; ++ i)
+   {
+      CRcvShard* s = m_pShard + i;
+
+      #ifndef WIN32
+         if (0 != s->m_WorkerThread)
+         {
+            pthread_mutex_lock(&s->m_Lock);
+            pthread_cond_signal(&s->m_Cond);
+            pthread_mutex_unlock(&s->m_Lock);
+            pthread_join(s->m_WorkerThread, NULL);
+         }
+         pthread_mutex_destroy(&s->m_Lock);
+         pthread_cond_destroy(&s->m_Cond);
+      #else
+         if (NULL != s->m_WorkerThread)
+         {
+            SetEvent(s->m_Cond);
+            WaitForSingleObject(s->m_WorkerThread, INFINITE);
+            CloseHandle(s->m_WorkerThread);
+         }
+         CloseHandle(s->m_Lock);
+         CloseHandle(s->m_Cond);
+      #endif
+
+      delete s->m_pRcvUList;
+      delete s->m_pHash;
+   }
+   delete [] m_pShard;
+
    delete m_pRendezvousQueue;
 
    // remove all queued messages
@@ -937,21 +1174,54 @@ CRcvQueue::~CRcvQueue()
    }
 }
 
-void CRcvQueue::init(const int& qsize, const int& payload, const int& version, const int& hsize, const CChannel* cc, const CTimer* t)
+void CRcvQueue::init(const int& qsize, const int& payload, const int& version, const int& hsize, const CChannel* cc, const CTimer* t, const int& workers)
 {
    m_iPayloadSize = payload;
 
    m_UnitQueue.init(qsize, payload, version);
 
-   m_pHash = new CHash;
-   m_pHash->init(hsize);
-
    m_pChannel = (CChannel*)cc;
    m_pTimer = (CTimer*)t;
 
-   m_pRcvUList = new CRcvUList;
    m_pRendezvousQueue = new CRendezvousQueue;
 
+   m_iWorkers = (workers > 1) ? workers : 1;
+   m_pShard = new CRcvShard[m_iWorkers];
+   for (int i = 0; i < m_iWorkers; ++ i)
+   {
+      CRcvShard* s = m_pShard + i;
+      s->m_pQueue = this;
+      s->m_pRcvUList = new CRcvUList;
+      s->m_pHash = new CHash;
+      s->m_pHash->init(hsize);
+      s->m_WorkerThread = 0;
+
+      #ifndef WIN32
+         pthread_mutex_init(&s->m_Lock, NULL);
+         CGuard::createCond(s->m_Cond);
+      #else
+         s->m_Lock = CreateMutex(NULL, false, NULL);
+         s->m_Cond = CreateEvent(NULL, false, false, NULL);
+      #endif
+   }
+
+   // with a single shard, the receiving thread processes the packets itself
+   for (int i = 0; (m_iWorkers > 1) && (i < m_iWorkers); ++ i)
+   {
+      #ifndef WIN32
+         if (0 != pthread_create(&m_pShard[i].m_WorkerThread, NULL, CRcvQueue::shardWorker, m_pShard + i))
+         {
+            m_pShard[i].m_WorkerThread = 0;
+            throw CUDTException(3, 1);
+         }
+      #else
+         DWORD threadID;
+         m_pShard[i].m_WorkerThread = CreateThread(NULL, 0, CRcvQueue::shardWorker, m_pShard + i, 0, &threadID);
+         if (NULL == m_pShard[i].m_WorkerThread)
+            throw CUDTException(3, 1);
+      #endif
+   }
+
    #ifndef WIN32
       if (0 != pthread_create(&m_WorkerThread, NULL, CRcvQueue::worker, this))
       {
@@ -974,9 +1244,24 @@ void CRcvQueue::init(const int& qsize, const int& payload, const int& version, c
 {
    CRcvQueue* self = (CRcvQueue*)param;
 
-   sockaddr* addr = (AF_INET == self->m_UnitQueue.m_iIPversion) ? (sockaddr*) new sockaddr_in : (sockaddr*) new sockaddr_in6;
-   CUDT* u = NULL;
-   int32_t id;
+   // sockaddr_in6 is large enough for both IP versions
+   sockaddr_in6* addrbuf = new sockaddr_in6 [CChannel::m_iMaxBatchSize];
+   sockaddr* addrs[CChannel::m_iMaxBatchSize];
+   for (int i = 0; i < CChannel::m_iMaxBatchSize; ++ i)
+      addrs[i] = (sockaddr*)(addrbuf + i);
+
+   CUnit* units[CChannel::m_iMaxBatchSize];
+   CPacket* packets[CChannel::m_iMaxBatchSize];
+   uint64_t arrtime[CChannel::m_iMaxBatchSize];
+
+   // packets to be passed to each shard, collected for a whole batch to take each shard's lock only once
+   std::vector<CPendingUnit>* pending = new std::vector<CPendingUnit> [self->m_iWorkers];
+
+   // last time the unit queue was more than a quarter full
+   uint64_t busytime = CTimer::getTime();
+
+   // no unit was free at the last wake up, so pending GRO segments must not end the next wait
+   bool starved = false;
 
    while (!self->m_bClosing)
    {
@@ -984,125 +1269,377 @@ void CRcvQueue::init(const int& qsize, const int& payload, const int& version, c
          self->m_pTimer->tick();
       #endif
 
-      // check waiting list, if new socket, insert it to the list
-      while (self->ifNewEntry())
+      // with a single shard, this thread also owns the sockets and their timers
+      int64_t timeout = 100000;
+      if (1 == self->m_iWorkers)
       {
-         CUDT* ne = self->getNewEntry();
-         if (NULL != ne)
-         {
-            self->m_pRcvUList->insert(ne);
-            self->m_pHash->insert(ne->m_SocketID, ne);
-         }
+         self->insertNewEntries(self->m_pShard);
+         timeout = self->getTimeout(self->m_pShard);
       }
 
-      // find next available slot for incoming packet
-      CUnit* unit = self->m_UnitQueue.getNextAvailUnit();
-      if (NULL == unit)
+      // connection requests are repeated by updateConnStatus()
+      if (!self->m_pRendezvousQueue->empty() && (timeout > 10000))
+         timeout = 10000;
+
+      // sleep until a packet arrives or the earliest timer of the UDT sockets is due
+      int n = 0;
+      if (!self->m_pChannel->waitRecv(timeout, !starved))
       {
-         // no space, skip this packet
-         CPacket temp;
-         temp.m_pcData = new char[self->m_iPayloadSize];
-         temp.setLength(self->m_iPayloadSize);
-         self->m_pChannel->recvfrom(addr, temp);
-         delete [] temp.m_pcData;
+         starved = false;
          goto TIMER_CHECK;
       }
 
-      unit->m_Packet.setLength(self->m_iPayloadSize);
-
-      // reading next incoming packet, recvfrom returns -1 is nothing has been received
-      if (self->m_pChannel->recvfrom(addr, unit->m_Packet) < 0)
-         goto TIMER_CHECK;
+      // find available slots for incoming packets, reserving each one so the next lookup returns a different unit
+      // a unit stays reserved until its packet is processed, unless the receiver buffer takes it
+      while (n < CChannel::m_iMaxBatchSize)
+      {
+         CUnit* unit = self->m_UnitQueue.getNextAvailUnit();
+         if (NULL == unit)
+            break;
 
-      id = unit->m_Packet.m_iID;
+         unit->m_iFlag = 4;
+         unit->m_Packet.setLength(self->m_iPayloadSize);
+         units[n] = unit;
+         packets[n] = &unit->m_Packet;
+         ++ n;
+      }
 
-      // ID 0 is for connection request, which should be passed to the listening socket or rendezvous sockets
-      if (0 == id)
+      starved = (0 == n);
+      if (starved)
       {
-         if (NULL != self->m_pListener)
-            ((CUDT*)self->m_pListener)->listen(addr, unit->m_Packet);
-         else if (NULL != (u = self->m_pRendezvousQueue->retrieve(addr, id)))
+         // no space, skip this packet; a leftover segment of a coalesced datagram is the next one, not the socket
+         if (!self->m_pChannel->dropSegment())
          {
-            // asynchronous connect: call connect here
-            // otherwise wait for the UDT socket to retrieve this packet
-            if (!u->m_bSynRecving)
-               u->connect(unit->m_Packet);
-            else
-               self->storePkt(id, unit->m_Packet.clone());
+            CPacket temp;
+            temp.m_pcData = new char[self->m_iPayloadSize];
+            temp.setLength(self->m_iPayloadSize);
+            self->m_pChannel->recvfrom(addrs[0], temp);
+            delete [] temp.m_pcData;
          }
+         goto TIMER_CHECK;
       }
-      else if (id > 0)
+
+      // reading the next incoming packets, recvBatch returns -1 if nothing has been received
       {
-         if (NULL != (u = self->m_pHash->lookup(id)))
+         int count = self->m_pChannel->recvBatch(addrs, packets, arrtime, n);
+
+         for (int i = 0; i < n; ++ i)
          {
-            if (CIPAddress::ipcmp(addr, u->m_pPeerAddr, u->m_iIPversion))
+            CUnit* unit = units[i];
+
+            if ((i >= count) || (unit->m_Packet.getLength() < 0))
             {
-               if (u->m_bConnected && !u->m_bBroken && !u->m_bClosing)
-               {
-                  if (0 == unit->m_Packet.getFlag())
-                     u->processData(unit);
-                  else
-                     u->processCtrl(unit->m_Packet);
-
-                  u->checkTimers();
-                  self->m_pRcvUList->update(u);
-               }
+               unit->m_iFlag = 0;
+               continue;
             }
-         }
-         else if (NULL != (u = self->m_pRendezvousQueue->retrieve(addr, id)))
-         {
-            if (!u->m_bSynRecving)
-               u->connect(unit->m_Packet);
+
+            unit->m_llArrivalTime = arrtime[i];
+
+            if (self->processConnReq(unit, addrs[i]))
+               continue;
+
+            CRcvShard* s = self->getShard(unit->m_Packet.m_iID);
+            if (1 == self->m_iWorkers)
+               self->processUnit(s, unit, addrs[i]);
             else
-               self->storePkt(id, unit->m_Packet.clone());
+            {
+               CPendingUnit p;
+               p.m_pUnit = unit;
+               memcpy(&p.m_Addr, addrbuf + i, sizeof(sockaddr_in6));
+               pending[s - self->m_pShard].push_back(p);
+            }
          }
       }
 
+      for (int i = 0; (self->m_iWorkers > 1) && (i < self->m_iWorkers); ++ i)
+      {
+         if (pending[i].empty())
+            continue;
+
+         CRcvShard* s = self->m_pShard + i;
+
+         CGuard::enterCS(s->m_Lock);
+         s->m_vUnit.insert(s->m_vUnit.end(), pending[i].begin(), pending[i].end());
+         #ifndef WIN32
+            pthread_cond_signal(&s->m_Cond);
+         #else
+            SetEvent(s->m_Cond);
+         #endif
+         CGuard::leaveCS(s->m_Lock);
+
+         pending[i].clear();
+      }
+
 TIMER_CHECK:
-      // take care of the timing event for all UDT sockets
+      if (1 == self->m_iWorkers)
+         self->checkTimers(self->m_pShard);
 
-      uint64_t currtime;
-      CTimer::rdtsc(currtime);
+      // Check connection requests status for all sockets in the RendezvousQueue.
+      self->m_pRendezvousQueue->updateConnStatus();
 
-      CRNode* ul = self->m_pRcvUList->m_pUList;
-      uint64_t ctime = currtime - 100000 * CTimer::getCPUFrequency();
-      while ((NULL != ul) && (ul->m_llTimeStamp < ctime))
+      // give the units added for a traffic burst back once the queue has been mostly empty for a while
+      uint64_t now = CTimer::getTime();
+      if (self->m_UnitQueue.m_iCount * 4 > self->m_UnitQueue.m_iSize)
+         busytime = now;
+      else if (now - busytime > uint64_t(CMemPool::m_iIdleTime))
       {
-         CUDT* u = ul->m_pUDT;
+         self->m_UnitQueue.shrink();
+         busytime = now;
+      }
+   }
 
-         if (u->m_bConnected && !u->m_bBroken && !u->m_bClosing)
-         {
-            u->checkTimers();
-            self->m_pRcvUList->update(u);
-         }
-         else
+   delete [] pending;
+   delete [] addrbuf;
+
+   #ifndef WIN32
+      return NULL;
+   #else
+      SetEvent(self->m_ExitCond);
+      return 0;
+   #endif
+}
+
+#ifndef WIN32
+   void* CRcvQueue::shardWorker(void* param)
+#else
+   DWORD WINAPI CRcvQueue::shardWorker(LPVOID param)
+#endif
+{
+   CRcvShard* shard = (CRcvShard*)param;
+   CRcvQueue* self = shard->m_pQueue;
+
+   std::vector<CPendingUnit> units;
+
+   while (!self->m_bClosing)
+   {
+      CGuard::enterCS(shard->m_Lock);
+
+      if (shard->m_vNewEntry.empty() && shard->m_vUnit.empty() && !self->m_bClosing)
+      {
+         // wait for new packets or the earliest timer of the shard's sockets
+         int64_t timeout = self->getTimeout(shard);
+
+         if (timeout > 0)
          {
-            // the socket must be removed from Hash table first, then RcvUList
-            self->m_pHash->remove(u->m_SocketID);
-            self->m_pRcvUList->remove(u);
-            u->m_pRNode->m_bOnList = false;
+            #ifndef WIN32
+               uint64_t exptime = CTimer::getTime() + timeout;
+               timespec locktime;
+               locktime.tv_sec = exptime / 1000000;
+               locktime.tv_nsec = (exptime % 1000000) * 1000;
+               pthread_cond_timedwait(&shard->m_Cond, &shard->m_Lock, &locktime);
+            #else
+               ReleaseMutex(shard->m_Lock);
+               WaitForSingleObject(shard->m_Cond, DWORD((timeout + 999) / 1000));
+               WaitForSingleObject(shard->m_Lock, INFINITE);
+            #endif
          }
-
-         ul = self->m_pRcvUList->m_pUList;
       }
 
-      // Check connection requests status for all sockets in the RendezvousQueue.
-      self->m_pRendezvousQueue->updateConnStatus();
+      units.swap(shard->m_vUnit);
+
+      CGuard::leaveCS(shard->m_Lock);
+
+      self->insertNewEntries(shard);
+
+      for (std::vector<CPendingUnit>::iterator i = units.begin(); i != units.end(); ++ i)
+         self->processUnit(shard, i->m_pUnit, (sockaddr*)&i->m_Addr);
+      units.clear();
+
+      self->checkTimers(shard);
    }
 
-   if (AF_INET == self->m_UnitQueue.m_iIPversion)
-      delete (sockaddr_in*)addr;
-   else
-      delete (sockaddr_in6*)addr;
+   // release the packets that have not been processed
+   CGuard::enterCS(shard->m_Lock);
+   for (std::vector<CPendingUnit>::iterator i = shard->m_vUnit.begin(); i != shard->m_vUnit.end(); ++ i)
+      i->m_pUnit->m_iFlag = 0;
+   shard->m_vUnit.clear();
+   CGuard::leaveCS(shard->m_Lock);
+
+   #ifndef WIN32
+      return NULL;
+   #else
+      return 0;
+   #endif
+}
+
+#ifndef WIN32
+   void* CRcvQueue::listenerWorker(void* param)
+#else
+   DWORD WINAPI CRcvQueue::listenerWorker(LPVOID param)
+#endif
+{
+   CRcvQueue* self = (CRcvQueue*)param;
+
+   std::vector<CConnReq> reqs;
+
+   while (!self->m_bClosing)
+   {
+      CGuard::enterCS(self->m_ConnReqLock);
+
+      if (self->m_vConnReq.empty() && !self->m_bClosing)
+      {
+         #ifndef WIN32
+            pthread_cond_wait(&self->m_ConnReqCond, &self->m_ConnReqLock);
+         #else
+            ReleaseMutex(self->m_ConnReqLock);
+            WaitForSingleObject(self->m_ConnReqCond, INFINITE);
+            WaitForSingleObject(self->m_ConnReqLock, INFINITE);
+         #endif
+      }
+
+      reqs.swap(self->m_vConnReq);
+
+      CGuard::leaveCS(self->m_ConnReqLock);
+
+      for (std::vector<CConnReq>::iterator i = reqs.begin(); i != reqs.end(); ++ i)
+      {
+         // the listener may have been closed after the request was queued
+         CUDT* l = (CUDT*)self->m_pListener;
+         if ((NULL != l) && !self->m_bClosing)
+            l->listen((sockaddr*)&i->m_Addr, *i->m_pPacket);
+
+         delete [] i->m_pPacket->m_pcData;
+         delete i->m_pPacket;
+      }
+      reqs.clear();
+   }
 
    #ifndef WIN32
       return NULL;
    #else
-      SetEvent(self->m_ExitCond);
       return 0;
    #endif
 }
 
+CRcvQueue::CRcvShard* CRcvQueue::getShard(const int32_t& id) const
+{
+   return m_pShard + (id % m_iWorkers);
+}
+
+void CRcvQueue::insertNewEntries(CRcvShard* shard)
+{
+   // check waiting list, if new socket, insert it to the list
+   if (shard->m_vNewEntry.empty())
+      return;
+
+   CGuard listguard(shard->m_Lock);
+
+   for (std::vector<CUDT*>::iterator i = shard->m_vNewEntry.begin(); i != shard->m_vNewEntry.end(); ++ i)
+   {
+      shard->m_pRcvUList->insert(*i);
+      shard->m_pHash->insert((*i)->m_SocketID, *i);
+   }
+   shard->m_vNewEntry.clear();
+}
+
+int64_t CRcvQueue::getTimeout(const CRcvShard* shard) const
+{
+   // check at least every 100ms, as closed sockets are removed by checkTimers()
+   int64_t timeout = 100000;
+
+   if (NULL != shard->m_pRcvUList->m_pUList)
+   {
+      uint64_t currtime;
+      CTimer::rdtsc(currtime);
+
+      uint64_t deadline = shard->m_pRcvUList->m_pUList->m_llTimeStamp;
+      timeout = (deadline > currtime) ? (int64_t)((deadline - currtime) / CTimer::getCPUFrequency()) : 0;
+      if (timeout > 100000)
+         timeout = 100000;
+   }
+
+   return timeout;
+}
+
+bool CRcvQueue::processConnReq(CUnit* unit, const sockaddr* addr)
+{
+   // handshakes of connecting sockets are handled on the receiving thread, in order with updateConnStatus()
+   // a socket is removed from the RendezvousQueue before it is added to a shard, so it is never in both
+
+   int32_t id = unit->m_Packet.m_iID;
+   CUDT* u = NULL;
+
+   if (id > 0)
+   {
+      if (m_pRendezvousQueue->empty() || (NULL == (u = m_pRendezvousQueue->retrieve(addr, id))))
+         return false;
+   }
+   else if (0 == id)
+   {
+      // ID 0 is for connection request, which should be passed to the listening socket or rendezvous sockets
+      if (NULL != m_pListener)
+         passConnReq(unit->m_Packet, addr);
+      else
+         u = m_pRendezvousQueue->retrieve(addr, id);
+   }
+
+   if (NULL != u)
+   {
+      // asynchronous connect: call connect here
+      // otherwise wait for the UDT socket to retrieve this packet
+      if (!u->m_bSynRecving)
+         u->connect(unit->m_Packet);
+      else
+         storePkt(id, unit->m_Packet.clone());
+   }
+
+   unit->m_iFlag = 0;
+   return true;
+}
+
+void CRcvQueue::processUnit(CRcvShard* shard, CUnit* unit, const sockaddr* addr)
+{
+   CUDT* u = shard->m_pHash->lookup(unit->m_Packet.m_iID);
+
+   if ((NULL == u) || !CIPAddress::ipcmp(addr, u->m_pPeerAddr, u->m_iIPversion) || !u->m_bConnected || u->m_bBroken || u->m_bClosing)
+   {
+      unit->m_iFlag = 0;
+      return;
+   }
+
+   if (0 == unit->m_Packet.getFlag())
+      u->processData(unit);
+   else
+      u->processCtrl(unit->m_Packet);
+
+   // release the unit unless the receiver buffer has taken it (m_iFlag == 1)
+   // the application cannot read it and release it before the next ACK, which is sent by this thread
+   if (4 == unit->m_iFlag)
+      unit->m_iFlag = 0;
+
+   u->checkTimers();
+   shard->m_pRcvUList->update(u);
+}
+
+void CRcvQueue::checkTimers(CRcvShard* shard)
+{
+   // take care of the timing event for all UDT sockets whose deadline has passed
+
+   uint64_t currtime;
+   CTimer::rdtsc(currtime);
+
+   CRNode* ul = shard->m_pRcvUList->m_pUList;
+   while ((NULL != ul) && (ul->m_llTimeStamp <= currtime))
+   {
+      CUDT* u = ul->m_pUDT;
+
+      if (u->m_bConnected && !u->m_bBroken && !u->m_bClosing)
+      {
+         u->checkTimers();
+         shard->m_pRcvUList->update(u);
+      }
+      else
+      {
+         // the socket must be removed from Hash table first, then RcvUList
+         shard->m_pHash->remove(u->m_SocketID);
+         shard->m_pRcvUList->remove(u);
+         u->m_pRNode->m_bOnList = false;
+      }
+
+      ul = shard->m_pRcvUList->m_pUList;
+   }
+}
+
 int CRcvQueue::recvfrom(const int32_t& id, CPacket& packet)
 {
    CGuard bufferlock(m_PassLock);
@@ -1166,6 +1703,22 @@ int CRcvQueue::setListener(const CUDT* u)
    if (NULL != m_pListener)
       return -1;
 
+   if (0 == m_ListenerThread)
+   {
+      #ifndef WIN32
+         if (0 != pthread_create(&m_ListenerThread, NULL, CRcvQueue::listenerWorker, this))
+         {
+            m_ListenerThread = 0;
+            throw CUDTException(3, 1);
+         }
+      #else
+         DWORD threadID;
+         m_ListenerThread = CreateThread(NULL, 0, CRcvQueue::listenerWorker, this, 0, &threadID);
+         if (NULL == m_ListenerThread)
+            throw CUDTException(3, 1);
+      #endif
+   }
+
    m_pListener = (CUDT*)u;
    return 0;
 }
@@ -1181,6 +1734,9 @@ void CRcvQueue::removeListener(const CUDT* u)
 void CRcvQueue::registerConnector(const UDTSOCKET& id, CUDT* u, const int& ipv, const sockaddr* addr, const uint64_t& ttl)
 {
    m_pRendezvousQueue->insert(id, u, ipv, addr, ttl);
+
+   // the worker may be waiting with a long timeout
+   m_pChannel->interrupt();
 }
 
 void CRcvQueue::removeConnector(const UDTSOCKET& id)
@@ -1204,26 +1760,22 @@ void CRcvQueue::removeConnector(const UDTSOCKET& id)
 
 void CRcvQueue::setNewEntry(CUDT* u)
 {
-   CGuard listguard(m_IDLock);
-   m_vNewEntry.push_back(u);
-}
+   CRcvShard* s = getShard(u->m_SocketID);
 
-bool CRcvQueue::ifNewEntry()
-{
-   return !(m_vNewEntry.empty());
-}
-
-CUDT* CRcvQueue::getNewEntry()
-{
-   CGuard listguard(m_IDLock);
-
-   if (m_vNewEntry.empty())
-      return NULL;
-
-   CUDT* u = (CUDT*)*(m_vNewEntry.begin());
-   m_vNewEntry.erase(m_vNewEntry.begin());
+   CGuard listguard(s->m_Lock);
+   s->m_vNewEntry.push_back(u);
 
-   return u;
+   // wake up the thread owning the shard, it may be waiting with a long timeout
+   if (1 == m_iWorkers)
+      m_pChannel->interrupt();
+   else
+   {
+      #ifndef WIN32
+         pthread_cond_signal(&s->m_Cond);
+      #else
+         SetEvent(s->m_Cond);
+      #endif
+   }
 }
 
 void CRcvQueue::storePkt(const int32_t& id, CPacket* pkt)
@@ -1251,3 +1803,27 @@ void CRcvQueue::storePkt(const int32_t& id, CPacket* pkt)
       i->second.push(pkt);
    }
 }
+
+void CRcvQueue::passConnReq(const CPacket& packet, const sockaddr* addr)
+{
+   CGuard reqlock(m_ConnReqLock);
+
+   // the client repeats the request if it is dropped, so a flood cannot grow the queue without bound
+   if (m_vConnReq.size() >= (size_t)m_iMaxConnReq)
+      return;
+
+   CConnReq req;
+   req.m_pPacket = packet.clone();
+   memcpy(&req.m_Addr, addr, sizeof(sockaddr_in6));
+   m_vConnReq.push_back(req);
+
+   // the listener thread only waits when the queue is empty, a burst of requests wakes it up once
+   if (1 == m_vConnReq.size())
+   {
+      #ifndef WIN32
+         pthread_cond_signal(&m_ConnReqCond);
+      #else
+         SetEvent(m_ConnReqCond);
+      #endif
+   }
+}
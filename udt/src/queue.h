@@ -55,7 +55,8 @@ class CUDT;
 struct CUnit
 {
    CPacket m_Packet;		// packet
-   int m_iFlag;			// 0: free, 1: occupied, 2: msg read but not freed (out-of-order), 3: msg dropped
+   int m_iFlag;			// 0: free, 1: occupied, 2: msg read but not freed (out-of-order), 3: msg dropped, 4: reserved for a batched receive
+   uint64_t m_llArrivalTime;	// time the packet was received by the kernel, 0 if unknown
 };
 
 class CUnitQueue
@@ -81,23 +82,41 @@ public:
    int init(const int& size, const int& mss, const int& version);
 
       // Functionality:
-      //    Increase (double) the unit queue size.
+      //    Increase (double) the unit queue size; beyond the memory budget only if no unit is free.
       // Parameters:
-      //    None.
+      //    0) [in] full: the queue looks full; m_iCount is corrected, and the queue grows even beyond the budget if no unit is free.
       // Returned value:
       //    0: success, -1: failure.
 
-   int increase();
+   int increase(const bool& full = false);
 
       // Functionality:
-      //    Decrease (halve) the unit queue size.
+      //    Return the unit queues added by increase() that hold no packet to the memory pool.
       // Parameters:
       //    None.
       // Returned value:
-      //    0: success, -1: failure.
+      //    Number of units released.
 
    int shrink();
 
+      // Functionality:
+      //    Update the number of used units; the receive shards and the readers of the sockets change it concurrently.
+      // Parameters:
+      //    0) [in] delta: number of units taken (positive) or released (negative).
+      // Returned value:
+      //    None.
+
+   void addCount(const int& delta);
+
+      // Functionality:
+      //    Query how many more packets the queue can store within the memory budget of CMemPool.
+      // Parameters:
+      //    None.
+      // Returned value:
+      //    Number of packets, -1 if there is no budget.
+
+   int getAvailSize() const;
+
       // Functionality:
       //    find an available unit for incoming packet.
       // Parameters:
@@ -111,8 +130,9 @@ private:
    struct CQEntry
    {
       CUnit* m_pUnit;		// unit queue
-      char* m_pBuffer;		// data buffer
+      char* m_pBuffer;		// data buffer, a slab of CMemPool
       int m_iSize;		// size of each queue
+      int m_iNode;		// NUMA node of m_pBuffer
 
       CQEntry* m_pNext;
    }
@@ -123,7 +143,7 @@ private:
    CUnit* m_pAvailUnit;         // recent available unit
 
    int m_iSize;			// total size of the unit queue, in number of packets
-   int m_iCount;		// total number of valid packets in the queue
+   volatile int m_iCount;	// total number of valid packets in the queue, changed through addCount()
 
    int m_iMSS;			// unit buffer size
    int m_iIPversion;		// IP version
@@ -223,7 +243,7 @@ private:
 struct CRNode
 {
    CUDT* m_pUDT;                // Pointer to the instance of CUDT socket
-   uint64_t m_llTimeStamp;      // Time Stamp
+   uint64_t m_llTimeStamp;      // next time the timers of this socket should be checked
 
    CRNode* m_pPrev;             // previous link
    CRNode* m_pNext;             // next link
@@ -258,7 +278,7 @@ public:
    void remove(const CUDT* u);
 
       // Functionality:
-      //    Move the UDT instance to the end of the list, if it already exists; otherwise, do nothing.
+      //    Move the UDT instance to its new timer deadline, if it already exists; otherwise, do nothing.
       // Parameters:
       //    1) [in] u: pointer to the UDT instance
       // Returned value:
@@ -267,11 +287,15 @@ public:
    void update(const CUDT* u);
 
 public:
-   CRNode* m_pUList;		// the head node
+   CRNode* m_pUList;		// the head node, which has the earliest timer deadline
 
 private:
    CRNode* m_pLast;		// the last node
 
+private:
+   void link(CRNode* n);
+   void unlink(CRNode* n);
+
 private:
    CRcvUList(const CRcvUList&);
    CRcvUList& operator=(const CRcvUList&);
@@ -351,6 +375,8 @@ public:
 
    void updateConnStatus();
 
+   bool empty() const {return m_lRendezvousID.empty();}
+
 private:
    struct CRL
    {
@@ -381,10 +407,30 @@ public:
       // Parameters:
       //    1) [in] c: UDP channel to be associated to the queue
       //    2) [in] t: Timer
+      //    3) [in] workers: number of sending threads
+      //    4) [in] cpu: CPU the first sending thread is pinned to, the others use the next CPUs; -1 for no pinning
       // Returned value:
       //    None.
 
-   void init(const CChannel* c, const CTimer* t);
+   void init(const CChannel* c, const CTimer* t, const int& workers = 1, const int& cpu = -1);
+
+      // Functionality:
+      //    Find the sending list of the thread that sends data for a UDT socket.
+      // Parameters:
+      //    1) [in] id: UDT socket ID
+      // Returned value:
+      //    The sending list.
+
+   CSndUList* getSndUList(const UDTSOCKET& id) const;
+
+      // Functionality:
+      //    Find the NUMA node of the thread that sends data for a UDT socket.
+      // Parameters:
+      //    1) [in] id: UDT socket ID
+      // Returned value:
+      //    Node number, -1 if the thread has not started yet.
+
+   int getNode(const UDTSOCKET& id) const;
 
       // Functionality:
       //    Send out a packet to a given address.
@@ -397,24 +443,36 @@ public:
    int sendto(const sockaddr* addr, CPacket& packet);
 
 private:
+      // Each UDT socket is served by one sending thread, chosen by socket ID. Every thread has its own
+      // heap of sockets and its own timer, so the threads do not share any lock when scheduling packets.
+
+   struct CSndShard
+   {
+      CSndQueue* m_pQueue;		// the queue this shard belongs to
+      CSndUList* m_pSndUList;		// List of UDT instances for data sending
+      CTimer* m_pTimer;			// Timing facility of the sending thread
+      int m_iCPU;			// CPU the thread is pinned to, -1 if it is not pinned
+      volatile int m_iNode;		// NUMA node of the thread, the send buffers of its sockets are placed there
+
+      pthread_mutex_t m_WindowLock;
+      pthread_cond_t m_WindowCond;
+
+      pthread_t m_WorkerThread;
+   };
+
 #ifndef WIN32
    static void* worker(void* param);
 #else
    static DWORD WINAPI worker(LPVOID param);
 #endif
 
-   pthread_t m_WorkerThread;
-
 private:
-   CSndUList* m_pSndUList;		// List of UDT instances for data sending
+   CSndShard* m_pShard;			// one shard per sending thread
+   int m_iWorkers;			// number of sending threads
    CChannel* m_pChannel;                // The UDP channel for data sending
-   CTimer* m_pTimer;			// Timing facility
-
-   pthread_mutex_t m_WindowLock;
-   pthread_cond_t m_WindowCond;
+   CTimer* m_pTimer;			// Timing facility, shared with the receiving queue and used by the first thread
 
    volatile bool m_bClosing;		// closing the worker
-   pthread_cond_t m_ExitCond;
 
 private:
    CSndQueue(const CSndQueue&);
@@ -441,10 +499,11 @@ public:
       //    4) [in] hsize: hash table size
       //    5) [in] c: UDP channel to be associated to the queue
       //    6) [in] t: timer
+      //    7) [in] workers: number of threads processing the received packets, 1 to process them on the receiving thread
       // Returned value:
       //    None.
 
-   void init(const int& size, const int& payload, const int& version, const int& hsize, const CChannel* c, const CTimer* t);
+   void init(const int& size, const int& payload, const int& version, const int& hsize, const CChannel* c, const CTimer* t, const int& workers = 1);
 
       // Functionality:
       //    Read a packet for a specific UDT socket id.
@@ -457,10 +516,37 @@ public:
    int recvfrom(const int32_t& id, CPacket& packet);
 
 private:
+      // UDT sockets are divided among the workers by socket ID, so all packets of a connection are handled
+      // by the same thread in arrival order, and only that thread uses the shard's hash table and timer list.
+
+   struct CPendingUnit
+   {
+      CUnit* m_pUnit;			// received packet
+      sockaddr_in6 m_Addr;		// source address, large enough for both IP versions
+   };
+
+   struct CRcvShard
+   {
+      CRcvQueue* m_pQueue;		// the queue this shard belongs to
+      CRcvUList* m_pRcvUList;		// List of UDT instances owned by this shard, ordered by timer deadline
+      CHash* m_pHash;			// Hash table for UDT socket looking up
+
+      std::vector<CUDT*> m_vNewEntry;	// newly added entries, to be inserted
+      std::vector<CPendingUnit> m_vUnit;	// packets waiting to be processed by the shard's worker
+      pthread_mutex_t m_Lock;		// protects m_vNewEntry and m_vUnit
+      pthread_cond_t m_Cond;		// signals new entries and packets
+
+      pthread_t m_WorkerThread;
+   };
+
 #ifndef WIN32
    static void* worker(void* param);
+   static void* shardWorker(void* param);
+   static void* listenerWorker(void* param);
 #else
    static DWORD WINAPI worker(LPVOID param);
+   static DWORD WINAPI shardWorker(LPVOID param);
+   static DWORD WINAPI listenerWorker(LPVOID param);
 #endif
 
    pthread_t m_WorkerThread;
@@ -468,8 +554,8 @@ private:
 private:
    CUnitQueue m_UnitQueue;		// The received packet queue
 
-   CRcvUList* m_pRcvUList;		// List of UDT instances that will read packets from the queue
-   CHash* m_pHash;			// Hash table for UDT socket looking up
+   CRcvShard* m_pShard;			// UDT instances and their packets, one shard per worker
+   int m_iWorkers;			// number of shards, 1 if the receiving thread processes all packets
    CChannel* m_pChannel;		// UDP channel for receving packets
    CTimer* m_pTimer;			// shared timer with the snd queue
 
@@ -486,18 +572,38 @@ private:
    void removeConnector(const UDTSOCKET& id);
 
    void setNewEntry(CUDT* u);
-   bool ifNewEntry();
-   CUDT* getNewEntry();
 
    void storePkt(const int32_t& id, CPacket* pkt);
 
+   void passConnReq(const CPacket& packet, const sockaddr* addr);
+
+private:
+   CRcvShard* getShard(const int32_t& id) const;
+   void insertNewEntries(CRcvShard* shard);
+   int64_t getTimeout(const CRcvShard* shard) const;
+   bool processConnReq(CUnit* unit, const sockaddr* addr);
+   void processUnit(CRcvShard* shard, CUnit* unit, const sockaddr* addr);
+   void checkTimers(CRcvShard* shard);
+
 private:
    pthread_mutex_t m_LSLock;
    volatile CUDT* m_pListener;                          // pointer to the (unique, if any) listening UDT entity
    CRendezvousQueue* m_pRendezvousQueue;                // The list of sockets in rendezvous mode
 
-   std::vector<CUDT*> m_vNewEntry;                      // newly added entries, to be inserted
-   pthread_mutex_t m_IDLock;
+      // connection requests to the listener are processed (SYN cookie, new socket) on a separate thread,
+      // so that a burst of reconnecting clients does not delay the data packets of established connections
+
+   struct CConnReq
+   {
+      CPacket* m_pPacket;		// copy of the handshake packet
+      sockaddr_in6 m_Addr;		// source address, large enough for both IP versions
+   };
+
+   std::vector<CConnReq> m_vConnReq;                    // connection requests waiting for the listener thread
+   pthread_mutex_t m_ConnReqLock;
+   pthread_cond_t m_ConnReqCond;
+   pthread_t m_ListenerThread;                          // started with the first listener of this queue
+   static const int m_iMaxConnReq = 1024;               // requests beyond this are dropped, clients repeat them every 250ms
 
    std::map<int32_t, std::queue<CPacket*> > m_mBuffer;	// temporary buffer for rendezvous connection request
    pthread_mutex_t m_PassLock;
@@ -0,0 +1,732 @@
+/*****************************************************************************
+Copyright (c) 2001 - 2011, The Board of Trustees of the University of Illinois.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+
+* Redistributions of source code must retain the above
+  copyright notice, this list of conditions and the
+  following disclaimer.
+
+* Redistributions in binary form must reproduce the
+  above copyright notice, this list of conditions
+  and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the University of Illinois
+  nor the names of its contributors may be used to
+  endorse or promote products derived from this
+  software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*****************************************************************************/
+
+#include <set>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include "common.h"
+#include "sim.h"
+
+using namespace std;
+
+// the same defaults CUDT starts a connection with
+static const int s_iSimFlowWindow = 25600;
+static const int s_iSimInitRTT = 100000;
+static const uint64_t s_ullSimMinInt = 300000;
+static const int32_t s_iSimISN = 1;		// seq numbers do not wrap within a simulation
+static const int s_iSimAWSize = 16;		// packet arrival window, as CPktTimeWindow
+
+struct CSimFlow
+{
+   int m_iIndex;			// position in CSimulator::m_vFlows
+   CCCVirtualFactory* m_pFactory;
+   CCC* m_pCC;
+   uint64_t m_ullStart;			// nanoseconds
+   uint64_t m_ullStop;			// nanoseconds
+
+   // sender
+   int32_t m_iSndCurrSeqNo;		// largest seq no sent out
+   int32_t m_iSndLastAck;		// first seq no not acknowledged
+   set<int32_t> m_SndLossList;
+   bool m_bSending;			// if a SEND event is pending
+   int m_iRTT;
+   int m_iRTTVar;
+   int m_iDeliveryRate;
+   int m_iBandwidth;
+   int m_iEXPCount;
+   uint64_t m_ullLastRspTime;
+
+   // receiver
+   int32_t m_iRcvCurrSeqNo;		// largest seq no received
+   set<int32_t> m_RcvLossList;
+   int32_t m_iRcvLastAck;
+   int32_t m_iRcvLastAckAck;
+   uint64_t m_ullLastAckTime;
+   uint64_t m_ullNextNAKTime;
+   int m_iRcvRTT;
+   int m_iRcvRTTVar;
+   int m_iPktCount;
+   uint64_t m_ullLastArrTime;
+   int m_piPktWindow[s_iSimAWSize];	// packet arrival intervals, microseconds
+   int m_iPktWindowPtr;
+
+   // statistics
+   CSimStats m_Stats;
+   int64_t m_llQueued;			// packets that entered the bottleneck buffer
+   uint64_t m_ullQueueDelay;		// total time spent in the bottleneck buffer, nanoseconds
+   uint64_t m_ullMaxQueueDelay;
+};
+
+CSimLink::CSimLink():
+m_dRate(100),
+m_iBuffer(1000),
+m_iRTT(50000),
+m_iMSS(1500),
+m_dLoss(0),
+m_dBurstStart(0),
+m_dBurstEnd(0),
+m_dBurstLoss(0)
+{
+}
+
+CSimulator* CSimulator::s_pRunning = NULL;
+
+CSimulator::CSimulator(const CSimLink& link, const uint64_t& seed):
+m_Link(link),
+m_ullRandom(seed ? seed : 1),
+m_bBurst(false),
+m_ullTime(0),
+m_ullDuration(0),
+m_ullOrder(0),
+m_Events(),
+m_ullLinkFree(0),
+m_Queue(),
+m_ullSerialize(0),
+m_vFlows()
+{
+   if (m_Link.m_dRate > 0)
+      m_ullSerialize = (uint64_t)(m_Link.m_iMSS * 8 * 1000 / m_Link.m_dRate);
+}
+
+CSimulator::~CSimulator()
+{
+   for (vector<CSimFlow*>::iterator i = m_vFlows.begin(); i != m_vFlows.end(); ++ i)
+   {
+      delete (*i)->m_pCC;
+      delete (*i)->m_pFactory;
+      delete *i;
+   }
+}
+
+int CSimulator::addFlow(CCCVirtualFactory* factory, const uint64_t& start, const uint64_t& stop)
+{
+   // value initialized: all counters and states start at zero
+   CSimFlow* f = new CSimFlow();
+
+   f->m_iIndex = m_vFlows.size();
+   f->m_pFactory = factory->clone();
+   f->m_ullStart = start * 1000;
+   f->m_ullStop = stop * 1000;
+
+   m_vFlows.push_back(f);
+   return m_vFlows.size() - 1;
+}
+
+void CSimulator::run(const uint64_t& duration)
+{
+   s_pRunning = this;
+   CTimer::setClock(getClock);
+
+   // CUDTCC randomizes its rate decrease with rand()
+   srand((unsigned int)m_ullRandom);
+
+   m_ullTime = 0;
+   m_ullDuration = duration * 1000;
+
+   for (int i = 0, n = m_vFlows.size(); i < n; ++ i)
+   {
+      CEvent e;
+      e.m_ullTime = m_vFlows[i]->m_ullStart;
+      e.m_Type = FLOW_START;
+      e.m_iFlow = i;
+      schedule(e);
+   }
+
+   while (!m_Events.empty() && (m_Events.top().m_ullTime <= m_ullDuration))
+   {
+      CEvent e = m_Events.top();
+      m_Events.pop();
+      m_ullTime = e.m_ullTime;
+
+      CSimFlow* f = m_vFlows[e.m_iFlow];
+
+      switch (e.m_Type)
+      {
+      case FLOW_START:
+         startFlow(f);
+         break;
+
+      case SEND:
+         sendData(f);
+         break;
+
+      case DATA:
+         recvData(f, e.m_iSeqNo);
+         break;
+
+      case ACK:
+         recvACK(f, e);
+         break;
+
+      case ACK2:
+         recvACK2(f, e);
+         break;
+
+      case NAK:
+         recvNAK(f, e);
+         delete e.m_pLossList;
+         break;
+
+      case TIMER:
+         checkTimers(f);
+         break;
+      }
+   }
+
+   while (!m_Events.empty())
+   {
+      delete m_Events.top().m_pLossList;
+      m_Events.pop();
+   }
+
+   for (vector<CSimFlow*>::iterator i = m_vFlows.begin(); i != m_vFlows.end(); ++ i)
+   {
+      if (NULL != (*i)->m_pCC)
+         (*i)->m_pCC->close();
+   }
+
+   CTimer::setClock(NULL);
+   s_pRunning = NULL;
+}
+
+void CSimulator::getStats(const int& flow, CSimStats& stats) const
+{
+   const CSimFlow* f = m_vFlows[flow];
+
+   stats = f->m_Stats;
+
+   // everything up to the first hole could have been read by the application
+   int32_t delivered = (f->m_RcvLossList.empty() ? f->m_iRcvCurrSeqNo + 1 : *f->m_RcvLossList.begin()) - s_iSimISN;
+   uint64_t end = (f->m_ullStop < m_ullDuration) ? f->m_ullStop : m_ullDuration;
+   int payload = m_Link.m_iMSS - CPacket::m_iPktHdrSize - 28;
+
+   stats.m_dGoodput = 0;
+   if ((end > f->m_ullStart) && (delivered > 0))
+      stats.m_dGoodput = double(delivered) * payload * 8.0 * 1000.0 / (end - f->m_ullStart);
+
+   stats.m_dAvgQueueDelay = (f->m_llQueued > 0) ? f->m_ullQueueDelay / 1000000.0 / f->m_llQueued : 0;
+   stats.m_dMaxQueueDelay = f->m_ullMaxQueueDelay / 1000000.0;
+}
+
+double CSimulator::getFairness() const
+{
+   double sum = 0;
+   double sqsum = 0;
+
+   for (int i = 0, n = m_vFlows.size(); i < n; ++ i)
+   {
+      CSimStats s;
+      getStats(i, s);
+      sum += s.m_dGoodput;
+      sqsum += s.m_dGoodput * s.m_dGoodput;
+   }
+
+   if (sqsum <= 0)
+      return 0;
+
+   return sum * sum / (m_vFlows.size() * sqsum);
+}
+
+double CSimulator::getUtilization() const
+{
+   if ((m_Link.m_dRate <= 0) || (0 == m_ullDuration))
+      return 0;
+
+   double bits = 0;
+
+   for (int i = 0, n = m_vFlows.size(); i < n; ++ i)
+   {
+      CSimStats s;
+      getStats(i, s);
+
+      const CSimFlow* f = m_vFlows[i];
+      uint64_t end = (f->m_ullStop < m_ullDuration) ? f->m_ullStop : m_ullDuration;
+      if (end > f->m_ullStart)
+         bits += s.m_dGoodput * (end - f->m_ullStart) / 1000.0;
+   }
+
+   return bits / (m_Link.m_dRate * m_ullDuration / 1000.0);
+}
+
+void CSimulator::schedule(CEvent& e)
+{
+   e.m_ullOrder = m_ullOrder ++;
+   m_Events.push(e);
+}
+
+void CSimulator::startFlow(CSimFlow* f)
+{
+   f->m_pCC = f->m_pFactory->create();
+
+   f->m_iSndCurrSeqNo = s_iSimISN - 1;
+   f->m_iSndLastAck = s_iSimISN;
+   f->m_iRTT = s_iSimInitRTT;
+   f->m_iRTTVar = s_iSimInitRTT >> 1;
+   f->m_iDeliveryRate = 16;
+   f->m_iBandwidth = 1;
+   f->m_iEXPCount = 1;
+   f->m_ullLastRspTime = m_ullTime;
+
+   f->m_iRcvCurrSeqNo = s_iSimISN - 1;
+   f->m_iRcvLastAck = s_iSimISN;
+   f->m_iRcvLastAckAck = s_iSimISN;
+   f->m_iRcvRTT = s_iSimInitRTT;
+   f->m_iRcvRTTVar = s_iSimInitRTT >> 1;
+   f->m_ullNextNAKTime = m_ullTime + s_ullSimMinInt * 1000;
+   for (int i = 0; i < s_iSimAWSize; ++ i)
+      f->m_piPktWindow[i] = 1000000;
+
+   f->m_pCC->m_UDT = UDT::INVALID_SOCK;
+   f->m_pCC->setMSS(m_Link.m_iMSS);
+   f->m_pCC->setMaxCWndSize(s_iSimFlowWindow);
+   updateCC(f);
+   f->m_pCC->init();
+
+   CEvent e;
+   e.m_ullTime = m_ullTime + (uint64_t)((f->m_pCC->m_iACKPeriod > 0) ? f->m_pCC->m_iACKPeriod : f->m_pCC->m_iSYNInterval) * 1000;
+   e.m_Type = TIMER;
+   e.m_iFlow = f->m_iIndex;
+   schedule(e);
+
+   wakeSender(f);
+}
+
+void CSimulator::sendData(CSimFlow* f)
+{
+   f->m_bSending = false;
+
+   while (!f->m_SndLossList.empty() && (*f->m_SndLossList.begin() < f->m_iSndLastAck))
+      f->m_SndLossList.erase(f->m_SndLossList.begin());
+
+   int32_t seqno;
+   bool retrans = false;
+
+   // retransmissions go first and are not limited by the window, as in CUDT::packData()
+   if (!f->m_SndLossList.empty())
+   {
+      seqno = *f->m_SndLossList.begin();
+      f->m_SndLossList.erase(f->m_SndLossList.begin());
+      retrans = true;
+   }
+   else
+   {
+      double cwnd = (f->m_pCC->m_dCWndSize < s_iSimFlowWindow) ? f->m_pCC->m_dCWndSize : s_iSimFlowWindow;
+      int flight = f->m_iSndCurrSeqNo - f->m_iSndLastAck + 1;
+
+      // stay idle until an ACK, NAK or timeout wakes the sender up
+      if ((m_ullTime >= f->m_ullStop) || ((int)cwnd < flight + 1))
+         return;
+
+      seqno = ++ f->m_iSndCurrSeqNo;
+      f->m_pCC->setSndCurrSeqNo(seqno);
+   }
+
+   transmit(f, seqno, retrans);
+
+   CPacket packet;
+   packet.m_iSeqNo = seqno;
+   packet.setLength(m_Link.m_iMSS - CPacket::m_iPktHdrSize - 28);
+   f->m_pCC->onPktSent(&packet);
+
+   CEvent e;
+   e.m_ullTime = m_ullTime + (uint64_t)(f->m_pCC->m_dPktSndPeriod * 1000);
+   e.m_Type = SEND;
+   e.m_iFlow = f->m_iIndex;
+   schedule(e);
+   f->m_bSending = true;
+}
+
+void CSimulator::transmit(CSimFlow* f, const int32_t& seqno, const bool& retrans)
+{
+   ++ f->m_Stats.m_llSent;
+   if (retrans)
+      ++ f->m_Stats.m_llRetrans;
+
+   while (!m_Queue.empty() && (m_Queue.front() <= m_ullTime))
+      m_Queue.pop_front();
+
+   if ((int)m_Queue.size() >= m_Link.m_iBuffer)
+   {
+      ++ f->m_Stats.m_llDropped;
+      return;
+   }
+
+   uint64_t start = (m_ullLinkFree > m_ullTime) ? m_ullLinkFree : m_ullTime;
+   m_ullLinkFree = start + m_ullSerialize;
+   m_Queue.push_back(m_ullLinkFree);
+
+   uint64_t delay = start - m_ullTime;
+   ++ f->m_llQueued;
+   f->m_ullQueueDelay += delay;
+   if (delay > f->m_ullMaxQueueDelay)
+      f->m_ullMaxQueueDelay = delay;
+
+   // random loss happens after the bottleneck, so the lost packet still used its capacity
+   if (isLost())
+   {
+      ++ f->m_Stats.m_llLost;
+      return;
+   }
+
+   CEvent e;
+   e.m_ullTime = m_ullLinkFree + (uint64_t)m_Link.m_iRTT * 500;
+   e.m_Type = DATA;
+   e.m_iFlow = f->m_iIndex;
+   e.m_iSeqNo = seqno;
+   e.m_bRetrans = retrans;
+   schedule(e);
+}
+
+void CSimulator::recvData(CSimFlow* f, const int32_t& seqno)
+{
+   // packet arrival speed, as measured by CPktTimeWindow
+   if (f->m_ullLastArrTime > 0)
+   {
+      f->m_piPktWindow[f->m_iPktWindowPtr] = (int)((m_ullTime - f->m_ullLastArrTime) / 1000);
+      f->m_iPktWindowPtr = (f->m_iPktWindowPtr + 1) % s_iSimAWSize;
+   }
+   f->m_ullLastArrTime = m_ullTime;
+
+   ++ f->m_iPktCount;
+
+   if (seqno > f->m_iRcvCurrSeqNo)
+   {
+      // a gap: report it at once
+      if (seqno > f->m_iRcvCurrSeqNo + 1)
+      {
+         vector<int32_t>* losslist = new vector<int32_t>;
+
+         for (int32_t i = f->m_iRcvCurrSeqNo + 1; i < seqno; ++ i)
+            f->m_RcvLossList.insert(i);
+
+         if (seqno - 1 == f->m_iRcvCurrSeqNo + 1)
+            losslist->push_back(seqno - 1);
+         else
+         {
+            losslist->push_back((f->m_iRcvCurrSeqNo + 1) | 0x80000000);
+            losslist->push_back(seqno - 1);
+         }
+
+         sendNAK(f, losslist);
+      }
+
+      f->m_iRcvCurrSeqNo = seqno;
+   }
+   else
+      f->m_RcvLossList.erase(seqno);
+
+   if ((f->m_pCC->m_iACKInterval > 0) && (f->m_pCC->m_iACKInterval <= f->m_iPktCount))
+      sendACK(f);
+}
+
+void CSimulator::sendACK(CSimFlow* f)
+{
+   f->m_iPktCount = 0;
+
+   int32_t ack = f->m_RcvLossList.empty() ? f->m_iRcvCurrSeqNo + 1 : *f->m_RcvLossList.begin();
+
+   // same rules as CUDT::sendCtrl(): nothing new, or the last ACK is recent
+   if (ack == f->m_iRcvLastAckAck)
+      return;
+
+   if (ack > f->m_iRcvLastAck)
+      f->m_iRcvLastAck = ack;
+   else if (ack == f->m_iRcvLastAck)
+   {
+      if (m_ullTime - f->m_ullLastAckTime < (uint64_t)(f->m_iRcvRTT + 4 * f->m_iRcvRTTVar) * 1000)
+         return;
+   }
+   else
+      return;
+
+   // median filtered arrival speed, as CPktTimeWindow::getPktRcvSpeed()
+   int replica[s_iSimAWSize];
+   memcpy(replica, f->m_piPktWindow, sizeof(replica));
+   nth_element(replica, replica + (s_iSimAWSize / 2), replica + s_iSimAWSize);
+   int median = replica[s_iSimAWSize / 2];
+   int count = 0;
+   int sum = 0;
+   for (int i = 0; i < s_iSimAWSize; ++ i)
+   {
+      if ((f->m_piPktWindow[i] < (median << 3)) && (f->m_piPktWindow[i] > (median >> 3)))
+      {
+         ++ count;
+         sum += f->m_piPktWindow[i];
+      }
+   }
+   int rcvrate = (count > (s_iSimAWSize >> 1)) ? (int)(1000000.0 / (sum / count)) : 0;
+
+   f->m_ullLastAckTime = m_ullTime;
+
+   // the reverse path has no queue and no loss
+   CEvent e;
+   e.m_ullTime = m_ullTime + (uint64_t)m_Link.m_iRTT * 500;
+   e.m_Type = ACK;
+   e.m_iFlow = f->m_iIndex;
+   e.m_iSeqNo = ack;
+   e.m_iRTT = f->m_iRcvRTT;
+   e.m_iRcvRate = rcvrate;
+   // the packet pairs UDT sends measure exactly the bottleneck capacity in this model
+   e.m_iBandwidth = (m_ullSerialize > 0) ? (int)(1000000000ULL / m_ullSerialize) : 0;
+   e.m_ullStamp = m_ullTime;
+   schedule(e);
+}
+
+void CSimulator::sendNAK(CSimFlow* f, vector<int32_t>* losslist)
+{
+   CEvent e;
+   e.m_ullTime = m_ullTime + (uint64_t)m_Link.m_iRTT * 500;
+   e.m_Type = NAK;
+   e.m_iFlow = f->m_iIndex;
+   e.m_pLossList = losslist;
+   schedule(e);
+}
+
+void CSimulator::recvACK(CSimFlow* f, const CEvent& e)
+{
+   f->m_iEXPCount = 1;
+   f->m_ullLastRspTime = m_ullTime;
+
+   // ACK2 goes back over the forward path, behind the packets in the bottleneck buffer
+   CEvent ack2;
+   ack2.m_ullTime = m_ullTime + getQueueDelay() + (uint64_t)m_Link.m_iRTT * 500;
+   ack2.m_Type = ACK2;
+   ack2.m_iFlow = e.m_iFlow;
+   ack2.m_iSeqNo = e.m_iSeqNo;
+   ack2.m_ullStamp = e.m_ullStamp;
+   schedule(ack2);
+
+   // repeated ACKs are discarded before the congestion control sees them
+   if (e.m_iSeqNo <= f->m_iSndLastAck)
+      return;
+
+   f->m_iSndLastAck = e.m_iSeqNo;
+
+   f->m_iRTTVar = (f->m_iRTTVar * 3 + abs(e.m_iRTT - f->m_iRTT)) >> 2;
+   f->m_iRTT = (f->m_iRTT * 7 + e.m_iRTT) >> 3;
+   if (e.m_iRcvRate > 0)
+      f->m_iDeliveryRate = (f->m_iDeliveryRate * 7 + e.m_iRcvRate) >> 3;
+   if (e.m_iBandwidth > 0)
+      f->m_iBandwidth = (f->m_iBandwidth * 7 + e.m_iBandwidth) >> 3;
+
+   updateCC(f);
+   f->m_pCC->onACK(e.m_iSeqNo);
+
+   wakeSender(f);
+}
+
+void CSimulator::recvACK2(CSimFlow* f, const CEvent& e)
+{
+   int rtt = (int)((m_ullTime - e.m_ullStamp) / 1000);
+   f->m_iRcvRTTVar = (f->m_iRcvRTTVar * 3 + abs(rtt - f->m_iRcvRTT)) >> 2;
+   f->m_iRcvRTT = (f->m_iRcvRTT * 7 + rtt) >> 3;
+
+   if (e.m_iSeqNo > f->m_iRcvLastAckAck)
+      f->m_iRcvLastAckAck = e.m_iSeqNo;
+}
+
+void CSimulator::recvNAK(CSimFlow* f, const CEvent& e)
+{
+   f->m_iEXPCount = 1;
+   f->m_ullLastRspTime = m_ullTime;
+
+   vector<int32_t>& losslist = *e.m_pLossList;
+
+   for (size_t i = 0, n = losslist.size(); i < n; ++ i)
+   {
+      int32_t first = losslist[i] & 0x7FFFFFFF;
+      int32_t last = first;
+      if ((losslist[i] & 0x80000000) && (i + 1 < n))
+         last = losslist[++ i];
+
+      if (first < f->m_iSndLastAck)
+         first = f->m_iSndLastAck;
+      if (last > f->m_iSndCurrSeqNo)
+         last = f->m_iSndCurrSeqNo;
+
+      for (int32_t s = first; s <= last; ++ s)
+         f->m_SndLossList.insert(s);
+   }
+
+   updateCC(f);
+   f->m_pCC->onLoss(&losslist[0], losslist.size());
+
+   wakeSender(f);
+}
+
+void CSimulator::checkTimers(CSimFlow* f)
+{
+   // receiver: periodic ACK, and NAK report for the losses not repaired yet
+   sendACK(f);
+
+   if (!f->m_RcvLossList.empty() && (m_ullTime > f->m_ullNextNAKTime))
+   {
+      vector<int32_t>* losslist = new vector<int32_t>;
+
+      set<int32_t>::iterator i = f->m_RcvLossList.begin();
+      while (i != f->m_RcvLossList.end())
+      {
+         int32_t first = *i;
+         int32_t last = first;
+         for (++ i; (i != f->m_RcvLossList.end()) && (*i == last + 1); ++ i)
+            last = *i;
+
+         if (first == last)
+            losslist->push_back(first);
+         else
+         {
+            losslist->push_back(first | 0x80000000);
+            losslist->push_back(last);
+         }
+      }
+
+      sendNAK(f, losslist);
+
+      uint64_t nakint = f->m_iRcvRTT + 4 * f->m_iRcvRTTVar;
+      int sum = 0;
+      for (int j = 0; j < s_iSimAWSize; ++ j)
+         sum += f->m_piPktWindow[j];
+      if (sum > 0)
+         nakint += f->m_RcvLossList.size() * (uint64_t)sum / s_iSimAWSize;
+      if (nakint < s_ullSimMinInt)
+         nakint = s_ullSimMinInt;
+      f->m_ullNextNAKTime = m_ullTime + nakint * 1000;
+   }
+
+   // sender: EXP timer, as CUDT::checkTimers()
+   uint64_t expint;
+   if (f->m_pCC->m_bUserDefinedRTO)
+      expint = f->m_pCC->m_iRTO;
+   else
+   {
+      expint = f->m_iEXPCount * (f->m_iRTT + 4 * f->m_iRTTVar) + f->m_pCC->m_iSYNInterval;
+      if (expint < f->m_iEXPCount * s_ullSimMinInt)
+         expint = f->m_iEXPCount * s_ullSimMinInt;
+   }
+
+   if (m_ullTime > f->m_ullLastRspTime + expint * 1000)
+   {
+      bool unacked = (f->m_iSndCurrSeqNo + 1 != f->m_iSndLastAck);
+
+      if (unacked || (m_ullTime < f->m_ullStop))
+      {
+         if (unacked && f->m_SndLossList.empty())
+         {
+            for (int32_t s = f->m_iSndLastAck; s <= f->m_iSndCurrSeqNo; ++ s)
+               f->m_SndLossList.insert(s);
+         }
+
+         ++ f->m_Stats.m_iTimeouts;
+         updateCC(f);
+         f->m_pCC->onTimeout();
+         wakeSender(f);
+      }
+
+      ++ f->m_iEXPCount;
+      f->m_ullLastRspTime = m_ullTime;
+   }
+
+   CEvent e;
+   e.m_ullTime = m_ullTime + (uint64_t)((f->m_pCC->m_iACKPeriod > 0) ? f->m_pCC->m_iACKPeriod : f->m_pCC->m_iSYNInterval) * 1000;
+   e.m_Type = TIMER;
+   e.m_iFlow = f->m_iIndex;
+   schedule(e);
+}
+
+void CSimulator::wakeSender(CSimFlow* f)
+{
+   if (f->m_bSending)
+      return;
+
+   CEvent e;
+   e.m_ullTime = m_ullTime;
+   e.m_Type = SEND;
+   e.m_iFlow = f->m_iIndex;
+   schedule(e);
+   f->m_bSending = true;
+}
+
+void CSimulator::updateCC(CSimFlow* f)
+{
+   f->m_pCC->setRTT(f->m_iRTT);
+   f->m_pCC->setRcvRate(f->m_iDeliveryRate);
+   f->m_pCC->setBandwidth(f->m_iBandwidth);
+   f->m_pCC->setSndCurrSeqNo(f->m_iSndCurrSeqNo);
+
+   // what getPerfInfo() returns to the congestion control
+   CPerfMon& perf = f->m_pCC->m_PerfInfo;
+   perf.pktFlightSize = f->m_iSndCurrSeqNo - f->m_iSndLastAck + 1;
+   perf.msRTT = f->m_iRTT / 1000.0;
+   perf.mbpsBandwidth = f->m_iBandwidth * (m_Link.m_iMSS - CPacket::m_iPktHdrSize - 28) * 8.0 / 1000000.0;
+   perf.pktCongestionWindow = (int)f->m_pCC->m_dCWndSize;
+   perf.usPktSndPeriod = f->m_pCC->m_dPktSndPeriod;
+}
+
+bool CSimulator::isLost()
+{
+   // Gilbert-Elliott: a two state chain, with its own loss rate in each state
+   if (m_Link.m_dBurstStart > 0)
+   {
+      if (m_bBurst)
+         m_bBurst = (random() >= m_Link.m_dBurstEnd);
+      else
+         m_bBurst = (random() < m_Link.m_dBurstStart);
+   }
+
+   double loss = m_bBurst ? m_Link.m_dBurstLoss : m_Link.m_dLoss;
+
+   return (loss > 0) && (random() < loss);
+}
+
+double CSimulator::random()
+{
+   // xorshift64*
+   m_ullRandom ^= m_ullRandom >> 12;
+   m_ullRandom ^= m_ullRandom << 25;
+   m_ullRandom ^= m_ullRandom >> 27;
+
+   return ((m_ullRandom * 2685821657736338717ULL) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+uint64_t CSimulator::getQueueDelay()
+{
+   return (m_ullLinkFree > m_ullTime) ? m_ullLinkFree - m_ullTime : 0;
+}
+
+uint64_t CSimulator::getClock()
+{
+   return s_pRunning->m_ullTime / 1000;
+}
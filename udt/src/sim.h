@@ -0,0 +1,206 @@
+/*****************************************************************************
+Copyright (c) 2001 - 2011, The Board of Trustees of the University of Illinois.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+
+* Redistributions of source code must retain the above
+  copyright notice, this list of conditions and the
+  following disclaimer.
+
+* Redistributions in binary form must reproduce the
+  above copyright notice, this list of conditions
+  and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the University of Illinois
+  nor the names of its contributors may be used to
+  endorse or promote products derived from this
+  software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*****************************************************************************/
+
+#ifndef __UDT_SIM_H__
+#define __UDT_SIM_H__
+
+
+#include <vector>
+#include <deque>
+#include <queue>
+#include "udt.h"
+#include "ccc.h"
+
+
+// The simulated path: one bottleneck link shared by all flows.
+struct CSimLink
+{
+   CSimLink();
+
+   double m_dRate;			// bottleneck rate, Mb/s
+   int m_iBuffer;			// bottleneck buffer (FIFO, drop tail), packets
+   int m_iRTT;				// round trip propagation delay, microseconds
+   int m_iMSS;				// packet size on the wire, bytes, including IP/UDP/UDT headers
+   double m_dLoss;			// probability that a data packet is lost after the bottleneck, 0 to 1
+   double m_dBurstStart;		// probability per packet to enter a loss burst (Gilbert-Elliott), 0 for none
+   double m_dBurstEnd;			// probability per packet to leave the loss burst
+   double m_dBurstLoss;		// loss probability while in a burst
+};
+
+// Measurements of one simulated flow.
+struct CSimStats
+{
+   double m_dGoodput;			// data delivered in order to the receiver over the life of the flow, Mb/s
+   int64_t m_llSent;			// data packets sent, including retransmissions
+   int64_t m_llRetrans;		// retransmitted data packets
+   int64_t m_llDropped;		// data packets dropped by the full bottleneck buffer
+   int64_t m_llLost;			// data packets lost on the link (random or burst loss)
+   int m_iTimeouts;			// EXP timeouts
+   double m_dAvgQueueDelay;		// average time a data packet waited in the bottleneck buffer, milliseconds
+   double m_dMaxQueueDelay;		// longest wait in the bottleneck buffer, milliseconds
+};
+
+struct CSimFlow;
+
+// Deterministic discrete event simulation of UDT flows over a CSimLink. Each flow runs a CCC
+// instance through the same callbacks CUDT uses (ACK every SYN, ACK2, NAK, periodic NAK, EXP) in
+// simulated time: CTimer::getTime() returns the simulated clock while run() executes. Results
+// only depend on the link, the flows and the seed. It is built into libudtsim.a, not libudt.
+class CSimulator
+{
+public:
+   CSimulator(const CSimLink& link, const uint64_t& seed = 1);
+   ~CSimulator();
+
+public:
+
+      // Functionality:
+      //    Add a bulk transfer flow. The sender always has data between "start" and "stop".
+      // Parameters:
+      //    0) [in] factory: creates the congestion control of the flow.
+      //    1) [in] start: time the flow starts, microseconds.
+      //    2) [in] stop: time the flow stops sending new data, microseconds.
+      // Returned value:
+      //    Index of the flow.
+
+   int addFlow(CCCVirtualFactory* factory, const uint64_t& start, const uint64_t& stop);
+
+      // Functionality:
+      //    Run the simulation. Only one simulator may run at a time, and no UDT socket may be open.
+      // Parameters:
+      //    0) [in] duration: simulated time, microseconds.
+      // Returned value:
+      //    None.
+
+   void run(const uint64_t& duration);
+
+      // Functionality:
+      //    Read the measurements of a flow after run().
+      // Parameters:
+      //    0) [in] flow: index returned by addFlow().
+      //    1) [out] stats: measurements of the flow.
+      // Returned value:
+      //    None.
+
+   void getStats(const int& flow, CSimStats& stats) const;
+
+      // Functionality:
+      //    Jain's fairness index of the flow goodputs, 1 if all flows got the same share.
+      // Parameters:
+      //    None.
+      // Returned value:
+      //    Fairness index, 1/n to 1.
+
+   double getFairness() const;
+
+      // Functionality:
+      //    Share of the bottleneck rate that was delivered as goodput by all flows.
+      // Parameters:
+      //    None.
+      // Returned value:
+      //    Utilization, 0 to 1.
+
+   double getUtilization() const;
+
+private:
+   enum EventType {FLOW_START, SEND, DATA, ACK, ACK2, NAK, TIMER};
+
+   struct CEvent
+   {
+      CEvent(): m_ullTime(0), m_ullOrder(0), m_Type(SEND), m_iFlow(0), m_iSeqNo(0), m_iRTT(0), m_iRcvRate(0),
+         m_iBandwidth(0), m_ullStamp(0), m_bRetrans(false), m_pLossList(NULL) {}
+
+      uint64_t m_ullTime;		// when the event happens, nanoseconds
+      uint64_t m_ullOrder;		// insertion order, breaks ties so that the run is deterministic
+      EventType m_Type;
+      int m_iFlow;
+      int32_t m_iSeqNo;			// data seq no, or ACK seq no
+      int m_iRTT;			// ACK: RTT estimated by the receiver
+      int m_iRcvRate;			// ACK: packet arrival speed at the receiver
+      int m_iBandwidth;			// ACK: bottleneck capacity estimate
+      uint64_t m_ullStamp;		// ACK, ACK2: time the ACK was sent
+      bool m_bRetrans;			// DATA: if the packet is a retransmission
+      std::vector<int32_t>* m_pLossList;	// NAK: loss list in the UDT packet format
+
+      bool operator>(const CEvent& e) const
+      {
+         return (m_ullTime > e.m_ullTime) || ((m_ullTime == e.m_ullTime) && (m_ullOrder > e.m_ullOrder));
+      }
+   };
+
+   void schedule(CEvent& e);
+   void startFlow(CSimFlow* f);
+   void sendData(CSimFlow* f);
+   void transmit(CSimFlow* f, const int32_t& seqno, const bool& retrans);
+   void recvData(CSimFlow* f, const int32_t& seqno);
+   void sendACK(CSimFlow* f);
+   void sendNAK(CSimFlow* f, std::vector<int32_t>* losslist);
+   void recvACK(CSimFlow* f, const CEvent& e);
+   void recvACK2(CSimFlow* f, const CEvent& e);
+   void recvNAK(CSimFlow* f, const CEvent& e);
+   void checkTimers(CSimFlow* f);
+   void wakeSender(CSimFlow* f);
+   void updateCC(CSimFlow* f);
+   bool isLost();
+   double random();
+   uint64_t getQueueDelay();
+
+   static uint64_t getClock();
+
+private:
+   CSimLink m_Link;
+   uint64_t m_ullRandom;		// xorshift state; the standard library generators differ between platforms
+   bool m_bBurst;			// if the link is in a loss burst
+
+   uint64_t m_ullTime;			// current simulated time, nanoseconds
+   uint64_t m_ullDuration;		// simulated time of the last run, nanoseconds
+   uint64_t m_ullOrder;		// number of events scheduled
+   std::priority_queue<CEvent, std::vector<CEvent>, std::greater<CEvent> > m_Events;
+
+   uint64_t m_ullLinkFree;		// when the bottleneck finishes sending the packets queued so far
+   std::deque<uint64_t> m_Queue;	// departure times of the packets in the bottleneck buffer
+   uint64_t m_ullSerialize;		// time to send one packet on the bottleneck, nanoseconds
+
+   std::vector<CSimFlow*> m_vFlows;
+
+   static CSimulator* s_pRunning;	// simulator behind CTimer::getTime() during run()
+
+private:
+   CSimulator(const CSimulator&);
+   CSimulator& operator=(const CSimulator&);
+};
+
+
+#endif
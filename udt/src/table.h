@@ -0,0 +1,440 @@
+/*****************************************************************************
+Copyright (c) 2001 - 2011, The Board of Trustees of the University of Illinois.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+
+* Redistributions of source code must retain the above
+  copyright notice, this list of conditions and the
+  following disclaimer.
+
+* Redistributions in binary form must reproduce the
+  above copyright notice, this list of conditions
+  and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the University of Illinois
+  nor the names of its contributors may be used to
+  endorse or promote products derived from this
+  software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*****************************************************************************/
+
+#ifndef __UDT_TABLE_H__
+#define __UDT_TABLE_H__
+
+#include <vector>
+
+#include "common.h"
+#include "udt.h"
+
+// Open addressing hash table split into independently locked shards.
+// Lookups on different shards never touch the same lock, and lookups on the same
+// shard only share it (read lock), so the table scales with the number of reader threads.
+// A key may be inserted more than once with different values (see findAll()).
+// K must be an integer type; V must be copyable and comparable with "==".
+
+template<typename K, typename V> class CHashTable
+{
+public:
+   CHashTable()
+   {
+      for (int i = 0; i < m_iShards; ++ i)
+      {
+         m_pShards[i].m_pEntries = NULL;
+         m_pShards[i].m_iCapacity = 0;
+         m_pShards[i].m_iSize = 0;
+         m_pShards[i].m_iUsed = 0;
+         #ifndef WIN32
+            pthread_rwlock_init(&m_pShards[i].m_Lock, NULL);
+         #else
+            CGuard::createMutex(m_pShards[i].m_Lock);
+         #endif
+      }
+   }
+
+   ~CHashTable()
+   {
+      for (int i = 0; i < m_iShards; ++ i)
+      {
+         delete [] m_pShards[i].m_pEntries;
+         #ifndef WIN32
+            pthread_rwlock_destroy(&m_pShards[i].m_Lock);
+         #else
+            CGuard::releaseMutex(m_pShards[i].m_Lock);
+         #endif
+      }
+   }
+
+public:
+      // Functionality:
+      //    look up the first value stored for a key.
+      // Parameters:
+      //    0) [in] key: the key to look up.
+      //    1) [out] value: the value found.
+      // Returned value:
+      //    true if the key exists, otherwise false.
+
+   bool find(const K& key, V& value) const
+   {
+      const uint64_t h = hash(key);
+      const CShard& shard = m_pShards[h >> (64 - m_iShardBits)];
+
+      readLock(shard);
+
+      bool found = false;
+      if (shard.m_iCapacity > 0)
+      {
+         const int mask = shard.m_iCapacity - 1;
+         for (int i = slot(h, mask); EMPTY != shard.m_pEntries[i].m_iState; i = (i + 1) & mask)
+         {
+            if ((FULL == shard.m_pEntries[i].m_iState) && (key == shard.m_pEntries[i].m_Key))
+            {
+               value = shard.m_pEntries[i].m_Value;
+               found = true;
+               break;
+            }
+         }
+      }
+
+      unlock(shard);
+
+      return found;
+   }
+
+      // Functionality:
+      //    look up all the values stored for a key.
+      // Parameters:
+      //    0) [in] key: the key to look up.
+      //    1) [out] values: the values found, appended to the vector.
+      // Returned value:
+      //    None.
+
+   void findAll(const K& key, std::vector<V>& values) const
+   {
+      const uint64_t h = hash(key);
+      const CShard& shard = m_pShards[h >> (64 - m_iShardBits)];
+
+      readLock(shard);
+
+      if (shard.m_iCapacity > 0)
+      {
+         const int mask = shard.m_iCapacity - 1;
+         for (int i = slot(h, mask); EMPTY != shard.m_pEntries[i].m_iState; i = (i + 1) & mask)
+         {
+            if ((FULL == shard.m_pEntries[i].m_iState) && (key == shard.m_pEntries[i].m_Key))
+               values.push_back(shard.m_pEntries[i].m_Value);
+         }
+      }
+
+      unlock(shard);
+   }
+
+      // Functionality:
+      //    store a (key, value) pair; nothing is done if the same pair already exists.
+      // Parameters:
+      //    0) [in] key: the key.
+      //    1) [in] value: the value.
+      // Returned value:
+      //    None.
+
+   void insert(const K& key, const V& value)
+   {
+      const uint64_t h = hash(key);
+      CShard& shard = m_pShards[h >> (64 - m_iShardBits)];
+
+      writeLock(shard);
+
+      // keep the table at most 3/4 full, counting the deleted entries, so that probing always ends
+      if ((shard.m_iUsed + 1) * 4 > shard.m_iCapacity * 3)
+      {
+         try
+         {
+            rebuild(shard);
+         }
+         catch (...)
+         {
+            unlock(shard);
+            throw;
+         }
+      }
+
+      const int mask = shard.m_iCapacity - 1;
+      int pos = -1;
+      int i;
+      for (i = slot(h, mask); EMPTY != shard.m_pEntries[i].m_iState; i = (i + 1) & mask)
+      {
+         if (FULL == shard.m_pEntries[i].m_iState)
+         {
+            if ((key == shard.m_pEntries[i].m_Key) && (value == shard.m_pEntries[i].m_Value))
+            {
+               unlock(shard);
+               return;
+            }
+         }
+         else if (pos < 0)
+            pos = i;
+      }
+
+      // reuse the first deleted entry on the probing path
+      if (pos < 0)
+      {
+         pos = i;
+         ++ shard.m_iUsed;
+      }
+
+      shard.m_pEntries[pos].m_Key = key;
+      shard.m_pEntries[pos].m_Value = value;
+      shard.m_pEntries[pos].m_iState = FULL;
+      ++ shard.m_iSize;
+
+      unlock(shard);
+   }
+
+      // Functionality:
+      //    remove all the values stored for a key.
+      // Parameters:
+      //    0) [in] key: the key to remove.
+      // Returned value:
+      //    true if anything was removed, otherwise false.
+
+   bool erase(const K& key)
+   {
+      return remove(key, NULL);
+   }
+
+      // Functionality:
+      //    remove one (key, value) pair.
+      // Parameters:
+      //    0) [in] key: the key.
+      //    1) [in] value: the value stored with the key.
+      // Returned value:
+      //    true if the pair was removed, otherwise false.
+
+   bool erase(const K& key, const V& value)
+   {
+      return remove(key, &value);
+   }
+
+      // Functionality:
+      //    copy out all the values in the table.
+      // Parameters:
+      //    0) [out] values: the values, appended to the vector.
+      // Returned value:
+      //    None.
+
+   void getValues(std::vector<V>& values) const
+   {
+      for (int s = 0; s < m_iShards; ++ s)
+      {
+         const CShard& shard = m_pShards[s];
+
+         readLock(shard);
+         for (int i = 0; i < shard.m_iCapacity; ++ i)
+         {
+            if (FULL == shard.m_pEntries[i].m_iState)
+               values.push_back(shard.m_pEntries[i].m_Value);
+         }
+         unlock(shard);
+      }
+   }
+
+      // Functionality:
+      //    count the (key, value) pairs in the table.
+      // Parameters:
+      //    None.
+      // Returned value:
+      //    Number of pairs.
+
+   int size() const
+   {
+      int size = 0;
+      for (int s = 0; s < m_iShards; ++ s)
+      {
+         readLock(m_pShards[s]);
+         size += m_pShards[s].m_iSize;
+         unlock(m_pShards[s]);
+      }
+
+      return size;
+   }
+
+      // Functionality:
+      //    remove everything from the table.
+      // Parameters:
+      //    None.
+      // Returned value:
+      //    None.
+
+   void clear()
+   {
+      for (int s = 0; s < m_iShards; ++ s)
+      {
+         CShard& shard = m_pShards[s];
+
+         writeLock(shard);
+         delete [] shard.m_pEntries;
+         shard.m_pEntries = NULL;
+         shard.m_iCapacity = 0;
+         shard.m_iSize = 0;
+         shard.m_iUsed = 0;
+         unlock(shard);
+      }
+   }
+
+private:
+   enum EState {EMPTY = 0, FULL, DELETED};
+
+   struct CEntry
+   {
+      K m_Key;
+      V m_Value;
+      char m_iState;                    // EState
+   };
+
+   struct CShard
+   {
+      CEntry* m_pEntries;               // slots, m_iCapacity of them (a power of 2)
+      int m_iCapacity;
+      int m_iSize;                      // number of FULL slots
+      int m_iUsed;                      // number of FULL and DELETED slots
+
+      #ifndef WIN32
+         mutable pthread_rwlock_t m_Lock;
+      #else
+         mutable pthread_mutex_t m_Lock;
+      #endif
+
+      char m_pPadding[64];              // keep the locks of neighbouring shards on different cache lines
+   };
+
+   static const int m_iShardBits = 5;
+   static const int m_iShards = 1 << m_iShardBits;
+   static const int m_iMinCapacity = 16;
+
+   CShard m_pShards[m_iShards];
+
+private:
+   static uint64_t hash(const K& key)
+   {
+      // Fibonacci hashing: the high bits select the shard, the bits below them the slot
+      return (uint64_t)(int64_t)key * 0x9E3779B97F4A7C15ULL;
+   }
+
+   static int slot(const uint64_t& h, const int& mask)
+   {
+      return (int)(h >> 24) & mask;
+   }
+
+   static void readLock(const CShard& shard)
+   {
+      #ifndef WIN32
+         pthread_rwlock_rdlock(&shard.m_Lock);
+      #else
+         CGuard::enterCS(shard.m_Lock);
+      #endif
+   }
+
+   static void writeLock(CShard& shard)
+   {
+      #ifndef WIN32
+         pthread_rwlock_wrlock(&shard.m_Lock);
+      #else
+         CGuard::enterCS(shard.m_Lock);
+      #endif
+   }
+
+   static void unlock(const CShard& shard)
+   {
+      #ifndef WIN32
+         pthread_rwlock_unlock(&shard.m_Lock);
+      #else
+         CGuard::leaveCS(shard.m_Lock);
+      #endif
+   }
+
+   // Re-hash a shard into a table large enough for twice its live entries, dropping the DELETED slots.
+   static void rebuild(CShard& shard)
+   {
+      int capacity = m_iMinCapacity;
+      while (capacity < (shard.m_iSize + 1) * 2)
+         capacity <<= 1;
+
+      CEntry* entries = new CEntry[capacity];
+      for (int i = 0; i < capacity; ++ i)
+         entries[i].m_iState = EMPTY;
+
+      const int mask = capacity - 1;
+      for (int i = 0; i < shard.m_iCapacity; ++ i)
+      {
+         if (FULL != shard.m_pEntries[i].m_iState)
+            continue;
+
+         int j = slot(hash(shard.m_pEntries[i].m_Key), mask);
+         while (EMPTY != entries[j].m_iState)
+            j = (j + 1) & mask;
+         entries[j] = shard.m_pEntries[i];
+      }
+
+      delete [] shard.m_pEntries;
+      shard.m_pEntries = entries;
+      shard.m_iCapacity = capacity;
+      shard.m_iUsed = shard.m_iSize;
+   }
+
+   bool remove(const K& key, const V* value)
+   {
+      const uint64_t h = hash(key);
+      CShard& shard = m_pShards[h >> (64 - m_iShardBits)];
+
+      writeLock(shard);
+
+      bool removed = false;
+      if (shard.m_iCapacity > 0)
+      {
+         const int mask = shard.m_iCapacity - 1;
+         for (int i = slot(h, mask); EMPTY != shard.m_pEntries[i].m_iState; i = (i + 1) & mask)
+         {
+            if ((FULL == shard.m_pEntries[i].m_iState) && (key == shard.m_pEntries[i].m_Key) && ((NULL == value) || (*value == shard.m_pEntries[i].m_Value)))
+            {
+               shard.m_pEntries[i].m_iState = DELETED;
+               -- shard.m_iSize;
+               removed = true;
+               if (NULL != value)
+                  break;
+            }
+         }
+
+         // an empty shard can be reset completely
+         if (0 == shard.m_iSize)
+         {
+            for (int i = 0; i < shard.m_iCapacity; ++ i)
+               shard.m_pEntries[i].m_iState = EMPTY;
+            shard.m_iUsed = 0;
+         }
+      }
+
+      unlock(shard);
+
+      return removed;
+   }
+
+private:
+   CHashTable(const CHashTable&);
+   CHashTable& operator=(const CHashTable&);
+};
+
+#endif
@@ -108,6 +108,19 @@ written by
 typedef SYSSOCKET UDPSOCKET;
 typedef int UDTSOCKET;
 
+// called when UDT no longer references a buffer passed to UDT::sendzc(). It runs on the UDT thread that processes
+// the ACKs of the UDP port, or in UDT::close() / the garbage collector if the socket is closed first, with no UDT
+// lock held. It must return quickly, as the packets of every socket on the port wait for it. It may free or reuse
+// the buffer and call non-blocking UDT functions; it must not close the socket or make a blocking send on it.
+typedef void (*UDTZCCALLBACK)(const char* buf, int len, void* param);
+
+// a span of received data lent out by UDT::recvpeek()
+struct UDTIOVEC
+{
+   const char* iov_base;
+   int iov_len;
+};
+
 ////////////////////////////////////////////////////////////////////////////////
 
 typedef std::set<UDTSOCKET> ud_set;
@@ -122,7 +135,9 @@ enum EPOLLOpt
    // so that if system values are used by mistake, they should have the same effect
    UDT_EPOLL_IN = 0x1,
    UDT_EPOLL_OUT = 0x4,
-   UDT_EPOLL_ERR = 0x8
+   UDT_EPOLL_ERR = 0x8,
+   // report a UDT socket once each time it becomes ready, instead of on every wait while it stays ready
+   UDT_EPOLL_ET = 0x80000000
 };
 
 enum UDTSTATUS {INIT = 1, OPENED, LISTENING, CONNECTING, CONNECTED, BROKEN, CLOSING, CLOSED, NONEXIST};
@@ -151,7 +166,13 @@ enum UDTOpt
    UDT_STATE,		// current socket state, see UDTSTATUS, read only
    UDT_EVENT,		// current avalable events associated with the socket
    UDT_SNDDATA,		// size of data in the sending buffer
-   UDT_RCVDATA		// size of data available for recv
+   UDT_RCVDATA,		// size of data available for recv
+   UDT_GSO,		// use UDP segmentation offload for sending, if the kernel supports it
+   UDT_GRO,		// use UDP receive offload, if the kernel supports it
+   UDT_RCVWORKERS,	// number of threads processing received packets on the UDP port
+   UDT_SNDWORKERS,	// number of threads sending data packets on the UDP port
+   UDT_SNDCPU,		// CPU the first sending thread is pinned to, -1 for no pinning
+   UDT_MEMBUDGET	// process-wide limit (bytes) on packet memory beyond the initial buffers, 0 for no limit
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -309,6 +330,7 @@ UDT_API int bind(UDTSOCKET u, const struct sockaddr* name, int namelen);
 UDT_API int bind(UDTSOCKET u, UDPSOCKET udpsock);
 UDT_API int listen(UDTSOCKET u, int backlog);
 UDT_API UDTSOCKET accept(UDTSOCKET u, struct sockaddr* addr, int* addrlen);
+UDT_API int acceptBatch(UDTSOCKET u, UDTSOCKET* socks, int size);
 UDT_API int connect(UDTSOCKET u, const struct sockaddr* name, int namelen);
 UDT_API int close(UDTSOCKET u);
 UDT_API int getpeername(UDTSOCKET u, struct sockaddr* name, int* namelen);
@@ -318,9 +340,16 @@ UDT_API int setsockopt(UDTSOCKET u, int level, SOCKOPT optname, const void* optv
 UDT_API int send(UDTSOCKET u, const char* buf, int len, int flags);
 UDT_API int recv(UDTSOCKET u, char* buf, int len, int flags);
 UDT_API int sendmsg(UDTSOCKET u, const char* buf, int len, int ttl = -1, bool inorder = false);
+UDT_API int sendzc(UDTSOCKET u, const char* buf, int len, UDTZCCALLBACK release, void* param = NULL);
 UDT_API int recvmsg(UDTSOCKET u, char* buf, int len);
+UDT_API int recvpeek(UDTSOCKET u, UDTIOVEC* iov, int iovcnt);
+UDT_API int recvconsume(UDTSOCKET u, int len);
 UDT_API int64_t sendfile(UDTSOCKET u, std::fstream& ifs, int64_t& offset, int64_t size, int block = 364000);
 UDT_API int64_t recvfile(UDTSOCKET u, std::fstream& ofs, int64_t& offset, int64_t size, int block = 7280000);
+#ifndef WIN32
+UDT_API int64_t sendfile(UDTSOCKET u, int fd, int64_t& offset, int64_t size, int block = 364000);
+UDT_API int64_t recvfile(UDTSOCKET u, int fd, int64_t& offset, int64_t size, int block = 7280000);
+#endif
 UDT_API int select(int nfds, UDSET* readfds, UDSET* writefds, UDSET* exceptfds, const struct timeval* timeout);
 UDT_API int selectEx(const std::vector<UDTSOCKET>& fds, std::vector<UDTSOCKET>* readfds, std::vector<UDTSOCKET>* writefds, std::vector<UDTSOCKET>* exceptfds, int64_t msTimeOut);
 UDT_API int epoll_create();
@@ -329,6 +358,7 @@ UDT_API int epoll_add_ssock(const int eid, const SYSSOCKET s, const int* events
 UDT_API int epoll_remove_usock(const int eid, const UDTSOCKET u);
 UDT_API int epoll_remove_ssock(const int eid, const SYSSOCKET s);
 UDT_API int epoll_wait(const int eid, std::set<UDTSOCKET>* readfds, std::set<UDTSOCKET>* writefds, int64_t msTimeOut, std::set<SYSSOCKET>* lrfds = NULL, std::set<SYSSOCKET>* wrfds = NULL);
+UDT_API int epoll_wait2(const int eid, UDTSOCKET* readfds, int* rnum, UDTSOCKET* writefds, int* wnum, int64_t msTimeOut, SYSSOCKET* lrfds = NULL, int* lrnum = NULL, SYSSOCKET* lwfds = NULL, int* lwnum = NULL);
 UDT_API int epoll_release(const int eid);
 UDT_API ERRORINFO& getlasterror();
 UDT_API int perfmon(UDTSOCKET u, TRACEINFO* perf, bool clear = true);
@@ -252,12 +252,15 @@ void CPktTimeWindow::onPktSent(const int& currtime)
    m_iLastSentTime = currtime;
 }
 
-void CPktTimeWindow::onPktArrival()
+void CPktTimeWindow::onPktArrival(const uint64_t& arrtime)
 {
-   m_CurrArrTime = CTimer::getTime();
+   m_CurrArrTime = arrtime;
 
    // record the packet interval between the current and the last one
-   *(m_piPktWindow + m_iPktWindowPtr) = int(m_CurrArrTime - m_LastArrTime);
+   // packets delivered together (e.g., segmented or coalesced by the kernel) have no measurable spacing,
+   // record the timer resolution instead so that the median filter still works
+   int interval = int(m_CurrArrTime - m_LastArrTime);
+   *(m_piPktWindow + m_iPktWindowPtr) = (interval > 0) ? interval : 1;
 
    // the window is logically circular
    ++ m_iPktWindowPtr;
@@ -268,17 +271,18 @@ void CPktTimeWindow::onPktArrival()
    m_LastArrTime = m_CurrArrTime;
 }
 
-void CPktTimeWindow::probe1Arrival()
+void CPktTimeWindow::probe1Arrival(const uint64_t& arrtime)
 {
-   m_ProbeTime = CTimer::getTime();
+   m_ProbeTime = arrtime;
 }
 
-void CPktTimeWindow::probe2Arrival()
+void CPktTimeWindow::probe2Arrival(const uint64_t& arrtime)
 {
-   m_CurrArrTime = CTimer::getTime();
+   m_CurrArrTime = arrtime;
 
-   // record the probing packets interval
-   *(m_piProbeWindow + m_iProbeWindowPtr) = int(m_CurrArrTime - m_ProbeTime);
+   // record the probing packets interval, at least the timer resolution (see onPktArrival)
+   int interval = int(m_CurrArrTime - m_ProbeTime);
+   *(m_piProbeWindow + m_iProbeWindowPtr) = (interval > 0) ? interval : 1;
    // the window is logically circular
    ++ m_iProbeWindowPtr;
    if (m_iProbeWindowPtr == m_iPWSize)